@@ -0,0 +1,43 @@
+package require tkpath 0.3.0
+
+# Times hit tests against a ppolygon with many vertices.
+# Build with and without -DPATH_NO_SIMD to compare the edge loops.
+# With this many vertices find closest searches an edge tree and
+# hardly runs those loops, so with -DPATH_BENCHMARK they are also timed
+# by themselves.
+
+set t .c_bigpolygon
+toplevel $t
+set w $t.c
+pack [tkp::canvas $w -width 400 -height 400 -bg white]
+pack [label $t.l -justify left -anchor w] -fill x
+
+set num 200000
+set coords {}
+for {set i 0} {$i < $num} {incr i} {
+    set phi [expr {2*3.14159265358979*$i/$num}]
+    set r [expr {150 + 20*sin(40*$phi)}]
+    lappend coords [expr {200 + $r*cos($phi)}] [expr {200 + $r*sin($phi)}]
+}
+set id [$w create ppolygon $coords -stroke "#2a6" -fill "#cfe"]
+update idletasks
+
+set n 20
+set tclosest [lindex [time {$w find closest 20 20} $n] 0]
+set tinside [lindex [time {$w find closest 200 200} $n] 0]
+set toverlap [lindex [time {$w find overlapping 40 40 60 60} $n] 0]
+
+set msg "$num vertices\n"
+append msg "find closest (outside):  [expr {$tclosest/1000.0}] ms\n"
+append msg "find closest (inside):   [expr {$tinside/1000.0}] ms\n"
+append msg "find overlapping:        [expr {$toverlap/1000.0}] ms"
+if {[llength [info commands ::tkp::bench]]} {
+    set kclosest [lindex [tkp::bench polygontopoint $coords 20 20 $n] 0]
+    set kinside [lindex [tkp::bench polygontopoint $coords 200 200 $n] 0]
+    set karea [lindex [tkp::bench polylinetoarea $coords 40 40 60 60 $n] 0]
+    append msg "\nPathPolygonToPointEx (outside): [expr {$kclosest/1000.0}] ms\n"
+    append msg "PathPolygonToPointEx (inside):  [expr {$kinside/1000.0}] ms\n"
+    append msg "PathPolyLineToArea:             [expr {$karea/1000.0}] ms"
+}
+$t.l configure -text $msg
+puts $msg
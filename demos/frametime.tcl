@@ -0,0 +1,45 @@
+package require tkpath 0.3.0
+
+# Times full redisplays of a canvas with many small path items.
+# Runs the same on builds from before and after the drawing context
+# was shared across items, so the two can be compared.
+
+set t .c_frametime
+toplevel $t
+set w $t.c
+pack [tkp::canvas $w -width 600 -height 400 -bg white]
+pack [label $t.l -justify left -anchor w] -fill x
+
+set num 5000
+expr {srand(1)}
+for {set i 0} {$i < $num} {incr i} {
+    set x [expr {600*rand()}]
+    set y [expr {400*rand()}]
+    switch -- [expr {$i % 3}] {
+        0 {
+            $w create prect $x $y [expr {$x+12}] [expr {$y+8}] \
+                -fill "#8ac" -stroke "#246"
+        }
+        1 {
+            $w create circle $x $y -r 5 -fill "#ca8" -stroke "#642"
+        }
+        2 {
+            $w create path "M $x $y l 10 4 l -4 6 z" -fill "#8c8" \
+                -stroke "#262"
+        }
+    }
+}
+raise $t
+update
+
+# Configuring the canvas asks for the whole window to be redrawn.
+set n 50
+set tframe [lindex [time {
+    $w configure -bg white
+    update idletasks
+} $n] 0]
+
+set msg "$num items\n"
+append msg "full redisplay: [expr {$tframe/1000.0}] ms"
+$t.l configure -text $msg
+puts $msg
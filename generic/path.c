@@ -29,6 +29,10 @@ Tcl_Interp *gInterp = NULL;
 extern int 	PixelAlignObjCmd(ClientData clientData, Tcl_Interp* interp,
                     int objc, Tcl_Obj* CONST objv[]);
 extern int	SurfaceInit(Tcl_Interp *interp);
+#ifdef PATH_BENCHMARK
+extern int	PathBenchObjCmd(ClientData clientData, Tcl_Interp* interp,
+                    int objc, Tcl_Obj* CONST objv[]);
+#endif
 
 
 #ifdef _WIN32
@@ -114,6 +118,10 @@ int Tkpath_Init(Tcl_Interp *interp)		/* Tcl interpreter. */
     }    
     Tcl_CreateObjCommand(interp, "::tkp::pixelalign",
             PixelAlignObjCmd, (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+#ifdef PATH_BENCHMARK
+    Tcl_CreateObjCommand(interp, "::tkp::bench",
+            PathBenchObjCmd, (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+#endif
 
     /*
      * Make separate gradient objects, similar to SVG.
@@ -21,36 +21,35 @@
 static const double zero = 0.0; // just for NaN
 #define NaN (zero/zero)
 
-PathAtom *
-MakePathAtomsFromArrow(ArrowDescr *arrowDescr)
+void
+MakePathAtomsFromArrow(ArrowDescr *arrowDescr, PathPacked *atomPtr)
 {
     PathPoint *coords = arrowDescr->arrowPointsPtr;
-    PathAtom *atomPtr = NULL, *ret = NULL;
     if (coords)
     {
         int i = 0;
         if (isnan(coords[0].x) || isnan(coords[0].y)) {
             i = 1;
         }
-        ret = atomPtr = NewMoveToAtom(coords[i].x, coords[i].y);
+        AddMoveToAtom(atomPtr, coords[i].x, coords[i].y);
         for (i++ ; i < DRAWABLE_PTS_IN_ARROW; i++) {
             if (isnan(coords[i].x) || isnan(coords[i].y))
                 continue;
-            atomPtr->nextPtr = NewLineToAtom(coords[i].x, coords[i].y);
-            atomPtr = atomPtr->nextPtr;
+            AddLineToAtom(atomPtr, coords[i].x, coords[i].y);
         }
     }
-    return ret;
 }
 
 void
-DisplayArrow(Tk_PathCanvas canvas, Drawable drawable, ArrowDescr *arrowDescr,
+DisplayArrow(Tk_PathCanvas canvas, TkPathContext ctx, ArrowDescr *arrowDescr,
         Tk_PathStyle *const style, TMatrix *mPtr, PathRect *bboxPtr)
 {
     if (arrowDescr->arrowEnabled && arrowDescr->arrowPointsPtr != NULL) {
         Tk_PathStyle arrowStyle = *style;
         TkPathColor fc;
-        PathAtom *atomPtr;
+        PathPacked atoms;
+        unsigned char types[DRAWABLE_PTS_IN_ARROW];
+        double coords[2*DRAWABLE_PTS_IN_ARROW];
 
         if (arrowDescr->arrowFillRatio > 0.0 && arrowDescr->arrowLength != 0.0) {
             // Hack for good arrowheads on linux: draw contour with stroke width=0.1, opacity=0.0 for filled arrowheads instead of stroke width=0.0
@@ -66,9 +65,11 @@ DisplayArrow(Tk_PathCanvas canvas, Drawable drawable, ArrowDescr *arrowDescr,
             arrowStyle.joinStyle = 1;
             arrowStyle.dashPtr = NULL;
         }
-        atomPtr = MakePathAtomsFromArrow(arrowDescr);
-        TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr, &arrowStyle, mPtr, bboxPtr);
-        TkPathFreeAtoms(atomPtr);
+        PathPackedInitStatic(&atoms, types, DRAWABLE_PTS_IN_ARROW,
+                coords, 2*DRAWABLE_PTS_IN_ARROW);
+        MakePathAtomsFromArrow(arrowDescr, &atoms);
+        TkPathDrawPathInContext(ctx, &atoms, &arrowStyle, mPtr, bboxPtr, NULL);
+        TkPathFreeAtoms(&atoms);
     }
 }
 
@@ -230,21 +231,44 @@ void TkPathFreeArrow(ArrowDescr *arrowDescr)
 typedef PathPoint *PathPointPtr;
 
 int
-getSegmentsFromPathAtomList(PathAtom *firstAtom,
+getSegmentsFromPathAtomList(PathPacked *atomPtr,
         PathPoint **firstPt, PathPoint *secondPt,
         PathPoint *penultPt, PathPoint **lastPt)
 {
-    PathAtom *atom;
-    int i;
+    PathAtomIter iter;
+    double *atom;
+    int i, type;
 
     *firstPt = *lastPt = NULL;
     secondPt->x = secondPt->y = penultPt->x = penultPt->y = NaN;
 
-    if (firstAtom && firstAtom->type != PATH_ATOM_M) {
+    /*
+     * The points of a packed polyline are all in a row, so there is no
+     * need to walk them. This keeps appending to long lines cheap.
+     */
+    if (atomPtr->flags & PATH_PACKED_POLY) {
+        double *coords = atomPtr->coords;
+        int n = atomPtr->numCoords;
+
+        if (atomPtr->numAtoms < 2) {
+            return TCL_ERROR;
+        }
+        *firstPt = (PathPointPtr) coords;
+        secondPt->x = coords[2];
+        secondPt->y = coords[3];
+        penultPt->x = coords[n-4];
+        penultPt->y = coords[n-3];
+        *lastPt = (PathPointPtr) (coords + n - 2);
+        return TCL_OK;
+    }
+
+    PathAtomIterInit(&iter, atomPtr);
+    if (PathAtomIterMore(&iter) && (PathAtomIterNext(&iter, &atom) != PATH_ATOM_M)) {
         Tcl_Panic("Invalid path! Path must start with M(move) atom");
     }
-    for (i = 0, atom = firstAtom; atom; atom = atom->nextPtr) {
-        switch (atom->type) {
+    PathAtomIterInit(&iter, atomPtr);
+    for (i = 0; (type = PathAtomIterNext(&iter, &atom)) != 0; ) {
+        switch (type) {
             case PATH_ATOM_M:
             {
                 MoveToAtom *moveto = (MoveToAtom *)atom;
@@ -295,7 +319,7 @@ getSegmentsFromPathAtomList(PathAtom *firstAtom,
                         startPt.x, startPt.y,
                         arc->x, arc->y, arc->radX, arc->radY,
                         phi,
-                        arc->largeArcFlag, arc->sweepFlag,
+                        (char) arc->largeArcFlag, (char) arc->sweepFlag,
                         &cx, &cy, &rx, &ry,
                         &theta1, &dtheta);
                 if (result == kPathArcOK) {
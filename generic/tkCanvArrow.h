@@ -59,13 +59,13 @@ void TkPathScaleArrow(ArrowDescr *arrowDescr, double originX, double originY, do
 
 void TkPathFreeArrow(ArrowDescr *arrowDescr);
 
-int getSegmentsFromPathAtomList(PathAtom *firstAtom,
+int getSegmentsFromPathAtomList(PathPacked *atomPtr,
         PathPoint **firstPt, PathPoint *secondPt,
         PathPoint *penultPt, PathPoint **lastPt);
 
-PathAtom * MakePathAtomsFromArrow(ArrowDescr *arrowDescr);
+void MakePathAtomsFromArrow(ArrowDescr *arrowDescr, PathPacked *atomPtr);
 
-void DisplayArrow(Tk_PathCanvas canvas, Drawable drawable, ArrowDescr *arrowDescr,
+void DisplayArrow(Tk_PathCanvas canvas, TkPathContext ctx, ArrowDescr *arrowDescr,
         Tk_PathStyle *const style, TMatrix *mPtr, PathRect *bboxPtr);
 
 #define PATH_OPTION_SPEC_ARROWLENGTH_DEFAULT  "10.0"
@@ -54,7 +54,7 @@ static int	CreateEllipse(Tcl_Interp *interp,
 static void	DeleteEllipse(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display);
 static void	DisplayEllipse(Tk_PathCanvas canvas,
-		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+		    Tk_PathItem *itemPtr, TkPathContext ctx,
 		    int x, int y, int width, int height);
 static void	EllipseBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 		    int mask);
@@ -138,7 +138,7 @@ Tk_PathItemType tkCircleType = {
     ConfigureEllipse,			/* configureProc */
     EllipseCoords,			/* coordProc */
     DeleteEllipse,			/* deleteProc */
-    DisplayEllipse,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     EllipseBbox,			/* bboxProc */
     EllipseToPoint,			/* pointProc */
@@ -152,6 +152,7 @@ Tk_PathItemType tkCircleType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayEllipse,			/* displayContextProc */
 };
 
 Tk_PathItemType tkEllipseType = {
@@ -162,7 +163,7 @@ Tk_PathItemType tkEllipseType = {
     ConfigureEllipse,			/* configureProc */
     EllipseCoords,			/* coordProc */
     DeleteEllipse,			/* deleteProc */
-    DisplayEllipse,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     EllipseBbox,			/* bboxProc */
     EllipseToPoint,			/* pointProc */
@@ -176,6 +177,7 @@ Tk_PathItemType tkEllipseType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayEllipse,			/* displayContextProc */
 };
                         
 static int		
@@ -215,6 +217,7 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
     ellPtr->type = type;
 
     if (ellPtr->type == kOvalTypeCircle) {
@@ -291,6 +294,9 @@ ComputeEllipseBbox(Tk_PathCanvas canvas, EllipseItem *ellPtr)
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
     PathRect totalBbox, bbox;
+    PathPacked atoms;
+    unsigned char type;
+    EllipseAtom ellAtom;
 
     if(state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
@@ -305,7 +311,11 @@ ComputeEllipseBbox(Tk_PathCanvas canvas, EllipseItem *ellPtr)
     totalBbox = GetGenericPathTotalBboxFromBare(NULL, &style, &bbox);
     itemPtr->bbox = bbox;
     itemPtr->totalBbox = totalBbox;
-    SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr, &totalBbox);
+    PathPackedInitStatic(&atoms, &type, 1, (double *) &ellAtom, 4);
+    AddEllipseAtom(&atoms, ellPtr->center[0], ellPtr->center[1], 
+            ellPtr->rx, ellPtr->ry);
+    SetGenericPathHeaderBboxFromAtoms(&itemExPtr->header, style.matrixPtr, 
+            &atoms, NULL, &bbox, &totalBbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -396,13 +406,14 @@ DeleteEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
 }
 
 static void		
-DisplayEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+DisplayEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
         int x, int y, int width, int height)
 {
     EllipseItem *ellPtr = (EllipseItem *) itemPtr;
     TMatrix m = GetCanvasTMatrix(canvas);
     PathRect bbox;
-    PathAtom *atomPtr;
+    PathPacked atoms;
+    unsigned char type;
     EllipseAtom ellAtom;
     Tk_PathStyle style;    
     
@@ -413,17 +424,14 @@ DisplayEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Dra
     /* 
      * We create the atom on the fly to save some memory.
      */    
-    atomPtr = (PathAtom *)&ellAtom;
-    atomPtr->nextPtr = NULL;
-    atomPtr->type = PATH_ATOM_ELLIPSE;
-    ellAtom.cx = ellPtr->center[0];
-    ellAtom.cy = ellPtr->center[1];
-    ellAtom.rx = ellPtr->rx;
-    ellAtom.ry = ellPtr->ry;
+    PathPackedInitStatic(&atoms, &type, 1, (double *) &ellAtom, 4);
+    AddEllipseAtom(&atoms, ellPtr->center[0], ellPtr->center[1], 
+            ellPtr->rx, ellPtr->ry);
     
     bbox = GetBareBbox(ellPtr);
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr, &style, &m, &bbox);
+    TkPathDrawPathInContext(ctx, &atoms, &style, &m, &bbox,
+	    &itemPtr->pathCache);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -490,21 +498,18 @@ EllipseToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
         if (rectiLinear) {
             dist = TkOvalToPoint(bareOval, width, filled, pointPtr);
         } else {
-            PathAtom *atomPtr;
+            PathPacked atoms;
+            unsigned char type;
             EllipseAtom ellAtom;
         
             /* 
             * We create the atom on the fly to save some memory.
             */    
-            atomPtr = (PathAtom *)&ellAtom;
-            atomPtr->nextPtr = NULL;
-            atomPtr->type = PATH_ATOM_ELLIPSE;
-            ellAtom.cx = ellPtr->center[0];
-            ellAtom.cy = ellPtr->center[1];
-            ellAtom.rx = ellPtr->rx;
-            ellAtom.ry = ellPtr->ry;
-            dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr, 
-                    kPathNumSegmentsEllipse+1, pointPtr);
+            PathPackedInitStatic(&atoms, &type, 1, (double *) &ellAtom, 4);
+            AddEllipseAtom(&atoms, ellPtr->center[0], ellPtr->center[1], 
+                    ellPtr->rx, ellPtr->ry);
+            dist = GenericPathToPoint(canvas, itemPtr, &style, &atoms, 
+                    pointPtr);
         }
     }
     TkPathCanvasFreeInheritedStyle(&style);
@@ -586,21 +591,18 @@ EllipseToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
             }
         }
     } else {
-        PathAtom *atomPtr;
+        PathPacked atoms;
+        unsigned char type;
         EllipseAtom ellAtom;
     
         /* 
          * We create the atom on the fly to save some memory.
          */    
-        atomPtr = (PathAtom *)&ellAtom;
-        atomPtr->nextPtr = NULL;
-        atomPtr->type = PATH_ATOM_ELLIPSE;
-        ellAtom.cx = ellPtr->center[0];
-        ellAtom.cy = ellPtr->center[1];
-        ellAtom.rx = ellPtr->rx;
-        ellAtom.ry = ellPtr->ry;
-        result = GenericPathToArea(canvas, itemPtr, &style, atomPtr, 
-                kPathNumSegmentsEllipse+1, areaPtr);
+        PathPackedInitStatic(&atoms, &type, 1, (double *) &ellAtom, 4);
+        AddEllipseAtom(&atoms, ellPtr->center[0], ellPtr->center[1], 
+                ellPtr->rx, ellPtr->ry);
+        result = GenericPathToArea(canvas, itemPtr, &style, &atoms, 
+                areaPtr);
     }
     TkPathCanvasFreeInheritedStyle(&style);
     return result;
@@ -52,7 +52,7 @@ static int	CreateGroup(Tcl_Interp *interp,
 static void	DeleteGroup(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display);
 static void	DisplayGroup(Tk_PathCanvas canvas,
-		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+		    Tk_PathItem *itemPtr, TkPathContext ctx,
 		    int x, int y, int width, int height);
 static void	GroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int flags);
 static int	GroupCoords(Tcl_Interp *interp,
@@ -101,7 +101,7 @@ Tk_PathItemType tkGroupType = {
     ConfigureGroup,			/* configureProc */
     GroupCoords,			/* coordProc */
     DeleteGroup,			/* deleteProc */
-    DisplayGroup,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     GroupBbox,				/* bboxProc */
     GroupToPoint,			/* pointProc */
@@ -115,6 +115,7 @@ Tk_PathItemType tkGroupType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayGroup,			/* displayContextProc */
 };
 
 
@@ -135,6 +136,7 @@ CreateGroup(Tcl_Interp *interp,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
     groupPtr->totalBbox = NewEmptyPathRect();
     groupPtr->flags = 0L;
     itemExPtr->header.x1 = itemExPtr->header.x2 =
@@ -264,7 +266,7 @@ DeleteGroup(Tk_PathCanvas canvas,
 
 static void	
 DisplayGroup(Tk_PathCanvas canvas,
-    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+    Tk_PathItem *itemPtr, TkPathContext ctx,
     int x, int y, int width, int height)
 {
     /* Empty. */
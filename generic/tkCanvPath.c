@@ -35,9 +35,7 @@ typedef struct PathItem  {
     Tcl_Obj *pathObjPtr;    /* The object containing the path definition. */
     int pathLen;
     Tcl_Obj *normPathObjPtr;/* The object containing the normalized path. */
-    PathAtom *atomPtr;
-    int maxNumSegments;     /* Max number of straight segments (for subpath)
-                             * needed for Area and Point functions. */
+    PathPacked atoms;       /* The parsed path. */
     ArrowDescr startarrow;
     ArrowDescr endarrow;
     long flags;             /* Various flags, see enum. */
@@ -64,7 +62,7 @@ static int	PathCoords(Tcl_Interp *interp,
 static void	DeletePath(Tk_PathCanvas canvas,
                         Tk_PathItem *itemPtr, Display *display);
 static void	DisplayPath(Tk_PathCanvas canvas,
-                        Tk_PathItem *itemPtr, Display *display, Drawable dst,
+                        Tk_PathItem *itemPtr, TkPathContext ctx,
                         int x, int y, int width, int height);
 static void	PathBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 		    int mask);
@@ -81,10 +79,6 @@ static void	TranslatePath(Tk_PathCanvas canvas,
                         Tk_PathItem *itemPtr, double deltaX, double deltaY);
 static int      ConfigureArrows(Tk_PathCanvas canvas, PathItem *pathPtr);
 
-/* Support functions. */
-
-static int		GetSubpathMaxNumSegments(PathAtom *atomPtr);
-
 
 PATH_STYLE_CUSTOM_OPTION_RECORDS
 PATH_CUSTOM_OPTION_TAGS
@@ -118,7 +112,7 @@ Tk_PathItemType tkPathType = {
     ConfigurePath,		/* configureProc */
     PathCoords,			/* coordProc */
     DeletePath,			/* deleteProc */
-    DisplayPath,		/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,                          /* flags */
     PathBbox,                   /* bboxProc */
     PathToPoint,		/* pointProc */
@@ -132,6 +126,7 @@ Tk_PathItemType tkPathType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPath,		/* displayContextProc */
 };
 
 void
@@ -213,13 +208,13 @@ CreatePath(
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
     pathPtr->pathObjPtr = NULL;
     pathPtr->pathLen = 0;
     pathPtr->normPathObjPtr = NULL;
-    pathPtr->atomPtr = NULL;
+    PathPackedInit(&pathPtr->atoms);
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
-    pathPtr->maxNumSegments = 0;
     TkPathArrowDescrInit(&pathPtr->startarrow);
     TkPathArrowDescrInit(&pathPtr->endarrow);
     pathPtr->flags = 0L;
@@ -286,7 +281,7 @@ ProcessPath(
     Tcl_Obj *CONST objv[])  /*  */
 {
     PathItem *pathPtr = (PathItem *) itemPtr;
-    PathAtom *atomPtr = NULL;
+    PathPacked atoms;
     int result, len;
     
     if (objc == 0) {
@@ -298,27 +293,24 @@ ProcessPath(
             if (pathPtr->normPathObjPtr != NULL) {
                 Tcl_DecrRefCount(pathPtr->normPathObjPtr);
             }
-            TkPathNormalize(interp, pathPtr->atomPtr, &(pathPtr->normPathObjPtr));
+            TkPathNormalize(interp, &pathPtr->atoms, &(pathPtr->normPathObjPtr));
             Tcl_IncrRefCount(pathPtr->normPathObjPtr);
             pathPtr->flags &= ~kPathItemNeedNewNormalizedPath;
         }
         Tcl_SetObjResult(interp, pathPtr->normPathObjPtr);
         return TCL_OK;
     } else if (objc == 1) {
-        result = TkPathParseToAtoms(interp, objv[0], &atomPtr, &len);
+        result = TkPathParseToAtoms(interp, objv[0], &atoms, &len);
         if (result == TCL_OK) {
         
             /* Free any old atoms. */
-            if (pathPtr->atomPtr != NULL) {
-                TkPathFreeAtoms(pathPtr->atomPtr);
-            }
-            pathPtr->atomPtr = atomPtr;
+            TkPathFreeAtoms(&pathPtr->atoms);
+            pathPtr->atoms = atoms;
             pathPtr->pathLen = len;
             if (pathPtr->pathObjPtr != NULL) {
 		Tcl_DecrRefCount(pathPtr->pathObjPtr);
 	    }
             pathPtr->pathObjPtr = objv[0];
-            pathPtr->maxNumSegments = GetSubpathMaxNumSegments(atomPtr);
             Tcl_IncrRefCount(pathPtr->pathObjPtr);
         }
         return result;
@@ -394,6 +386,7 @@ ComputePathBbox(
     Tk_PathItem *itemPtr = &itemExPtr->header;
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
+    PathRect arrowBbox;
 
     if(state == TK_PATHSTATE_NULL) {
         state = TkPathCanvasState(canvas);
@@ -409,12 +402,18 @@ ComputePathBbox(
      * Get an approximation of the path's bounding box
      * assuming zero stroke width.
      */
-    itemPtr->bbox = GetGenericBarePathBbox(pathPtr->atomPtr);
-    IncludeArrowPointsInRect(&itemPtr->bbox, &pathPtr->startarrow);
-    IncludeArrowPointsInRect(&itemPtr->bbox, &pathPtr->endarrow);
-    itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(pathPtr->atomPtr,
+    itemPtr->bbox = GetGenericBarePathBbox(&pathPtr->atoms);
+    arrowBbox = NewEmptyPathRect();
+    IncludeArrowPointsInRect(&arrowBbox, &pathPtr->startarrow);
+    IncludeArrowPointsInRect(&arrowBbox, &pathPtr->endarrow);
+    if (!IsPathRectEmpty(&arrowBbox)) {
+        IncludePointInRect(&itemPtr->bbox, arrowBbox.x1, arrowBbox.y1);
+        IncludePointInRect(&itemPtr->bbox, arrowBbox.x2, arrowBbox.y2);
+    }
+    itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(&pathPtr->atoms,
             &style, &itemPtr->bbox);
-    SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr, &itemPtr->totalBbox);
+    SetGenericPathHeaderBboxFromAtoms(&itemExPtr->header, style.matrixPtr, 
+            &pathPtr->atoms, &arrowBbox, &itemPtr->bbox, &itemPtr->totalBbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -427,7 +426,7 @@ ConfigureArrows(
     PathPoint ppenult;
     PathPoint *plastp;
 
-    int error = getSegmentsFromPathAtomList(pathPtr->atomPtr, &pfirstp, &psecond, &ppenult, &plastp);
+    int error = getSegmentsFromPathAtomList(&pathPtr->atoms, &pfirstp, &psecond, &ppenult, &plastp);
 
     if (error == TCL_OK) {
         PathPoint pfirst = *pfirstp;
@@ -579,10 +578,7 @@ DeletePath(
     if (pathPtr->normPathObjPtr != NULL) {
         Tcl_DecrRefCount(pathPtr->normPathObjPtr);
     }
-    if (pathPtr->atomPtr != NULL) {
-        TkPathFreeAtoms(pathPtr->atomPtr);
-        pathPtr->atomPtr = NULL;
-    }
+    TkPathFreeAtoms(&pathPtr->atoms);
     TkPathFreeArrow(&pathPtr->startarrow);
     TkPathFreeArrow(&pathPtr->endarrow);
     Tk_FreeConfigOptions((char *) pathPtr, optionTable, Tk_PathCanvasTkwin(canvas));
@@ -594,13 +590,13 @@ DeletePath(
  * DisplayPath --
  *
  *	This procedure is invoked to draw a line item in a given
- *	drawable.
+ *	drawing context.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	ItemPtr is drawn in drawable using the transformation
+ *	ItemPtr is drawn in the context using the transformation
  *	information in canvas.
  *
  *--------------------------------------------------------------
@@ -610,9 +606,7 @@ static void
 DisplayPath(
     Tk_PathCanvas canvas,   /* Canvas that contains item. */
     Tk_PathItem *itemPtr,   /* Item to be displayed. */
-    Display *display,       /* Display on which to draw item. */
-    Drawable drawable,      /* Pixmap or window in which to draw
-                             * item. */
+    TkPathContext ctx,      /* Context in which to draw item. */
     int x, int y,           /* Describes region of canvas that */
     int width, int height)  /* must be redisplayed (not used). */
 {
@@ -626,13 +620,13 @@ DisplayPath(
     
     if (pathPtr->pathLen > 2) {
         style = TkPathCanvasInheritStyle(itemPtr, 0);
-        TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, pathPtr->atomPtr, 
-                &style, &m, &itemPtr->bbox);
+        TkPathDrawPathInContext(ctx, &pathPtr->atoms, &style, &m,
+                &itemPtr->bbox, &itemPtr->pathCache);
         /*
          * Display arrowheads, if they are wanted.
          */
-        DisplayArrow(canvas, drawable, &pathPtr->startarrow, &style, &m, &itemPtr->bbox);
-        DisplayArrow(canvas, drawable, &pathPtr->endarrow, &style, &m, &itemPtr->bbox);
+        DisplayArrow(canvas, ctx, &pathPtr->startarrow, &style, &m, &itemPtr->bbox);
+        DisplayArrow(canvas, ctx, &pathPtr->endarrow, &style, &m, &itemPtr->bbox);
 
         TkPathCanvasFreeInheritedStyle(&style);
     }
@@ -681,13 +675,12 @@ PathToPoint(
     double *pointPtr)		/* Pointer to x and y coordinates. */
 {
     PathItem        *pathPtr = (PathItem *) itemPtr;
-    PathAtom        *atomPtr = pathPtr->atomPtr;
+    PathPacked      *atomPtr = &pathPtr->atoms;
     Tk_PathStyle style;
     double dist;
 
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr, 
-            pathPtr->maxNumSegments, pointPtr);
+    dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr, pointPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return dist;
 }
@@ -752,119 +745,6 @@ TkLineToPoint2(
     }
 }
 
-/* 
- * Get maximum number of segments needed to describe path. 
- * Needed to see if we can use static space or need to allocate more.
- */
-
-static int
-GetArcNumSegments(double currentX, double currentY, ArcAtom *arc)
-{
-    int result;
-    int ntheta, nlength;
-    int numSteps;			/* Number of curve points to
-					 * generate.  */
-    double cx, cy, rx, ry;
-    double theta1, dtheta;
-
-    result = EndpointToCentralArcParameters(
-            currentX, currentY,
-            arc->x, arc->y, arc->radX, arc->radY, 
-            DEGREES_TO_RADIANS * arc->angle, 
-            arc->largeArcFlag, arc->sweepFlag,
-            &cx, &cy, &rx, &ry,
-            &theta1, &dtheta);
-    if (result == kPathArcLine) {
-        return 2;
-    } else if (result == kPathArcSkip) {
-        return 0;
-    }
-
-    /* Estimate the number of steps needed. 
-     * Max 10 degrees or length 50.
-     */
-    ntheta = (int) (dtheta/5.0 + 0.5);
-    nlength = (int) (0.5*(rx + ry)*dtheta/50 + 0.5);
-    numSteps = MAX(4, MAX(ntheta, nlength));;
-    return numSteps;
-}
-
-static int
-GetSubpathMaxNumSegments(PathAtom *atomPtr)
-{
-    int			num;
-    int 		maxNumSegments;
-    double 		currentX = 0.0, currentY = 0.0;
-    double 		startX = 0.0, startY = 0.0;
-    MoveToAtom 	*move;
-    LineToAtom 	*line;
-    ArcAtom 	*arc;
-    QuadBezierAtom *quad;
-    CurveToAtom *curve;
-    
-    num = 0;
-    maxNumSegments = 0;
-    
-    while (atomPtr != NULL) {
-    
-        switch (atomPtr->type) {
-            case PATH_ATOM_M: {
-                move = (MoveToAtom *) atomPtr;
-                num = 1;
-                currentX = move->x;
-                currentY = move->y;
-                startX = currentX;
-                startY = currentY;
-                break;
-            }
-            case PATH_ATOM_L: {
-                line = (LineToAtom *) atomPtr;
-                num++;
-                currentX = line->x;
-                currentY = line->y;
-                break;
-            }
-            case PATH_ATOM_A: {
-                arc = (ArcAtom *) atomPtr;
-                num += GetArcNumSegments(currentX, currentY, arc);
-                currentX = arc->x;
-                currentY = arc->y;
-                break;
-            }
-            case PATH_ATOM_Q: {
-                quad = (QuadBezierAtom *) atomPtr;
-                num += kPathNumSegmentsQuadBezier;
-                currentX = quad->anchorX;
-                currentY = quad->anchorY;
-                break;
-            }
-            case PATH_ATOM_C: {
-                curve = (CurveToAtom *) atomPtr;
-                num += kPathNumSegmentsCurveTo;
-                currentX = curve->anchorX;
-                currentY = curve->anchorY;
-                break;
-            }
-            case PATH_ATOM_Z: {
-                num++;
-                currentX = startX;
-                currentY = startY;
-                break;
-            }
-            case PATH_ATOM_ELLIPSE:
-            case PATH_ATOM_RECT: {
-                /* Empty. */
-                break;
-            }
-        }
-        if (num > maxNumSegments) {
-            maxNumSegments = num;
-        }
-        atomPtr = atomPtr->nextPtr;
-    }
-    return maxNumSegments;
-}
-
 /*
  *--------------------------------------------------------------
  *
@@ -902,7 +782,7 @@ PathToArea(
    
     style = TkPathCanvasInheritStyle(itemPtr, 0);
     area = GenericPathToArea(canvas, itemPtr, &style, 
-            pathPtr->atomPtr, pathPtr->maxNumSegments, areaPtr);
+            &pathPtr->atoms, areaPtr);
     TkPathCanvasFreeInheritedStyle(&style);            
     return area;
 }
@@ -936,7 +816,7 @@ ScalePath(
     double scaleY)                  /* Amount to scale in Y direction. */
 {
     PathItem *pathPtr = (PathItem *) itemPtr;
-    PathAtom *atomPtr = pathPtr->atomPtr;
+    PathPacked *atomPtr = &pathPtr->atoms;
     PathRect r;
     
     /* @@@ TODO: Arc atoms with nonzero rotation angle is WRONG! */
@@ -987,7 +867,7 @@ TranslatePath(
     double deltaY)              /* moved. */
 {
     PathItem *pathPtr = (PathItem *) itemPtr;
-    PathAtom *atomPtr = pathPtr->atomPtr;
+    PathPacked *atomPtr = &pathPtr->atoms;
     
     TranslatePathAtoms(atomPtr, deltaX, deltaY);
     
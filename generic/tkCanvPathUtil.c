@@ -16,6 +16,17 @@
 /* For debugging. */
 extern Tcl_Interp *gInterp;
 
+/*
+ * The edge loops of the hit tests do two edges at a time with SSE2
+ * where the compiler targets it, which all x86-64 processors have.
+ * Define PATH_NO_SIMD to get the plain loops only.
+ */
+#if !defined(PATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#   define PATH_SSE2 1
+#   include <emmintrin.h>
+#endif
+
 /*
  * For wider strokes we must make a more detailed analysis
  * when doing hit tests and area tests.
@@ -23,12 +34,71 @@ extern Tcl_Interp *gInterp;
 #define kPathStrokeThicknessLimit 	4.0
 
 #define MAX_NUM_STATIC_SEGMENTS  2000
-/* @@@ Should this be moved inside the function instead? */
-static double staticSpace[2*MAX_NUM_STATIC_SEGMENTS];
 
+/*
+ * The straight line segments of one subpath. Points that are made
+ * are put in 'space' which is the caller's static space until it
+ * runs out. It lives on the caller's stack so that paths can be
+ * flattened from more than one thread.
+ */
+
+typedef struct PathSegments {
+    double *polyPtr;		/* The points of the subpath. */
+    int numPoints;		/* Number of points in polyPtr. */
+    int numStrokes;		/* Equals numPoints if closed. */
+    double *space;		/* Storage for made points. */
+    int spaceUsed;		/* Number of points made in space. */
+    int spaceSize;		/* Number of points that fit in space. */
+    double *staticSpace;	/* Initial space, not to be freed. */
+} PathSegments;
 
-static void		MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr, 
-                        int *numPointsPtr, int *numStrokesPtr, TMatrix *matrixPtr);
+/*
+ * The flattened path of an item is kept in itemPtr->flatCache between
+ * hit tests. It has all subpaths in device coordinates and is only
+ * valid for the matrix and tolerance it was made with. It is a single
+ * block of memory which the canvas frees whenever the item changes.
+ */
+
+typedef struct PathFlatCache {
+    TMatrix matrix;		/* The matrix used, unit matrix if none. */
+    double tolerance;		/* The tolerance used. */
+    double *points;		/* Points of all subpaths. */
+    int *subPaths;		/* Offset into points, numPoints and
+				 * numStrokes for each subpath. */
+    int numSubPaths;
+} PathFlatCache;
+
+/*
+ * Subpaths with at least this many points get a tree of bounding boxes
+ * for hit tests, kept in itemPtr->edgeCache. The leaves are runs of
+ * kPathEdgeTreeLeafEdges consecutive edges, which are close together
+ * for any reasonable polygon, and node i has children 2i+1 and 2i+2.
+ */
+
+#define kPathEdgeTreeMinPoints	1024
+#define kPathEdgeTreeLeafEdges	16
+
+typedef struct PathEdgeTree {
+    struct PathEdgeTree *nextPtr;
+    double *polyPtr;		/* The points the tree was made for. */
+    int numPoints;
+    int numLeaves;		/* A power of two; leaves past the edges
+				 * have empty boxes. */
+    double *boxes;		/* x1, y1, x2, y2 for each node. */
+} PathEdgeTree;
+
+static void		MakeSubPathSegments(PathAtomIter *iterPtr, PathSegments *segPtr, 
+                        TMatrix *matrixPtr, double tolerance);
+static PathFlatCache *	GetFlatCache(Tk_PathItem *itemPtr, PathPacked *atomPtr,
+			    TMatrix *matrixPtr, double tolerance);
+static int		NextSubPathSegments(PathAtomIter *iterPtr, 
+			    PathFlatCache *flatPtr, int *indexPtr, 
+			    PathSegments *segPtr);
+static PathEdgeTree *	GetEdgeTree(Tk_PathItem *itemPtr, double *polyPtr,
+			    int numPoints);
+static double		EdgeTreeToPoint(PathEdgeTree *treePtr, double *pointPtr,
+			    int *intersectionsPtr, int *nonzerorulePtr);
+static double		TMatrixMaxScale(TMatrix *m);
 static int		SubPathToArea(Tk_PathStyle *stylePtr, double *polyPtr, int numPoints,
                         int	numStrokes,	double *rectPtr, int inside);
 
@@ -162,126 +232,325 @@ CoordsForRectangularItems(
 /*
  *--------------------------------------------------------------
  *
- * GetBareArcBbox
+ * GetPackedCoordsFormat --
+ *
+ *	Checks if objPtr is one of the flags "-packed" or
+ *	"-packedfloat" that announce a bytearray of native
+ *	coordinates. Objects without a string rep, typically big
+ *	lists and bytearrays, are never flags and are left alone.
+ *
+ * Results:
+ *	The size in bytes of each packed coordinate, or 0 if
+ *	objPtr isn't a flag.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+GetPackedCoordsFormat(Tcl_Obj *objPtr)
+{
+    if (objPtr->bytes == NULL || objPtr->bytes[0] != '-') {
+        return 0;
+    }
+    if (strcmp(objPtr->bytes, "-packed") == 0) {
+        return sizeof(double);
+    } else if (strcmp(objPtr->bytes, "-packedfloat") == 0) {
+        return sizeof(float);
+    }
+    return 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetPackedCoordsFromObj --
+ *
+ *	Gets the bytes of a bytearray of packed coordinates,
+ *	each of them size bytes long.
+ *
+ * Results:
+ *	Standard tcl result. The bytes and the number of
+ *	coordinates are returned in bytesPtr and numPtr.
+ *
+ * Side effects:
+ *	May convert objPtr to a bytearray.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+GetPackedCoordsFromObj(
+        Tcl_Interp *interp,
+        Tcl_Obj *objPtr,
+        int size,			/* sizeof(double) or sizeof(float). */
+        unsigned char **bytesPtr,
+        int *numPtr)
+{
+    int length;
+    
+    *bytesPtr = Tcl_GetByteArrayFromObj(objPtr, &length);
+    if (length % size != 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+                "packed coordinates must be a multiple of %d bytes, got %d",
+                size, length));
+        return TCL_ERROR;
+    }
+    *numPtr = length/size;
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CopyPackedCoords --
+ *
+ *	Copies num packed coordinates into coords. Doubles are
+ *	copied in one go, floats are widened one by one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills in coords.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+CopyPackedCoords(unsigned char *bytes, int size, int num, double *coords)
+{
+    if (size == sizeof(double)) {
+        memcpy(coords, bytes, num*sizeof(double));
+    } else {
+        float f;
+        int i;
+        
+        for (i = 0; i < num; i++, bytes += sizeof(float)) {
+            memcpy(&f, bytes, sizeof(float));
+            coords[i] = f;
+        }
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * NewPackedCoordsObj --
+ *
+ *	The reverse of CopyPackedCoords.
  *
- *	Gets an overestimate of the bounding box rectangle of
- * 	an arc defined using central parametrization assuming
- *	zero stroke width.
- * 	Untransformed coordinates!
+ * Results:
+ *	A new bytearray object holding num coordinates, each of
+ *	them size bytes long.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+Tcl_Obj *
+NewPackedCoordsObj(double *coords, int num, int size)
+{
+    Tcl_Obj *objPtr = Tcl_NewByteArrayObj(NULL, 0);
+    unsigned char *bytes = Tcl_SetByteArrayLength(objPtr, num*size);
+    
+    if (size == sizeof(double)) {
+        memcpy(bytes, coords, num*sizeof(double));
+    } else {
+        float f;
+        int i;
+        
+        for (i = 0; i < num; i++, bytes += sizeof(float)) {
+            f = (float) coords[i];
+            memcpy(bytes, &f, sizeof(float));
+        }
+    }
+    return objPtr;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * IncludeArcInRect
+ *
+ *	Includes the exact extent of an arc defined using central 
+ *	parametrization, assuming zero stroke width, in a rect.
+ *	The arc, optionally transformed by mPtr, is parametrized as
+ *	C + U cos(t) + V sin(t). Its x extremes are where
+ *	tan(t) = Vx/Ux and its y extremes where tan(t) = Vy/Uy, which
+ *	are included if inside the sweep together with the end points.
  *	Note: 1) all angles clockwise direction!
  *	      2) all angles in radians.
  *
  * Results:
- *	A PathRect.
+ *	None.
  *
  * Side effects:
- *	None.
+ *	The rect may be enlarged.
  *
  *--------------------------------------------------------------
  */
 
-static PathRect
-GetBareArcBbox(double cx, double cy, double rx, double ry,
+static void
+IncludeArcInRect(PathRect *r, TMatrix *mPtr, 
+        double cx, double cy, double rx, double ry,
         double theta1, double dtheta, double phi)
 {
-    PathRect r = {1.0e36, 1.0e36, -1.0e36, -1.0e36};	/* Empty rect. */
-    double start, extent, stop, stop2PI;
-    double cosStart, sinStart, cosStop, sinStop;
+    double u[2], v[2], c[2];
+    double cosPhi, sinPhi;
+    double start, extent, alpha, t;
+    double extremes[4];
+    int i;
     
-    /* Keep 0 <= start, extent < 2pi 
-     * and 0 <= stop < 4pi */
+    cosPhi = cos(phi);
+    sinPhi = sin(phi);
+    u[0] = rx*cosPhi;
+    u[1] = rx*sinPhi;
+    v[0] = -ry*sinPhi;
+    v[1] = ry*cosPhi;
+    c[0] = cx;
+    c[1] = cy;
+    if (mPtr != NULL) {
+        double x, y;
+        
+        x = u[0], y = u[1];
+        u[0] = x*mPtr->a + y*mPtr->c;
+        u[1] = x*mPtr->b + y*mPtr->d;
+        x = v[0], y = v[1];
+        v[0] = x*mPtr->a + y*mPtr->c;
+        v[1] = x*mPtr->b + y*mPtr->d;
+        PathApplyTMatrix(mPtr, c, c+1);
+    }
+
     if (dtheta >= 0.0) {
         start = theta1;
         extent = dtheta;
     } else {
         start = theta1 + dtheta;
-        extent = -1.0*dtheta;
-    }
-    if (start < 0.0) {
-        start += 2.0*M_PI;
-        if (start < 0.0) {
-            start += 2.0*M_PI;
+        extent = -dtheta;
+    }
+    IncludePointInRect(r, c[0] + u[0]*cos(start) + v[0]*sin(start),
+            c[1] + u[1]*cos(start) + v[1]*sin(start));
+    IncludePointInRect(r, c[0] + u[0]*cos(start+extent) + v[0]*sin(start+extent),
+            c[1] + u[1]*cos(start+extent) + v[1]*sin(start+extent));
+
+    extremes[0] = atan2(v[0], u[0]);
+    extremes[1] = extremes[0] + M_PI;
+    extremes[2] = atan2(v[1], u[1]);
+    extremes[3] = extremes[2] + M_PI;
+    for (i = 0; i < 4; i++) {
+        alpha = extremes[i];
+        
+        /* Angle from start of sweep in [0, 2pi). */
+        t = fmod(alpha - start, 2.0*M_PI);
+        if (t < 0.0) {
+            t += 2.0*M_PI;
+        }
+        if (t <= extent) {
+            IncludePointInRect(r, c[0] + u[0]*cos(alpha) + v[0]*sin(alpha),
+                    c[1] + u[1]*cos(alpha) + v[1]*sin(alpha));
         }
     }
-    if (start >= 2.0*M_PI) {
-        start -= 2.0*M_PI;
-    }
-    stop = start + extent;
-    stop2PI = stop - 2.0*M_PI;
-    cosStart = cos(start);
-    sinStart = sin(start);
-    cosStop = cos(stop);
-    sinStop = sin(stop);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * IncludeQuadBezierInRect, IncludeCurveInRect
+ *
+ *	Includes the exact extent of a quadratic or cubic Bezier in
+ *	a rect. The curve is evaluated where its derivative has a root
+ *	for t in (0,1) in x or y. The end points are not included.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The rect may be enlarged.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+IncludeQuadBezierInRect(PathRect *r, double control[])
+{
+    double denom, t, u;
+    int i;
     
-    /*
-     * Compute bbox for phi = 0.
-     * Put everything at (0,0) and shift to (cx,cy) at the end.
-     * Look for extreme points of arc:
-     * 	1) start and stop points
-     *	2) any intersections of x and y axes
-     * Count both first and second "turns".
-     */
-                
-    IncludePointInRect(&r, rx*cosStart, ry*sinStart);
-    IncludePointInRect(&r, rx*cosStop,  ry*sinStop);
-    if (((start < M_PI/2.0) && (stop > M_PI/2.0)) || (stop2PI > M_PI/2.0)) {
-        IncludePointInRect(&r, 0.0, ry);
-    }
-    if (((start < M_PI) && (stop > M_PI)) || (stop2PI > M_PI)) {
-        IncludePointInRect(&r, -rx, 0.0);
-    }
-    if (((start < 3.0*M_PI/2.0) && (stop > 3.0*M_PI/2.0)) || (stop2PI > 3.0*M_PI/2.0)) {
-        IncludePointInRect(&r, 0.0, -ry);
-    }
-    if (stop > 2.0*M_PI) {
-        IncludePointInRect(&r, rx, 0.0);
+    for (i = 0; i < 2; i++) {
+        denom = control[i] - 2.0*control[i+2] + control[i+4];
+        if (denom == 0.0) {
+            continue;
+        }
+        t = (control[i] - control[i+2])/denom;
+        if ((t > 0.0) && (t < 1.0)) {
+            u = 1.0 - t;
+            IncludePointInRect(r, 
+                    u*u*control[0] + 2.0*t*u*control[2] + t*t*control[4],
+                    u*u*control[1] + 2.0*t*u*control[3] + t*t*control[5]);
+        }
     }
-    
-    /*
-     * Rotate the bbox above to get an overestimate of extremas.
-     */
-    if (fabs(phi) > 1e-6) {
-        double cosPhi, sinPhi;
-        double x, y;
-        PathRect rrot = {1.0e36, 1.0e36, -1.0e36, -1.0e36};
-        
-        cosPhi = cos(phi);
-        sinPhi = sin(phi);
-        x = r.x1*cosPhi - r.y1*sinPhi;
-        y = r.x1*sinPhi + r.y1*cosPhi;
-        IncludePointInRect(&rrot, x, y);
-        
-        x = r.x2*cosPhi - r.y1*sinPhi;
-        y = r.x2*sinPhi + r.y1*cosPhi;
-        IncludePointInRect(&rrot, x, y);
-        
-        x = r.x1*cosPhi - r.y2*sinPhi;
-        y = r.x1*sinPhi + r.y2*cosPhi;
-        IncludePointInRect(&rrot, x, y);
-        
-        x = r.x2*cosPhi - r.y2*sinPhi;
-        y = r.x2*sinPhi + r.y2*cosPhi;
-        IncludePointInRect(&rrot, x, y);
+}
 
-        r = rrot;
-    }
+static void
+IncludeCurveInRect(PathRect *r, double control[])
+{
+    double a, b, c, disc, q;
+    double roots[2], t, u;
+    int i, j, numRoots;
     
-    /* Shift rect to arc center. */
-    r.x1 += cx;
-    r.y1 += cy;
-    r.x2 += cx;
-    r.y2 += cy;
-    return r;
+    for (i = 0; i < 2; i++) {
+    
+        /* The derivative divided by 3 is a t^2 + b t + c. */
+        a = -control[i] + 3.0*control[i+2] - 3.0*control[i+4] + control[i+6];
+        b = 2.0*(control[i] - 2.0*control[i+2] + control[i+4]);
+        c = control[i+2] - control[i];
+        numRoots = 0;
+        if (fabs(a) < 1e-12) {
+            if (b != 0.0) {
+                roots[numRoots++] = -c/b;
+            }
+        } else {
+            disc = b*b - 4.0*a*c;
+            if (disc >= 0.0) {
+            
+                /* Numerically stable form of the two roots. */
+                q = -0.5*(b + ((b < 0.0) ? -sqrt(disc) : sqrt(disc)));
+                roots[numRoots++] = q/a;
+                if (q != 0.0) {
+                    roots[numRoots++] = c/q;
+                }
+            }
+        }
+        for (j = 0; j < numRoots; j++) {
+            t = roots[j];
+            if ((t > 0.0) && (t < 1.0)) {
+                u = 1.0 - t;
+                IncludePointInRect(r, 
+                        u*u*u*control[0] + 3.0*t*u*(u*control[2] + t*control[4])
+                        + t*t*t*control[6],
+                        u*u*u*control[1] + 3.0*t*u*(u*control[3] + t*control[5])
+                        + t*t*t*control[7]);
+            }
+        }
+    }
 }
 
 /*
  *--------------------------------------------------------------
  *
- * GetGenericBarePathBbox
+ * GetGenericBarePathBbox, GetTransformedBarePathBbox
  *
- *	Gets an overestimate of the bounding box rectangle of
- * 	a path assuming zero stroke width.
- * 	Untransformed coordinates!
+ *	Gets the exact bounding box rectangle of a path assuming 
+ *	zero stroke width, either in untransformed coordinates or
+ *	transformed by mPtr. Since an affine transform of a Bezier
+ *	or an elliptical arc is still one, the transformed box is
+ *	exact as well and often much smaller than the transformed
+ *	corners of the untransformed box.
  *
  * Results:
  *	A PathRect.
@@ -293,32 +562,56 @@ GetBareArcBbox(double cx, double cy, double rx, double ry,
  */
 
 PathRect
-GetGenericBarePathBbox(PathAtom *atomPtr)
+GetGenericBarePathBbox(PathPacked *packedPtr)
+{
+    return GetTransformedBarePathBbox(packedPtr, NULL);
+}
+
+PathRect
+GetTransformedBarePathBbox(PathPacked *packedPtr, TMatrix *mPtr)
 {
-    double x1, y1, x2, y2, x3, y3, x4, y4, x5, y5;
-    double currentX, currentY;
+    PathAtomIter iter;
+    double	*atomPtr;
+    int		type;
+    double	p[2];
+    double	control[8];
+    double	current[2];	/* Current untransformed point. */
     PathRect r = {1.0e36, 1.0e36, -1.0e36, -1.0e36};
     
-    currentX = 0.0;
-    currentY = 0.0;
+    current[0] = 0.0;
+    current[1] = 0.0;
+
+    if ((packedPtr != NULL) && (packedPtr->flags & PATH_PACKED_POLY)) {
+        double *coords = packedPtr->coords;
+        int i;
+
+        for (i = 0; i < packedPtr->numCoords; i += 2) {
+            PathApplyTMatrixToPoint(mPtr, coords+i, p);
+            IncludePointInRect(&r, p[0], p[1]);
+        }
+        return r;
+    }
 
-    while (atomPtr != NULL) {
+    PathAtomIterInit(&iter, packedPtr);
+    while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
     
-        switch (atomPtr->type) {
+        switch (type) {
             case PATH_ATOM_M: { 
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
                 
-                IncludePointInRect(&r, move->x, move->y);
-                currentX = move->x;
-                currentY = move->y;
+                PathApplyTMatrixToPoint(mPtr, &(move->x), p);
+                IncludePointInRect(&r, p[0], p[1]);
+                current[0] = move->x;
+                current[1] = move->y;
                 break;
             }
             case PATH_ATOM_L: {
                 LineToAtom *line = (LineToAtom *) atomPtr;
 
-                IncludePointInRect(&r, line->x, line->y);
-                currentX = line->x;
-                currentY = line->y;
+                PathApplyTMatrixToPoint(mPtr, &(line->x), p);
+                IncludePointInRect(&r, p[0], p[1]);
+                current[0] = line->x;
+                current[1] = line->y;
                 break;
             }
             case PATH_ATOM_A: {
@@ -328,60 +621,46 @@ GetGenericBarePathBbox(PathAtom *atomPtr)
                 double theta1, dtheta;
             
                 result = EndpointToCentralArcParameters(
-                        currentX, currentY,
+                        current[0], current[1],
                         arc->x, arc->y, arc->radX, arc->radY, 
                         DEGREES_TO_RADIANS * arc->angle, 
-                        arc->largeArcFlag, arc->sweepFlag,
+                        (char) arc->largeArcFlag, (char) arc->sweepFlag,
                         &cx, &cy, &rx, &ry,
                         &theta1, &dtheta);
                 if (result == kPathArcLine) {
-                    IncludePointInRect(&r, arc->x, arc->y);
+                    PathApplyTMatrixToPoint(mPtr, &(arc->x), p);
+                    IncludePointInRect(&r, p[0], p[1]);
                 } else if (result == kPathArcOK) {
-                    PathRect arcRect;
-                    
-                    arcRect = GetBareArcBbox(cx, cy, rx, ry, theta1, dtheta, 
+                    IncludeArcInRect(&r, mPtr, cx, cy, rx, ry, theta1, dtheta, 
                             DEGREES_TO_RADIANS * arc->angle);
-                    IncludePointInRect(&r, arcRect.x1, arcRect.y1);
-                    IncludePointInRect(&r, arcRect.x2, arcRect.y2);
                 }
-                currentX = arc->x;
-                currentY = arc->y;
+                current[0] = arc->x;
+                current[1] = arc->y;
                 break;
             }
             case PATH_ATOM_Q: {
                 QuadBezierAtom *quad = (QuadBezierAtom *) atomPtr;
                 
-                x1 = (currentX + quad->ctrlX)/2.0;
-                y1 = (currentY + quad->ctrlY)/2.0;
-                x2 = (quad->ctrlX + quad->anchorX)/2.0;
-                y2 = (quad->ctrlY + quad->anchorY)/2.0;
-                IncludePointInRect(&r, x1, y1);
-                IncludePointInRect(&r, x2, y2);
-                currentX = quad->anchorX;
-                currentY = quad->anchorY;
-                IncludePointInRect(&r, currentX, currentY);
+                PathApplyTMatrixToPoint(mPtr, current, control);
+                PathApplyTMatrixToPoint(mPtr, &(quad->ctrlX), control+2);
+                PathApplyTMatrixToPoint(mPtr, &(quad->anchorX), control+4);
+                IncludeQuadBezierInRect(&r, control);
+                IncludePointInRect(&r, control[4], control[5]);
+                current[0] = quad->anchorX;
+                current[1] = quad->anchorY;
                 break;
             }
             case PATH_ATOM_C: {
                 CurveToAtom *curve = (CurveToAtom *) atomPtr;
 
-                x1 = (currentX + curve->ctrlX1)/2.0;
-                y1 = (currentY + curve->ctrlY1)/2.0;
-                x2 = (curve->ctrlX1 + curve->ctrlX2)/2.0;
-                y2 = (curve->ctrlY1 + curve->ctrlY2)/2.0;
-                x3 = (curve->ctrlX2 + curve->anchorX)/2.0;
-                y3 = (curve->ctrlY2 + curve->anchorY)/2.0;
-                IncludePointInRect(&r, x1, y1);
-                IncludePointInRect(&r, x3, y3);
-                x4 = (x1 + x2)/2.0;
-                y4 = (y1 + y2)/2.0;
-                x5 = (x2 + x3)/2.0;
-                y5 = (y2 + y3)/2.0;
-                IncludePointInRect(&r, x4, y4);
-                IncludePointInRect(&r, x5, y5);
-                currentX = curve->anchorX;
-                currentY = curve->anchorY;
-                IncludePointInRect(&r, currentX, currentY);
+                PathApplyTMatrixToPoint(mPtr, current, control);
+                PathApplyTMatrixToPoint(mPtr, &(curve->ctrlX1), control+2);
+                PathApplyTMatrixToPoint(mPtr, &(curve->ctrlX2), control+4);
+                PathApplyTMatrixToPoint(mPtr, &(curve->anchorX), control+6);
+                IncludeCurveInRect(&r, control);
+                IncludePointInRect(&r, control[6], control[7]);
+                current[0] = curve->anchorX;
+                current[1] = curve->anchorY;
                 break;
             }
             case PATH_ATOM_Z: {
@@ -390,18 +669,27 @@ GetGenericBarePathBbox(PathAtom *atomPtr)
             }
             case PATH_ATOM_ELLIPSE: {
                 EllipseAtom *ell = (EllipseAtom *) atomPtr;
-                IncludePointInRect(&r, ell->cx - ell->rx, ell->cy - ell->ry);
-                IncludePointInRect(&r, ell->cx + ell->rx, ell->cy + ell->ry);            
+                
+                IncludeArcInRect(&r, mPtr, ell->cx, ell->cy, ell->rx, ell->ry, 
+                        0.0, 2.0*M_PI, 0.0);
                 break;
             }
             case PATH_ATOM_RECT: {
                 RectAtom *rect = (RectAtom *) atomPtr;
-                IncludePointInRect(&r, rect->x, rect->y);
-                IncludePointInRect(&r, rect->x + rect->width, rect->y + rect->height);            
+                double corners[8];
+                int i;
+                
+                corners[0] = corners[6] = rect->x;
+                corners[1] = corners[3] = rect->y;
+                corners[2] = corners[4] = rect->x + rect->width;
+                corners[5] = corners[7] = rect->y + rect->height;
+                for (i = 0; i < 8; i += 2) {
+                    PathApplyTMatrixToPoint(mPtr, corners+i, p);
+                    IncludePointInRect(&r, p[0], p[1]);
+                }
                 break;
             }
         }
-        atomPtr = atomPtr->nextPtr;
     }
     return r;
 }
@@ -535,8 +823,11 @@ IncludeMiterPointsInRect(double p1[2], double p2[2], double p3[2], PathRect *bou
 }
 
 static PathRect
-GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
+GetMiterBbox(PathPacked *packedPtr, double width, double miterLimit)
 {
+    PathAtomIter iter;
+    double	*atomPtr;
+    int		type;
     int		npts;
     double 	p1[2], p2[2], p3[2];
     double	current[2], second[2];
@@ -564,9 +855,10 @@ GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
         return bounds;
     }
     
-    while (atomPtr != NULL) {
+    PathAtomIterInit(&iter, packedPtr);
+    while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
     
-        switch (atomPtr->type) {
+        switch (type) {
             case PATH_ATOM_M: { 
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
                 current[0] = move->x;
@@ -666,7 +958,6 @@ GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
         if (npts == 2) {
             CopyPoint(current, second);
         }
-        atomPtr = atomPtr->nextPtr;
     }
     
     return bounds;
@@ -690,7 +981,7 @@ GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
  */
 
 PathRect
-GetGenericPathTotalBboxFromBare(PathAtom *atomPtr, Tk_PathStyle *stylePtr, PathRect *bboxPtr)
+GetGenericPathTotalBboxFromBare(PathPacked *atomPtr, Tk_PathStyle *stylePtr, PathRect *bboxPtr)
 {
     double fudge = 1.0;
     double width = 0.0;
@@ -708,7 +999,7 @@ GetGenericPathTotalBboxFromBare(PathAtom *atomPtr, Tk_PathStyle *stylePtr, PathR
     }
     
     /* Add the miter corners if necessary. */
-    if (atomPtr && (stylePtr->joinStyle == JoinMiter) 
+    if (atomPtr && (atomPtr->numAtoms > 0) && (stylePtr->joinStyle == JoinMiter) 
             && (stylePtr->strokeWidth > 1.0)) {
         PathRect miterBox;
         miterBox = GetMiterBbox(atomPtr, width, stylePtr->miterLimit);
@@ -790,6 +1081,77 @@ SetGenericPathHeaderBbox(
     headerPtr->y2 = (int) rect.y2;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * SetGenericPathHeaderBboxFromAtoms --
+ *
+ *	This procedure sets the (transformed) bbox in the items header
+ *	like SetGenericPathHeaderBbox but shrinks it for rotated and
+ *	skewed items to the exact transformed bbox of the atoms grown
+ *	by the stroke margin of totalBboxPtr.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The fields x1, y1, x2, and y2 are updated in the header
+ *	for itemPtr.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+SetGenericPathHeaderBboxFromAtoms(
+        Tk_PathItem *headerPtr,
+        TMatrix *mPtr,
+        PathPacked *atomPtr,
+        PathRect *extraPtr,	/* Untransformed bbox of anything drawn
+				 * besides the atoms, like arrows, or NULL. */
+        PathRect *bboxPtr,	/* Bare bbox including extraPtr. */
+        PathRect *totalBboxPtr)
+{
+    PathRect rect;
+    double margin;
+    
+    SetGenericPathHeaderBbox(headerPtr, mPtr, totalBboxPtr);
+    
+    /* Transforming the corners is already exact without rotation. */
+    if ((mPtr == NULL) || ((mPtr->b == 0.0) && (mPtr->c == 0.0))
+            || IsPathRectEmpty(bboxPtr)) {
+        return;
+    }
+    rect = GetTransformedBarePathBbox(atomPtr, mPtr);
+    if ((extraPtr != NULL) && !IsPathRectEmpty(extraPtr)) {
+        double x, y;
+        
+        x = extraPtr->x1, y = extraPtr->y1;
+        PathApplyTMatrix(mPtr, &x, &y);
+        IncludePointInRect(&rect, x, y);
+        x = extraPtr->x2, y = extraPtr->y1;
+        PathApplyTMatrix(mPtr, &x, &y);
+        IncludePointInRect(&rect, x, y);
+        x = extraPtr->x1, y = extraPtr->y2;
+        PathApplyTMatrix(mPtr, &x, &y);
+        IncludePointInRect(&rect, x, y);
+        x = extraPtr->x2, y = extraPtr->y2;
+        PathApplyTMatrix(mPtr, &x, &y);
+        IncludePointInRect(&rect, x, y);
+    }
+    if (IsPathRectEmpty(&rect)) {
+        return;
+    }
+    margin = MAX(MAX(bboxPtr->x1 - totalBboxPtr->x1, totalBboxPtr->x2 - bboxPtr->x2),
+            MAX(bboxPtr->y1 - totalBboxPtr->y1, totalBboxPtr->y2 - bboxPtr->y2));
+    margin *= MAX(1.0, TMatrixMaxScale(mPtr));
+    
+    /* Both boxes hold the item so their intersection does too. */
+    headerPtr->x1 = MAX(headerPtr->x1, (int) (rect.x1 - margin));
+    headerPtr->y1 = MAX(headerPtr->y1, (int) (rect.y1 - margin));
+    headerPtr->x2 = MIN(headerPtr->x2, (int) (rect.x2 + margin));
+    headerPtr->y2 = MIN(headerPtr->y2, (int) (rect.y2 + margin));
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -815,8 +1177,7 @@ GenericPathToPoint(
     Tk_PathCanvas canvas,	/* Canvas containing item. */
     Tk_PathItem *itemPtr,	/* Item to check against point. */
     Tk_PathStyle *stylePtr,
-    PathAtom *atomPtr,
-    int maxNumSegments,
+    PathPacked *atomPtr,
     double *pointPtr)		/* Pointer to x and y coordinates. */
 {
     int		    numPoints, numStrokes;
@@ -825,8 +1186,12 @@ GenericPathToPoint(
     int		    sumIntersections = 0, sumNonzerorule = 0;
     double	    *polyPtr;
     double	    bestDist, radius, width, dist;
+    int		    index = 0;
     Tk_PathState    state = itemPtr->state;
     TMatrix	    *matrixPtr = stylePtr->matrixPtr;
+    PathAtomIter    iter;
+    PathSegments    segs;
+    PathFlatCache   *flatPtr;
 
     bestDist = 1.0e36;
 
@@ -836,18 +1201,12 @@ GenericPathToPoint(
     if (!HaveAnyFillFromPathColor(stylePtr->fill) && (stylePtr->strokeColor == NULL)) {
         return bestDist;
     }
-    if (atomPtr == NULL) {
+    if ((atomPtr == NULL) || (atomPtr->numAtoms == 0)) {
         return bestDist;
     }
     
-    /* 
-     * Do we need more memory or can we use static space? 
-     */
-    if (maxNumSegments > MAX_NUM_STATIC_SEGMENTS) {
-        polyPtr = (double *) ckalloc((unsigned) (2*maxNumSegments*sizeof(double)));
-    } else {
-        polyPtr = staticSpace;
-    }
+    flatPtr = GetFlatCache(itemPtr, atomPtr, matrixPtr, 
+            TkPathCanvasTolerance(canvas));
     width = stylePtr->strokeWidth;
     if (width < 1.0) {
         width = 1.0;
@@ -863,8 +1222,11 @@ GenericPathToPoint(
      *		 "holes".
      */
      
-    while (atomPtr != NULL) {
-        MakeSubPathSegments(&atomPtr, polyPtr, &numPoints, &numStrokes, matrixPtr);
+    PathAtomIterInit(&iter, atomPtr);
+    while (NextSubPathSegments(&iter, flatPtr, &index, &segs)) {
+        polyPtr = segs.polyPtr;
+        numPoints = segs.numPoints;
+        numStrokes = segs.numStrokes;
         isclosed = 0;
         if (numStrokes == numPoints) {
             isclosed = 1;
@@ -874,8 +1236,13 @@ GenericPathToPoint(
          * This gives the min distance to the *stroke* AND the
          * number of intersections of the two types.
          */
-        dist = PathPolygonToPointEx(polyPtr, numPoints, pointPtr, 
-                &intersections, &nonzerorule);
+        if (numPoints >= kPathEdgeTreeMinPoints) {
+            dist = EdgeTreeToPoint(GetEdgeTree(itemPtr, polyPtr, numPoints),
+                    pointPtr, &intersections, &nonzerorule);
+        } else {
+            dist = PathPolygonToPointEx(polyPtr, numPoints, pointPtr, 
+                    &intersections, &nonzerorule);
+        }
         sumIntersections += intersections;
         sumNonzerorule += nonzerorule;
         if ((stylePtr->strokeColor != NULL) && (stylePtr->strokeWidth <= kPathStrokeThicknessLimit)) {
@@ -928,9 +1295,6 @@ GenericPathToPoint(
     }
     
 done:
-    if (polyPtr != staticSpace) {
-        ckfree((char *) polyPtr);
-    }
     return bestDist;
 }
 
@@ -962,8 +1326,7 @@ GenericPathToArea(
     Tk_PathCanvas canvas,   /* Canvas containing item. */
     Tk_PathItem *itemPtr,   /* Item to check against line. */
     Tk_PathStyle *stylePtr,
-    PathAtom *atomPtr,
-    int maxNumSegments,
+    PathPacked *atomPtr,
     double *areaPtr)	    /* Pointer to array of four coordinates
                              * (x1, y1, x2, y2) describing rectangular
                              * area.  */
@@ -979,9 +1342,13 @@ GenericPathToArea(
     int		    isclosed = 0;
     double	    *polyPtr;
     double	    currentT[2];
+    int		    index = 0;
     Tk_PathState    state = itemPtr->state;
     TMatrix	    *matrixPtr = stylePtr->matrixPtr;
-    MoveToAtom	    *move;
+    double	    *coords;
+    PathAtomIter    iter;
+    PathSegments    segs;
+    PathFlatCache   *flatPtr;
 
 #if 0
     if(state == TK_PATHSTATE_NULL) {
@@ -994,25 +1361,19 @@ GenericPathToArea(
     if ((GetColorFromPathColor(stylePtr->fill) == NULL) && (stylePtr->strokeColor == NULL)) {
         return -1;
     }
-    if (atomPtr == NULL) {
+    if ((atomPtr == NULL) || (atomPtr->numAtoms == 0)) {
         return -1;
     }
-    
-    /* 
-     * Do we need more memory or can we use static space? 
-     */
-    if (maxNumSegments > MAX_NUM_STATIC_SEGMENTS) {
-        polyPtr = (double *) ckalloc((unsigned) (2*maxNumSegments*sizeof(double)));
-    } else {
-        polyPtr = staticSpace;
-    }
 
     /* A 'M' atom must be first, may show up later as well. */
-    if (atomPtr->type != PATH_ATOM_M) {
+    PathAtomIterInit(&iter, atomPtr);
+    if (PathAtomIterNext(&iter, &coords) != PATH_ATOM_M) {
         return -1;
     }
-    move = (MoveToAtom *) atomPtr;
-    PathApplyTMatrixToPoint(matrixPtr, &(move->x), currentT);
+    PathApplyTMatrixToPoint(matrixPtr, coords, currentT);
+    
+    flatPtr = GetFlatCache(itemPtr, atomPtr, matrixPtr, 
+            TkPathCanvasTolerance(canvas));
     
     /*
      * This defines the starting point. It is either -1 or 1. 
@@ -1026,8 +1387,11 @@ GenericPathToArea(
         inside = 1;
     }
     
-    while (atomPtr != NULL) {
-        MakeSubPathSegments(&atomPtr, polyPtr, &numPoints, &numStrokes, matrixPtr);
+    PathAtomIterInit(&iter, atomPtr);
+    while (NextSubPathSegments(&iter, flatPtr, &index, &segs)) {
+        polyPtr = segs.polyPtr;
+        numPoints = segs.numPoints;
+        numStrokes = segs.numStrokes;
         isclosed = 0;
         if (numStrokes == numPoints) {
             isclosed = 1;
@@ -1040,9 +1404,6 @@ GenericPathToArea(
     }
 
 done:
-    if (polyPtr != staticSpace) {
-        ckfree((char *) polyPtr);
-    }
     return inside;
 }
 
@@ -1100,41 +1461,90 @@ ArcSegments(
     }
 }
 
-/* 
- * Get maximum number of segments needed to describe path. 
- * Needed to see if we can use static space or need to allocate more.
+/*
+ *--------------------------------------------------------------
+ *
+ * BezierNumSegments, ArcNumSegments --
+ *
+ *	Computes the number of straight line segments needed for the
+ *	flattened curve to stay within tolerance of the true curve.
+ *	For a Bezier of the given degree this is Wang's formula on
+ *	the second differences of the control points. For an arc it
+ *	follows from the sagitta r(1 - cos(dtheta/2n)) of each segment.
+ *	Coordinates must be in device space for the tolerance to be
+ *	in pixels.
+ *
+ * Results:
+ *	Number of segments, between 1 and kPathMaxNumSegments.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
  */
 
 static int
-GetArcNumSegments(double currentX, double currentY, ArcAtom *arc)
+ClampNumSegments(double num)
 {
-    int result;
-    int ntheta, nlength;
-    int numSteps;			/* Number of curve points to
-					 * generate.  */
-    double cx, cy, rx, ry;
-    double theta1, dtheta;
+    if (!(num > 1.0)) {
+        return 1;
+    } else if (num > kPathMaxNumSegments) {
+        return kPathMaxNumSegments;
+    } else {
+        return (int) num;
+    }
+}
 
-    result = EndpointToCentralArcParameters(
-            currentX, currentY,
-            arc->x, arc->y, arc->radX, arc->radY, 
-            DEGREES_TO_RADIANS * arc->angle, 
-            arc->largeArcFlag, arc->sweepFlag,
-            &cx, &cy, &rx, &ry,
-            &theta1, &dtheta);
-    if (result == kPathArcLine) {
-        return 2;
-    } else if (result == kPathArcSkip) {
-        return 0;
+static int
+BezierNumSegments(
+    double control[],		/* Control points x0, y0, x1, y1, ... */
+    int degree,			/* 2 for quadratic, 3 for cubic. */
+    double tolerance)
+{
+    int i;
+    double dx, dy, dist, maxDist = 0.0;
+    
+    for (i = 0; i < 2*(degree-1); i += 2) {
+        dx = control[i] - 2.0*control[i+2] + control[i+4];
+        dy = control[i+1] - 2.0*control[i+3] + control[i+5];
+        dist = hypot(dx, dy);
+        if (dist > maxDist) {
+            maxDist = dist;
+        }
     }
+    return ClampNumSegments(
+            ceil(sqrt(degree*(degree-1)*maxDist/(8.0*tolerance))));
+}
 
-    /* Estimate the number of steps needed. 
-     * Max 10 degrees or length 50.
-     */
-    ntheta = (int) (dtheta/5.0 + 0.5);
-    nlength = (int) (0.5*(rx + ry)*dtheta/50 + 0.5);
-    numSteps = MAX(4, MAX(ntheta, nlength));;
-    return numSteps;
+static int
+ArcNumSegments(
+    double radius,		/* Largest radius in device space. */
+    double dtheta,		/* Sweep angle in radians. */
+    double tolerance)
+{
+    if (radius <= tolerance) {
+        return 1;
+    }
+    return ClampNumSegments(
+            ceil(fabs(dtheta)/(2.0*acos(1.0 - tolerance/radius))));
+}
+
+/*
+ * Largest scale factor of the matrix, its largest singular value.
+ * Radii are multiplied by this to get their size in device space.
+ */
+
+static double
+TMatrixMaxScale(TMatrix *m)
+{
+    double sum, det;
+    
+    if (m == NULL) {
+        return 1.0;
+    }
+    sum = m->a*m->a + m->b*m->b + m->c*m->c + m->d*m->d;
+    det = m->a*m->d - m->b*m->c;
+    return sqrt(0.5*(sum + sqrt(MAX(0.0, sum*sum - 4.0*det*det))));
 }
 
 /*
@@ -1260,33 +1670,74 @@ EllipseSegments(
 /*
  *--------------------------------------------------------------
  *
- * AddArcSegments, AddQuadBezierSegments, AddCurveToSegments,
- *   AddEllipseToSegments --
+ * SegmentsRoom --
  *
- *	Adds a number of points along the arc (curve) to coordPtr
- *	representing straight line segments.
+ *	Makes room for numMore points after the ones already made.
+ *	The static space is used until it runs out.
  *
  * Results:
- *	Number of points added. 
+ *	Pointer to where the next point goes.
  *
  * Side effects:
+ *	May allocate new storage for the points.
+ *
+ *--------------------------------------------------------------
+ */
+
+static double *
+SegmentsRoom(PathSegments *segPtr, int numMore)
+{
+    int need = segPtr->spaceUsed + numMore;
+    int size;
+    
+    if (need > segPtr->spaceSize) {
+        size = MAX(need, 2*segPtr->spaceSize);
+        if (segPtr->space == segPtr->staticSpace) {
+            segPtr->space = (double *) ckalloc((unsigned) (2*size*sizeof(double)));
+            memcpy(segPtr->space, segPtr->staticSpace, 
+                    2*segPtr->spaceUsed*sizeof(double));
+        } else {
+            segPtr->space = (double *) ckrealloc((char *) segPtr->space, 
+                    (unsigned) (2*size*sizeof(double)));
+        }
+        segPtr->spaceSize = size;
+    }
+    return segPtr->space + 2*segPtr->spaceUsed;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * AddArcSegments, AddQuadBezierSegments, AddCurveToSegments,
+ *   AddEllipseToSegments, AddRectToSegments --
+ *
+ *	Adds a number of points along the arc (curve) to segPtr
+ *	representing straight line segments. Curves are flattened
+ *	in device space to within tolerance.
+ *
+ * Results:
  *	None.
  *
+ * Side effects:
+ *	Points added to segPtr.
+ *
  *--------------------------------------------------------------
  */
 
-static int
+static void
 AddArcSegments(
+    PathSegments *segPtr,
     TMatrix *matrixPtr,
     double current[2],		/* Current point. */
     ArcAtom *arc,
-    double *coordPtr)		/* Where to put the points. */
+    double tolerance)
 {
     int result;
-    int numPoints;
+    int numSteps;
     CentralArcPars arcPars;
     double cx, cy, rx, ry;
     double theta1, dtheta;
+    double *coordPtr;
             
     /*
      * Note: The arc parametrization used cannot generally
@@ -1297,20 +1748,16 @@ AddArcSegments(
             current[0], current[1],
             arc->x, arc->y, arc->radX, arc->radY, 
             DEGREES_TO_RADIANS * arc->angle, 
-            arc->largeArcFlag, arc->sweepFlag,
+            (char) arc->largeArcFlag, (char) arc->sweepFlag,
             &cx, &cy, &rx, &ry,
             &theta1, &dtheta);
     if (result == kPathArcLine) {
-        double pts[2];
-
-        pts[0] = arc->x;
-        pts[1] = arc->y;
-        PathApplyTMatrix(matrixPtr, pts, pts+1);
-        coordPtr[0] = pts[0];
-        coordPtr[1] = pts[1];
-        return 1;
+        coordPtr = SegmentsRoom(segPtr, 1);
+        PathApplyTMatrixToPoint(matrixPtr, &(arc->x), coordPtr);
+        segPtr->spaceUsed++;
+        return;
     } else if (result == kPathArcSkip) {
-        return 0;
+        return;
     }
 
     arcPars.cx = cx;
@@ -1319,67 +1766,74 @@ AddArcSegments(
     arcPars.ry = ry;
     arcPars.theta1 = theta1;
     arcPars.dtheta = dtheta;
-    arcPars.phi = arc->angle;
-
-    numPoints = GetArcNumSegments(current[0], current[1], arc);    
-    ArcSegments(&arcPars, matrixPtr, 0, numPoints, coordPtr);
+    arcPars.phi = DEGREES_TO_RADIANS * arc->angle;
 
-    return numPoints;
+    numSteps = ArcNumSegments(MAX(rx, ry) * TMatrixMaxScale(matrixPtr), 
+            dtheta, tolerance);
+    coordPtr = SegmentsRoom(segPtr, numSteps);
+    ArcSegments(&arcPars, matrixPtr, 0, numSteps, coordPtr);
+    segPtr->spaceUsed += numSteps;
 }
 
-static int
+static void
 AddQuadBezierSegments(
+    PathSegments *segPtr,
     TMatrix *matrixPtr,
     double current[2],		/* Current point. */
     QuadBezierAtom *quad,
-    double *coordPtr)		/* Where to put the points. */
+    double tolerance)
 {
-    int numPoints;			/* Number of curve points to
-                             * generate.  */
+    int numSteps;		/* Number of curve points to
+                                 * generate.  */
     double control[6];
+    double *coordPtr;
 
     PathApplyTMatrixToPoint(matrixPtr, current, control);
     PathApplyTMatrixToPoint(matrixPtr, &(quad->ctrlX), control+2);
     PathApplyTMatrixToPoint(matrixPtr, &(quad->anchorX), control+4);
 
-    numPoints = kPathNumSegmentsQuadBezier;
-    QuadBezierSegments(control, 0, numPoints, coordPtr);
-
-    return numPoints;
+    numSteps = BezierNumSegments(control, 2, tolerance);
+    coordPtr = SegmentsRoom(segPtr, numSteps);
+    QuadBezierSegments(control, 0, numSteps, coordPtr);
+    segPtr->spaceUsed += numSteps;
 }
 
-static int
+static void
 AddCurveToSegments(
+    PathSegments *segPtr,
     TMatrix *matrixPtr,
     double current[2],			/* Current point. */
     CurveToAtom *curve,
-    double *coordPtr)
+    double tolerance)
 {
     int numSteps;				/* Number of curve points to
                                  * generate.  */
     double control[8];
+    double *coordPtr;
 
     PathApplyTMatrixToPoint(matrixPtr, current, control);
     PathApplyTMatrixToPoint(matrixPtr, &(curve->ctrlX1), control+2);
     PathApplyTMatrixToPoint(matrixPtr, &(curve->ctrlX2), control+4);
     PathApplyTMatrixToPoint(matrixPtr, &(curve->anchorX), control+6);
 
-    numSteps = kPathNumSegmentsCurveTo;
-    CurveSegments(control, 1, numSteps, coordPtr);
-    
-    return numSteps;
+    numSteps = BezierNumSegments(control, 3, tolerance);
+    coordPtr = SegmentsRoom(segPtr, numSteps);
+    CurveSegments(control, 0, numSteps, coordPtr);
+    segPtr->spaceUsed += numSteps;
 }
 
-static int
+static void
 AddEllipseToSegments(
+    PathSegments *segPtr,
     TMatrix *matrixPtr,
     EllipseAtom *ellipse,
-    double *coordPtr)
+    double tolerance)
 {
     int numSteps;
     double rx, ry, angle;
     double c[2], crx[2], cry[2];
     double p[2];
+    double *coordPtr;
 
     /* 
      * We transform the three points: c, c+rx, c+ry
@@ -1399,32 +1853,25 @@ AddEllipseToSegments(
     ry = hypot(cry[0]-c[0], cry[1]-c[1]);
     angle = atan2(crx[1]-c[1], crx[0]-c[0]);
     
-    /* Note we add 1 here since we need both start and stop points. 
-     * Small things wont need so many segments.
-     * Approximate circumference: 4(rx+ry)
+    /* 
+     * Note we add 1 here since we need both start and stop points. 
+     * Keep at least a square for tiny ones.
      */
-    if (rx+ry < 2.1) {
-        numSteps = 1;
-    } else if (rx+ry < 4) {
-        numSteps = 3;
-    } else if (rx+ry < kPathNumSegmentsEllipse) {
-        numSteps = (int)(rx+ry+2);
-    } else {
-        numSteps = kPathNumSegmentsEllipse + 1;
-    }
+    numSteps = MAX(4, ArcNumSegments(MAX(rx, ry), 2*M_PI, tolerance)) + 1;
+    coordPtr = SegmentsRoom(segPtr, numSteps);
     EllipseSegments(c, rx, ry, angle, numSteps, coordPtr);
-
-    return numSteps;
+    segPtr->spaceUsed += numSteps;
 }
 
-static int
+static void
 AddRectToSegments(
+    PathSegments *segPtr,
     TMatrix *matrixPtr,
-    RectAtom *rect,
-    double *coordPtr)
+    RectAtom *rect)
 {
     int i;
     double p[8];
+    double *coordPtr;
     
     p[0] = rect->x;
     p[1] = rect->y;
@@ -1435,12 +1882,12 @@ AddRectToSegments(
     p[6] = rect->x;
     p[7] = rect->y + rect->height;
     
+    /* The first corner is repeated to close it. */
+    coordPtr = SegmentsRoom(segPtr, 5);
     for (i = 0; i <= 8; i += 2, coordPtr += 2) {
-        PathApplyTMatrix(matrixPtr, p, p+1);
-        coordPtr[0] = p[0];
-        coordPtr[1] = p[1];
+        PathApplyTMatrixToPoint(matrixPtr, p + (i % 8), coordPtr);
     }
-    return 4;
+    segPtr->spaceUsed += 5;
 }
 
 /*
@@ -1452,27 +1899,27 @@ AddRectToSegments(
  *	by both Area and Point functions.
  *
  * Results:
- *	Points filled into polyPtr...
+ *	Points filled into segPtr...
  *
  * Side effects:
- *	Pointer *atomPtrPtr may be updated.
+ *	The iterator is advanced to the start of the next subpath.
+ *	May grow the space of segPtr.
  *
  *--------------------------------------------------------------
  */
 
 static void
-MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr, 
-        int *numPointsPtr, int *numStrokesPtr, TMatrix *matrixPtr)
+MakeSubPathSegments(PathAtomIter *iterPtr, PathSegments *segPtr, 
+        TMatrix *matrixPtr, double tolerance)
 {
     int 	first = 1;
-    int		numPoints;
-    int		numStrokes;
-    int		numAdded;
     int		isclosed = 0;
+    int		start;		/* Where this subpath starts in space. */
     double 	current[2];	/* Current untransformed point. */
-    double	*currentTPtr;	/* Pointer to the transformed current point. */
     double	*coordPtr;
-    PathAtom 	*atomPtr;
+    double 	*atomPtr;
+    int		type;
+    PathAtomIter next;
     
     /* @@@ 	Note that for unfilled paths we could have made a progressive
      *     	area (point) check which may be faster since we may stop when 0 (overlapping).
@@ -1489,32 +1936,30 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
 
     current[0] = 0.0;
     current[1] = 0.0;
-    numPoints = 0;
-    numStrokes = 0;
+    start = segPtr->spaceUsed;
+    segPtr->numStrokes = 0;
     isclosed = 0;
-    atomPtr = *atomPtrPtr;
-    coordPtr = NULL;
     
-    while (atomPtr != NULL) {
+    next = *iterPtr;
+    while ((type = PathAtomIterNext(&next, &atomPtr)) != 0) {
 
-        switch (atomPtr->type) {
+        switch (type) {
             case PATH_ATOM_M: {
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
             
                 /* A 'M' atom must be first, may show up later as well. */
                 
                 if (first) {
-                    coordPtr = polyPtr;
                     current[0] = move->x;
                     current[1] = move->y;
+                    coordPtr = SegmentsRoom(segPtr, 1);
                     PathApplyTMatrixToPoint(matrixPtr, current, coordPtr);
-                    currentTPtr = coordPtr;
-                    coordPtr += 2;
-                    numPoints = 1;
+                    segPtr->spaceUsed++;
                 } else {
                 
                     /*  
-                     * We have finalized a subpath.
+                     * We have finalized a subpath. Leave the 
+                     * iterator at this 'M' atom.
                      */
                     goto done;
                 }
@@ -1524,57 +1969,47 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
             case PATH_ATOM_L: {
                 LineToAtom *line = (LineToAtom *) atomPtr;
                 
+                coordPtr = SegmentsRoom(segPtr, 1);
                 PathApplyTMatrixToPoint(matrixPtr, &(line->x), coordPtr);
                 current[0] = line->x;
                 current[1] = line->y;
-                currentTPtr = coordPtr;
-                coordPtr += 2;
-                numPoints++;;
+                segPtr->spaceUsed++;
                 break;
             }
             case PATH_ATOM_A: {
                 ArcAtom *arc = (ArcAtom *) atomPtr;
                 
-                numAdded = AddArcSegments(matrixPtr, current, arc, coordPtr);
-                coordPtr += 2 * numAdded;
-                numPoints += numAdded;
+                AddArcSegments(segPtr, matrixPtr, current, arc, tolerance);
                 current[0] = arc->x;
                 current[1] = arc->y;
-                currentTPtr = coordPtr;
                 break;
             }
             case PATH_ATOM_Q: {
                 QuadBezierAtom *quad = (QuadBezierAtom *) atomPtr;
                 
-                numAdded = AddQuadBezierSegments(matrixPtr, current,
-                        quad, coordPtr);
-                coordPtr += 2 * numAdded;
-                numPoints += numAdded;
+                AddQuadBezierSegments(segPtr, matrixPtr, current,
+                        quad, tolerance);
                 current[0] = quad->anchorX;
                 current[1] = quad->anchorY;
-                currentTPtr = coordPtr;
                 break;
             }
             case PATH_ATOM_C: {
                 CurveToAtom *curve = (CurveToAtom *) atomPtr;
                 
-                numAdded = AddCurveToSegments(matrixPtr, current,
-                        curve, coordPtr);
-                coordPtr += 2 * numAdded;
-                numPoints += numAdded;
+                AddCurveToSegments(segPtr, matrixPtr, current,
+                        curve, tolerance);
                 current[0] = curve->anchorX;
                 current[1] = curve->anchorY;
-                currentTPtr = coordPtr;
                 break;
             }
             case PATH_ATOM_Z: {
                 CloseAtom *close = (CloseAtom *) atomPtr;
             
                 /* Just add the first point to the end. */
-                coordPtr[0] = polyPtr[0];
-                coordPtr[1] = polyPtr[1];
-                coordPtr += 2;
-                numPoints++;
+                coordPtr = SegmentsRoom(segPtr, 1);
+                coordPtr[0] = segPtr->space[2*start];
+                coordPtr[1] = segPtr->space[2*start+1];
+                segPtr->spaceUsed++;
                 current[0]  = close->x;
                 current[1]  = close->y;
                 isclosed = 1;
@@ -1583,49 +2018,392 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
             case PATH_ATOM_ELLIPSE: {
                 EllipseAtom *ellipse = (EllipseAtom *) atomPtr;
 
-                if (first) {
-                    coordPtr = polyPtr;
-                }
-                numAdded = AddEllipseToSegments(matrixPtr, ellipse, coordPtr);
-                coordPtr += 2 * numAdded;
-                numPoints += numAdded;
-                if (first) {
-                    /* Not sure about this. Never used anyway! */
-                    current[0]  = ellipse->cx + ellipse->rx;
-                    current[1]  = ellipse->cy;
-                }
-                break;
-            }
-            case PATH_ATOM_RECT: {
-                RectAtom *rect = (RectAtom *) atomPtr;
-                
-                if (first) {
-                    coordPtr = polyPtr;
-                }
-                numAdded = AddRectToSegments(matrixPtr, rect, coordPtr);
-                coordPtr += 2 * numAdded;
-                numPoints += numAdded;
-                current[0] = rect->x;
-                current[1] = rect->y;
-                break;
-            }
+                AddEllipseToSegments(segPtr, matrixPtr, ellipse, tolerance);
+                if (first) {
+                    /* Not sure about this. Never used anyway! */
+                    current[0]  = ellipse->cx + ellipse->rx;
+                    current[1]  = ellipse->cy;
+                }
+                isclosed = 1;
+                break;
+            }
+            case PATH_ATOM_RECT: {
+                RectAtom *rect = (RectAtom *) atomPtr;
+                
+                AddRectToSegments(segPtr, matrixPtr, rect);
+                current[0] = rect->x;
+                current[1] = rect->y;
+                isclosed = 1;
+                break;
+            }
+        }
+        *iterPtr = next;
+    }
+
+done:
+    segPtr->polyPtr = segPtr->space + 2*start;
+    segPtr->numPoints = segPtr->spaceUsed - start;
+    if (segPtr->numPoints > 1) {
+        if (isclosed) {
+            segPtr->numStrokes = segPtr->numPoints;
+        } else {
+            segPtr->numStrokes = segPtr->numPoints - 1;
+        }
+    }
+
+    return;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetFlatCache --
+ *
+ *	Gives the flattened path of an item, making it if the item
+ *	has none or if it was made with another matrix or tolerance.
+ *	An untransformed polyline needs no flattening and gets none.
+ *
+ * Results:
+ *	The flattened path or NULL if the atoms can be used directly.
+ *
+ * Side effects:
+ *	May replace itemPtr->flatCache.
+ *
+ *--------------------------------------------------------------
+ */
+
+static PathFlatCache *
+GetFlatCache(
+    Tk_PathItem *itemPtr,
+    PathPacked *atomPtr,
+    TMatrix *matrixPtr,
+    double tolerance)
+{
+    PathFlatCache *flatPtr = (PathFlatCache *) itemPtr->flatCache;
+    PathSegments segs;
+    double staticSpace[2*MAX_NUM_STATIC_SEGMENTS];
+    PathAtomIter iter;
+    TMatrix matrix = kPathUnitTMatrix;
+    int *subPaths = NULL;
+    int numSubPaths = 0, subPathsSize = 0;
+    unsigned size;
+
+    if ((atomPtr->flags & PATH_PACKED_POLY) && (matrixPtr == NULL)) {
+        return NULL;
+    }
+    if (matrixPtr != NULL) {
+        matrix = *matrixPtr;
+    }
+    if ((flatPtr != NULL) && (flatPtr->tolerance == tolerance)
+            && (flatPtr->matrix.a == matrix.a) && (flatPtr->matrix.b == matrix.b)
+            && (flatPtr->matrix.c == matrix.c) && (flatPtr->matrix.d == matrix.d)
+            && (flatPtr->matrix.tx == matrix.tx) 
+            && (flatPtr->matrix.ty == matrix.ty)) {
+        return flatPtr;
+    }
+    
+    segs.space = segs.staticSpace = staticSpace;
+    segs.spaceSize = MAX_NUM_STATIC_SEGMENTS;
+    segs.spaceUsed = 0;
+    PathAtomIterInit(&iter, atomPtr);
+    while (PathAtomIterMore(&iter)) {
+        MakeSubPathSegments(&iter, &segs, matrixPtr, tolerance);
+        if (subPaths == NULL) {
+            subPathsSize = 4;
+            subPaths = (int *) ckalloc((unsigned) (3*subPathsSize*sizeof(int)));
+        } else if (numSubPaths == subPathsSize) {
+            subPathsSize *= 2;
+            subPaths = (int *) ckrealloc((char *) subPaths, 
+                    (unsigned) (3*subPathsSize*sizeof(int)));
+        }
+        subPaths[3*numSubPaths] = (int) (segs.polyPtr - segs.space)/2;
+        subPaths[3*numSubPaths+1] = segs.numPoints;
+        subPaths[3*numSubPaths+2] = segs.numStrokes;
+        numSubPaths++;
+    }
+
+    /* 
+     * Everything goes in one block with the points right after the
+     * struct, which keeps them aligned, and the subpaths last.
+     */
+    if (flatPtr != NULL) {
+        ckfree((char *) flatPtr);
+    }
+    TkPathFreeEdgeCache(itemPtr->edgeCache);
+    itemPtr->edgeCache = NULL;
+    size = sizeof(PathFlatCache) + 2*segs.spaceUsed*sizeof(double)
+            + 3*numSubPaths*sizeof(int);
+    flatPtr = (PathFlatCache *) ckalloc(size);
+    flatPtr->matrix = matrix;
+    flatPtr->tolerance = tolerance;
+    flatPtr->points = (double *) (flatPtr + 1);
+    flatPtr->subPaths = (int *) (flatPtr->points + 2*segs.spaceUsed);
+    flatPtr->numSubPaths = numSubPaths;
+    memcpy(flatPtr->points, segs.space, 2*segs.spaceUsed*sizeof(double));
+    if (numSubPaths > 0) {
+        memcpy(flatPtr->subPaths, subPaths, 3*numSubPaths*sizeof(int));
+    }
+    if (subPaths != NULL) {
+        ckfree((char *) subPaths);
+    }
+    if (segs.space != staticSpace) {
+        ckfree((char *) segs.space);
+    }
+    itemPtr->flatCache = (void *) flatPtr;
+    return flatPtr;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * NextSubPathSegments --
+ *
+ *	Gives the segments of the next subpath from the flattened path.
+ *	If flatPtr is NULL the atoms are an untransformed PATH_PACKED_POLY
+ *	and its coords are used as is since they are the one and only
+ *	subpath.
+ *
+ * Results:
+ *	1 if segPtr got a subpath, 0 if there are no more.
+ *
+ * Side effects:
+ *	The iterator or *indexPtr is advanced.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+NextSubPathSegments(
+    PathAtomIter *iterPtr, 
+    PathFlatCache *flatPtr, 
+    int *indexPtr,		/* Next subpath in flatPtr. */
+    PathSegments *segPtr)
+{
+    PathPacked *packedPtr = iterPtr->packedPtr;
+    int *subPathPtr;
+    
+    if (flatPtr == NULL) {
+        if (!PathAtomIterMore(iterPtr)) {
+            return 0;
+        }
+        segPtr->polyPtr = packedPtr->coords;
+        segPtr->numPoints = packedPtr->numAtoms;
+        segPtr->numStrokes = 0;
+        if (packedPtr->numAtoms > 1) {
+            segPtr->numStrokes = (packedPtr->flags & PATH_PACKED_CLOSED) ? 
+                    packedPtr->numAtoms : packedPtr->numAtoms - 1;
+        }
+        iterPtr->atom = packedPtr->numAtoms;
+        iterPtr->coord = packedPtr->numCoords;
+        return 1;
+    }
+    if (*indexPtr >= flatPtr->numSubPaths) {
+        return 0;
+    }
+    subPathPtr = flatPtr->subPaths + 3*(*indexPtr);
+    segPtr->polyPtr = flatPtr->points + 2*subPathPtr[0];
+    segPtr->numPoints = subPathPtr[1];
+    segPtr->numStrokes = subPathPtr[2];
+    (*indexPtr)++;
+    return 1;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetEdgeTree --
+ *
+ *	Gives the edge tree for a subpath of an item, making it
+ *	the first time it is asked for. The points must be those of
+ *	the item or its flatCache, which the tree is dropped with.
+ *
+ * Results:
+ *	The edge tree.
+ *
+ * Side effects:
+ *	May add a tree to itemPtr->edgeCache.
+ *
+ *--------------------------------------------------------------
+ */
+
+static PathEdgeTree *
+GetEdgeTree(
+    Tk_PathItem *itemPtr,
+    double *polyPtr,		/* The subpath: x0, y0, x1, y1, ... */
+    int numPoints)		/* Number of points, at least 2. */
+{
+    PathEdgeTree *treePtr;
+    int numEdges = numPoints - 1;
+    int numRuns, numLeaves, i, j, last;
+    double *boxPtr, *pPtr;
+
+    for (treePtr = (PathEdgeTree *) itemPtr->edgeCache; treePtr != NULL;
+            treePtr = treePtr->nextPtr) {
+        if ((treePtr->polyPtr == polyPtr) && (treePtr->numPoints == numPoints)) {
+            return treePtr;
         }
-        atomPtr = atomPtr->nextPtr;
     }
+    numRuns = (numEdges + kPathEdgeTreeLeafEdges - 1)/kPathEdgeTreeLeafEdges;
+    for (numLeaves = 1; numLeaves < numRuns; numLeaves *= 2) {
+        /* Empty. */
+    }
+    treePtr = (PathEdgeTree *) ckalloc((unsigned) (sizeof(PathEdgeTree)
+            + 4*(2*numLeaves - 1)*sizeof(double)));
+    treePtr->polyPtr = polyPtr;
+    treePtr->numPoints = numPoints;
+    treePtr->numLeaves = numLeaves;
+    treePtr->boxes = (double *) (treePtr + 1);
 
-done:
-    if (numPoints > 1) {
-        if (isclosed) {
-            numStrokes = numPoints;
+    /*
+     * Leaf boxes from the points, then each node from its children.
+     */
+    for (i = 0; i < numLeaves; i++) {
+        boxPtr = treePtr->boxes + 4*(numLeaves - 1 + i);
+        if (i >= numRuns) {
+            boxPtr[0] = boxPtr[1] = 1.0e300;
+            boxPtr[2] = boxPtr[3] = -1.0e300;
+            continue;
+        }
+        pPtr = polyPtr + 2*i*kPathEdgeTreeLeafEdges;
+        last = MIN(kPathEdgeTreeLeafEdges, numEdges - i*kPathEdgeTreeLeafEdges);
+        boxPtr[0] = boxPtr[2] = pPtr[0];
+        boxPtr[1] = boxPtr[3] = pPtr[1];
+        for (j = 1; j <= last; j++) {
+            boxPtr[0] = MIN(boxPtr[0], pPtr[2*j]);
+            boxPtr[1] = MIN(boxPtr[1], pPtr[2*j+1]);
+            boxPtr[2] = MAX(boxPtr[2], pPtr[2*j]);
+            boxPtr[3] = MAX(boxPtr[3], pPtr[2*j+1]);
+        }
+    }
+    for (i = numLeaves - 2; i >= 0; i--) {
+        double *b1Ptr = treePtr->boxes + 4*(2*i + 1);
+        double *b2Ptr = b1Ptr + 4;
+
+        boxPtr = treePtr->boxes + 4*i;
+        boxPtr[0] = MIN(b1Ptr[0], b2Ptr[0]);
+        boxPtr[1] = MIN(b1Ptr[1], b2Ptr[1]);
+        boxPtr[2] = MAX(b1Ptr[2], b2Ptr[2]);
+        boxPtr[3] = MAX(b1Ptr[3], b2Ptr[3]);
+    }
+    treePtr->nextPtr = (PathEdgeTree *) itemPtr->edgeCache;
+    itemPtr->edgeCache = (void *) treePtr;
+    return treePtr;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * EdgeTreeToPoint --
+ *
+ *	Does what PathPolygonToPointEx does for the subpath of an
+ *	edge tree, but only looks at the edges that can be closer
+ *	than the closest one found so far and at those that span the
+ *	x-coordinate of the point, which are the ones that can cross
+ *	the ray from it.
+ *
+ * Results:
+ *	The distance from the point to the closest edge, and the
+ *	crossings as PathPolygonToPointEx gives them.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static double
+EdgeTreeToPoint(
+    PathEdgeTree *treePtr,
+    double *pointPtr,		/* Points to coords for point. */
+    int *intersectionsPtr,	/* (out) The number of intersections. */
+    int *nonzerorulePtr)	/* (out) The number of intersections
+				 * considering crossing direction. */
+{
+    double x = pointPtr[0], y = pointPtr[1];
+    double bestDist, dist, dx, dy, d1, d2, *boxPtr;
+    int intersections = 0, nonzerorule = 0, runIntersections, runRule;
+    int stack[64], depth, node, child, first, numEdges;
+
+    bestDist = 1.0e36;
+    numEdges = treePtr->numPoints - 1;
+    stack[0] = 0;
+    depth = 1;
+    while (depth > 0) {
+        node = stack[--depth];
+        boxPtr = treePtr->boxes + 4*node;
+        if ((x < boxPtr[0]) || (x > boxPtr[2])) {
+            dx = MAX(boxPtr[0] - x, x - boxPtr[2]);
+            dy = MAX(0.0, MAX(boxPtr[1] - y, y - boxPtr[3]));
+            if (dx*dx + dy*dy >= bestDist*bestDist) {
+                continue;
+            }
+        }
+        if (node >= treePtr->numLeaves - 1) {
+            first = (node - treePtr->numLeaves + 1)*kPathEdgeTreeLeafEdges;
+            dist = PathPolygonToPointEx(treePtr->polyPtr + 2*first, 
+                    MIN(kPathEdgeTreeLeafEdges, numEdges - first) + 1, 
+                    pointPtr, &runIntersections, &runRule);
+            intersections += runIntersections;
+            nonzerorule += runRule;
+            if (dist < bestDist) {
+                bestDist = dist;
+            }
+            continue;
+        }
+        
+        /*
+         * Push the farther child first so that the nearer one is
+         * searched first and prunes more.
+         */
+        child = 2*node + 1;
+        boxPtr = treePtr->boxes + 4*child;
+        dx = MAX(0.0, MAX(boxPtr[0] - x, x - boxPtr[2]));
+        dy = MAX(0.0, MAX(boxPtr[1] - y, y - boxPtr[3]));
+        d1 = dx*dx + dy*dy;
+        dx = MAX(0.0, MAX(boxPtr[4] - x, x - boxPtr[6]));
+        dy = MAX(0.0, MAX(boxPtr[5] - y, y - boxPtr[7]));
+        d2 = dx*dx + dy*dy;
+        if (d1 <= d2) {
+            stack[depth++] = child + 1;
+            stack[depth++] = child;
         } else {
-            numStrokes = numPoints - 1;
+            stack[depth++] = child;
+            stack[depth++] = child + 1;
         }
     }
-    *numPointsPtr = numPoints;
-    *numStrokesPtr = numStrokes;
-    *atomPtrPtr = atomPtr;
+    *intersectionsPtr = intersections;
+    *nonzerorulePtr = nonzerorule;
+    return bestDist;
+}
 
-    return;
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathFreeEdgeCache --
+ *
+ *	Frees the edge trees of an item.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathFreeEdgeCache(
+    void *edgeCache)
+{
+    PathEdgeTree *treePtr = (PathEdgeTree *) edgeCache;
+    PathEdgeTree *nextPtr;
+
+    while (treePtr != NULL) {
+        nextPtr = treePtr->nextPtr;
+        ckfree((char *) treePtr);
+        treePtr = nextPtr;
+    }
 }
 
 /*
@@ -1703,7 +2481,7 @@ SubPathToArea(
  *
  * TranslatePathAtoms --
  *
- *	This procedure is called to translate a linked list of path atoms.
+ *	This procedure is called to translate packed path atoms.
  *
  * Results:
  *	None.
@@ -1716,12 +2494,27 @@ SubPathToArea(
 
 void
 TranslatePathAtoms(
-    PathAtom *atomPtr,
+    PathPacked *packedPtr,
     double deltaX,				/* Amount by which item is to be */
     double deltaY)              /* moved. */
 {
-    while (atomPtr != NULL) {
-        switch (atomPtr->type) {
+    PathAtomIter iter;
+    double	*atomPtr;
+    int		type;
+
+    if (packedPtr->flags & PATH_PACKED_POLY) {
+        double *coords = packedPtr->coords;
+        int i;
+
+        for (i = 0; i < packedPtr->numCoords; i += 2) {
+            coords[i] += deltaX;
+            coords[i+1] += deltaY;
+        }
+        return;
+    }
+    PathAtomIterInit(&iter, packedPtr);
+    while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
+        switch (type) {
             case PATH_ATOM_M: {
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
                 
@@ -1776,7 +2569,6 @@ TranslatePathAtoms(
                 break;
             }
         }
-        atomPtr = atomPtr->nextPtr;
     }
 }
 
@@ -1785,7 +2577,7 @@ TranslatePathAtoms(
  *
  * ScalePathAtoms --
  *
- *	This procedure is called to scale a linked list of path atoms.
+ *	This procedure is called to scale packed path atoms.
  *	The following transformation is applied to all point
  *	coordinates:
  *	x' = originX + scaleX*(x-originX)
@@ -1802,13 +2594,28 @@ TranslatePathAtoms(
 
 void
 ScalePathAtoms(
-    PathAtom *atomPtr,
+    PathPacked *packedPtr,
     double originX, double originY,	/* Origin about which to scale rect. */
     double scaleX,			/* Amount to scale in X direction. */
     double scaleY)			/* Amount to scale in Y direction. */
 {
-    while (atomPtr != NULL) {
-        switch (atomPtr->type) {
+    PathAtomIter iter;
+    double	*atomPtr;
+    int		type;
+
+    if (packedPtr->flags & PATH_PACKED_POLY) {
+        double *coords = packedPtr->coords;
+        int i;
+
+        for (i = 0; i < packedPtr->numCoords; i += 2) {
+            coords[i] = originX + scaleX*(coords[i] - originX);
+            coords[i+1] = originY + scaleY*(coords[i+1] - originY);
+        }
+        return;
+    }
+    PathAtomIterInit(&iter, packedPtr);
+    while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
+        switch (type) {
             case PATH_ATOM_M: {
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
                 
@@ -1887,7 +2694,6 @@ ScalePathAtoms(
                 break;
             }
         }
-        atomPtr = atomPtr->nextPtr;
     }
 }
 
@@ -1906,6 +2712,37 @@ GetCanvasTMatrix(Tk_PathCanvas canvas)
     return m;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathCanvasItemExDisplay --
+ *
+ *	Generic displayProc for items that do their drawing in a
+ *	displayContextProc. Sets up a drawing context for the drawable
+ *	and hands over to the item. Normally DisplayCanvas calls the
+ *	displayContextProc directly using its shared context.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Item is drawn in drawable.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathCanvasItemExDisplay(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+	Display *display, Drawable drawable, int x, int y, int width, int height)
+{
+    TkPathContext ctx;
+
+    ctx = TkPathInit(Tk_PathCanvasTkwin(canvas), drawable);
+    (*itemPtr->typePtr->displayContextProc)(canvas, itemPtr, ctx,
+	    x, y, width, height);
+    TkPathFree(ctx);
+}
+
 PathRect
 NewEmptyPathRect(void)
 {
@@ -2044,8 +2881,58 @@ PathPolyLineToArea(
     if (state == 0) {
         return 0;
     }
-    for (pPtr = polyPtr+2, count = numPoints-1; count >= 2;
-            pPtr += 2, count--) {
+    pPtr = polyPtr+2;
+    count = numPoints-1;
+#ifdef PATH_SSE2
+
+    /*
+     * Most edges of a large polygon lie with both ends on the same
+     * side of the rectangle, or both ends inside it. Check two edges
+     * at a time for that and only call TkLineToArea for the others.
+     */
+
+    {
+        __m128d rx1 = _mm_set1_pd(rectPtr[0]);
+        __m128d ry1 = _mm_set1_pd(rectPtr[1]);
+        __m128d rx2 = _mm_set1_pd(rectPtr[2]);
+        __m128d ry2 = _mm_set1_pd(rectPtr[3]);
+        __m128d p0, p1, p2, xa, ya, xb, yb, same;
+
+        for (; count >= 3; pPtr += 4, count -= 2) {
+            p0 = _mm_loadu_pd(pPtr);
+            p1 = _mm_loadu_pd(pPtr+2);
+            p2 = _mm_loadu_pd(pPtr+4);
+            xa = _mm_unpacklo_pd(p0, p1);
+            ya = _mm_unpackhi_pd(p0, p1);
+            xb = _mm_unpacklo_pd(p1, p2);
+            yb = _mm_unpackhi_pd(p1, p2);
+            if (state < 0) {
+                same = _mm_or_pd(
+                        _mm_or_pd(
+                            _mm_and_pd(_mm_cmplt_pd(xa, rx1), _mm_cmplt_pd(xb, rx1)),
+                            _mm_and_pd(_mm_cmpgt_pd(xa, rx2), _mm_cmpgt_pd(xb, rx2))),
+                        _mm_or_pd(
+                            _mm_and_pd(_mm_cmplt_pd(ya, ry1), _mm_cmplt_pd(yb, ry1)),
+                            _mm_and_pd(_mm_cmpgt_pd(ya, ry2), _mm_cmpgt_pd(yb, ry2))));
+            } else {
+                same = _mm_and_pd(
+                        _mm_and_pd(
+                            _mm_and_pd(_mm_cmpge_pd(xa, rx1), _mm_cmple_pd(xa, rx2)),
+                            _mm_and_pd(_mm_cmpge_pd(ya, ry1), _mm_cmple_pd(ya, ry2))),
+                        _mm_and_pd(
+                            _mm_and_pd(_mm_cmpge_pd(xb, rx1), _mm_cmple_pd(xb, rx2)),
+                            _mm_and_pd(_mm_cmpge_pd(yb, ry1), _mm_cmple_pd(yb, ry2))));
+            }
+            if (_mm_movemask_pd(same) != 3) {
+                if ((TkLineToArea(pPtr, pPtr+2, rectPtr) != state)
+                        || (TkLineToArea(pPtr+2, pPtr+4, rectPtr) != state)) {
+                    return 0;
+                }
+            }
+        }
+    }
+#endif
+    for (; count >= 2; pPtr += 2, count--) {
         if (TkLineToArea(pPtr, pPtr+2, rectPtr) != state) {
             return 0;
         }
@@ -2280,8 +3167,73 @@ PathPolygonToPointEx(
     bestDist = 1.0e36;
     intersections = 0;
     nonzerorule = 0;
+    count = numPoints;
+    pPtr = polyPtr;
+#ifdef PATH_SSE2
+
+    /*
+     * Two edges at a time, one in each lane. The closest point is
+     * found by projecting onto the edge, which is the same point as
+     * the one the loop below finds with line equations. The crossing
+     * test is the one below with the vertical and horizontal cases
+     * folded in: a vertical edge has an empty x-range and a
+     * horizontal edge has m1 = 0.
+     */
+
+    if (count >= 3) {
+        __m128d px = _mm_set1_pd(pointPtr[0]);
+        __m128d py = _mm_set1_pd(pointPtr[1]);
+        __m128d zero = _mm_setzero_pd();
+        __m128d one = _mm_set1_pd(1.0);
+        __m128d best = _mm_set1_pd(1.0e72);
+        __m128d p0, p1, p2, xa, ya, xb, yb, dx, dy, ex, ey, len2, t, m1, b1;
+        __m128d cross;
+        int mask, left;
+
+        p0 = _mm_loadu_pd(pPtr);
+        for (; count >= 3; count -= 2, pPtr += 4) {
+            p1 = _mm_loadu_pd(pPtr+2);
+            p2 = _mm_loadu_pd(pPtr+4);
+            xa = _mm_unpacklo_pd(p0, p1);
+            ya = _mm_unpackhi_pd(p0, p1);
+            xb = _mm_unpacklo_pd(p1, p2);
+            yb = _mm_unpackhi_pd(p1, p2);
+            p0 = p2;
+
+            dx = _mm_sub_pd(xb, xa);
+            dy = _mm_sub_pd(yb, ya);
+            ex = _mm_sub_pd(px, xa);
+            ey = _mm_sub_pd(py, ya);
+            len2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+            t = _mm_div_pd(_mm_add_pd(_mm_mul_pd(ex, dx), _mm_mul_pd(ey, dy)), len2);
+            t = _mm_and_pd(t, _mm_cmpgt_pd(len2, zero));
+            t = _mm_min_pd(_mm_max_pd(t, zero), one);
+            ex = _mm_sub_pd(ex, _mm_mul_pd(t, dx));
+            ey = _mm_sub_pd(ey, _mm_mul_pd(t, dy));
+            best = _mm_min_pd(best,
+                    _mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey)));
+
+            m1 = _mm_div_pd(dy, dx);
+            b1 = _mm_sub_pd(ya, _mm_mul_pd(m1, xa));
+            cross = _mm_and_pd(
+                    _mm_cmpgt_pd(_mm_add_pd(_mm_mul_pd(m1, px), b1), py),
+                    _mm_and_pd(_mm_cmpge_pd(px, _mm_min_pd(xa, xb)),
+                        _mm_cmplt_pd(px, _mm_max_pd(xa, xb))));
+            mask = _mm_movemask_pd(cross);
+            if (mask) {
+                left = mask & _mm_movemask_pd(_mm_cmpge_pd(xa, xb));
+                mask = (mask & 1) + (mask >> 1);
+                left = (left & 1) + (left >> 1);
+                intersections += mask;
+                nonzerorule += 2*left - mask;
+            }
+        }
+        best = _mm_min_pd(best, _mm_unpackhi_pd(best, best));
+        bestDist = sqrt(_mm_cvtsd_f64(best));
+    }
+#endif
 
-    for (count = numPoints, pPtr = polyPtr; count > 1; count--, pPtr += 2) {
+    for (; count > 1; count--, pPtr += 2) {
         double x, y, dist;
     
         /*
@@ -2391,6 +3343,217 @@ PathPolygonToPointEx(
     return bestDist;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * PathSimplifyPoly --
+ *
+ *	Picks the points of a polyline that are needed to draw it
+ *	to within a tolerance in device pixels. If the points go
+ *	monotonically in x on the device, as for a time series, the
+ *	first, last, lowest and highest point of each column of
+ *	tolerance width are kept. Otherwise points closer than the
+ *	tolerance to the last one kept are dropped and the rest are
+ *	thinned with the Douglas-Peucker algorithm.
+ *
+ * Results:
+ *	The number of points put in outPtr, which are copied from
+ *	coords untransformed. The first and last points are always
+ *	kept.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+PathSimplifyPoly(
+    double *coords,		/* The polyline: x0, y0, x1, y1, ... */
+    int numPoints,		/* Number of points in coords. */
+    TMatrix *mPtr,		/* Maps coords to device, or NULL. */
+    double tolerance,		/* Tolerance in device pixels. */
+    double *outPtr)		/* Room for numPoints points. */
+{
+    double *dev, *pPtr, x, y;
+    int *keep, *stack;
+    int i, k, numOut, increasing, decreasing, depth;
+
+    if ((numPoints <= 2) || (tolerance <= 0.0)) {
+        memcpy(outPtr, coords, 2*numPoints*sizeof(double));
+        return numPoints;
+    }
+    dev = (double *) ckalloc((unsigned) (2*numPoints*sizeof(double)));
+    keep = (int *) ckalloc((unsigned) (2*numPoints*sizeof(int)));
+    increasing = decreasing = 1;
+    for (i = 0, pPtr = coords; i < numPoints; i++, pPtr += 2) {
+        x = pPtr[0];
+        y = pPtr[1];
+        if (mPtr != NULL) {
+            PathApplyTMatrix(mPtr, &x, &y);
+        }
+        dev[2*i] = x;
+        dev[2*i+1] = y;
+        if (i > 0) {
+            increasing = increasing && (x >= dev[2*i-2]);
+            decreasing = decreasing && (x <= dev[2*i-2]);
+        }
+    }
+
+    numOut = 0;
+    if (increasing || decreasing) {
+        numOut = PathSimplifyColumns(dev, 0, numPoints, NULL, tolerance, keep);
+    } else {
+        double dx, dy, len, dist, maxDist, tol2 = tolerance*tolerance;
+        int numIdx, lo, hi, maxIdx;
+        int *idx = keep + numPoints;
+
+        /*
+         * Drop the points near the last one kept, keeping the last
+         * point in any case, then mark the points that Douglas-Peucker
+         * keeps of the rest by setting keep[k] to 1.
+         */
+        idx[0] = 0;
+        numIdx = 1;
+        for (i = 1; i < numPoints-1; i++) {
+            dx = dev[2*i] - dev[2*idx[numIdx-1]];
+            dy = dev[2*i+1] - dev[2*idx[numIdx-1]+1];
+            if (dx*dx + dy*dy > tol2) {
+                idx[numIdx++] = i;
+            }
+        }
+        idx[numIdx++] = numPoints-1;
+        memset(keep, 0, numIdx*sizeof(int));
+        keep[0] = keep[numIdx-1] = 1;
+        stack = (int *) ckalloc((unsigned) (2*numIdx*sizeof(int)));
+        stack[0] = 0;
+        stack[1] = numIdx-1;
+        depth = 1;
+        while (depth > 0) {
+            depth--;
+            lo = stack[2*depth];
+            hi = stack[2*depth+1];
+            if (hi - lo < 2) {
+                continue;
+            }
+            dx = dev[2*idx[hi]] - dev[2*idx[lo]];
+            dy = dev[2*idx[hi]+1] - dev[2*idx[lo]+1];
+            len = hypot(dx, dy);
+            maxDist = -1.0;
+            maxIdx = lo;
+            for (k = lo+1; k < hi; k++) {
+                x = dev[2*idx[k]] - dev[2*idx[lo]];
+                y = dev[2*idx[k]+1] - dev[2*idx[lo]+1];
+                if (len > 0.0) {
+                    dist = fabs(x*dy - y*dx)/len;
+                } else {
+                    dist = hypot(x, y);
+                }
+                if (dist > maxDist) {
+                    maxDist = dist;
+                    maxIdx = k;
+                }
+            }
+            if (maxDist > tolerance) {
+                keep[maxIdx] = 1;
+                stack[2*depth] = lo;
+                stack[2*depth+1] = maxIdx;
+                stack[2*depth+2] = maxIdx;
+                stack[2*depth+3] = hi;
+                depth += 2;
+            }
+        }
+        ckfree((char *) stack);
+        for (k = 0; k < numIdx; k++) {
+            if (keep[k]) {
+                keep[numOut++] = idx[k];
+            }
+        }
+    }
+    for (i = 0; i < numOut; i++) {
+        outPtr[2*i] = coords[2*keep[i]];
+        outPtr[2*i+1] = coords[2*keep[i]+1];
+    }
+    ckfree((char *) keep);
+    ckfree((char *) dev);
+    return numOut;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathSimplifyColumns --
+ *
+ *	The part of PathSimplifyPoly for points that go monotonically
+ *	in x on the device. The points from first on are split into
+ *	columns of tolerance width, and the first, last, lowest and
+ *	highest point of each are kept. Since a column only depends on
+ *	its own points, a caller that keeps the result can redo just
+ *	the columns at either end when points are added or removed
+ *	there, as long as first is where a column starts.
+ *
+ * Results:
+ *	The number of indices put in keepPtr, in increasing order.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+PathSimplifyColumns(
+    double *coords,		/* The polyline: x0, y0, x1, y1, ... */
+    int first, int last,	/* Range of points to use, last not
+				 * included. */
+    TMatrix *mPtr,		/* Maps coords to device, or NULL. */
+    double tolerance,		/* Tolerance in device pixels. */
+    int *keepPtr)		/* Room for last-first indices. */
+{
+    double x, y, col, loY, hiY;
+    int i, j, lo, hi, numOut = 0;
+
+    for (i = first; i < last; i = j) {
+        x = coords[2*i];
+        y = coords[2*i+1];
+        if (mPtr != NULL) {
+            PathApplyTMatrix(mPtr, &x, &y);
+        }
+        col = floor(x/tolerance);
+        lo = hi = i;
+        loY = hiY = y;
+        for (j = i+1; j < last; j++) {
+            x = coords[2*j];
+            y = coords[2*j+1];
+            if (mPtr != NULL) {
+                PathApplyTMatrix(mPtr, &x, &y);
+            }
+            if (floor(x/tolerance) != col) {
+                break;
+            }
+            if (y < loY) {
+                lo = j;
+                loY = y;
+            }
+            if (y > hiY) {
+                hi = j;
+                hiY = y;
+            }
+        }
+        keepPtr[numOut++] = i;
+        if (MIN(lo, hi) > i) {
+            keepPtr[numOut++] = MIN(lo, hi);
+        }
+        if (MAX(lo, hi) > keepPtr[numOut-1]) {
+            keepPtr[numOut++] = MAX(lo, hi);
+        }
+        if (j-1 > keepPtr[numOut-1]) {
+            keepPtr[numOut++] = j-1;
+        }
+    }
+    return numOut;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -2654,6 +3817,7 @@ TkPathCanvasItemExConfigure(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathIte
     Tk_PathItem *itemPtr = (Tk_PathItem *) itemExPtr;
     Tk_PathStyle *stylePtr = &itemExPtr->style;
 
+    TkPathCanvasInheritedStyleChanged(itemPtr);
     tkwin = Tk_PathCanvasTkwin(canvas);
     if (mask & PATH_CORE_OPTION_PARENT) {
 	if (TkPathCanvasFindGroup(interp, canvas, itemPtr->parentObj, &parentPtr) != TCL_OK) {
@@ -2725,6 +3889,7 @@ PathGradientChangedProc(ClientData clientData, int flags)
     Tk_PathStyle *stylePtr = &(itemExPtr->style);
         
     if (flags) {
+	TkPathCanvasInheritedStyleChanged(itemPtr);
 	if (flags & PATH_GRADIENT_FLAG_DELETE) {
 	    TkPathFreePathColor(stylePtr->fill);	
 	    stylePtr->fill = NULL;
@@ -2749,6 +3914,7 @@ PathStyleChangedProc(ClientData clientData, int flags)
     Tk_PathItem *itemPtr = (Tk_PathItem *) itemExPtr;
         
     if (flags) {
+	TkPathCanvasInheritedStyleChanged(itemPtr);
 	if (flags & PATH_STYLE_FLAG_DELETE) {
 	    TkPathFreeStyle(itemExPtr->styleInst);	
 	    itemExPtr->styleInst = NULL;
@@ -2766,4 +3932,124 @@ PathStyleChangedProc(ClientData clientData, int flags)
     }
 }
 
+#ifdef PATH_BENCHMARK
+/*
+ *--------------------------------------------------------------
+ *
+ * PathBenchObjCmd --
+ *
+ *	Implements ::tkp::bench which times the edge loops of the hit
+ *	tests by themselves, without the canvas and item code around
+ *	them:
+ *
+ *	    tkp::bench polygontopoint coords x y count
+ *	    tkp::bench polylinetoarea coords x1 y1 x2 y2 count
+ *
+ *	The polygon is closed by repeating its first point. Only built
+ *	with PATH_BENCHMARK defined; build once more with PATH_NO_SIMD to
+ *	compare against the plain loops.
+ *
+ * Results:
+ *	A standard Tcl result. The interpreter result is a list of the
+ *	microseconds per call and what the last call returned, which is
+ *	the distance and the two crossing counts, or the area state.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+PathBenchObjCmd(ClientData clientData, Tcl_Interp* interp,
+        int objc, Tcl_Obj* CONST objv[])
+{
+    static CONST char *subCmds[] = {
+        "polygontopoint", "polylinetoarea", (char *) NULL
+    };
+    enum { BENCH_POLYGONTOPOINT, BENCH_POLYLINETOAREA };
+    Tcl_Obj **coordObjs, *resultObj;
+    Tcl_Time start, stop;
+    double *polyPtr, args[4], dist = 0.0;
+    double micros;
+    int index, numCoords, numArgs, numPoints, count, i;
+    int state = 0, intersections = 0, nonzerorule = 0;
+
+    if (objc < 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "option coords ?arg ...? count");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subCmds, "option", 0,
+            &index) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    numArgs = (index == BENCH_POLYGONTOPOINT) ? 2 : 4;
+    if (objc != numArgs + 4) {
+        Tcl_WrongNumArgs(interp, 2, objv, (index == BENCH_POLYGONTOPOINT) ?
+                "coords x y count" : "coords x1 y1 x2 y2 count");
+        return TCL_ERROR;
+    }
+    if (Tcl_ListObjGetElements(interp, objv[2], &numCoords,
+            &coordObjs) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if ((numCoords < 4) || (numCoords & 1)) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(
+                "expected an even number of at least 4 coordinates", -1));
+        return TCL_ERROR;
+    }
+    for (i = 0; i < numArgs; i++) {
+        if (Tcl_GetDoubleFromObj(interp, objv[3+i], &args[i]) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    }
+    if (Tcl_GetIntFromObj(interp, objv[3+numArgs], &count) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (count <= 0) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(
+                "count must be a positive integer", -1));
+        return TCL_ERROR;
+    }
+    numPoints = numCoords/2 + 1;
+    polyPtr = (double *) ckalloc((unsigned) (2 * numPoints * sizeof(double)));
+    for (i = 0; i < numCoords; i++) {
+        if (Tcl_GetDoubleFromObj(interp, coordObjs[i], &polyPtr[i]) != TCL_OK) {
+            ckfree((char *) polyPtr);
+            return TCL_ERROR;
+        }
+    }
+    polyPtr[numCoords] = polyPtr[0];
+    polyPtr[numCoords+1] = polyPtr[1];
+
+    Tcl_GetTime(&start);
+    for (i = 0; i < count; i++) {
+        if (index == BENCH_POLYGONTOPOINT) {
+            dist = PathPolygonToPointEx(polyPtr, numPoints, args,
+                    &intersections, &nonzerorule);
+        } else {
+            state = PathPolyLineToArea(polyPtr, numPoints, args);
+        }
+    }
+    Tcl_GetTime(&stop);
+    ckfree((char *) polyPtr);
+
+    micros = ((stop.sec - start.sec) * 1000000.0 
+            + (stop.usec - start.usec)) / count;
+    resultObj = Tcl_NewListObj(0, NULL);
+    Tcl_ListObjAppendElement(interp, resultObj, Tcl_NewDoubleObj(micros));
+    if (index == BENCH_POLYGONTOPOINT) {
+        Tcl_ListObjAppendElement(interp, resultObj, Tcl_NewDoubleObj(dist));
+        Tcl_ListObjAppendElement(interp, resultObj, 
+                Tcl_NewIntObj(intersections));
+        Tcl_ListObjAppendElement(interp, resultObj, 
+                Tcl_NewIntObj(nonzerorule));
+    } else {
+        Tcl_ListObjAppendElement(interp, resultObj, Tcl_NewIntObj(state));
+    }
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+#endif /* PATH_BENCHMARK */
+
 /*--------------------------------------------------------------------------*/
@@ -21,20 +21,29 @@ int	    CoordsForPointItems(Tcl_Interp *interp, Tk_PathCanvas canvas,
                     double *pointPtr, int objc, Tcl_Obj *CONST objv[]);
 int	    CoordsForRectangularItems(Tcl_Interp *interp, Tk_PathCanvas canvas, 
                     PathRect *rectPtr, int objc, Tcl_Obj *CONST objv[]);
-PathRect    GetGenericBarePathBbox(PathAtom *atomPtr);
-PathRect    GetGenericPathTotalBboxFromBare(PathAtom *atomPtr, Tk_PathStyle *stylePtr, PathRect *bboxPtr);
+int	    GetPackedCoordsFormat(Tcl_Obj *objPtr);
+int	    GetPackedCoordsFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr, int size,
+                    unsigned char **bytesPtr, int *numPtr);
+void	    CopyPackedCoords(unsigned char *bytes, int size, int num, double *coords);
+Tcl_Obj *   NewPackedCoordsObj(double *coords, int num, int size);
+PathRect    GetGenericBarePathBbox(PathPacked *atomPtr);
+PathRect    GetTransformedBarePathBbox(PathPacked *atomPtr, TMatrix *mPtr);
+PathRect    GetGenericPathTotalBboxFromBare(PathPacked *atomPtr, Tk_PathStyle *stylePtr, PathRect *bboxPtr);
 void	    SetGenericPathHeaderBbox(Tk_PathItem *headerPtr, TMatrix *mPtr,
                     PathRect *totalBboxPtr);
+void	    SetGenericPathHeaderBboxFromAtoms(Tk_PathItem *headerPtr, TMatrix *mPtr,
+                    PathPacked *atomPtr, PathRect *extraPtr, PathRect *bboxPtr,
+                    PathRect *totalBboxPtr);
 TMatrix	    GetCanvasTMatrix(Tk_PathCanvas canvas);
 PathRect    NewEmptyPathRect(void);
 int	    IsPathRectEmpty(PathRect *r);
 void	    IncludePointInRect(PathRect *r, double x, double y);
 double	    GenericPathToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Tk_PathStyle *stylePtr,
-		    PathAtom *atomPtr, int maxNumSegments, double *pointPtr);
+		    PathPacked *atomPtr, double *pointPtr);
 int	    GenericPathToArea(Tk_PathCanvas canvas,	Tk_PathItem *itemPtr, Tk_PathStyle *stylePtr,
-                    PathAtom * atomPtr, int maxNumSegments, double *areaPtr);
-void	    TranslatePathAtoms(PathAtom *atomPtr, double deltaX, double deltaY);
-void	    ScalePathAtoms(PathAtom *atomPtr, double originX, double originY,
+                    PathPacked *atomPtr, double *areaPtr);
+void	    TranslatePathAtoms(PathPacked *atomPtr, double deltaX, double deltaY);
+void	    ScalePathAtoms(PathPacked *atomPtr, double originX, double originY,
                     double scaleX, double scaleY);
 void	    TranslatePathRect(PathRect *r, double deltaX, double deltaY);
 void	    ScalePathRect(PathRect *r, double originX, double originY,
@@ -42,6 +51,10 @@ void	    ScalePathRect(PathRect *r, double originX, double originY,
 void	    TranslateItemHeader(Tk_PathItem *itemPtr, double deltaX, double deltaY);
 void	    ScaleItemHeader(Tk_PathItem *itemPtr, double originX, double originY,
 		    double scaleX, double scaleY);
+int	    PathSimplifyPoly(double *coords, int numPoints, TMatrix *mPtr,
+		    double tolerance, double *outPtr);
+int	    PathSimplifyColumns(double *coords, int first, int last,
+		    TMatrix *mPtr, double tolerance, int *keepPtr);
 
 /*
  * The canvas 'Area' and 'Point' functions.
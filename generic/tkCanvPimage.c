@@ -48,6 +48,8 @@ typedef struct PimageItem  {
     double tintAmount;
     int interpolation;
     PathRect *srcRegionPtr;
+    void *custom;	    /* The image converted by the backend and
+			     * cached between redraws. */
 } PimageItem;
 
 
@@ -65,7 +67,7 @@ static int	CreatePimage(Tcl_Interp *interp,
 static void	DeletePimage(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display);
 static void	DisplayPimage(Tk_PathCanvas canvas,
-		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+		    Tk_PathItem *itemPtr, TkPathContext ctx,
 		    int x, int y, int width, int height);
 static void	PimageBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
 static int	PimageCoords(Tcl_Interp *interp,
@@ -216,7 +218,7 @@ Tk_PathItemType tkPimageType = {
     ConfigurePimage,			/* configureProc */
     PimageCoords,			/* coordProc */
     DeletePimage,			/* deleteProc */
-    DisplayPimage,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     PimageBbox,				/* bboxProc */
     PimageToPoint,			/* pointProc */
@@ -230,6 +232,7 @@ Tk_PathItemType tkPimageType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPimage,			/* displayContextProc */
 };
                         
  
@@ -265,6 +268,7 @@ CreatePimage(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemP
     pimagePtr->tintAmount = 0.0;
     pimagePtr->interpolation = kPathImageInterpolationFast;
     pimagePtr->srcRegionPtr = NULL;
+    pimagePtr->custom = NULL;
     itemPtr->bbox = NewEmptyPathRect();
 
     if (optionTable == NULL) {
@@ -564,23 +568,23 @@ DeletePimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (pimagePtr->image != NULL) {
         Tk_FreeImage(pimagePtr->image);
     }
+    TkPathImageFree(pimagePtr->custom);
     Tk_FreeConfigOptions((char *) pimagePtr, optionTable, Tk_PathCanvasTkwin(canvas));
 }
 
 static void		
-DisplayPimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+DisplayPimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
         int x, int y, int width, int height)
 {
     PimageItem *pimagePtr = (PimageItem *) itemPtr;
     TMatrix m;
-    TkPathContext ctx;
     
     /* === EB - 23-apr-2010: register coordinate offsets */
     m = GetCanvasTMatrix(canvas);
     TkPathSetCoordOffsets(m.tx, m.ty);
-    ctx = TkPathInit(Tk_PathCanvasTkwin(canvas), drawable);
     /* === */
     
+    TkPathSaveState(ctx);
     TkPathPushTMatrix(ctx, &m);
     m = GetTMatrix(pimagePtr);
     TkPathPushTMatrix(ctx, &m);
@@ -589,8 +593,8 @@ DisplayPimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Draw
             itemPtr->bbox.x1+BBOX_OUT, itemPtr->bbox.y1+BBOX_OUT,
             pimagePtr->width, pimagePtr->height, pimagePtr->fillOpacity,
             pimagePtr->tintColor, pimagePtr->tintAmount, pimagePtr->interpolation,
-            pimagePtr->srcRegionPtr);
-    TkPathFree(ctx);
+            pimagePtr->srcRegionPtr, &pimagePtr->custom);
+    TkPathRestoreState(ctx);
 }
 
 static void	
@@ -653,6 +657,12 @@ ImageChangedProc(
 {
     PimageItem *pimagePtr = (PimageItem *) clientData;
 
+    /*
+     * The converted image is stale now.
+     */
+    TkPathImageFree(pimagePtr->custom);
+    pimagePtr->custom = NULL;
+
     /*
      * If the image's size changed and it's not anchored at its
      * northwest corner then just redisplay the entire area of the
@@ -671,6 +681,7 @@ ImageChangedProc(
                 pimagePtr->header.y1, pimagePtr->header.x2, pimagePtr->header.y2);
     } 
     ComputePimageBbox(pimagePtr->canvas, pimagePtr);
+    TkPathCanvasItemBboxChanged(pimagePtr->canvas, (Tk_PathItem *) pimagePtr);
     Tk_PathCanvasEventuallyRedraw(pimagePtr->canvas, pimagePtr->header.x1 + x,
             pimagePtr->header.y1 + y, (int) (pimagePtr->header.x1 + x + width),
             (int) (pimagePtr->header.y1 + y + height));
@@ -45,7 +45,7 @@ static int	CreatePline(Tcl_Interp *interp,
 static void	DeletePline(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display);
 static void	DisplayPline(Tk_PathCanvas canvas,
-		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+		    Tk_PathItem *itemPtr, TkPathContext ctx,
 		    int x, int y, int width, int height);
 static void	PlineBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
 static int	ProcessCoords(Tcl_Interp *interp, Tk_PathCanvas canvas, 
@@ -64,7 +64,7 @@ static void	ScalePline(Tk_PathCanvas canvas,
 		    double scaleX, double scaleY);
 static void	TranslatePline(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, double deltaX, double deltaY);
-static PathAtom * MakePathAtoms(PlineItem *plinePtr);
+static void	MakePathAtoms(PlineItem *plinePtr, PathPacked *atomPtr);
 static int      ConfigureArrows(Tk_PathCanvas canvas, PlineItem *linePtr);
 
 
@@ -100,7 +100,7 @@ Tk_PathItemType tkPlineType = {
     ConfigurePline,			/* configureProc */
     PlineCoords,			/* coordProc */
     DeletePline,			/* deleteProc */
-    DisplayPline,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     PlineBbox,				/* bboxProc */
     PlineToPoint,			/* pointProc */
@@ -114,6 +114,7 @@ Tk_PathItemType tkPlineType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPline,			/* displayContextProc */
 };
 
 static int		
@@ -137,6 +138,7 @@ CreatePline(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPt
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
     itemPtr->totalBbox = NewEmptyPathRect();
     TkPathArrowDescrInit(&plinePtr->startarrow);
     TkPathArrowDescrInit(&plinePtr->endarrow);
@@ -236,7 +238,8 @@ ComputePlineBbox(Tk_PathCanvas canvas, PlineItem *plinePtr)
     Tk_PathItem *itemPtr = &itemExPtr->header;
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
-    PathRect r;
+    PathRect r, arrowBbox;
+    PathPacked atoms;
 
     if(state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
@@ -251,10 +254,17 @@ ComputePlineBbox(Tk_PathCanvas canvas, PlineItem *plinePtr)
     r.x2 = MAX(plinePtr->coords.x1, plinePtr->coords.x2);
     r.y1 = MIN(plinePtr->coords.y1, plinePtr->coords.y2);
     r.y2 = MAX(plinePtr->coords.y1, plinePtr->coords.y2);
-    IncludeArrowPointsInRect(&r, &plinePtr->startarrow);
-    IncludeArrowPointsInRect(&r, &plinePtr->endarrow);
+    arrowBbox = NewEmptyPathRect();
+    IncludeArrowPointsInRect(&arrowBbox, &plinePtr->startarrow);
+    IncludeArrowPointsInRect(&arrowBbox, &plinePtr->endarrow);
+    if (!IsPathRectEmpty(&arrowBbox)) {
+        IncludePointInRect(&r, arrowBbox.x1, arrowBbox.y1);
+        IncludePointInRect(&r, arrowBbox.x2, arrowBbox.y2);
+    }
     itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(NULL, &style, &r);
-    SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr, &itemPtr->totalBbox);
+    MakePathAtoms(plinePtr, &atoms);
+    SetGenericPathHeaderBboxFromAtoms(&itemExPtr->header, style.matrixPtr, 
+            &atoms, &arrowBbox, &r, &itemPtr->totalBbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -323,14 +333,14 @@ ConfigurePline(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     }
 }
 
-static PathAtom *
-MakePathAtoms(PlineItem *plinePtr)
+/*
+ * The atoms use the two points in coords in place and need not be freed.
+ */
+
+static void
+MakePathAtoms(PlineItem *plinePtr, PathPacked *atomPtr)
 {
-    PathAtom *atomPtr;
-                
-    atomPtr = NewMoveToAtom(plinePtr->coords.x1, plinePtr->coords.y1);
-    atomPtr->nextPtr = NewLineToAtom(plinePtr->coords.x2, plinePtr->coords.y2);
-    return atomPtr;
+    PathPackedInitPoly(atomPtr, &plinePtr->coords.x1, 2, 0);
 }
 
 static void		
@@ -348,13 +358,13 @@ DeletePline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
 }
 
 static void		
-DisplayPline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+DisplayPline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
         int x, int y, int width, int height)
 {
     PlineItem *plinePtr = (PlineItem *) itemPtr;
     TMatrix m = GetCanvasTMatrix(canvas);
     PathRect r;
-    PathAtom *atomPtr;
+    PathPacked atoms;
     Tk_PathStyle style;
 
     /* === EB - 23-apr-2010: register coordinate offsets */
@@ -368,16 +378,16 @@ DisplayPline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawa
     IncludeArrowPointsInRect(&r, &plinePtr->startarrow);
     IncludeArrowPointsInRect(&r, &plinePtr->endarrow);
 
-    atomPtr = MakePathAtoms(plinePtr);
+    MakePathAtoms(plinePtr, &atoms);
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr, &style, &m, &r);
-    TkPathFreeAtoms(atomPtr);
+    TkPathDrawPathInContext(ctx, &atoms, &style, &m, &r,
+	    &itemPtr->pathCache);
 
     /*
      * Display arrowheads, if they are wanted.
      */
-    DisplayArrow(canvas, drawable, &plinePtr->startarrow, &style, &m, &r);
-    DisplayArrow(canvas, drawable, &plinePtr->endarrow, &style, &m, &r);
+    DisplayArrow(canvas, ctx, &plinePtr->startarrow, &style, &m, &r);
+    DisplayArrow(canvas, ctx, &plinePtr->endarrow, &style, &m, &r);
 
     TkPathCanvasFreeInheritedStyle(&style);
 }
@@ -394,16 +404,15 @@ PlineToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
 {
     PlineItem *plinePtr = (PlineItem *) itemPtr;
     Tk_PathStyle style;
-    PathAtom *atomPtr;
+    PathPacked atoms;
     double point;
     
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
 
     /* @@@ Perhaps we should do a simplified treatment here instead of the generic. */
-    atomPtr = MakePathAtoms(plinePtr);
+    MakePathAtoms(plinePtr, &atoms);
     point = GenericPathToPoint(canvas, itemPtr, &style, 
-            atomPtr, 2, pointPtr);
-    TkPathFreeAtoms(atomPtr);
+            &atoms, pointPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return point;
 }
@@ -413,16 +422,15 @@ PlineToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
 {
     PlineItem *plinePtr = (PlineItem *) itemPtr;
     Tk_PathStyle style;
-    PathAtom *atomPtr;
+    PathPacked atoms;
     int area;
     
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
 
     /* @@@ Perhaps we should do a simplified treatment here instead of the generic. */
-    atomPtr = MakePathAtoms(plinePtr);
+    MakePathAtoms(plinePtr, &atoms);
     area = GenericPathToArea(canvas, itemPtr, &style, 
-            atomPtr, 2, areaPtr);
-    TkPathFreeAtoms(atomPtr);
+            &atoms, areaPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return area;
 }
@@ -26,11 +26,22 @@ typedef struct PpolyItem  {
     Tk_PathItemEx headerEx; /* Generic stuff that's the same for all
                              * path types.  MUST BE FIRST IN STRUCTURE. */
     char type;		    /* Polyline or polygon. */
-    PathAtom *atomPtr;
-    int maxNumSegments;	    /* Max number of straight segments (for subpath)
-			     * needed for Area and Point functions. */
+    PathPacked atoms;	    /* The points as M, L... and Z atoms. */
     ArrowDescr startarrow;
     ArrowDescr endarrow;
+    double simplify;	    /* Tolerance in pixels when drawing, or 0. */
+    PathPacked simplified;  /* The points drawn if simplify > 0, made
+			     * from atoms when first needed. */
+    TMatrix simplifiedMatrix;
+			    /* The matrix simplified was made for. */
+    int simplifiedSource;   /* Number of points in atoms that simplified
+			     * was made from. Any points after those
+			     * have been appended since. */
+    int simplifiedDir;	    /* 1 or -1 if simplified was made by columns
+			     * from an open polyline whose points go
+			     * that way in x on the device, else 0. */
+    int trimmed;	    /* Number of points trimmed off since the
+			     * bbox was last computed from all points. */
 } PpolyItem;
 
 enum {
@@ -44,11 +55,13 @@ enum {
  */
 
 static void	ComputePpolyBbox(Tk_PathCanvas canvas, PpolyItem *ppolyPtr);
+static int	AppendPpolyCoords(Tcl_Interp *interp, Tk_PathCanvas canvas,
+                        PpolyItem *ppolyPtr, int objc, Tcl_Obj *CONST objv[]);
 static int	ConfigurePpoly(Tcl_Interp *interp, Tk_PathCanvas canvas, 
                         Tk_PathItem *itemPtr, int objc,
                         Tcl_Obj *CONST objv[], int flags);
 int		CoordsForPolygonline(Tcl_Interp *interp, Tk_PathCanvas canvas, int closed,
-                        int objc, Tcl_Obj *CONST objv[], PathAtom **atomPtrPtr, int *lenPtr);
+                        int objc, Tcl_Obj *CONST objv[], PathPacked *packedPtr, int *lenPtr);
 static int	CreateAny(Tcl_Interp *interp,
                         Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
                         int objc, Tcl_Obj *CONST objv[], char type);
@@ -60,11 +73,14 @@ static int	CreatePpolygon(Tcl_Interp *interp,
                         int objc, Tcl_Obj *CONST objv[]);
 static void	DeletePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display);
 static void	DisplayPpoly(Tk_PathCanvas canvas,
-                        Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+                        Tk_PathItem *itemPtr, TkPathContext ctx,
                         int x, int y, int width, int height);
 static void	PpolyBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
 static int	PpolyCoords(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
                         int objc, Tcl_Obj *CONST objv[]);
+static int	PpolyCanRedrawPart(Tk_PathCanvas canvas, PpolyItem *ppolyPtr);
+static void	PpolyIncludePart(Tk_PathCanvas canvas, PpolyItem *ppolyPtr,
+                        double *coords, int numPoints, PathRect *arrowBboxPtr);
 static int	PpolyToArea(Tk_PathCanvas canvas,
                         Tk_PathItem *itemPtr, double *rectPtr);
 static double	PpolyToPoint(Tk_PathCanvas canvas,
@@ -76,8 +92,19 @@ static void	ScalePpoly(Tk_PathCanvas canvas,
                         double scaleX, double scaleY);
 static void	TranslatePpoly(Tk_PathCanvas canvas,
                         Tk_PathItem *itemPtr, double deltaX, double deltaY);
+static int	TrimPpolyCoords(Tcl_Interp *interp, Tk_PathCanvas canvas,
+                        PpolyItem *ppolyPtr, int objc, Tcl_Obj *CONST objv[]);
 
 static int      ConfigureArrows(Tk_PathCanvas canvas, PpolyItem *ppolyPtr);
+static PathPacked *GetSimplifiedAtoms(PpolyItem *ppolyPtr, TMatrix *mPtr);
+static int	GoesInDirection(double *coords, int first, int last,
+                        TMatrix *mPtr, int dir);
+static double	ColumnKey(double *pointPtr, TMatrix *mPtr, double tolerance,
+                        int dir);
+static int	ColumnEnd(double *coords, int lo, int hi, TMatrix *mPtr,
+                        double tolerance, int dir, double key);
+static int	ExtendSimplifiedAtoms(PpolyItem *ppolyPtr);
+static void	TrimSimplifiedAtoms(PpolyItem *ppolyPtr);
 
 PATH_STYLE_CUSTOM_OPTION_RECORDS
 PATH_CUSTOM_OPTION_TAGS
@@ -85,6 +112,11 @@ PATH_OPTION_STRING_TABLES_FILL
 PATH_OPTION_STRING_TABLES_STROKE
 PATH_OPTION_STRING_TABLES_STATE
 
+#define PATH_OPTION_SPEC_SIMPLIFY(typeName)	    \
+    {TK_OPTION_DOUBLE, "-simplify", NULL, NULL,	    \
+        "0.0", -1, Tk_Offset(typeName, simplify),  \
+	0, 0, 0}
+
 static Tk_OptionSpec optionSpecsPolyline[] = {
     PATH_OPTION_SPEC_CORE(Tk_PathItemEx),
     PATH_OPTION_SPEC_PARENT,
@@ -93,6 +125,7 @@ static Tk_OptionSpec optionSpecsPolyline[] = {
     PATH_OPTION_SPEC_STYLE_STROKE(Tk_PathItemEx, "black"),
     PATH_OPTION_SPEC_STARTARROW_GRP(PpolyItem),
     PATH_OPTION_SPEC_ENDARROW_GRP(PpolyItem),
+    PATH_OPTION_SPEC_SIMPLIFY(PpolyItem),
     PATH_OPTION_SPEC_END
 };
 
@@ -102,6 +135,7 @@ static Tk_OptionSpec optionSpecsPpolygon[] = {
     PATH_OPTION_SPEC_STYLE_FILL(Tk_PathItemEx, ""),
     PATH_OPTION_SPEC_STYLE_MATRIX(Tk_PathItemEx),
     PATH_OPTION_SPEC_STYLE_STROKE(Tk_PathItemEx, "black"),
+    PATH_OPTION_SPEC_SIMPLIFY(PpolyItem),
     PATH_OPTION_SPEC_END
 };
 
@@ -121,7 +155,7 @@ Tk_PathItemType tkPolylineType = {
     ConfigurePpoly,			/* configureProc */
     PpolyCoords,			/* coordProc */
     DeletePpoly,			/* deleteProc */
-    DisplayPpoly,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     PpolyBbox,				/* bboxProc */
     PpolyToPoint,			/* pointProc */
@@ -135,6 +169,7 @@ Tk_PathItemType tkPolylineType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPpoly,			/* displayContextProc */
 };
 
 Tk_PathItemType tkPpolygonType = {
@@ -145,7 +180,7 @@ Tk_PathItemType tkPpolygonType = {
     ConfigurePpoly,			/* configureProc */
     PpolyCoords,			/* coordProc */
     DeletePpoly,			/* deleteProc */
-    DisplayPpoly,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     PpolyBbox,				/* bboxProc */
     PpolyToPoint,			/* pointProc */
@@ -159,6 +194,7 @@ Tk_PathItemType tkPpolygonType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPpoly,			/* displayContextProc */
 };
  
 
@@ -198,11 +234,15 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
-    ppolyPtr->atomPtr = NULL;
+    itemExPtr->inheritedEpoch = 0;
+    PathPackedInit(&ppolyPtr->atoms);
+    PathPackedInit(&ppolyPtr->simplified);
+    ppolyPtr->simplifiedSource = 0;
+    ppolyPtr->simplifiedDir = 0;
     ppolyPtr->type = type;
+    ppolyPtr->trimmed = 0;
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
-    ppolyPtr->maxNumSegments = 0;
     TkPathArrowDescrInit(&ppolyPtr->startarrow);
     TkPathArrowDescrInit(&ppolyPtr->endarrow);
 
@@ -223,7 +263,9 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
         goto error;
     }
 
-    for (i = 1; i < objc; i++) {
+    /* Packed coords are a flag and one bytearray. */
+    i = (GetPackedCoordsFormat(objv[0]) && (objc > 1)) ? 2 : 1;
+    for (; i < objc; i++) {
         char *arg = Tcl_GetString(objv[i]);
         if ((arg[0] == '-') && (arg[1] >= 'a') && (arg[1] <= 'z')) {
             break;
@@ -231,10 +273,9 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
     }
     if (CoordsForPolygonline(interp, canvas, 
 	    (ppolyPtr->type == kPpolyTypePolyline) ? 0 : 1, 
-	    i, objv, &(ppolyPtr->atomPtr), &len) != TCL_OK) {
+	    i, objv, &ppolyPtr->atoms, &len) != TCL_OK) {
         goto error;
     }
-    ppolyPtr->maxNumSegments = len;
    
     if (ConfigurePpoly(interp, canvas, itemPtr, objc-i, objv+i, 0) == TCL_OK) {
         return TCL_OK;
@@ -257,17 +298,305 @@ PpolyCoords(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
     int len, closed;
 
+    if (objc > 1) {
+        char *arg = Tcl_GetString(objv[0]);
+        
+        if (strcmp(arg, "append") == 0) {
+            return AppendPpolyCoords(interp, canvas, ppolyPtr, objc-1, objv+1);
+        } else if (strcmp(arg, "trim") == 0) {
+            return TrimPpolyCoords(interp, canvas, ppolyPtr, objc-1, objv+1);
+        }
+    }
     closed = (ppolyPtr->type == kPpolyTypePolyline) ? 0 : 1;
     if (CoordsForPolygonline(interp, canvas, closed, objc, objv, 
-            &(ppolyPtr->atomPtr), &len) != TCL_OK) {
+            &ppolyPtr->atoms, &len) != TCL_OK) {
         return TCL_ERROR;
     }
-    ppolyPtr->maxNumSegments = len;
+    if ((objc == 1) && GetPackedCoordsFormat(objv[0])) {
+        return TCL_OK;
+    }
+    if (objc > 0) {
+        TkPathFreeAtoms(&ppolyPtr->simplified);
+    }
     ConfigureArrows(canvas, ppolyPtr);
     ComputePpolyBbox(canvas, ppolyPtr);
     return TCL_OK;
 }	
 
+/*
+ *--------------------------------------------------------------
+ *
+ * AppendPpolyCoords --
+ *
+ *	Implements "coords tagOrId append x y ?x y ...?" which adds
+ *	points at the end of the line without touching the others.
+ *	The points may also be packed as for CoordsForPolygonline.
+ *
+ * Results:
+ *	Standard tcl result.
+ *
+ * Side effects:
+ *	The bbox is grown and, when possible, only the new segments
+ *	are redrawn.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+AppendPpolyCoords(
+    Tcl_Interp *interp, 
+    Tk_PathCanvas canvas, 
+    PpolyItem *ppolyPtr,
+    int objc, 
+    Tcl_Obj *CONST objv[])
+{
+    PathPacked *atomPtr = &ppolyPtr->atoms;
+    double staticSpace[64], *points = staticSpace, *coords;
+    PathRect arrowBbox;
+    unsigned char *bytes = NULL;
+    int i, part, size = 0;
+
+    if (objc == 2) {
+        size = GetPackedCoordsFormat(objv[0]);
+    }
+    if (size) {
+        if (GetPackedCoordsFromObj(interp, objv[1], size, &bytes, 
+                &objc) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    } else if (objc == 1) {
+        if (Tcl_ListObjGetElements(interp, objv[0], &objc,
+            (Tcl_Obj ***) &objv) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    }
+    if ((objc & 1) || (objc == 0)) {
+        char buf[64 + TCL_INTEGER_SPACE];
+        sprintf(buf, "wrong # coordinates: expected an even number, got %d", objc);
+        Tcl_SetResult(interp, buf, TCL_VOLATILE);
+        return TCL_ERROR;
+    }
+    if ((bytes == NULL) && (objc > 64)) {
+        points = (double *) ckalloc((unsigned) (objc * sizeof(double)));
+    }
+    for (i = 0; (bytes == NULL) && (i < objc); i++) {
+        if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i], 
+                points + i) != TCL_OK) {
+            if (points != staticSpace) {
+                ckfree((char *) points);
+            }
+            return TCL_ERROR;
+        }
+    }
+    part = PpolyCanRedrawPart(canvas, ppolyPtr);
+    
+    /*
+     * The old end point becomes an inner one and must be put back
+     * where it was before it was moved into the arrowhead.
+     */
+    arrowBbox = NewEmptyPathRect();
+    IncludeArrowPointsInRect(&arrowBbox, &ppolyPtr->endarrow);
+    if (ppolyPtr->endarrow.arrowPointsPtr != NULL) {
+        TkPathPreconfigureArrow((PathPoint *) 
+                (atomPtr->coords + atomPtr->numCoords - 2), &ppolyPtr->endarrow);
+    }
+    coords = PathPackedAppendPoly(atomPtr, objc/2);
+    if (bytes != NULL) {
+        CopyPackedCoords(bytes, size, objc, coords);
+    } else {
+        memcpy(coords, points, objc * sizeof(double));
+    }
+    if (points != staticSpace) {
+        ckfree((char *) points);
+    }
+    if (ppolyPtr->simplifiedDir == 0) {
+        /* Else GetSimplifiedAtoms adds the new points to it. */
+        TkPathFreeAtoms(&ppolyPtr->simplified);
+    }
+    ConfigureArrows(canvas, ppolyPtr);
+    
+    if (part) {
+        /* The segment before the new ones changes its end cap. */
+        IncludeArrowPointsInRect(&arrowBbox, &ppolyPtr->endarrow);
+        PpolyIncludePart(canvas, ppolyPtr, coords - 4, objc/2 + 2, &arrowBbox);
+    } else {
+        ComputePpolyBbox(canvas, ppolyPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TrimPpolyCoords --
+ *
+ *	Implements "coords tagOrId trim count" which removes the first
+ *	count points. At least two points must be left.
+ *
+ * Results:
+ *	Standard tcl result.
+ *
+ * Side effects:
+ *	When possible only the removed segments are redrawn. The bbox
+ *	is only made again from all points once half of them have been
+ *	trimmed off since last time, and until then may be too large.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+TrimPpolyCoords(
+    Tcl_Interp *interp, 
+    Tk_PathCanvas canvas, 
+    PpolyItem *ppolyPtr,
+    int objc, 
+    Tcl_Obj *CONST objv[])
+{
+    PathPacked *atomPtr = &ppolyPtr->atoms;
+    PathRect arrowBbox;
+    int count, numPoints, part;
+
+    if (objc != 1) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(
+                "wrong # args: should be \"coords tagOrId trim count\"", -1));
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIntFromObj(interp, objv[0], &count) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    numPoints = atomPtr->numAtoms;
+    if (atomPtr->flags & PATH_PACKED_CLOSED) {
+        numPoints--;
+    }
+    if ((count < 0) || (numPoints - count < 2)) {
+        char buf[64 + TCL_INTEGER_SPACE];
+        sprintf(buf, "wrong # coordinates: expected at least 4, got %d", 
+                2*(numPoints - count));
+        Tcl_SetResult(interp, buf, TCL_VOLATILE);
+        return TCL_ERROR;
+    }
+    if (count == 0) {
+        return TCL_OK;
+    }
+    part = PpolyCanRedrawPart(canvas, ppolyPtr);
+    if (part) {
+        /* The segment after the removed ones gets an end cap. */
+        arrowBbox = NewEmptyPathRect();
+        IncludeArrowPointsInRect(&arrowBbox, &ppolyPtr->startarrow);
+        PpolyIncludePart(canvas, ppolyPtr, atomPtr->coords, count + 2, &arrowBbox);
+    }
+    PathPackedTrimPoly(atomPtr, count);
+    ppolyPtr->simplifiedSource -= count;
+    ConfigureArrows(canvas, ppolyPtr);
+    TrimSimplifiedAtoms(ppolyPtr);
+    
+    if (part) {
+        if (ppolyPtr->startarrow.arrowPointsPtr != NULL) {
+            arrowBbox = NewEmptyPathRect();
+            IncludeArrowPointsInRect(&arrowBbox, &ppolyPtr->startarrow);
+            PpolyIncludePart(canvas, ppolyPtr, atomPtr->coords, 2, &arrowBbox);
+        }
+        ppolyPtr->trimmed += count;
+        if (2*ppolyPtr->trimmed >= atomPtr->numAtoms) {
+            ComputePpolyBbox(canvas, ppolyPtr);
+        }
+    } else {
+        ComputePpolyBbox(canvas, ppolyPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PpolyCanRedrawPart --
+ *
+ *	Tells if a change of some of the points of an item can be
+ *	handled by PpolyIncludePart. Polygons and simplified lines may
+ *	change shape far from the points that changed, and need the
+ *	whole item redrawn.
+ *
+ * Results:
+ *	1 if so, else 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+PpolyCanRedrawPart(Tk_PathCanvas canvas, PpolyItem *ppolyPtr)
+{
+    Tk_PathItem *itemPtr = &ppolyPtr->headerEx.header;
+    Tk_PathState state = itemPtr->state;
+
+    if (state == TK_PATHSTATE_NULL) {
+	state = TkPathCanvasState(canvas);
+    }
+    return ((state != TK_PATHSTATE_HIDDEN)
+            && !(ppolyPtr->atoms.flags & PATH_PACKED_CLOSED)
+            && (ppolyPtr->simplify <= 0.0)
+            && (itemPtr->x1 < itemPtr->x2) && (itemPtr->y1 < itemPtr->y2));
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PpolyIncludePart --
+ *
+ *	Grows the bboxes of an item to hold a run of its points and
+ *	asks for the area they cover to be redrawn.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets TK_ITEM_DONT_REDRAW to tell the canvas that it need not
+ *	redraw the whole item.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+PpolyIncludePart(
+    Tk_PathCanvas canvas,
+    PpolyItem *ppolyPtr,
+    double *coords,		/* The first point that changed. */
+    int numPoints,
+    PathRect *arrowBboxPtr)	/* Old and new arrowheads at the ends of
+				 * the run. */
+{
+    Tk_PathItem *itemPtr = &ppolyPtr->headerEx.header;
+    Tk_PathItem part;
+    Tk_PathStyle style;
+    PathPacked partAtoms;
+    PathRect bbox, totalBbox;
+
+    style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+    PathPackedInitPoly(&partAtoms, coords, numPoints, 0);
+    bbox = GetGenericBarePathBbox(&partAtoms);
+    if (!IsPathRectEmpty(arrowBboxPtr)) {
+        IncludePointInRect(&bbox, arrowBboxPtr->x1, arrowBboxPtr->y1);
+        IncludePointInRect(&bbox, arrowBboxPtr->x2, arrowBboxPtr->y2);
+    }
+    totalBbox = GetGenericPathTotalBboxFromBare(&partAtoms, &style, &bbox);
+    SetGenericPathHeaderBboxFromAtoms(&part, style.matrixPtr, &partAtoms,
+            arrowBboxPtr, &bbox, &totalBbox);
+    TkPathCanvasFreeInheritedStyle(&style);
+    
+    IncludePointInRect(&itemPtr->bbox, bbox.x1, bbox.y1);
+    IncludePointInRect(&itemPtr->bbox, bbox.x2, bbox.y2);
+    IncludePointInRect(&itemPtr->totalBbox, totalBbox.x1, totalBbox.y1);
+    IncludePointInRect(&itemPtr->totalBbox, totalBbox.x2, totalBbox.y2);
+    itemPtr->x1 = MIN(itemPtr->x1, part.x1);
+    itemPtr->y1 = MIN(itemPtr->y1, part.y1);
+    itemPtr->x2 = MAX(itemPtr->x2, part.x2);
+    itemPtr->y2 = MAX(itemPtr->y2, part.y2);
+    Tk_PathCanvasEventuallyRedraw(canvas, part.x1, part.y1, part.x2, part.y2);
+    itemPtr->redraw_flags |= TK_ITEM_DONT_REDRAW;
+}
+
 void
 ComputePpolyBbox(Tk_PathCanvas canvas, PpolyItem *ppolyPtr)
 {
@@ -275,22 +604,30 @@ ComputePpolyBbox(Tk_PathCanvas canvas, PpolyItem *ppolyPtr)
     Tk_PathItem *itemPtr = &itemExPtr->header;
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
+    PathRect arrowBbox;
 
+    ppolyPtr->trimmed = 0;
     if (state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
     }
-    if ((ppolyPtr->atomPtr == NULL) || (state == TK_PATHSTATE_HIDDEN)) {
+    if ((ppolyPtr->atoms.numAtoms == 0) || (state == TK_PATHSTATE_HIDDEN)) {
         itemExPtr->header.x1 = itemExPtr->header.x2 =
         itemExPtr->header.y1 = itemExPtr->header.y2 = -1;
         return;
     }
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
-    itemPtr->bbox = GetGenericBarePathBbox(ppolyPtr->atomPtr);
-    IncludeArrowPointsInRect(&itemPtr->bbox, &ppolyPtr->startarrow);
-    IncludeArrowPointsInRect(&itemPtr->bbox, &ppolyPtr->endarrow);
-    itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(ppolyPtr->atomPtr,
+    itemPtr->bbox = GetGenericBarePathBbox(&ppolyPtr->atoms);
+    arrowBbox = NewEmptyPathRect();
+    IncludeArrowPointsInRect(&arrowBbox, &ppolyPtr->startarrow);
+    IncludeArrowPointsInRect(&arrowBbox, &ppolyPtr->endarrow);
+    if (!IsPathRectEmpty(&arrowBbox)) {
+        IncludePointInRect(&itemPtr->bbox, arrowBbox.x1, arrowBbox.y1);
+        IncludePointInRect(&itemPtr->bbox, arrowBbox.x2, arrowBbox.y2);
+    }
+    itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(&ppolyPtr->atoms,
             &style, &itemPtr->bbox);
-    SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr, &itemPtr->totalBbox);
+    SetGenericPathHeaderBboxFromAtoms(&itemExPtr->header, style.matrixPtr, 
+            &ppolyPtr->atoms, &arrowBbox, &itemPtr->bbox, &itemPtr->totalBbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -322,7 +659,7 @@ ConfigureArrows(
     PathPoint ppenult;
     PathPoint *plastp;
 
-    int error = getSegmentsFromPathAtomList(ppolyPtr->atomPtr, &pfirstp, &psecond, &ppenult, &plastp);
+    int error = getSegmentsFromPathAtomList(&ppolyPtr->atoms, &pfirstp, &psecond, &ppenult, &plastp);
 
     if (error == TCL_OK) {
         PathPoint pfirst = *pfirstp;
@@ -396,6 +733,7 @@ ConfigurePpoly(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 #endif
 
     ConfigureArrows(canvas, ppolyPtr);
+    TkPathFreeAtoms(&ppolyPtr->simplified);
 
     if (error) {
 	Tcl_SetObjResult(interp, errorResult);
@@ -421,10 +759,8 @@ DeletePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (itemExPtr->styleInst != NULL) {
 	TkPathFreeStyle(itemExPtr->styleInst);
     }
-    if (ppolyPtr->atomPtr != NULL) {
-        TkPathFreeAtoms(ppolyPtr->atomPtr);
-        ppolyPtr->atomPtr = NULL;
-    }
+    TkPathFreeAtoms(&ppolyPtr->atoms);
+    TkPathFreeAtoms(&ppolyPtr->simplified);
     TkPathFreeArrow(&ppolyPtr->startarrow);
     TkPathFreeArrow(&ppolyPtr->endarrow);
     optionTable = (ppolyPtr->type == kPpolyTypePolyline) ? optionTablePolyline : optionTablePpolygon;
@@ -432,28 +768,342 @@ DeletePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
 }
 
 static void		
-DisplayPpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+DisplayPpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
         int x, int y, int width, int height)
 {
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
     TMatrix m = GetCanvasTMatrix(canvas);
     Tk_PathStyle style;
+    PathPacked *atomPtr;
     
     /* === EB - 23-apr-2010: register coordinate offsets */
     TkPathSetCoordOffsets(m.tx, m.ty);
     /* === */
     
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, ppolyPtr->atomPtr, &style,
-            &m, &itemPtr->bbox);
+    atomPtr = &ppolyPtr->atoms;
+    if (ppolyPtr->simplify > 0.0) {
+        atomPtr = GetSimplifiedAtoms(ppolyPtr, style.matrixPtr);
+    }
+    TkPathDrawPathInContext(ctx, atomPtr, &style,
+            &m, &itemPtr->bbox, &itemPtr->pathCache);
     /*
      * Display arrowheads, if they are wanted.
      */
-    DisplayArrow(canvas, drawable, &ppolyPtr->startarrow, &style, &m, &itemPtr->bbox);
-    DisplayArrow(canvas, drawable, &ppolyPtr->endarrow, &style, &m, &itemPtr->bbox);
+    DisplayArrow(canvas, ctx, &ppolyPtr->startarrow, &style, &m, &itemPtr->bbox);
+    DisplayArrow(canvas, ctx, &ppolyPtr->endarrow, &style, &m, &itemPtr->bbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * GetSimplifiedAtoms --
+ *
+ *	Gives the points to draw for an item with -simplify, making
+ *	them again if the item's matrix has changed since. Hit tests
+ *	still use all the points.
+ *
+ * Results:
+ *	The simplified atoms.
+ *
+ * Side effects:
+ *	May replace ppolyPtr->simplified and drop the item's
+ *	retained path.
+ *
+ *--------------------------------------------------------------
+ */
+
+static PathPacked *
+GetSimplifiedAtoms(
+    PpolyItem *ppolyPtr,
+    TMatrix *mPtr)		/* The item's matrix, or NULL. */
+{
+    Tk_PathItem *itemPtr = &ppolyPtr->headerEx.header;
+    PathPacked *atomPtr = &ppolyPtr->atoms;
+    TMatrix m = kPathUnitTMatrix;
+    int closed, numPoints, i, *keep;
+    double *coords;
+
+    if (mPtr != NULL) {
+        m = *mPtr;
+    }
+    if ((ppolyPtr->simplified.numAtoms > 0) 
+            && (ppolyPtr->simplifiedMatrix.a == m.a) 
+            && (ppolyPtr->simplifiedMatrix.b == m.b)
+            && (ppolyPtr->simplifiedMatrix.c == m.c) 
+            && (ppolyPtr->simplifiedMatrix.d == m.d)
+            && (ppolyPtr->simplifiedMatrix.tx == m.tx) 
+            && (ppolyPtr->simplifiedMatrix.ty == m.ty)) {
+        if (ppolyPtr->simplifiedSource == atomPtr->numAtoms) {
+            return &ppolyPtr->simplified;
+        }
+        if (ExtendSimplifiedAtoms(ppolyPtr) == TCL_OK) {
+            goto done;
+        }
+    }
+    if (!(atomPtr->flags & PATH_PACKED_POLY) || (atomPtr->numAtoms < 3)) {
+        return atomPtr;
+    }
+
+    /*
+     * A closed polygon has its first point repeated last which is
+     * always kept. An open polyline that goes one way in x, such as a
+     * time series, is done by columns directly so that appending and
+     * trimming points later only need the columns at the ends redone.
+     */
+    closed = (atomPtr->flags & PATH_PACKED_CLOSED) ? 1 : 0;
+    ppolyPtr->simplifiedDir = 0;
+    if (!closed) {
+        if (GoesInDirection(atomPtr->coords, 0, atomPtr->numAtoms, &m, 1)) {
+            ppolyPtr->simplifiedDir = 1;
+        } else if (GoesInDirection(atomPtr->coords, 0, atomPtr->numAtoms, &m, -1)) {
+            ppolyPtr->simplifiedDir = -1;
+        }
+    }
+    if (ppolyPtr->simplifiedDir != 0) {
+        keep = (int *) ckalloc((unsigned) (atomPtr->numAtoms * sizeof(int)));
+        numPoints = PathSimplifyColumns(atomPtr->coords, 0, atomPtr->numAtoms,
+                &m, ppolyPtr->simplify, keep);
+        coords = PathPackedSetPoly(&ppolyPtr->simplified, numPoints, 0);
+        for (i = 0; i < numPoints; i++) {
+            coords[2*i] = atomPtr->coords[2*keep[i]];
+            coords[2*i+1] = atomPtr->coords[2*keep[i]+1];
+        }
+        ckfree((char *) keep);
+    } else {
+        coords = (double *) ckalloc((unsigned) (atomPtr->numCoords * sizeof(double)));
+        numPoints = PathSimplifyPoly(atomPtr->coords, atomPtr->numAtoms, &m,
+                ppolyPtr->simplify, coords);
+        memcpy(PathPackedSetPoly(&ppolyPtr->simplified, numPoints - closed, closed),
+                coords, 2*numPoints*sizeof(double));
+        ckfree((char *) coords);
+    }
+    ppolyPtr->simplifiedMatrix = m;
+    ppolyPtr->simplifiedSource = atomPtr->numAtoms;
+
+  done:
+    if (itemPtr->pathCache != NULL) {
+        TkPathFreeRetainedPath(itemPtr->pathCache);
+        itemPtr->pathCache = NULL;
+    }
+    return &ppolyPtr->simplified;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GoesInDirection, ColumnKey, ColumnEnd --
+ *
+ *	Helpers for keeping simplified points made by columns. Points
+ *	go in direction dir if their x on the device never decreases
+ *	when dir is 1, or never increases when dir is -1. The key of a
+ *	point is its column times dir, so that keys never decrease
+ *	along such points, and ColumnEnd uses that to find by bisection
+ *	the first point in [lo, hi) whose key is greater than key.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+GoesInDirection(
+    double *coords,
+    int first, int last,	/* Range of points, last not included. */
+    TMatrix *mPtr,
+    int dir)
+{
+    double x, y, prevX = 0.0;
+    int i;
+
+    for (i = first; i < last; i++) {
+        x = coords[2*i];
+        y = coords[2*i+1];
+        PathApplyTMatrix(mPtr, &x, &y);
+        if ((i > first) && (dir*(x - prevX) < 0.0)) {
+            return 0;
+        }
+        prevX = x;
+    }
+    return 1;
+}
+
+static double
+ColumnKey(
+    double *pointPtr,
+    TMatrix *mPtr,
+    double tolerance,
+    int dir)
+{
+    double x = pointPtr[0], y = pointPtr[1];
+
+    PathApplyTMatrix(mPtr, &x, &y);
+    return dir*floor(x/tolerance);
+}
+
+static int
+ColumnEnd(
+    double *coords,
+    int lo, int hi,
+    TMatrix *mPtr,
+    double tolerance,
+    int dir,
+    double key)
+{
+    int mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo)/2;
+        if (ColumnKey(coords + 2*mid, mPtr, tolerance, dir) > key) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ExtendSimplifiedAtoms --
+ *
+ *	Brings simplified points made by columns up to date after
+ *	points have been appended. Only the columns from the one of the
+ *	last old point but one are redone. The last old point itself
+ *	may have been moved by an arrowhead when the simplified points
+ *	were made, and is not used to find them.
+ *
+ * Results:
+ *	TCL_OK if done, TCL_ERROR if the simplified points must be
+ *	made again from all points.
+ *
+ * Side effects:
+ *	Changes ppolyPtr->simplified.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+ExtendSimplifiedAtoms(
+    PpolyItem *ppolyPtr)
+{
+    PathPacked *atomPtr = &ppolyPtr->atoms;
+    PathPacked *simplePtr = &ppolyPtr->simplified;
+    TMatrix *mPtr = &ppolyPtr->simplifiedMatrix;
+    double tolerance = ppolyPtr->simplify, key, *coords;
+    int dir = ppolyPtr->simplifiedDir, numOld = ppolyPtr->simplifiedSource;
+    int numPoints = atomPtr->numAtoms;
+    int start, numKept, numKeep, i, *keep;
+
+    if ((dir == 0) || (numOld < 3) || (numPoints < numOld)
+            || !GoesInDirection(atomPtr->coords, numOld - 2, numPoints,
+                mPtr, dir)) {
+        return TCL_ERROR;
+    }
+    key = ColumnKey(atomPtr->coords + 2*(numOld - 2), mPtr, tolerance, dir);
+    start = ColumnEnd(atomPtr->coords, 0, numOld - 2, mPtr, tolerance, dir,
+            key - 1.0);
+    for (numKept = simplePtr->numAtoms; numKept > 0; numKept--) {
+        if (ColumnKey(simplePtr->coords + 2*(numKept - 1), mPtr, tolerance,
+                dir) < key) {
+            break;
+        }
+    }
+    if (numKept == 0) {
+        return TCL_ERROR;
+    }
+    keep = (int *) ckalloc((unsigned) ((numPoints - start) * sizeof(int)));
+    numKeep = PathSimplifyColumns(atomPtr->coords, start, numPoints, mPtr,
+            tolerance, keep);
+    simplePtr->numAtoms = numKept;
+    simplePtr->numCoords = 2*numKept;
+    coords = PathPackedAppendPoly(simplePtr, numKeep);
+    for (i = 0; i < numKeep; i++) {
+        coords[2*i] = atomPtr->coords[2*keep[i]];
+        coords[2*i+1] = atomPtr->coords[2*keep[i]+1];
+    }
+    ckfree((char *) keep);
+    ppolyPtr->simplifiedSource = numPoints;
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TrimSimplifiedAtoms --
+ *
+ *	Brings simplified points made by columns up to date after the
+ *	first points have been trimmed off, by redoing the columns up to
+ *	the one of what is now the second point. The first point may be
+ *	moved by an arrowhead, so the columns are found from the second.
+ *	Other simplified points are dropped.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Changes or frees ppolyPtr->simplified.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+TrimSimplifiedAtoms(
+    PpolyItem *ppolyPtr)
+{
+    Tk_PathItem *itemPtr = &ppolyPtr->headerEx.header;
+    PathPacked *atomPtr = &ppolyPtr->atoms;
+    PathPacked *simplePtr = &ppolyPtr->simplified;
+    TMatrix *mPtr = &ppolyPtr->simplifiedMatrix;
+    double tolerance = ppolyPtr->simplify, key;
+    int dir = ppolyPtr->simplifiedDir, numPoints = ppolyPtr->simplifiedSource;
+    int end, numDrop, numKeep, numOld, i, keep[8];
+
+    if (simplePtr->numAtoms == 0) {
+        return;
+    }
+    if ((dir == 0) || (numPoints < 3)) {
+        TkPathFreeAtoms(simplePtr);
+        return;
+    }
+    key = ColumnKey(atomPtr->coords + 2, mPtr, tolerance, dir);
+    end = ColumnEnd(atomPtr->coords, 1, numPoints, mPtr, tolerance, dir, key);
+    for (numDrop = 0; numDrop < simplePtr->numAtoms; numDrop++) {
+        if (ColumnKey(simplePtr->coords + 2*numDrop, mPtr, tolerance,
+                dir) > key) {
+            break;
+        }
+    }
+    if (numDrop == simplePtr->numAtoms) {
+        TkPathFreeAtoms(simplePtr);
+        return;
+    }
+
+    /*
+     * The points before end are the first point, alone in its column
+     * unless in that of the second, and the column of the second, so
+     * at most five are kept.
+     */
+    numKeep = PathSimplifyColumns(atomPtr->coords, 0, end, mPtr,
+            tolerance, keep);
+    if (numKeep < numDrop) {
+        PathPackedTrimPoly(simplePtr, numDrop - numKeep);
+    } else if (numKeep > numDrop) {
+        numOld = simplePtr->numAtoms;
+        PathPackedAppendPoly(simplePtr, numKeep - numDrop);
+        memmove(simplePtr->coords + 2*numKeep, simplePtr->coords + 2*numDrop,
+                (size_t) (2*(numOld - numDrop) * sizeof(double)));
+    }
+    for (i = 0; i < numKeep; i++) {
+        simplePtr->coords[2*i] = atomPtr->coords[2*keep[i]];
+        simplePtr->coords[2*i+1] = atomPtr->coords[2*keep[i]+1];
+    }
+    if (itemPtr->pathCache != NULL) {
+        TkPathFreeRetainedPath(itemPtr->pathCache);
+        itemPtr->pathCache = NULL;
+    }
+}
+
 static void	
 PpolyBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask)
 {
@@ -471,8 +1121,8 @@ PpolyToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
 
     flags = (ppolyPtr->type == kPpolyTypePolyline) ? kPathMergeStyleNotFill : 0;
     style = TkPathCanvasInheritStyle(itemPtr, flags);
-    dist = GenericPathToPoint(canvas, itemPtr, &style, ppolyPtr->atomPtr, 
-            ppolyPtr->maxNumSegments, pointPtr);
+    dist = GenericPathToPoint(canvas, itemPtr, &style, &ppolyPtr->atoms, 
+            pointPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return dist;
 }
@@ -488,7 +1138,7 @@ PpolyToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
     flags = (ppolyPtr->type == kPpolyTypePolyline) ? kPathMergeStyleNotFill : 0;
     style = TkPathCanvasInheritStyle(itemPtr, flags);    
     area = GenericPathToArea(canvas, itemPtr, &style, 
-            ppolyPtr->atomPtr, ppolyPtr->maxNumSegments, areaPtr);
+            &ppolyPtr->atoms, areaPtr);
     TkPathCanvasFreeInheritedStyle(&style);            
     return area;
 }
@@ -505,7 +1155,8 @@ ScalePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double originX, double or
 {
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
 
-    ScalePathAtoms(ppolyPtr->atomPtr, originX, originY, scaleX, scaleY);
+    ScalePathAtoms(&ppolyPtr->atoms, originX, originY, scaleX, scaleY);
+    TkPathFreeAtoms(&ppolyPtr->simplified);
     ScalePathRect(&itemPtr->bbox, originX, originY, scaleX, scaleY);
     ScalePathRect(&itemPtr->totalBbox, originX, originY, scaleX, scaleY);
     TkPathScaleArrow(&ppolyPtr->startarrow, originX, originY, scaleX, scaleY);
@@ -519,7 +1170,8 @@ TranslatePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double deltaX, double
 {
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
 
-    TranslatePathAtoms(ppolyPtr->atomPtr, deltaX, deltaY);
+    TranslatePathAtoms(&ppolyPtr->atoms, deltaX, deltaY);
+    TkPathFreeAtoms(&ppolyPtr->simplified);
     TranslatePathRect(&itemPtr->bbox, deltaX, deltaY);
     TranslatePathRect(&itemPtr->totalBbox, deltaX, deltaY);
     TkPathTranslateArrow(&ppolyPtr->startarrow, deltaX, deltaY);
@@ -537,8 +1189,12 @@ TranslatePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double deltaX, double
  * Results:
  *		Standard tcl result.
  *
+ *		The coords may also be given or asked for as a bytearray
+ *		of native doubles or floats after a "-packed" or
+ *		"-packedfloat" flag.
+ *
  * Side effects:
- *		May store new atoms in atomPtrPtr and max number of points
+ *		May store new atoms in packedPtr and max number of points
  *		in lenPtr.
  *
  *--------------------------------------------------------------
@@ -551,16 +1207,33 @@ CoordsForPolygonline(
     int closed,				/* Polyline (0) or polygon (1) */
     int objc, 
     Tcl_Obj *CONST objv[],
-    PathAtom **atomPtrPtr,
+    PathPacked *packedPtr,
     int *lenPtr)
 {
-    PathAtom *atomPtr = *atomPtrPtr;
+    unsigned char *bytes = NULL;
+    int size = 0;
 
+    if (objc > 0) {
+        size = GetPackedCoordsFormat(objv[0]);
+    }
+    if ((objc == 1) && size) {
+        int num = packedPtr->numCoords;
+        
+        if ((num > 0) && (packedPtr->flags & PATH_PACKED_CLOSED)) {
+            num -= 2;
+        }
+        Tcl_SetObjResult(interp, NewPackedCoordsObj(packedPtr->coords, num, size));
+        return TCL_OK;
+    }
     if (objc == 0) {
         Tcl_Obj *obj = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+        PathAtomIter iter;
+        double *atomPtr;
+        int type;
         
-        while (atomPtr != NULL) {
-            switch (atomPtr->type) {
+        PathAtomIterInit(&iter, packedPtr);
+        while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
+            switch (type) {
                 case PATH_ATOM_M: { 
                     MoveToAtom *move = (MoveToAtom *) atomPtr;
                     Tcl_ListObjAppendElement(interp, obj, Tcl_NewDoubleObj(move->x));
@@ -581,12 +1254,16 @@ CoordsForPolygonline(
                     /* empty */
                 }
             }
-            atomPtr = atomPtr->nextPtr;
         }
         Tcl_SetObjResult(interp, obj);
         return TCL_OK;
     }
-    if (objc == 1) {
+    if ((objc == 2) && size) {
+        if (GetPackedCoordsFromObj(interp, objv[1], size, &bytes, 
+                &objc) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    } else if (objc == 1) {
         if (Tcl_ListObjGetElements(interp, objv[0], &objc,
             (Tcl_Obj ***) &objv) != TCL_OK) {
             return TCL_ERROR;
@@ -604,39 +1281,29 @@ CoordsForPolygonline(
         return TCL_ERROR;
     } else {
         int 	i;
-        double	x, y;
-        double	firstX = 0.0, firstY = 0.0;
-        PathAtom *firstAtomPtr = NULL;
+        double	*coords;
     
         /*
-        * Free any old stuff.
-        */
-        if (atomPtr != NULL) {
-            TkPathFreeAtoms(atomPtr);
-            atomPtr = NULL;
-        }
-        for (i = 0; i < objc; i += 2) {
-            if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i], &x) != TCL_OK) {
-                /* @@@ error recovery? */
-                return TCL_ERROR;
-            }
-            if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i+1], &y) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            if (i == 0) {
-                firstX = x;
-                firstY = y;
-                atomPtr = NewMoveToAtom(x, y);
-                firstAtomPtr = atomPtr;
-            } else {
-                atomPtr->nextPtr = NewLineToAtom(x, y);
-                atomPtr = atomPtr->nextPtr;
+         * The points go straight into a single array which is reused
+         * when big enough.
+         */
+        coords = PathPackedSetPoly(packedPtr, objc/2, closed);
+        if (bytes != NULL) {
+            CopyPackedCoords(bytes, size, objc, coords);
+            i = objc;
+        } else {
+            for (i = 0; i < objc; i++) {
+                if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i], 
+                        coords + i) != TCL_OK) {
+                    TkPathFreeAtoms(packedPtr);
+                    return TCL_ERROR;
+                }
             }
         }
         if (closed) {
-            atomPtr->nextPtr = NewCloseAtom(firstX, firstY);
+            coords[objc] = coords[0];
+            coords[objc+1] = coords[1];
         }
-        *atomPtrPtr = firstAtomPtr;
         *lenPtr = i/2 + 2;
     }
     return TCL_OK;
@@ -26,8 +26,6 @@ typedef struct PrectItem  {
                              * path types.  MUST BE FIRST IN STRUCTURE. */
     double rx;		    /* Radius of corners. */
     double ry;
-    int maxNumSegments;	    /* Max number of straight segments (for subpath)
-                             * needed for Area and Point functions. */
 } PrectItem;
 
 /*
@@ -44,7 +42,7 @@ static int	CreatePrect(Tcl_Interp *interp,
 static void	DeletePrect(Tk_PathCanvas canvas,
                         Tk_PathItem *itemPtr, Display *display);
 static void	DisplayPrect(Tk_PathCanvas canvas,
-                        Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+                        Tk_PathItem *itemPtr, TkPathContext ctx,
                         int x, int y, int width, int height);
 static void	PrectBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
 static int	PrectCoords(Tcl_Interp *interp,
@@ -61,7 +59,8 @@ static void	ScalePrect(Tk_PathCanvas canvas,
                         double scaleX, double scaleY);
 static void	TranslatePrect(Tk_PathCanvas canvas,
                         Tk_PathItem *itemPtr, double deltaX, double deltaY);
-static PathAtom * MakePathAtoms(PrectItem *prectPtr);
+static void	MakePathAtoms(PrectItem *prectPtr, PathPacked *atomPtr,
+			    unsigned char *types, double *coords);
 
 
 enum {
@@ -111,7 +110,7 @@ Tk_PathItemType tkPrectType = {
     ConfigurePrect,			/* configureProc */
     PrectCoords,			/* coordProc */
     DeletePrect,			/* deleteProc */
-    DisplayPrect,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     PrectBbox,				/* bboxProc */
     PrectToPoint,			/* pointProc */
@@ -125,6 +124,7 @@ Tk_PathItemType tkPrectType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPrect,			/* displayContextProc */
 };
                         
 
@@ -149,9 +149,9 @@ CreatePrect(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
-    prectPtr->maxNumSegments = 100;		/* Crude overestimate. */
     
     if (optionTable == NULL) {
 	optionTable = Tk_CreateOptionTable(interp, optionSpecs);
@@ -206,6 +206,9 @@ ComputePrectBbox(Tk_PathCanvas canvas, PrectItem *prectPtr)
     Tk_PathItem *itemPtr = &itemExPtr->header;
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
+    PathPacked atoms;
+    unsigned char types[PATH_PRECT_NUM_ATOMS];
+    double coords[PATH_PRECT_NUM_COORDS];
 
     if(state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
@@ -217,7 +220,9 @@ ComputePrectBbox(Tk_PathCanvas canvas, PrectItem *prectPtr)
     }
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
     itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(NULL, &style, &itemPtr->bbox);
-    SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr, &itemPtr->totalBbox);
+    MakePathAtoms(prectPtr, &atoms, types, coords);
+    SetGenericPathHeaderBboxFromAtoms(&itemExPtr->header, style.matrixPtr, 
+            &atoms, NULL, &itemPtr->bbox, &itemPtr->totalBbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -286,19 +291,25 @@ ConfigurePrect(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     }
 }
 
-static PathAtom *
-MakePathAtoms(PrectItem *prectPtr)
+/*
+ * The atoms are built in caller supplied space, PATH_PRECT_NUM_ATOMS types
+ * and PATH_PRECT_NUM_COORDS coords, and need not be freed.
+ */
+
+static void
+MakePathAtoms(PrectItem *prectPtr, PathPacked *atomPtr, 
+        unsigned char *types, double *coords)
 {
     Tk_PathItem *itemPtr = (Tk_PathItem *) prectPtr;
-    PathAtom *atomPtr;
     double points[4];
     
+    PathPackedInitStatic(atomPtr, types, PATH_PRECT_NUM_ATOMS, 
+            coords, PATH_PRECT_NUM_COORDS);
     points[0] = itemPtr->bbox.x1;
     points[1] = itemPtr->bbox.y1;
     points[2] = itemPtr->bbox.x2;
     points[3] = itemPtr->bbox.y2;
-    TkPathMakePrectAtoms(points, prectPtr->rx, prectPtr->ry, &atomPtr);
-    return atomPtr;
+    TkPathMakePrectAtoms(points, prectPtr->rx, prectPtr->ry, atomPtr);
 }
 
 static void		
@@ -318,12 +329,14 @@ DeletePrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
 }
 
 static void		
-DisplayPrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+DisplayPrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
         int x, int y, int width, int height)
 {
     PrectItem *prectPtr = (PrectItem *) itemPtr;
     TMatrix m = GetCanvasTMatrix(canvas);
-    PathAtom *atomPtr;            
+    PathPacked atoms;
+    unsigned char types[PATH_PRECT_NUM_ATOMS];
+    double coords[PATH_PRECT_NUM_COORDS];
     Tk_PathStyle style;
     
     /* === EB - 23-apr-2010: register coordinate offsets */
@@ -331,10 +344,9 @@ DisplayPrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawa
     /* === */
     
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    atomPtr = MakePathAtoms(prectPtr);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr, 
-	    &style, &m, &itemPtr->bbox);
-    TkPathFreeAtoms(atomPtr);
+    MakePathAtoms(prectPtr, &atoms, types, coords);
+    TkPathDrawPathInContext(ctx, &atoms, 
+	    &style, &m, &itemPtr->bbox, &itemPtr->pathCache);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -386,10 +398,13 @@ PrectToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
     if (rectiLinear) {
         dist = PathRectToPoint(bareRect, width, filled, pointPtr);
     } else {
-	PathAtom *atomPtr = MakePathAtoms(prectPtr);
-        dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr, 
-            prectPtr->maxNumSegments, pointPtr);
-	TkPathFreeAtoms(atomPtr);
+	PathPacked atoms;
+	unsigned char types[PATH_PRECT_NUM_ATOMS];
+	double coords[PATH_PRECT_NUM_COORDS];
+
+	MakePathAtoms(prectPtr, &atoms, types, coords);
+        dist = GenericPathToPoint(canvas, itemPtr, &style, &atoms, 
+            pointPtr);
     }
     TkPathCanvasFreeInheritedStyle(&style);
     return dist;
@@ -437,10 +452,13 @@ PrectToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
     if (rectiLinear) {
         area = PathRectToArea(bareRect, width, filled, areaPtr);
     } else {
-	PathAtom *atomPtr = MakePathAtoms(prectPtr);
+	PathPacked atoms;
+	unsigned char types[PATH_PRECT_NUM_ATOMS];
+	double coords[PATH_PRECT_NUM_COORDS];
+
+	MakePathAtoms(prectPtr, &atoms, types, coords);
         area = GenericPathToArea(canvas, itemPtr, &style, 
-                atomPtr, prectPtr->maxNumSegments, areaPtr);
-	TkPathFreeAtoms(atomPtr);
+                &atoms, areaPtr);
     }
     TkPathCanvasFreeInheritedStyle(&style);
     return area;
@@ -51,7 +51,7 @@ static int	CreatePtext(Tcl_Interp *interp,
 static void	DeletePtext(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display);
 static void	DisplayPtext(Tk_PathCanvas canvas,
-		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+		    Tk_PathItem *itemPtr, TkPathContext ctx,
 		    int x, int y, int width, int height);
 static void	PtextBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
 static int	PtextCoords(Tcl_Interp *interp,
@@ -194,7 +194,7 @@ Tk_PathItemType tkPtextType = {
     ConfigurePtext,			/* configureProc */
     PtextCoords,			/* coordProc */
     DeletePtext,			/* deleteProc */
-    DisplayPtext,			/* displayProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
     0,					/* flags */
     PtextBbox,				/* bboxProc */
     PtextToPoint,			/* pointProc */
@@ -208,6 +208,7 @@ Tk_PathItemType tkPtextType = {
     (Tk_PathItemInsertProc *) NULL,	/* insertProc */
     (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
     (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayPtext,			/* displayContextProc */
 };
                          
 
@@ -233,6 +234,7 @@ CreatePtext(Tcl_Interp *interp, Tk_PathCanvas canvas,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
     itemPtr->bbox = NewEmptyPathRect();
     ptextPtr->utf8Obj = NULL;
     ptextPtr->numChars = 0;
@@ -529,14 +531,13 @@ DeletePtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
 }
 
 static void		
-DisplayPtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+DisplayPtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
         int x, int y, int width, int height)
 {
     PtextItem *ptextPtr = (PtextItem *) itemPtr;
     Tk_PathItemEx *itemExPtr = &ptextPtr->headerEx;
     Tk_PathStyle style;
     TMatrix m = GetCanvasTMatrix(canvas);
-    TkPathContext ctx;
     
     /* === EB - 23-apr-2010: register coordinate offsets */
     TkPathSetCoordOffsets(m.tx, m.ty);
@@ -557,8 +558,7 @@ DisplayPtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawa
 	style.strokeColor = itemExPtr->style.strokeColor;
     }
     
-    ctx = TkPathInit(Tk_PathCanvasTkwin(canvas), drawable);
-    
+    TkPathSaveState(ctx);
     TkPathPushTMatrix(ctx, &m);
     if (style.matrixPtr != NULL) {
         TkPathPushTMatrix(ctx, style.matrixPtr);
@@ -577,7 +577,7 @@ DisplayPtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawa
         ptextPtr->fillOverStroke, Tcl_GetString(ptextPtr->utf8Obj), ptextPtr->custom);
     
     TkPathEndPath(ctx);
-    TkPathFree(ctx);
+    TkPathRestoreState(ctx);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -0,0 +1,967 @@
+/*
+ * tkCanvTrace.c --
+ *
+ *	This file implements a trace canvas item for plotting a stream of
+ *	samples in real time. It keeps the latest samples in a ring of
+ *	fixed capacity and draws them as a polyline with the sample index
+ *	as x and its value as y. Use -matrix to place them on screen.
+ *
+ * $Id$
+ */
+
+#include "tkIntPath.h"
+#include "tkpCanvas.h"
+#include "tkCanvPathUtil.h"
+#include "tkPathStyle.h"
+
+/*
+ * The structure below defines the record for each trace item.
+ */
+
+typedef struct TraceItem  {
+    Tk_PathItemEx headerEx; /* Generic stuff that's the same for all
+                             * path types.  MUST BE FIRST IN STRUCTURE. */
+    int capacity;	    /* Most samples kept, the -capacity option. */
+    double *samples;	    /* Ring of ringSize sample values. */
+    int ringSize;	    /* Capacity the ring was made for. */
+    int first;		    /* Index in samples of the oldest sample. */
+    int numSamples;	    /* Number of samples in the ring. */
+    double min, max;	    /* Range of the sample values. May be too
+			     * wide after samples have been evicted. */
+    int evicted;	    /* Number of samples evicted since min and
+			     * max were computed from all samples. */
+    TMatrix place;	    /* Takes sample index and value to item
+			     * coordinates. Only changed by move and
+			     * scale, and never rotates. */
+} TraceItem;
+
+/*
+ * Hit tests first look at the samples this far, in canvas units, to
+ * each side of the point and only at all samples if none is that close.
+ */
+
+#define kTraceHitMargin 16.0
+
+/*
+ * Runs of up to this many points are made on the stack.
+ */
+
+#define kTraceStaticPoints 256
+
+/*
+ * Prototypes for procedures defined in this file:
+ */
+
+static void	ComputeTraceBbox(Tk_PathCanvas canvas, TraceItem *tracePtr);
+static void	ComputeTraceRange(TraceItem *tracePtr);
+static int	ConfigureTrace(Tcl_Interp *interp, Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, int objc,
+                        Tcl_Obj *CONST objv[], int flags);
+static int	CreateTrace(Tcl_Interp *interp,
+                        Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
+                        int objc, Tcl_Obj *CONST objv[]);
+static void	DeleteTrace(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+                        Display *display);
+static void	DisplayTrace(Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, TkPathContext ctx,
+                        int x, int y, int width, int height);
+static int	GetSamplesFromObjs(Tcl_Interp *interp, int objc,
+                        Tcl_Obj *CONST objv[], double *staticSpace,
+                        double **valuesPtr);
+static void	ResizeTraceRing(TraceItem *tracePtr, int size);
+static void	TraceBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
+static int	TraceCoords(Tcl_Interp *interp, Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, int objc, Tcl_Obj *CONST objv[]);
+static void	TracePush(TraceItem *tracePtr, double value);
+static double * TraceRunCoords(TraceItem *tracePtr, int first, int last,
+                        TMatrix *mPtr, double *staticSpace);
+static int	TraceRunToArea(Tk_PathCanvas canvas, TraceItem *tracePtr,
+                        Tk_PathStyle *stylePtr, int first, int last,
+                        double *areaPtr);
+static double	TraceRunToPoint(Tk_PathCanvas canvas, TraceItem *tracePtr,
+                        Tk_PathStyle *stylePtr, int first, int last,
+                        double *pointPtr);
+static PathRect TraceTotalBbox(Tk_PathStyle *stylePtr, PathRect *bboxPtr);
+static void	TraceWindow(TraceItem *tracePtr, TMatrix *mPtr,
+                        double x1, double x2, int *firstPtr, int *lastPtr);
+static int	TraceToArea(Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, double *rectPtr);
+static double	TraceToPoint(Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, double *coordPtr);
+static int	TraceToPostscript(Tcl_Interp *interp,
+                        Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int prepass);
+static void	ScaleTrace(Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, double originX, double originY,
+                        double scaleX, double scaleY);
+static void	TranslateTrace(Tk_PathCanvas canvas,
+                        Tk_PathItem *itemPtr, double deltaX, double deltaY);
+
+PATH_STYLE_CUSTOM_OPTION_MATRIX
+PATH_STYLE_CUSTOM_OPTION_DASH
+PATH_CUSTOM_OPTION_TAGS
+PATH_OPTION_STRING_TABLES_STROKE
+PATH_OPTION_STRING_TABLES_STATE
+
+static Tk_OptionSpec optionSpecs[] = {
+    PATH_OPTION_SPEC_CORE(Tk_PathItemEx),
+    PATH_OPTION_SPEC_PARENT,
+    PATH_OPTION_SPEC_STYLE_MATRIX(Tk_PathItemEx),
+    PATH_OPTION_SPEC_STYLE_STROKE(Tk_PathItemEx, "black"),
+    {TK_OPTION_INT, "-capacity", NULL, NULL,
+        "1000", -1, Tk_Offset(TraceItem, capacity), 0, 0, 0},
+    PATH_OPTION_SPEC_END
+};
+
+static Tk_OptionTable optionTable = NULL;
+
+/*
+ * The structures below defines the 'trace' item type by means
+ * of procedures that can be invoked by generic item code.
+ */
+
+Tk_PathItemType tkTraceType = {
+    "trace",				/* name */
+    sizeof(TraceItem),			/* itemSize */
+    CreateTrace,			/* createProc */
+    optionSpecs,			/* optionSpecs */
+    ConfigureTrace,			/* configureProc */
+    TraceCoords,			/* coordProc */
+    DeleteTrace,			/* deleteProc */
+    TkPathCanvasItemExDisplay,	/* displayProc */
+    0,					/* flags */
+    TraceBbox,				/* bboxProc */
+    TraceToPoint,			/* pointProc */
+    TraceToArea,			/* areaProc */
+    TraceToPostscript,			/* postscriptProc */
+    ScaleTrace,				/* scaleProc */
+    TranslateTrace,			/* translateProc */
+    (Tk_PathItemIndexProc *) NULL,	/* indexProc */
+    (Tk_PathItemCursorProc *) NULL,	/* icursorProc */
+    (Tk_PathItemSelectionProc *) NULL,	/* selectionProc */
+    (Tk_PathItemInsertProc *) NULL,	/* insertProc */
+    (Tk_PathItemDCharsProc *) NULL,	/* dTextProc */
+    (Tk_PathItemType *) NULL,		/* nextPtr */
+    DisplayTrace,			/* displayContextProc */
+};
+
+static int
+CreateTrace(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
+        int objc, Tcl_Obj *CONST objv[])
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    Tk_PathItemEx *itemExPtr = &tracePtr->headerEx;
+    TMatrix unit = kPathUnitTMatrix;
+    int	i;
+
+    /*
+     * Carry out initialization that is needed to set defaults and to
+     * allow proper cleanup after errors during the the remainder of
+     * this procedure.
+     */
+    TkPathInitStyle(&itemExPtr->style);
+    itemExPtr->canvas = canvas;
+    itemExPtr->styleObj = NULL;
+    itemExPtr->styleInst = NULL;
+    itemExPtr->inheritedEpoch = 0;
+    itemPtr->bbox = NewEmptyPathRect();
+    itemPtr->totalBbox = NewEmptyPathRect();
+    tracePtr->samples = NULL;
+    tracePtr->ringSize = 0;
+    tracePtr->first = 0;
+    tracePtr->numSamples = 0;
+    tracePtr->place = unit;
+    ComputeTraceRange(tracePtr);
+
+    if (optionTable == NULL) {
+	optionTable = Tk_CreateOptionTable(interp, optionSpecs);
+    }
+    itemPtr->optionTable = optionTable;
+    if (Tk_InitOptions(interp, (char *) tracePtr, optionTable,
+	    Tk_PathCanvasTkwin(canvas)) != TCL_OK) {
+        goto error;
+    }
+
+    /*
+     * The options go first here since -capacity sizes the ring that
+     * the samples go into. Packed samples are a flag and one bytearray.
+     */
+    i = ((objc > 1) && GetPackedCoordsFormat(objv[0])) ? 2 : 0;
+    for (; i < objc; i++) {
+        char *arg = Tcl_GetString(objv[i]);
+        if ((arg[0] == '-') && (arg[1] >= 'a') && (arg[1] <= 'z')) {
+            break;
+        }
+    }
+    if (ConfigureTrace(interp, canvas, itemPtr, objc-i, objv+i, 0) != TCL_OK) {
+        goto error;
+    }
+    if ((i > 0) && (TraceCoords(interp, canvas, itemPtr, i, objv) != TCL_OK)) {
+        goto error;
+    }
+    return TCL_OK;
+
+    error:
+    /*
+     * NB: We must unlink the item here since the TkPathCanvasItemExConfigure()
+     *     link it to the root by default.
+     */
+    TkPathCanvasItemDetach(itemPtr);
+    DeleteTrace(canvas, itemPtr, Tk_Display(Tk_PathCanvasTkwin(canvas)));
+    return TCL_ERROR;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TraceCoords --
+ *
+ *	The coordProc of trace items. The coords are the sample values,
+ *	oldest first. Besides setting them all it takes "append value
+ *	?value ...?" which pushes new samples and evicts the oldest
+ *	ones beyond the capacity, and "trim count" which evicts the
+ *	count oldest samples. Samples may also be given or asked for
+ *	as a bytearray of native doubles or floats after a "-packed" or
+ *	"-packedfloat" flag.
+ *
+ * Results:
+ *	Standard tcl result.
+ *
+ * Side effects:
+ *	While the ring is not yet full appending only asks for the new
+ *	segments to be redrawn. Otherwise all samples move and the
+ *	canvas redraws the whole item.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+TraceCoords(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+        int objc, Tcl_Obj *CONST objv[])
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    double staticSpace[64], *values;
+    int i, numValues, size;
+
+    if ((objc == 1) && (size = GetPackedCoordsFormat(objv[0]))) {
+        Tcl_Obj *obj;
+        int num = MIN(tracePtr->numSamples, tracePtr->ringSize - tracePtr->first);
+
+        /* The ring may wrap around, when it takes two copies. */
+        obj = NewPackedCoordsObj(tracePtr->samples + tracePtr->first, num, size);
+        if (num < tracePtr->numSamples) {
+            Tcl_Obj *restObj = NewPackedCoordsObj(tracePtr->samples,
+                    tracePtr->numSamples - num, size);
+            unsigned char *rest, *bytes;
+            int length, restLength;
+
+            rest = Tcl_GetByteArrayFromObj(restObj, &restLength);
+            Tcl_GetByteArrayFromObj(obj, &length);
+            bytes = Tcl_SetByteArrayLength(obj, length + restLength);
+            memcpy(bytes + length, rest, restLength);
+            Tcl_DecrRefCount(restObj);
+        }
+        Tcl_SetObjResult(interp, obj);
+        return TCL_OK;
+    }
+    if (objc == 0) {
+        Tcl_Obj *obj = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+
+        for (i = 0; i < tracePtr->numSamples; i++) {
+            Tcl_ListObjAppendElement(interp, obj, Tcl_NewDoubleObj(
+                    tracePtr->samples[(tracePtr->first + i) % tracePtr->ringSize]));
+        }
+        Tcl_SetObjResult(interp, obj);
+        return TCL_OK;
+    }
+    if (objc > 1) {
+        char *arg = Tcl_GetString(objv[0]);
+
+        if (strcmp(arg, "append") == 0) {
+            int part, old = tracePtr->numSamples;
+            Tk_PathState state = itemPtr->state;
+
+            numValues = GetSamplesFromObjs(interp, objc-1, objv+1,
+                    staticSpace, &values);
+            if (numValues < 0) {
+                return TCL_ERROR;
+            }
+            if (state == TK_PATHSTATE_NULL) {
+                state = TkPathCanvasState(canvas);
+            }
+            part = (state != TK_PATHSTATE_HIDDEN) && (old >= 2)
+                    && (old + numValues <= tracePtr->ringSize)
+                    && (itemPtr->x1 < itemPtr->x2) && (itemPtr->y1 < itemPtr->y2);
+            for (i = 0; i < numValues; i++) {
+                TracePush(tracePtr, values[i]);
+            }
+            if (values != staticSpace) {
+                ckfree((char *) values);
+            }
+            if (tracePtr->evicted >= tracePtr->ringSize) {
+                ComputeTraceRange(tracePtr);
+            }
+            ComputeTraceBbox(canvas, tracePtr);
+
+            if (part) {
+                Tk_PathStyle style;
+                Tk_PathItem partHeader;
+                PathPacked atoms;
+                PathRect bbox, totalBbox;
+                double space[2*kTraceStaticPoints], *coords;
+
+                /*
+                 * The last old segment is included since its end cap
+                 * becomes a join.
+                 */
+                style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+                coords = TraceRunCoords(tracePtr, old - 2, tracePtr->numSamples - 1,
+                        NULL, space);
+                PathPackedInitPoly(&atoms, coords, tracePtr->numSamples - old + 2, 0);
+                bbox = GetGenericBarePathBbox(&atoms);
+                totalBbox = TraceTotalBbox(&style, &bbox);
+                SetGenericPathHeaderBbox(&partHeader, style.matrixPtr, &totalBbox);
+                TkPathCanvasFreeInheritedStyle(&style);
+                if (coords != space) {
+                    ckfree((char *) coords);
+                }
+                Tk_PathCanvasEventuallyRedraw(canvas, partHeader.x1, partHeader.y1,
+                        partHeader.x2, partHeader.y2);
+                itemPtr->redraw_flags |= TK_ITEM_DONT_REDRAW;
+            }
+            return TCL_OK;
+        } else if (strcmp(arg, "trim") == 0) {
+            int count;
+
+            if (objc != 2) {
+                Tcl_SetObjResult(interp, Tcl_NewStringObj(
+                        "wrong # args: should be \"coords tagOrId trim count\"", -1));
+                return TCL_ERROR;
+            }
+            if (Tcl_GetIntFromObj(interp, objv[1], &count) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if ((count < 0) || (count > tracePtr->numSamples)) {
+                char buf[64 + 2*TCL_INTEGER_SPACE];
+                sprintf(buf, "can't trim %d samples from %d", count,
+                        tracePtr->numSamples);
+                Tcl_SetResult(interp, buf, TCL_VOLATILE);
+                return TCL_ERROR;
+            }
+            if (tracePtr->ringSize > 0) {
+                tracePtr->first = (tracePtr->first + count) % tracePtr->ringSize;
+            }
+            tracePtr->numSamples -= count;
+            tracePtr->evicted += count;
+            if (tracePtr->evicted >= tracePtr->ringSize) {
+                ComputeTraceRange(tracePtr);
+            }
+            ComputeTraceBbox(canvas, tracePtr);
+            return TCL_OK;
+        }
+    }
+    numValues = GetSamplesFromObjs(interp, objc, objv, staticSpace, &values);
+    if (numValues < 0) {
+        return TCL_ERROR;
+    }
+    tracePtr->first = 0;
+    tracePtr->numSamples = 0;
+    ComputeTraceRange(tracePtr);
+    for (i = 0; i < numValues; i++) {
+        TracePush(tracePtr, values[i]);
+    }
+    if (values != staticSpace) {
+        ckfree((char *) values);
+    }
+    if (tracePtr->evicted > 0) {
+        ComputeTraceRange(tracePtr);
+    }
+    ComputeTraceBbox(canvas, tracePtr);
+    return TCL_OK;
+}
+
+/*
+ * Parses sample values given either as separate arguments, as a
+ * single list, or packed. Gives the number of values, or -1 on error.
+ */
+
+static int
+GetSamplesFromObjs(Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[],
+        double *staticSpace, double **valuesPtr)
+{
+    double *values = staticSpace;
+    int i, size;
+
+    if ((objc == 2) && (size = GetPackedCoordsFormat(objv[0]))) {
+        unsigned char *bytes;
+
+        if (GetPackedCoordsFromObj(interp, objv[1], size, &bytes,
+                &objc) != TCL_OK) {
+            return -1;
+        }
+        if (objc > 64) {
+            values = (double *) ckalloc((unsigned) (objc * sizeof(double)));
+        }
+        CopyPackedCoords(bytes, size, objc, values);
+        *valuesPtr = values;
+        return objc;
+    }
+    if (objc == 1) {
+        if (Tcl_ListObjGetElements(interp, objv[0], &objc,
+            (Tcl_Obj ***) &objv) != TCL_OK) {
+            return -1;
+        }
+    }
+    if (objc > 64) {
+        values = (double *) ckalloc((unsigned) (objc * sizeof(double)));
+    }
+    for (i = 0; i < objc; i++) {
+        if (Tcl_GetDoubleFromObj(interp, objv[i], values + i) != TCL_OK) {
+            if (values != staticSpace) {
+                ckfree((char *) values);
+            }
+            return -1;
+        }
+    }
+    *valuesPtr = values;
+    return objc;
+}
+
+/*
+ * Adds a sample, evicting the oldest one if the ring is full. The
+ * range is only ever widened here.
+ */
+
+static void
+TracePush(TraceItem *tracePtr, double value)
+{
+    int i;
+
+    if (tracePtr->numSamples == tracePtr->ringSize) {
+        tracePtr->first++;
+        if (tracePtr->first == tracePtr->ringSize) {
+            tracePtr->first = 0;
+        }
+        tracePtr->numSamples--;
+        tracePtr->evicted++;
+    }
+    i = tracePtr->first + tracePtr->numSamples;
+    if (i >= tracePtr->ringSize) {
+        i -= tracePtr->ringSize;
+    }
+    tracePtr->samples[i] = value;
+    tracePtr->numSamples++;
+    tracePtr->min = MIN(tracePtr->min, value);
+    tracePtr->max = MAX(tracePtr->max, value);
+}
+
+/*
+ * Computes the range of the samples from all of them. This is only
+ * done once the ring has turned over since last time, which keeps
+ * pushing a sample constant time on average.
+ */
+
+static void
+ComputeTraceRange(TraceItem *tracePtr)
+{
+    int i, j;
+
+    tracePtr->min = 1.0e36;
+    tracePtr->max = -1.0e36;
+    for (i = 0, j = tracePtr->first; i < tracePtr->numSamples; i++, j++) {
+        if (j == tracePtr->ringSize) {
+            j = 0;
+        }
+        tracePtr->min = MIN(tracePtr->min, tracePtr->samples[j]);
+        tracePtr->max = MAX(tracePtr->max, tracePtr->samples[j]);
+    }
+    tracePtr->evicted = 0;
+}
+
+/*
+ * Makes a new ring keeping the newest samples that fit.
+ */
+
+static void
+ResizeTraceRing(TraceItem *tracePtr, int size)
+{
+    double *samples;
+    int i, j, num, skip;
+
+    samples = (double *) ckalloc((unsigned) (size * sizeof(double)));
+    num = MIN(tracePtr->numSamples, size);
+    skip = tracePtr->numSamples - num;
+    for (i = 0; i < num; i++) {
+        j = (tracePtr->first + skip + i) % tracePtr->ringSize;
+        samples[i] = tracePtr->samples[j];
+    }
+    if (tracePtr->samples != NULL) {
+        ckfree((char *) tracePtr->samples);
+    }
+    tracePtr->samples = samples;
+    tracePtr->ringSize = size;
+    tracePtr->first = 0;
+    tracePtr->numSamples = num;
+    if (skip > 0) {
+        ComputeTraceRange(tracePtr);
+    }
+}
+
+static void
+ComputeTraceBbox(Tk_PathCanvas canvas, TraceItem *tracePtr)
+{
+    Tk_PathItemEx *itemExPtr = &tracePtr->headerEx;
+    Tk_PathItem *itemPtr = &itemExPtr->header;
+    Tk_PathStyle style;
+    Tk_PathState state = itemExPtr->header.state;
+    TMatrix *p = &tracePtr->place;
+
+    if (state == TK_PATHSTATE_NULL) {
+	state = TkPathCanvasState(canvas);
+    }
+    if ((tracePtr->numSamples == 0) || (state == TK_PATHSTATE_HIDDEN)) {
+        itemExPtr->header.x1 = itemExPtr->header.x2 =
+        itemExPtr->header.y1 = itemExPtr->header.y2 = -1;
+        return;
+    }
+    style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+    itemPtr->bbox = NewEmptyPathRect();
+    IncludePointInRect(&itemPtr->bbox, p->tx, p->d*tracePtr->min + p->ty);
+    IncludePointInRect(&itemPtr->bbox, p->a*(tracePtr->numSamples - 1) + p->tx,
+            p->d*tracePtr->max + p->ty);
+    itemPtr->totalBbox = TraceTotalBbox(&style, &itemPtr->bbox);
+    SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr,
+            &itemPtr->totalBbox);
+    TkPathCanvasFreeInheritedStyle(&style);
+}
+
+/*
+ * Grows a bare bbox by the stroke. Miter corners of sharp turns, which
+ * noisy samples have plenty of, may stick out half the miter limit
+ * times the width.
+ */
+
+static PathRect
+TraceTotalBbox(Tk_PathStyle *stylePtr, PathRect *bboxPtr)
+{
+    PathRect rect;
+
+    rect = GetGenericPathTotalBboxFromBare(NULL, stylePtr, bboxPtr);
+    if ((stylePtr->strokeColor != NULL) && (stylePtr->joinStyle == JoinMiter)
+            && (stylePtr->strokeWidth > 1.0)) {
+        double extra = (0.5*stylePtr->miterLimit - 1.0) * stylePtr->strokeWidth;
+
+        if (extra > 0.0) {
+            rect.x1 -= extra;
+            rect.y1 -= extra;
+            rect.x2 += extra;
+            rect.y2 += extra;
+        }
+    }
+    return rect;
+}
+
+static int
+ConfigureTrace(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+        int objc, Tcl_Obj *CONST objv[], int flags)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    Tk_PathItemEx *itemExPtr = &tracePtr->headerEx;
+    Tk_PathStyle *stylePtr = &itemExPtr->style;
+    Tk_Window tkwin;
+    Tk_SavedOptions savedOptions;
+    Tcl_Obj *errorResult = NULL;
+    int error;
+    int mask = 0;
+
+    tkwin = Tk_PathCanvasTkwin(canvas);
+    for (error = 0; error <= 1; error++) {
+        if (!error) {
+            if (Tk_SetOptions(interp, (char *) tracePtr, optionTable,
+                    objc, objv, tkwin, &savedOptions, &mask) != TCL_OK) {
+                continue;
+            }
+            if (tracePtr->capacity < 1) {
+                Tcl_SetObjResult(interp, Tcl_NewStringObj(
+                        "capacity must be at least 1", -1));
+                continue;
+            }
+        } else {
+            errorResult = Tcl_GetObjResult(interp);
+            Tcl_IncrRefCount(errorResult);
+            Tk_RestoreSavedOptions(&savedOptions);
+        }
+        if (TkPathCanvasItemExConfigure(interp, canvas, itemExPtr, mask) != TCL_OK) {
+            continue;
+        }
+
+        /*
+         * If we reach this on the first pass we are OK and continue below.
+         */
+        break;
+    }
+    if (!error) {
+        Tk_FreeSavedOptions(&savedOptions);
+        stylePtr->mask |= mask;
+    }
+    if (tracePtr->capacity != tracePtr->ringSize) {
+        ResizeTraceRing(tracePtr, tracePtr->capacity);
+    }
+
+    if (error) {
+        Tcl_SetObjResult(interp, errorResult);
+        Tcl_DecrRefCount(errorResult);
+        return TCL_ERROR;
+    } else {
+        ComputeTraceBbox(canvas, tracePtr);
+        return TCL_OK;
+    }
+}
+
+static void
+DeleteTrace(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    Tk_PathItemEx *itemExPtr = &tracePtr->headerEx;
+
+    if (itemExPtr->styleInst != NULL) {
+	TkPathFreeStyle(itemExPtr->styleInst);
+    }
+    if (tracePtr->samples != NULL) {
+        ckfree((char *) tracePtr->samples);
+    }
+    Tk_FreeConfigOptions((char *) itemPtr, optionTable, Tk_PathCanvasTkwin(canvas));
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TraceWindow --
+ *
+ *	Finds the run of samples that may be drawn between two x
+ *	coordinates of the canvas, including the samples just outside
+ *	so that every segment crossing them is in the run.
+ *
+ * Results:
+ *	The first and last index of the run in *firstPtr and *lastPtr.
+ *	The run is empty if last is less than first, and all samples
+ *	if the matrix makes x depend on the value.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+TraceWindow(
+    TraceItem *tracePtr,
+    TMatrix *mPtr,		/* The item's matrix, or NULL. */
+    double x1, double x2,	/* The range of canvas x. */
+    int *firstPtr, int *lastPtr)
+{
+    double k = tracePtr->place.a, x0 = tracePtr->place.tx;
+    double lo, hi;
+    int n = tracePtr->numSamples;
+
+    *firstPtr = 0;
+    *lastPtr = n - 1;
+    if (mPtr != NULL) {
+        if (mPtr->c != 0.0) {
+            return;
+        }
+        k = mPtr->a * tracePtr->place.a;
+        x0 = mPtr->a * tracePtr->place.tx + mPtr->tx;
+    }
+    if (k == 0.0) {
+        return;
+    }
+    lo = (x1 - x0)/k;
+    hi = (x2 - x0)/k;
+    if (lo > hi) {
+        double tmp = lo;
+        lo = hi;
+        hi = tmp;
+    }
+    if ((hi < -1.0) || (lo > n)) {
+        *lastPtr = -1;
+        return;
+    }
+    *firstPtr = (int) MAX(0.0, floor(lo) - 1.0);
+    *lastPtr = (int) MIN(n - 1.0, ceil(hi) + 1.0);
+}
+
+/*
+ * Makes the points of the samples first to last in item coordinates,
+ * transformed by mPtr if not NULL. The caller frees them if they are
+ * not in staticSpace which holds kTraceStaticPoints points.
+ */
+
+static double *
+TraceRunCoords(TraceItem *tracePtr, int first, int last, TMatrix *mPtr,
+        double *staticSpace)
+{
+    TMatrix *p = &tracePtr->place;
+    double *coords = staticSpace, *c;
+    int i, j, num = last - first + 1;
+
+    if (num > kTraceStaticPoints) {
+        coords = (double *) ckalloc((unsigned) (2*num*sizeof(double)));
+    }
+    j = (tracePtr->first + first) % tracePtr->ringSize;
+    for (i = first, c = coords; i <= last; i++, j++, c += 2) {
+        if (j == tracePtr->ringSize) {
+            j = 0;
+        }
+        c[0] = p->a*i + p->tx;
+        c[1] = p->d*tracePtr->samples[j] + p->ty;
+        PathApplyTMatrix(mPtr, c, c+1);
+    }
+    return coords;
+}
+
+static void
+DisplayTrace(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, TkPathContext ctx,
+        int x, int y, int width, int height)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    TMatrix m = GetCanvasTMatrix(canvas);
+    Tk_PathStyle style;
+    PathPacked atoms;
+    double space[2*kTraceStaticPoints], *coords;
+    double margin;
+    int first, last;
+
+    if (tracePtr->numSamples < 2) {
+        return;
+    }
+
+    /* === EB - 23-apr-2010: register coordinate offsets */
+    TkPathSetCoordOffsets(m.tx, m.ty);
+    /* === */
+
+    /*
+     * Only the samples in the area to draw, grown by the stroke, are
+     * drawn. The path changes with the area and isn't retained.
+     */
+    style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+    margin = TraceTotalBbox(&style, &itemPtr->bbox).x2 - itemPtr->bbox.x2;
+    if (style.matrixPtr != NULL) {
+        margin *= MAX(hypot(style.matrixPtr->a, style.matrixPtr->b),
+                hypot(style.matrixPtr->c, style.matrixPtr->d));
+    }
+    TraceWindow(tracePtr, style.matrixPtr, x - margin, x + width + margin,
+            &first, &last);
+    if (last > first) {
+        coords = TraceRunCoords(tracePtr, first, last, NULL, space);
+        PathPackedInitPoly(&atoms, coords, last - first + 1, 0);
+        TkPathDrawPathInContext(ctx, &atoms, &style, &m, &itemPtr->bbox, NULL);
+        if (coords != space) {
+            ckfree((char *) coords);
+        }
+    }
+    TkPathCanvasFreeInheritedStyle(&style);
+}
+
+static void
+TraceBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    ComputeTraceBbox(canvas, tracePtr);
+}
+
+/*
+ * The hit tests hand the run of samples, already transformed to canvas
+ * coordinates, to the generic code through a copy of the header. The
+ * copy keeps any caches the generic code makes away from the item
+ * since they only hold for this run.
+ */
+
+static double
+TraceRunToPoint(Tk_PathCanvas canvas, TraceItem *tracePtr, Tk_PathStyle *stylePtr,
+        int first, int last, double *pointPtr)
+{
+    Tk_PathItem probe = tracePtr->headerEx.header;
+    Tk_PathStyle style = *stylePtr;
+    PathPacked atoms;
+    double space[2*kTraceStaticPoints], *coords;
+    double dist;
+
+    if (last <= first) {
+        return 1.0e36;
+    }
+    coords = TraceRunCoords(tracePtr, first, last, stylePtr->matrixPtr, space);
+    PathPackedInitPoly(&atoms, coords, last - first + 1, 0);
+    probe.flatCache = NULL;
+    probe.edgeCache = NULL;
+    style.matrixPtr = NULL;
+    dist = GenericPathToPoint(canvas, &probe, &style, &atoms, pointPtr);
+    TkPathFreeEdgeCache(probe.edgeCache);
+    if (coords != space) {
+        ckfree((char *) coords);
+    }
+    return dist;
+}
+
+static int
+TraceRunToArea(Tk_PathCanvas canvas, TraceItem *tracePtr, Tk_PathStyle *stylePtr,
+        int first, int last, double *areaPtr)
+{
+    Tk_PathItem probe = tracePtr->headerEx.header;
+    Tk_PathStyle style = *stylePtr;
+    PathPacked atoms;
+    double space[2*kTraceStaticPoints], *coords;
+    int area;
+
+    if (last <= first) {
+        return -1;
+    }
+    coords = TraceRunCoords(tracePtr, first, last, stylePtr->matrixPtr, space);
+    PathPackedInitPoly(&atoms, coords, last - first + 1, 0);
+    probe.flatCache = NULL;
+    probe.edgeCache = NULL;
+    style.matrixPtr = NULL;
+    area = GenericPathToArea(canvas, &probe, &style, &atoms, areaPtr);
+    TkPathFreeEdgeCache(probe.edgeCache);
+    if (coords != space) {
+        ckfree((char *) coords);
+    }
+    return area;
+}
+
+static double
+TraceToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    Tk_PathStyle style;
+    double dist, margin;
+    int first, last;
+
+    style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+    margin = kTraceHitMargin + style.strokeWidth;
+    TraceWindow(tracePtr, style.matrixPtr, pointPtr[0] - margin,
+            pointPtr[0] + margin, &first, &last);
+    dist = TraceRunToPoint(canvas, tracePtr, &style, first, last, pointPtr);
+
+    /*
+     * Samples outside the window are further away than margin from the
+     * point, which is kTraceHitMargin plus half the stroke width once
+     * the stroke is taken off. Only if nothing that close was found
+     * must we look at them all.
+     */
+    if ((dist > kTraceHitMargin + style.strokeWidth/2.0)
+            && ((first > 0) || (last < tracePtr->numSamples - 1))) {
+        dist = TraceRunToPoint(canvas, tracePtr, &style,
+                0, tracePtr->numSamples - 1, pointPtr);
+    }
+    TkPathCanvasFreeInheritedStyle(&style);
+    return dist;
+}
+
+static int
+TraceToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    Tk_PathStyle style;
+    double margin;
+    int area, first, last;
+
+    style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+    margin = style.strokeWidth + 1.0;
+    TraceWindow(tracePtr, style.matrixPtr, areaPtr[0] - margin,
+            areaPtr[2] + margin, &first, &last);
+    area = TraceRunToArea(canvas, tracePtr, &style, first, last, areaPtr);
+
+    /* The samples outside the window are outside the area. */
+    if ((area == 1)
+            && ((first > 0) || (last < tracePtr->numSamples - 1))) {
+        area = 0;
+    }
+    TkPathCanvasFreeInheritedStyle(&style);
+    return area;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TraceToPostscript --
+ *
+ *	The postscriptProc of trace items. All samples are stroked as
+ *	one polyline and Postscript clips it to the area printed. The
+ *	dash pattern and the stroke opacity are left out.
+ *
+ * Results:
+ *	Standard tcl result. Postscript for the item is appended to the
+ *	interpreter result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+TraceToPostscript(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int prepass)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    Tk_PathStyle style;
+    double space[2*kTraceStaticPoints], *coords;
+    double width;
+    char buffer[100];
+    int result = TCL_OK;
+
+    if (prepass || (tracePtr->numSamples < 2)) {
+        return TCL_OK;
+    }
+    style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
+    if (style.strokeColor != NULL) {
+        width = style.strokeWidth;
+        if (style.matrixPtr != NULL) {
+            width *= sqrt(fabs(style.matrixPtr->a * style.matrixPtr->d
+                    - style.matrixPtr->b * style.matrixPtr->c));
+        }
+        coords = TraceRunCoords(tracePtr, 0, tracePtr->numSamples - 1,
+                style.matrixPtr, space);
+        Tk_PathCanvasPsPath(interp, canvas, coords, tracePtr->numSamples);
+        if (coords != space) {
+            ckfree((char *) coords);
+        }
+        sprintf(buffer, "%.15g setlinewidth %d setlinecap %d setlinejoin\n",
+                width, (style.capStyle == CapRound) ? 1 :
+                ((style.capStyle == CapProjecting) ? 2 : 0),
+                (style.joinStyle == JoinRound) ? 1 :
+                ((style.joinStyle == JoinBevel) ? 2 : 0));
+        Tcl_AppendResult(interp, buffer, NULL);
+        result = Tk_PathCanvasPsColor(interp, canvas, style.strokeColor);
+        if (result == TCL_OK) {
+            Tcl_AppendResult(interp, "stroke\n", NULL);
+        }
+    }
+    TkPathCanvasFreeInheritedStyle(&style);
+    return result;
+}
+
+static void
+ScaleTrace(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double originX, double originY,
+        double scaleX, double scaleY)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+    TMatrix *p = &tracePtr->place;
+
+    p->a *= scaleX;
+    p->d *= scaleY;
+    p->tx = originX + scaleX*(p->tx - originX);
+    p->ty = originY + scaleY*(p->ty - originY);
+    ComputeTraceBbox(canvas, tracePtr);
+}
+
+static void
+TranslateTrace(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double deltaX, double deltaY)
+{
+    TraceItem *tracePtr = (TraceItem *) itemPtr;
+
+    tracePtr->place.tx += deltaX;
+    tracePtr->place.ty += deltaY;
+    ComputeTraceBbox(canvas, tracePtr);
+}
+
+/*----------------------------------------------------------------------*/
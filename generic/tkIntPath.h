@@ -91,14 +91,15 @@ extern "C" {
 #define HaveAnyFillFromPathColor(pcol) 		(((pcol != NULL) && ((pcol->color != NULL) || (pcol->gradientInstPtr != NULL))) ? 1 : 0 )
 
 /*
- * So far we use a fixed number of straight line segments when
- * doing various things, but it would be better to use the de Castlejau
- * algorithm to iterate these segments.
+ * Fixed number of straight line segments used where no tolerance is
+ * at hand. Hit testing flattens curves to the canvas -tolerance instead
+ * but never uses more than kPathMaxNumSegments per curve.
  */
 #define kPathNumSegmentsCurveTo     	18
 #define kPathNumSegmentsQuadBezier 	12
 #define kPathNumSegmentsMax		18
 #define kPathNumSegmentsEllipse         48
+#define kPathMaxNumSegments		1000
 
 #define kPathUnitTMatrix  {1.0, 0.0, 0.0, 1.0, 0.0, 0.0}
 
@@ -197,39 +198,32 @@ typedef struct LookupTable {
 #define LINE_PT_IN_ARROW 5
 
 /*
- * Records used for parsing path to a linked list of primitive 
- * drawing instructions.
- *
- * PathAtom: vaguely modelled after Tk_PathItem. Each atom has a PathAtom record
- * in its first position, padded with type specific data.
+ * Records describing the numbers of each atom type in the coords array
+ * of a PathPacked. They contain doubles only and overlay the array, so
+ * a pointer from PathAtomIterNext may be cast to the record of its type.
  */
 
 typedef struct MoveToAtom {
-    PathAtom pathAtom;		/* Generic stuff that's the same for all
-                                 * types.  MUST BE FIRST IN STRUCTURE. */
     double x;
     double y;
 } MoveToAtom;
 
 typedef struct LineToAtom {
-    PathAtom pathAtom;
     double x;
     double y;
 } LineToAtom;
 
 typedef struct ArcAtom {
-    PathAtom pathAtom;
     double radX;
     double radY;
     double angle;		/* In degrees! */
-    char largeArcFlag;
-    char sweepFlag;
+    double largeArcFlag;	/* 0 or 1. */
+    double sweepFlag;		/* 0 or 1. */
     double x;
     double y;
 } ArcAtom;
 
 typedef struct QuadBezierAtom {
-    PathAtom pathAtom;
     double ctrlX;
     double ctrlY;
     double anchorX;
@@ -237,7 +231,6 @@ typedef struct QuadBezierAtom {
 } QuadBezierAtom;
 
 typedef struct CurveToAtom {
-    PathAtom pathAtom;
     double ctrlX1;
     double ctrlY1;
     double ctrlX2;
@@ -247,13 +240,11 @@ typedef struct CurveToAtom {
 } CurveToAtom;
 
 typedef struct CloseAtom {
-    PathAtom pathAtom;
     double x;
     double y;
 } CloseAtom;
 
 typedef struct EllipseAtom {
-    PathAtom pathAtom;
     double cx;
     double cy;
     double rx;
@@ -261,7 +252,6 @@ typedef struct EllipseAtom {
 } EllipseAtom;
 
 typedef struct RectAtom {
-    PathAtom pathAtom;
     double x;
     double y;
     double width;
@@ -286,7 +276,19 @@ enum {
 void TkPathSetCoordOffsets(double dx, double dy);
 /* === */
 TkPathContext	TkPathInit(Tk_Window tkwin, Drawable d);
+TkPathContext	TkPathInitWithSize(Tk_Window tkwin, Drawable d, int width, int height);
 TkPathContext	TkPathInitSurface(int width, int height);
+TkPathContext	TkPathInitImageBuffer(Tk_Window tkwin, int width, int height);
+void		TkPathImageBufferFill(TkPathContext ctx, XColor *colorPtr,
+                    int x, int y, int width, int height);
+void		TkPathImageBufferPut(TkPathContext ctx, Drawable d, GC gc,
+                    int srcX, int srcY, int width, int height, int destX, int destY);
+void		TkPathImageBufferGet(TkPathContext ctx, Drawable d,
+                    int x, int y, int width, int height);
+TkPathContext	TkPathInitRecording(TkPathContext ctx,
+                    int x, int y, int width, int height);
+void		TkPathReplayRecording(TkPathContext recording, TkPathContext ctx,
+                    int numThreads);
 void		TkPathBeginPath(TkPathContext ctx, Tk_PathStyle *stylePtr);
 void    	TkPathEndPath(TkPathContext ctx);
 void		TkPathMoveTo(TkPathContext ctx, double x, double y);
@@ -302,9 +304,14 @@ void		TkPathArcToUsingBezier(TkPathContext ctx, double rx, double ry,
 void		TkPathRect(TkPathContext ctx, double x, double y, double width, double height);
 void		TkPathOval(TkPathContext ctx, double cx, double cy, double rx, double ry);
 void		TkPathClosePath(TkPathContext ctx);
+int		TkPathAppendRetainedPath(TkPathContext ctx, Tk_PathStyle *stylePtr, void *custom);
+void		TkPathRetainPath(TkPathContext ctx, void **customPtr);
+void		TkPathFreeRetainedPath(void *custom);
 void		TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo, 
                     double x, double y, double width, double height, double fillOpacity,
-                    XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion);
+                    XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+                    void **customPtr);
+void		TkPathImageFree(void *custom);
 int			TkPathTextConfig(Tcl_Interp *interp, Tk_PathTextStyle *textStylePtr, char *utf8, void **customPtr);
 void		TkPathTextDraw(TkPathContext ctx, Tk_PathStyle *style, 
                     Tk_PathTextStyle *textStylePtr, double x, double y, int fillOverStroke, char *utf8, void *custom);
@@ -314,16 +321,25 @@ void    	TkPathSurfaceErase(TkPathContext ctx, double x, double y, double width,
 void		TkPathSurfaceToPhoto(Tcl_Interp *interp, TkPathContext ctx, Tk_PhotoHandle photo);
 
 /*
- * General path drawing using linked list of path atoms.
+ * General path drawing using packed path atoms.
  */
 void		TkPathDrawPath(Tk_Window tkwin, Drawable drawable,
-                    PathAtom *atomPtr, Tk_PathStyle *stylePtr, TMatrix *mPtr,			
+                    PathPacked *atomPtr, Tk_PathStyle *stylePtr, TMatrix *mPtr,			
                     PathRect *bboxPtr);
-void		TkPathPaintPath(TkPathContext context, PathAtom *atomPtr,
+void		TkPathDrawPathInContext(TkPathContext context,
+                    PathPacked *atomPtr, Tk_PathStyle *stylePtr, TMatrix *mPtr,
+                    PathRect *bboxPtr, void **pathCachePtr);
+void		TkPathPaintPath(TkPathContext context, PathPacked *atomPtr,
                     Tk_PathStyle *stylePtr, PathRect *bboxPtr);
-PathRect	TkPathGetTotalBbox(PathAtom *atomPtr, Tk_PathStyle *stylePtr);
+PathRect	TkPathGetTotalBbox(PathPacked *atomPtr, Tk_PathStyle *stylePtr);
+
+/*
+ * Room needed for the atoms made by TkPathMakePrectAtoms.
+ */
+#define PATH_PRECT_NUM_ATOMS	10
+#define PATH_PRECT_NUM_COORDS	42
 
-void		TkPathMakePrectAtoms(double *pointsPtr, double rx, double ry, PathAtom **atomPtrPtr);
+void		TkPathMakePrectAtoms(double *pointsPtr, double rx, double ry, PathPacked *atomPtr);
 TkPathColor *	TkPathNewPathColor(Tcl_Interp *interp, Tk_Window tkwin, Tcl_Obj *nameObj);
 void		TkPathFreePathColor(TkPathColor *colorPtr);
 TkPathColor *	TkPathGetPathColor(Tcl_Interp *interp, Tk_Window tkwin, 
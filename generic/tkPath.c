@@ -222,139 +222,508 @@ GetPathArcParameters(Tcl_Interp *interp, Tcl_Obj *CONST objv[], int len, int *in
 /*
  *--------------------------------------------------------------
  *
- * NewMoveToAtom, NewLineToAtom, NewArcAtom, NewQuadBezierAtom,
- * NewCurveToAtom, NewCloseAtom --
+ * PathPackedInit, PathPackedInitStatic --
  *
- *		Creates a PathAtom of the specified type using the given
- *		parameters. It updates the currentX and currentY.
+ *		Initializes an empty PathPacked. The static variant makes
+ *		it use the caller supplied arrays until they are full,
+ *		which lets short-lived paths avoid the heap entirely.
  *
  * Results:
- *		A PathAtom pointer.
+ *		None.
  *
  * Side effects:
- *		Memory allocated.
+ *		None.
  *
  *--------------------------------------------------------------
  */
 
-PathAtom *
-NewMoveToAtom(double x, double y)
+void
+PathPackedInit(PathPacked *packedPtr)
 {
-    PathAtom *atomPtr;
-    MoveToAtom *moveToAtomPtr;
+    packedPtr->types = NULL;
+    packedPtr->coords = NULL;
+    packedPtr->numAtoms = 0;
+    packedPtr->numCoords = 0;
+    packedPtr->typesSpace = 0;
+    packedPtr->coordsSpace = 0;
+    packedPtr->flags = 0;
+    packedPtr->coordsOffset = 0;
+}
 
-    moveToAtomPtr = (MoveToAtom *) ckalloc((unsigned) (sizeof(MoveToAtom)));
-    atomPtr = (PathAtom *) moveToAtomPtr;
-    atomPtr->type = PATH_ATOM_M;
-    atomPtr->nextPtr = NULL;
-    moveToAtomPtr->x = x;
-    moveToAtomPtr->y = y;
-    return atomPtr;
+void
+PathPackedInitStatic(PathPacked *packedPtr, unsigned char *types, 
+        int typesSpace, double *coords, int coordsSpace)
+{
+    packedPtr->types = types;
+    packedPtr->coords = coords;
+    packedPtr->numAtoms = 0;
+    packedPtr->numCoords = 0;
+    packedPtr->typesSpace = typesSpace;
+    packedPtr->coordsSpace = coordsSpace;
+    packedPtr->flags = PATH_PACKED_STATIC;
+    packedPtr->coordsOffset = 0;
 }
 
-PathAtom *
-NewLineToAtom(double x, double y)
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPackedInitPoly --
+ *
+ *		Initializes a PathPacked as a polyline or polygon that uses
+ *		the caller supplied points in place. If closed, the last
+ *		point must repeat the first one.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		None.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+PathPackedInitPoly(PathPacked *packedPtr, double *coords, 
+        int numPoints, int closed)
 {
-    PathAtom *atomPtr;
-    LineToAtom *lineToAtomPtr;
+    packedPtr->types = NULL;
+    packedPtr->coords = coords;
+    packedPtr->numAtoms = numPoints;
+    packedPtr->numCoords = 2*numPoints;
+    packedPtr->typesSpace = 0;
+    packedPtr->coordsSpace = 2*numPoints;
+    packedPtr->flags = PATH_PACKED_STATIC | PATH_PACKED_POLY;
+    if (closed) {
+        packedPtr->flags |= PATH_PACKED_CLOSED;
+    }
+    packedPtr->coordsOffset = 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPackedSetPoly --
+ *
+ *		Makes packedPtr a polyline, or a polygon if closed, with
+ *		room for numPoints points plus the closing point. Any 
+ *		previous atoms are dropped, and the storage of a previous
+ *		polyline is reused when it is big enough.
+ *
+ * Results:
+ *		The coords array for the caller to fill in. For a polygon
+ *		the point after the numPoints ones must repeat the first.
+ *
+ * Side effects:
+ *		At most one allocation.
+ *
+ *--------------------------------------------------------------
+ */
 
-    lineToAtomPtr = (LineToAtom *) ckalloc((unsigned) (sizeof(LineToAtom)));
-    atomPtr = (PathAtom *) lineToAtomPtr;
-    atomPtr->type = PATH_ATOM_L;
-    atomPtr->nextPtr = NULL;
-    lineToAtomPtr->x = x;
-    lineToAtomPtr->y = y;
-    return atomPtr;
+double *
+PathPackedSetPoly(PathPacked *packedPtr, int numPoints, int closed)
+{
+    int numCoords = 2*(closed ? numPoints + 1 : numPoints);
+    
+    if (!(packedPtr->flags & PATH_PACKED_POLY) 
+            || (packedPtr->flags & PATH_PACKED_STATIC)
+            || (packedPtr->coordsOffset + packedPtr->coordsSpace < numCoords)) {
+        TkPathFreeAtoms(packedPtr);
+        packedPtr->coords = (double *) ckalloc((unsigned) (numCoords * sizeof(double)));
+        packedPtr->coordsSpace = numCoords;
+    } else if (packedPtr->coordsOffset > 0) {
+        packedPtr->coords -= packedPtr->coordsOffset;
+        packedPtr->coordsSpace += packedPtr->coordsOffset;
+        packedPtr->coordsOffset = 0;
+    }
+    packedPtr->numAtoms = numCoords/2;
+    packedPtr->numCoords = numCoords;
+    packedPtr->flags = PATH_PACKED_POLY;
+    if (closed) {
+        packedPtr->flags |= PATH_PACKED_CLOSED;
+    }
+    return packedPtr->coords;
 }
 
-PathAtom *
-NewArcAtom(double radX, double radY, 
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPackedAppendPoly --
+ *
+ *		Adds room for numPoints more points at the end of a
+ *		polyline, or before the closing point of a polygon. The
+ *		storage grows geometrically so that appending one point
+ *		at a time takes amortized constant time.
+ *
+ * Results:
+ *		Where the caller fills in the new points. The closing
+ *		point of a polygon has already been moved after them.
+ *
+ * Side effects:
+ *		Memory may be reallocated which moves all points.
+ *
+ *--------------------------------------------------------------
+ */
+
+double *
+PathPackedAppendPoly(PathPacked *packedPtr, int numPoints)
+{
+    int closed = (packedPtr->flags & PATH_PACKED_CLOSED) ? 1 : 0;
+    int numCoords = packedPtr->numCoords + 2*numPoints;
+    double *coords;
+    
+    if (!(packedPtr->flags & PATH_PACKED_POLY)) {
+        Tcl_Panic("can only append points to a packed polyline");
+    }
+    if ((packedPtr->flags & PATH_PACKED_STATIC) 
+            || (packedPtr->coordsSpace < numCoords)) {
+        int space = 2*numCoords;
+        
+        coords = (double *) ckalloc((unsigned) (space * sizeof(double)));
+        memcpy(coords, packedPtr->coords, 
+                (size_t) packedPtr->numCoords * sizeof(double));
+        if (!(packedPtr->flags & PATH_PACKED_STATIC)) {
+            ckfree((char *) (packedPtr->coords - packedPtr->coordsOffset));
+        }
+        packedPtr->coords = coords;
+        packedPtr->coordsSpace = space;
+        packedPtr->coordsOffset = 0;
+        packedPtr->flags &= ~PATH_PACKED_STATIC;
+    }
+    coords = packedPtr->coords + packedPtr->numCoords - 2*closed;
+    packedPtr->numAtoms += numPoints;
+    packedPtr->numCoords = numCoords;
+    if (closed) {
+        packedPtr->coords[numCoords-2] = packedPtr->coords[0];
+        packedPtr->coords[numCoords-1] = packedPtr->coords[1];
+    }
+    return coords;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPackedTrimPoly --
+ *
+ *		Removes the first numPoints points of a polyline or
+ *		polygon. The caller makes sure that at least two points
+ *		are left. The points are not moved until the trimmed off
+ *		space exceeds the points in use.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		The closing point of a polygon is set to the new first
+ *		point.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+PathPackedTrimPoly(PathPacked *packedPtr, int numPoints)
+{
+    int numCoords;
+    
+    if (!(packedPtr->flags & PATH_PACKED_POLY)) {
+        Tcl_Panic("can only trim points from a packed polyline");
+    }
+    packedPtr->coords += 2*numPoints;
+    packedPtr->coordsOffset += 2*numPoints;
+    packedPtr->coordsSpace -= 2*numPoints;
+    packedPtr->numAtoms -= numPoints;
+    packedPtr->numCoords -= 2*numPoints;
+    numCoords = packedPtr->numCoords;
+    if (packedPtr->flags & PATH_PACKED_CLOSED) {
+        packedPtr->coords[numCoords-2] = packedPtr->coords[0];
+        packedPtr->coords[numCoords-1] = packedPtr->coords[1];
+    }
+    if (!(packedPtr->flags & PATH_PACKED_STATIC) 
+            && (packedPtr->coordsOffset > numCoords)) {
+        double *coords = packedPtr->coords - packedPtr->coordsOffset;
+        
+        memmove(coords, packedPtr->coords, (size_t) numCoords * sizeof(double));
+        packedPtr->coords = coords;
+        packedPtr->coordsSpace += packedPtr->coordsOffset;
+        packedPtr->coordsOffset = 0;
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPackedReserve --
+ *
+ *		Makes sure there is room for at least numAtoms more atoms
+ *		with numCoords more numbers in total without further
+ *		reallocation.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Memory may be (re)allocated. Caller supplied arrays of a 
+ *		static PathPacked are copied to the heap when too small.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+PathPackedReserve(PathPacked *packedPtr, int numAtoms, int numCoords)
+{
+    int typesNeed = packedPtr->numAtoms + numAtoms;
+    int coordsNeed = packedPtr->numCoords + numCoords;
+    
+    if (packedPtr->flags & PATH_PACKED_POLY) {
+        Tcl_Panic("cannot add atoms to a packed polyline");
+    }
+    if ((typesNeed <= packedPtr->typesSpace) && 
+            (coordsNeed <= packedPtr->coordsSpace)) {
+        return;
+    }
+    if (typesNeed < 2*packedPtr->typesSpace) {
+        typesNeed = 2*packedPtr->typesSpace;
+    }
+    if (coordsNeed < 2*packedPtr->coordsSpace) {
+        coordsNeed = 2*packedPtr->coordsSpace;
+    }
+    if (packedPtr->flags & PATH_PACKED_STATIC) {
+        unsigned char *types;
+        double *coords;
+
+        types = (unsigned char *) ckalloc((unsigned) typesNeed);
+        coords = (double *) ckalloc((unsigned) (coordsNeed * sizeof(double)));
+        if (packedPtr->numAtoms > 0) {
+            memcpy(types, packedPtr->types, (size_t) packedPtr->numAtoms);
+            memcpy(coords, packedPtr->coords, 
+                    (size_t) packedPtr->numCoords * sizeof(double));
+        }
+        packedPtr->types = types;
+        packedPtr->coords = coords;
+        packedPtr->flags &= ~PATH_PACKED_STATIC;
+    } else {
+        packedPtr->types = (unsigned char *) ckrealloc(
+                (char *) packedPtr->types, (unsigned) typesNeed);
+        packedPtr->coords = (double *) ckrealloc(
+                (char *) packedPtr->coords, 
+                (unsigned) (coordsNeed * sizeof(double)));
+    }
+    packedPtr->typesSpace = typesNeed;
+    packedPtr->coordsSpace = coordsNeed;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathAtomNumCoords --
+ *
+ *		Gives the number of doubles an atom of the given type
+ *		occupies in the coords array.
+ *
+ * Results:
+ *		Number of doubles.
+ *
+ * Side effects:
+ *		None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+PathAtomNumCoords(int type)
+{
+    switch (type) {
+        case PATH_ATOM_M: 	return sizeof(MoveToAtom)/sizeof(double);
+        case PATH_ATOM_L: 	return sizeof(LineToAtom)/sizeof(double);
+        case PATH_ATOM_A: 	return sizeof(ArcAtom)/sizeof(double);
+        case PATH_ATOM_Q: 	return sizeof(QuadBezierAtom)/sizeof(double);
+        case PATH_ATOM_C: 	return sizeof(CurveToAtom)/sizeof(double);
+        case PATH_ATOM_Z: 	return sizeof(CloseAtom)/sizeof(double);
+        case PATH_ATOM_ELLIPSE: return sizeof(EllipseAtom)/sizeof(double);
+        case PATH_ATOM_RECT: 	return sizeof(RectAtom)/sizeof(double);
+    }
+    return 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathAtomIterInit, PathAtomIterNext --
+ *
+ *		Walks the atoms of a PathPacked in order. A NULL packedPtr
+ *		is treated as an empty path.
+ *
+ * Results:
+ *		PathAtomIterNext returns the type of the next atom and 
+ *		sets *coordsPtr to its numbers, or returns 0 when there are
+ *		no more atoms.
+ *
+ * Side effects:
+ *		Advances the iterator.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+PathAtomIterInit(PathAtomIter *iterPtr, PathPacked *packedPtr)
+{
+    static PathPacked empty = {NULL, NULL, 0, 0, 0, 0, 0, 0};
+
+    iterPtr->packedPtr = (packedPtr != NULL) ? packedPtr : &empty;
+    iterPtr->atom = 0;
+    iterPtr->coord = 0;
+}
+
+int
+PathAtomIterNext(PathAtomIter *iterPtr, double **coordsPtr)
+{
+    PathPacked *packedPtr = iterPtr->packedPtr;
+    int type;
+    
+    if (iterPtr->atom >= packedPtr->numAtoms) {
+        return 0;
+    }
+    if (packedPtr->types == NULL) {
+        
+        /* PATH_PACKED_POLY: all atoms are points. */
+        if (iterPtr->atom == 0) {
+            type = PATH_ATOM_M;
+        } else if ((iterPtr->atom == packedPtr->numAtoms - 1) 
+                && (packedPtr->flags & PATH_PACKED_CLOSED)) {
+            type = PATH_ATOM_Z;
+        } else {
+            type = PATH_ATOM_L;
+        }
+        iterPtr->atom++;
+        *coordsPtr = packedPtr->coords + iterPtr->coord;
+        iterPtr->coord += 2;
+        return type;
+    }
+    type = packedPtr->types[iterPtr->atom++];
+    *coordsPtr = packedPtr->coords + iterPtr->coord;
+    iterPtr->coord += PathAtomNumCoords(type);
+    return type;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * AddMoveToAtom, AddLineToAtom, AddArcAtom, AddQuadBezierAtom,
+ * AddCurveToAtom, AddRectAtom, AddEllipseAtom, AddCloseAtom --
+ *
+ *		Appends an atom of the specified type using the given
+ *		parameters to a PathPacked.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Memory may be (re)allocated.
+ *
+ *--------------------------------------------------------------
+ */
+
+static double *
+AddAtom(PathPacked *packedPtr, int type)
+{
+    int numCoords = PathAtomNumCoords(type);
+    double *coords;
+    
+    PathPackedReserve(packedPtr, 1, numCoords);
+    packedPtr->types[packedPtr->numAtoms++] = (unsigned char) type;
+    coords = packedPtr->coords + packedPtr->numCoords;
+    packedPtr->numCoords += numCoords;
+    return coords;
+}
+
+void
+AddMoveToAtom(PathPacked *packedPtr, double x, double y)
+{
+    MoveToAtom *move = (MoveToAtom *) AddAtom(packedPtr, PATH_ATOM_M);
+
+    move->x = x;
+    move->y = y;
+}
+
+void
+AddLineToAtom(PathPacked *packedPtr, double x, double y)
+{
+    LineToAtom *line = (LineToAtom *) AddAtom(packedPtr, PATH_ATOM_L);
+
+    line->x = x;
+    line->y = y;
+}
+
+void
+AddArcAtom(PathPacked *packedPtr, double radX, double radY, 
         double angle, char largeArcFlag, char sweepFlag, double x, double y)
 {
-    PathAtom *atomPtr;
-    ArcAtom *arcAtomPtr;
-
-    arcAtomPtr = (ArcAtom *) ckalloc((unsigned) (sizeof(ArcAtom)));
-    atomPtr = (PathAtom *) arcAtomPtr;
-    atomPtr->type = PATH_ATOM_A;
-    atomPtr->nextPtr = NULL;    
-    arcAtomPtr->radX = radX;
-    arcAtomPtr->radY = radY;
-    arcAtomPtr->angle = angle;
-    arcAtomPtr->largeArcFlag = largeArcFlag;
-    arcAtomPtr->sweepFlag = sweepFlag;
-    arcAtomPtr->x = x;
-    arcAtomPtr->y = y;
-    return atomPtr;
-}
-
-PathAtom *
-NewQuadBezierAtom(double ctrlX, double ctrlY, double anchorX, double anchorY)
-{
-    PathAtom *atomPtr;
-    QuadBezierAtom *quadBezierAtomPtr;
-
-    quadBezierAtomPtr = (QuadBezierAtom *) ckalloc((unsigned) (sizeof(QuadBezierAtom)));
-    atomPtr = (PathAtom *) quadBezierAtomPtr;
-    atomPtr->type = PATH_ATOM_Q;
-    atomPtr->nextPtr = NULL;
-    quadBezierAtomPtr->ctrlX = ctrlX;
-    quadBezierAtomPtr->ctrlY = ctrlY;
-    quadBezierAtomPtr->anchorX = anchorX;
-    quadBezierAtomPtr->anchorY = anchorY;
-    return atomPtr;
-}
-
-PathAtom *
-NewCurveToAtom(double ctrlX1, double ctrlY1, double ctrlX2, double ctrlY2, 
+    ArcAtom *arc = (ArcAtom *) AddAtom(packedPtr, PATH_ATOM_A);
+
+    arc->radX = radX;
+    arc->radY = radY;
+    arc->angle = angle;
+    arc->largeArcFlag = largeArcFlag ? 1.0 : 0.0;
+    arc->sweepFlag = sweepFlag ? 1.0 : 0.0;
+    arc->x = x;
+    arc->y = y;
+}
+
+void
+AddQuadBezierAtom(PathPacked *packedPtr, double ctrlX, double ctrlY, 
         double anchorX, double anchorY)
 {
-    PathAtom *atomPtr;
-    CurveToAtom *curveToAtomPtr;
+    QuadBezierAtom *quad = (QuadBezierAtom *) AddAtom(packedPtr, PATH_ATOM_Q);
 
-    curveToAtomPtr = (CurveToAtom *) ckalloc((unsigned) (sizeof(CurveToAtom)));
-    atomPtr = (PathAtom *) curveToAtomPtr;
-    atomPtr->type = PATH_ATOM_C;
-    atomPtr->nextPtr = NULL;
-    curveToAtomPtr->ctrlX1 = ctrlX1;
-    curveToAtomPtr->ctrlY1 = ctrlY1;
-    curveToAtomPtr->ctrlX2 = ctrlX2;
-    curveToAtomPtr->ctrlY2 = ctrlY2;
-    curveToAtomPtr->anchorX = anchorX;
-    curveToAtomPtr->anchorY = anchorY;
-    return atomPtr;
+    quad->ctrlX = ctrlX;
+    quad->ctrlY = ctrlY;
+    quad->anchorX = anchorX;
+    quad->anchorY = anchorY;
 }
 
-PathAtom *
-NewRectAtom(double pointsPtr[])
+void
+AddCurveToAtom(PathPacked *packedPtr, double ctrlX1, double ctrlY1, 
+        double ctrlX2, double ctrlY2, double anchorX, double anchorY)
 {
-    PathAtom *atomPtr;
-    RectAtom *rectAtomPtr;
+    CurveToAtom *curve = (CurveToAtom *) AddAtom(packedPtr, PATH_ATOM_C);
 
-    rectAtomPtr = (RectAtom *) ckalloc((unsigned) (sizeof(RectAtom)));
-    atomPtr = (PathAtom *) rectAtomPtr;    
-    atomPtr->nextPtr = NULL;
-    atomPtr->type = PATH_ATOM_RECT;
-    rectAtomPtr->x = pointsPtr[0];
-    rectAtomPtr->y = pointsPtr[1];
-    rectAtomPtr->width = pointsPtr[2] - pointsPtr[0];
-    rectAtomPtr->height = pointsPtr[3] - pointsPtr[1];
-    return atomPtr;
+    curve->ctrlX1 = ctrlX1;
+    curve->ctrlY1 = ctrlY1;
+    curve->ctrlX2 = ctrlX2;
+    curve->ctrlY2 = ctrlY2;
+    curve->anchorX = anchorX;
+    curve->anchorY = anchorY;
 }
 
-PathAtom *
-NewCloseAtom(double x, double y)
+void
+AddRectAtom(PathPacked *packedPtr, double pointsPtr[])
 {
-    PathAtom *atomPtr;
-    CloseAtom *closeAtomPtr;
+    RectAtom *rect = (RectAtom *) AddAtom(packedPtr, PATH_ATOM_RECT);
 
-    closeAtomPtr = (CloseAtom *) ckalloc((unsigned) (sizeof(CloseAtom)));
-    atomPtr = (PathAtom *) closeAtomPtr;
-    atomPtr->type = PATH_ATOM_Z;
-    atomPtr->nextPtr = NULL;
-    closeAtomPtr->x = x;
-    closeAtomPtr->y = y;
-    return atomPtr;
+    rect->x = pointsPtr[0];
+    rect->y = pointsPtr[1];
+    rect->width = pointsPtr[2] - pointsPtr[0];
+    rect->height = pointsPtr[3] - pointsPtr[1];
+}
+
+void
+AddEllipseAtom(PathPacked *packedPtr, double cx, double cy, 
+        double rx, double ry)
+{
+    EllipseAtom *ell = (EllipseAtom *) AddAtom(packedPtr, PATH_ATOM_ELLIPSE);
+
+    ell->cx = cx;
+    ell->cy = cy;
+    ell->rx = rx;
+    ell->ry = ry;
+}
+
+void
+AddCloseAtom(PathPacked *packedPtr, double x, double y)
+{
+    CloseAtom *close = (CloseAtom *) AddAtom(packedPtr, PATH_ATOM_Z);
+
+    close->x = x;
+    close->y = y;
 }
 
 /*
@@ -363,7 +732,8 @@ NewCloseAtom(double x, double y)
  * TkPathParseToAtoms
  *
  *		Takes a tcl list of values which defines the path item and
- *		parses them into a linked list of path atoms.
+ *		parses them into packed path atoms. The packedPtr is 
+ *		initialized here and must be freed with TkPathFreeAtoms.
  *
  * Results:
  *		A standard Tcl result.
@@ -375,7 +745,7 @@ NewCloseAtom(double x, double y)
  */
 
 int
-TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPtr, int *lenPtr)
+TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathPacked *packedPtr, int *lenPtr)
 {
     char 	currentInstr;		/* current instruction (M, l, c, etc.) */
     char 	lastInstr;			/* previous instruction */
@@ -389,10 +759,8 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
     double 	ctrlX, ctrlY;		/* last control point, for s, S, t, T */
     double 	x, y;
     Tcl_Obj **objv;
-    PathAtom *atomPtr = NULL;
-    PathAtom *currentAtomPtr = NULL;
     
-    *atomPtrPtr = NULL;
+    PathPackedInit(packedPtr);
     currentX = 0.0;
     currentY = 0.0;
     startX = 0.0;
@@ -424,6 +792,12 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
         return TCL_ERROR;
     }
     currentInd = 0;
+    
+    /* 
+     * Each instruction takes at least one list element, and no atom
+     * has more numbers than elements, so this is enough for most paths.
+     */
+    PathPackedReserve(packedPtr, len/2, len);
      
     while (currentInd < len) {
 
@@ -457,13 +831,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                     x += currentX;
                     y += currentY;
                 }    
-                atomPtr = NewMoveToAtom(x, y);
-                if (currentAtomPtr == NULL) {
-                    *atomPtrPtr = atomPtr;
-                } else {
-                    currentAtomPtr->nextPtr = atomPtr;
-                }
-                currentAtomPtr = atomPtr;
+                AddMoveToAtom(packedPtr, x, y);
                 currentX = x;
                 currentY = y;
                 startX = x;
@@ -481,9 +849,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         x += currentX;
                         y += currentY;
                     }    
-                    atomPtr = NewLineToAtom(x, y);
-                    currentAtomPtr->nextPtr = atomPtr;
-                    currentAtomPtr = atomPtr;
+                    AddLineToAtom(packedPtr, x, y);
                     currentX = x;
                     currentY = y;
                 } else {
@@ -503,9 +869,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         x += currentX;
                         y += currentY;
                     }    
-                    atomPtr = NewArcAtom(radX, radY, angle, largeArcFlag, sweepFlag, x, y);
-                    currentAtomPtr->nextPtr = atomPtr;
-                    currentAtomPtr = atomPtr;
+                    AddArcAtom(packedPtr, radX, radY, angle, largeArcFlag, sweepFlag, x, y);
                     currentX = x;
                     currentY = y;
                 } else {
@@ -530,9 +894,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         x  += currentX;
                         y  += currentY;
                     }    
-                    atomPtr = NewCurveToAtom(x1, y1, x2, y2, x, y);
-                    currentAtomPtr->nextPtr = atomPtr;
-                    currentAtomPtr = atomPtr;
+                    AddCurveToAtom(packedPtr, x1, y1, x2, y2, x, y);
                     ctrlX = x2; 	/* Keep track of the last control point. */
                     ctrlY = y2;
                     currentX = x;
@@ -567,9 +929,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         x  += currentX;
                         y  += currentY;
                     }    
-                    atomPtr = NewCurveToAtom(x1, y1, x2, y2, x, y);
-                    currentAtomPtr->nextPtr = atomPtr;
-                    currentAtomPtr = atomPtr;
+                    AddCurveToAtom(packedPtr, x1, y1, x2, y2, x, y);
                     ctrlX = x2; 	/* Keep track of the last control point. */
                     ctrlY = y2;
                     currentX = x;
@@ -590,9 +950,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         x  += currentX;
                         y  += currentY;
                     }    
-                    atomPtr = NewQuadBezierAtom(x1, y1, x, y);
-                    currentAtomPtr->nextPtr = atomPtr;
-                    currentAtomPtr = atomPtr;
+                    AddQuadBezierAtom(packedPtr, x1, y1, x, y);
                     ctrlX = x1; 	/* Keep track of the last control point. */
                     ctrlY = y1;
                     currentX = x;
@@ -620,9 +978,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         x  += currentX;
                         y  += currentY;
                     }    
-                    atomPtr = NewQuadBezierAtom(x1, y1, x, y);
-                    currentAtomPtr->nextPtr = atomPtr;
-                    currentAtomPtr = atomPtr;
+                    AddQuadBezierAtom(packedPtr, x1, y1, x, y);
                     ctrlX = x1; 	/* Keep track of the last control point. */
                     ctrlY = y1;
                     currentX = x;
@@ -637,9 +993,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                 while ((index < len) && 
                         (GetPathDouble(interp, objv, len, &index, &x) == TCL_OK))
                     ;
-                atomPtr = NewLineToAtom(x, currentY);
-                currentAtomPtr->nextPtr = atomPtr;
-                currentAtomPtr = atomPtr;
+                AddLineToAtom(packedPtr, x, currentY);
                 currentX = x;
                 break;
             }
@@ -652,9 +1006,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         (GetPathDouble(interp, objv, len, &index, &z) == TCL_OK)) {
                     x += z;
                 }
-                atomPtr = NewLineToAtom(x, currentY);
-                currentAtomPtr->nextPtr = atomPtr;
-                currentAtomPtr = atomPtr;
+                AddLineToAtom(packedPtr, x, currentY);
                 currentX = x;
                 break;
             }
@@ -663,9 +1015,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                 while ((index < len) && 
                         (GetPathDouble(interp, objv, len, &index, &y) == TCL_OK))
                     ;
-                atomPtr = NewLineToAtom(currentX, y);
-                currentAtomPtr->nextPtr = atomPtr;
-                currentAtomPtr = atomPtr;
+                AddLineToAtom(packedPtr, currentX, y);
                 currentY = y;
                 break;
             }
@@ -678,17 +1028,13 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
                         (GetPathDouble(interp, objv, len, &index, &z) == TCL_OK)) {
                     y += z;
                 }
-                atomPtr = NewLineToAtom(currentX, y);
-                currentAtomPtr->nextPtr = atomPtr;
-                currentAtomPtr = atomPtr;
+                AddLineToAtom(packedPtr, currentX, y);
                 currentY = y;
                 break;
             }
             
             case 'Z': case 'z': {
-                atomPtr = NewCloseAtom(startX, startY);
-                currentAtomPtr->nextPtr = atomPtr;
-                currentAtomPtr = atomPtr;
+                AddCloseAtom(packedPtr, startX, startY);
                 currentX = startX;
                 currentY = startY;
                 break;
@@ -711,8 +1057,7 @@ TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPt
     
 error:
 
-    TkPathFreeAtoms(*atomPtrPtr);
-    *atomPtrPtr = NULL;
+    TkPathFreeAtoms(packedPtr);
     return TCL_ERROR;
 }
 
@@ -721,27 +1066,30 @@ error:
  *
  * TkPathFreeAtoms
  *
- *		Frees up all memory allocated for the path atoms.
+ *		Frees up all memory allocated for the path atoms and
+ *		leaves packedPtr empty.
  *
  * Results:
  *		None.
  *
  * Side effects:
- *		None.
+ *		Memory freed.
  *
  *--------------------------------------------------------------
  */
 
 void
-TkPathFreeAtoms(PathAtom *pathAtomPtr)
+TkPathFreeAtoms(PathPacked *packedPtr)
 {
-    PathAtom *tmpAtomPtr;
-
-    while (pathAtomPtr != NULL) {
-        tmpAtomPtr = pathAtomPtr;
-        pathAtomPtr = tmpAtomPtr->nextPtr;
-        ckfree((char *) tmpAtomPtr);
+    if (!(packedPtr->flags & PATH_PACKED_STATIC)) {
+        if (packedPtr->types != NULL) {
+            ckfree((char *) packedPtr->types);
+        }
+        if (packedPtr->coords != NULL) {
+            ckfree((char *) (packedPtr->coords - packedPtr->coordsOffset));
+        }
     }
+    PathPackedInit(packedPtr);
 }
 
 /*
@@ -749,7 +1097,7 @@ TkPathFreeAtoms(PathAtom *pathAtomPtr)
  *
  * TkPathNormalize
  *
- *		Takes a list of PathAtoms and creates a tcl list where
+ *		Takes packed path atoms and creates a tcl list where
  *		elements have a standard form. All upper case instructions,
  *		no repeates.
  *
@@ -763,15 +1111,19 @@ TkPathFreeAtoms(PathAtom *pathAtomPtr)
  */
 
 int
-TkPathNormalize(Tcl_Interp *interp, PathAtom *atomPtr, Tcl_Obj **listObjPtrPtr)
+TkPathNormalize(Tcl_Interp *interp, PathPacked *packedPtr, Tcl_Obj **listObjPtrPtr)
 {
     Tcl_Obj *normObjPtr;    
+    PathAtomIter iter;
+    double *atomPtr;
+    int type;
 
     normObjPtr = Tcl_NewListObj( 0, (Tcl_Obj **) NULL );
 
-    while (atomPtr != NULL) {
+    PathAtomIterInit(&iter, packedPtr);
+    while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
     
-        switch (atomPtr->type) {
+        switch (type) {
             case PATH_ATOM_M: { 
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
                 
@@ -795,8 +1147,8 @@ TkPathNormalize(Tcl_Interp *interp, PathAtom *atomPtr, Tcl_Obj **listObjPtrPtr)
                 Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewDoubleObj(arc->radX));
                 Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewDoubleObj(arc->radY));
                 Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewDoubleObj(arc->angle));
-                Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewBooleanObj(arc->largeArcFlag));
-                Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewBooleanObj(arc->sweepFlag));
+                Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewBooleanObj(arc->largeArcFlag != 0.0));
+                Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewBooleanObj(arc->sweepFlag != 0.0));
                 Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewDoubleObj(arc->x));
                 Tcl_ListObjAppendElement(interp, normObjPtr, Tcl_NewDoubleObj(arc->y));
                 break;
@@ -833,7 +1185,6 @@ TkPathNormalize(Tcl_Interp *interp, PathAtom *atomPtr, Tcl_Obj **listObjPtrPtr)
                 break;
             }
         }
-        atomPtr = atomPtr->nextPtr;
     }
     *listObjPtrPtr = normObjPtr;
     return TCL_OK;
@@ -844,7 +1195,7 @@ TkPathNormalize(Tcl_Interp *interp, PathAtom *atomPtr, Tcl_Obj **listObjPtrPtr)
  *
  * TkPathMakePath
  *
- *		Defines the path using the PathAtom.
+ *		Defines the path using the packed path atoms.
  *
  * Results:
  *		A standard Tcl result.
@@ -858,14 +1209,19 @@ TkPathNormalize(Tcl_Interp *interp, PathAtom *atomPtr, Tcl_Obj **listObjPtrPtr)
 int
 TkPathMakePath(
     TkPathContext context,
-    PathAtom *atomPtr,
+    PathPacked *packedPtr,
     Tk_PathStyle *stylePtr)
 {
+    PathAtomIter iter;
+    double *atomPtr;
+    int type;
+
     TkPathBeginPath(context, stylePtr);
 
-    while (atomPtr != NULL) {
+    PathAtomIterInit(&iter, packedPtr);
+    while ((type = PathAtomIterNext(&iter, &atomPtr)) != 0) {
     
-        switch (atomPtr->type) {
+        switch (type) {
             case PATH_ATOM_M: { 
                 MoveToAtom *move = (MoveToAtom *) atomPtr;
                 TkPathMoveTo(context, move->x, move->y);
@@ -879,7 +1235,7 @@ TkPathMakePath(
             case PATH_ATOM_A: {
                 ArcAtom *arc = (ArcAtom *) atomPtr;
                 TkPathArcTo(context, arc->radX, arc->radY, arc->angle, 
-                        arc->largeArcFlag, arc->sweepFlag,
+                        (char) arc->largeArcFlag, (char) arc->sweepFlag,
                         arc->x, arc->y);
                 break;
             }
@@ -913,7 +1269,6 @@ TkPathMakePath(
                 break;
             }
         }
-        atomPtr = atomPtr->nextPtr;
     }
     TkPathEndPath(context);
     return TCL_OK;
@@ -25,7 +25,7 @@ extern "C" {
 #endif
 
 /*
- * The enum below defines the valid types for the PathAtom's.
+ * The enum below defines the valid types for the path atoms.
  */
 
 typedef enum {
@@ -65,17 +65,46 @@ typedef struct TMatrix {
 } TMatrix;
 
 /*
- * Records used for parsing path to a linked list of primitive 
- * drawing instructions.
+ * Record used for parsing path to a sequence of primitive drawing 
+ * instructions, atoms. The atoms are stored packed: one PathAtomType 
+ * byte per atom in types, and the numbers of all atoms, in order, in 
+ * coords. The layout of the numbers of each atom type is given by the
+ * *Atom records in tkIntPath.h. Use a PathAtomIter to walk the atoms.
  *
- * PathAtom: vaguely modelled after Tk_PathItem. Each atom has a PathAtom record
- * in its first position, padded with type specific data.
+ * Polylines and polygons use the PATH_PACKED_POLY form where types is
+ * NULL and coords is just the points, the first being the M atom and
+ * the rest L atoms. With PATH_PACKED_CLOSED the last point is the Z atom
+ * and repeats the first point.
  */
  
-typedef struct PathAtom {
-    PathAtomType type;		/* Type of PathAtom. */
-    struct PathAtom *nextPtr;	/* Next PathAtom along the path. */
-} PathAtom;
+typedef struct PathPacked {
+    unsigned char *types;	/* One PathAtomType per atom. */
+    double *coords;		/* The numbers of all atoms. */
+    int numAtoms;		/* Number of atoms in types. */
+    int numCoords;		/* Number of doubles used in coords. */
+    int typesSpace;		/* Allocated size of types. */
+    int coordsSpace;		/* Allocated size of coords. */
+    int flags;			/* PATH_PACKED_STATIC if the arrays are
+				 * supplied by the caller and not owned,
+				 * PATH_PACKED_POLY, PATH_PACKED_CLOSED. */
+    int coordsOffset;		/* Number of doubles trimmed off the front
+				 * of a polyline that are still allocated
+				 * before coords. */
+} PathPacked;
+
+#define PATH_PACKED_STATIC	    (1L << 0)
+#define PATH_PACKED_POLY	    (1L << 1)
+#define PATH_PACKED_CLOSED	    (1L << 2)
+
+typedef struct PathAtomIter {
+    PathPacked *packedPtr;
+    int atom;			/* Index of the next atom. */
+    int coord;			/* Index of the first number of the next
+				 * atom in coords. */
+} PathAtomIter;
+
+#define PathAtomIterMore(iterPtr) \
+    ((iterPtr)->atom < (iterPtr)->packedPtr->numAtoms)
 
 typedef void (TkPathGradientChangedProc)(ClientData clientData, int flags);
 typedef void (TkPathStyleChangedProc)(ClientData clientData, int flags);
@@ -174,12 +203,6 @@ typedef struct TkPathColor {
 			     * It points to the actual gradient object, the master. */
 } TkPathColor;
 
-/*
- * Opaque platform dependent struct.
- */
- 
-typedef XID TkPathContext;
-
 /* 
  * Information used for parsing configuration options.
  * Mask bits for options changed.
@@ -270,27 +293,42 @@ typedef struct Tk_PathTextStyle {
 } Tk_PathTextStyle;
 
 /*
- * Functions to create path atoms.
+ * Functions to create and walk packed path atoms.
  */
  
-PathAtom *  NewMoveToAtom(double x, double y);
-PathAtom *  NewLineToAtom(double x, double y);
-PathAtom *  NewArcAtom(double radX, double radY, 
+void	    PathPackedInit(PathPacked *packedPtr);
+void	    PathPackedInitStatic(PathPacked *packedPtr, unsigned char *types, 
+		int typesSpace, double *coords, int coordsSpace);
+void	    PathPackedInitPoly(PathPacked *packedPtr, double *coords, 
+		int numPoints, int closed);
+double *    PathPackedSetPoly(PathPacked *packedPtr, int numPoints, int closed);
+double *    PathPackedAppendPoly(PathPacked *packedPtr, int numPoints);
+void	    PathPackedTrimPoly(PathPacked *packedPtr, int numPoints);
+void	    PathPackedReserve(PathPacked *packedPtr, int numAtoms, int numCoords);
+int	    PathAtomNumCoords(int type);
+void	    PathAtomIterInit(PathAtomIter *iterPtr, PathPacked *packedPtr);
+int	    PathAtomIterNext(PathAtomIter *iterPtr, double **coordsPtr);
+void	    AddMoveToAtom(PathPacked *packedPtr, double x, double y);
+void	    AddLineToAtom(PathPacked *packedPtr, double x, double y);
+void	    AddArcAtom(PathPacked *packedPtr, double radX, double radY, 
 		double angle, char largeArcFlag, char sweepFlag, double x, double y);
-PathAtom *  NewQuadBezierAtom(double ctrlX, double ctrlY, double anchorX, double anchorY);
-PathAtom *  NewCurveToAtom(double ctrlX1, double ctrlY1, double ctrlX2, double ctrlY2, 
+void	    AddQuadBezierAtom(PathPacked *packedPtr, double ctrlX, double ctrlY, 
 		double anchorX, double anchorY);
-PathAtom *  NewRectAtom(double pointsPtr[]);
-PathAtom *  NewCloseAtom(double x, double y);
+void	    AddCurveToAtom(PathPacked *packedPtr, double ctrlX1, double ctrlY1, 
+		double ctrlX2, double ctrlY2, double anchorX, double anchorY);
+void	    AddRectAtom(PathPacked *packedPtr, double pointsPtr[]);
+void	    AddEllipseAtom(PathPacked *packedPtr, double cx, double cy, 
+		double rx, double ry);
+void	    AddCloseAtom(PathPacked *packedPtr, double x, double y);
 
 /*
  * Functions that process lists and atoms.
  */
  
-int	TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathAtom **atomPtrPtr, int *lenPtr);
-void	TkPathFreeAtoms(PathAtom *pathAtomPtr);
-int	TkPathNormalize(Tcl_Interp *interp, PathAtom *atomPtr, Tcl_Obj **listObjPtrPtr);
-int	TkPathMakePath(Drawable drawable, PathAtom *atomPtr, Tk_PathStyle *stylePtr);
+int	TkPathParseToAtoms(Tcl_Interp *interp, Tcl_Obj *listObjPtr, PathPacked *packedPtr, int *lenPtr);
+void	TkPathFreeAtoms(PathPacked *packedPtr);
+int	TkPathNormalize(Tcl_Interp *interp, PathPacked *packedPtr, Tcl_Obj **listObjPtrPtr);
+int	TkPathMakePath(TkPathContext context, PathPacked *packedPtr, Tk_PathStyle *stylePtr);
 
 /*
  * Stroke, fill, clip etc.
@@ -420,10 +420,8 @@ GetTwoPointsCoords(Tcl_Interp *interp, double *pointsPtr, int objc, Tcl_Obj *CON
 }
 
 static int
-MakePolyAtoms(Tcl_Interp *interp, int closed, int objc, Tcl_Obj *CONST objv[], PathAtom **atomPtrPtr)
+MakePolyAtoms(Tcl_Interp *interp, int closed, int objc, Tcl_Obj *CONST objv[], PathPacked *atomPtr)
 {
-    PathAtom *atomPtr = NULL;
-
     if (objc == 1) {
         if (Tcl_ListObjGetElements(interp, objv[0], &objc,
             (Tcl_Obj ***) &objv) != TCL_OK) {
@@ -438,30 +436,18 @@ MakePolyAtoms(Tcl_Interp *interp, int closed, int objc, Tcl_Obj *CONST objv[], P
         return TCL_ERROR;
     } else {
         int 	i;
-        double	x, y;
-        double	firstX = 0.0, firstY = 0.0;
-        PathAtom *firstAtomPtr = NULL;
-
-        for (i = 0; i < objc; i += 2) {
-            if ((Tcl_GetDoubleFromObj(interp, objv[i], &x) != TCL_OK)
-                    || (Tcl_GetDoubleFromObj(interp, objv[i+1], &y) != TCL_OK)) {
-                TkPathFreeAtoms(atomPtr);
+        double	*coords;
+
+        coords = PathPackedSetPoly(atomPtr, objc/2, closed);
+        for (i = 0; i < objc; i++) {
+            if (Tcl_GetDoubleFromObj(interp, objv[i], coords + i) != TCL_OK) {
                 return TCL_ERROR;
             }
-            if (i == 0) {
-                firstX = x;
-                firstY = y;
-                atomPtr = NewMoveToAtom(x, y);
-                firstAtomPtr = atomPtr;
-            } else {
-                atomPtr->nextPtr = NewLineToAtom(x, y);
-                atomPtr = atomPtr->nextPtr;
-            }
         }
         if (closed) {
-            atomPtr->nextPtr = NewCloseAtom(firstX, firstY);
+            coords[objc] = coords[0];
+            coords[objc+1] = coords[1];
         }
-        *atomPtrPtr = firstAtomPtr;
     }
     return TCL_OK;
 }
@@ -529,8 +515,9 @@ SurfaceCreateEllipse(Tcl_Interp* interp, PathSurface *surfacePtr, int type, int
     TkPathContext 	context = surfacePtr->ctx;
     int			i;
     double		center[2];
-    PathAtom 		*atomPtr;
-    EllipseAtom 	ellAtom;
+    PathPacked 		atoms;
+    unsigned char	types[1];
+    double		coords[4];
     PathRect		bbox;
     SurfEllipseItem	ellipse;
     Tk_PathStyle	*style = &ellipse.style;
@@ -568,22 +555,18 @@ SurfaceCreateEllipse(Tcl_Interp* interp, PathSurface *surfacePtr, int type, int
     }
     ellipse.rx = MAX(0.0, ellipse.rx);
     ellipse.ry = MAX(0.0, ellipse.ry);
-    atomPtr = (PathAtom *)&ellAtom;
-    atomPtr->nextPtr = NULL;
-    atomPtr->type = PATH_ATOM_ELLIPSE;
-    ellAtom.cx = center[0];
-    ellAtom.cy = center[1];
-    ellAtom.rx = ellipse.rx;
-    ellAtom.ry = (type == kPathSurfaceItemCircle) ? ellipse.rx : ellipse.ry;
+    PathPackedInitStatic(&atoms, types, 1, coords, 4);
+    AddEllipseAtom(&atoms, center[0], center[1], ellipse.rx,
+            (type == kPathSurfaceItemCircle) ? ellipse.rx : ellipse.ry);
     TkPathSaveState(context);
     TkPathPushTMatrix(context, mergedStyle.matrixPtr);
-    if (TkPathMakePath(context, atomPtr, &mergedStyle) != TCL_OK) {
+    if (TkPathMakePath(context, &atoms, &mergedStyle) != TCL_OK) {
         TkPathRestoreState(context);
         result = TCL_ERROR;
         goto bail;
     }
-    bbox = TkPathGetTotalBbox(atomPtr, &mergedStyle);
-    TkPathPaintPath(context, atomPtr, &mergedStyle, &bbox);
+    bbox = TkPathGetTotalBbox(&atoms, &mergedStyle);
+    TkPathPaintPath(context, &atoms, &mergedStyle, &bbox);
     TkPathRestoreState(context);
 
 bail:
@@ -606,7 +589,7 @@ static int
 SurfaceCreatePath(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Obj* CONST objv[]) 
 {
     TkPathContext 	context = surfacePtr->ctx;
-    PathAtom 		*atomPtr = NULL;
+    PathPacked 		atoms;
     PathRect		bbox;
     SurfGenericItem	item;
     Tk_PathStyle	*style = &item.style;
@@ -616,7 +599,7 @@ SurfaceCreatePath(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Obj
     
     item.styleObj = NULL;
     TkPathInitStyle(&item.style);
-    if (TkPathParseToAtoms(interp, objv[3], &atomPtr, &len) != TCL_OK) {
+    if (TkPathParseToAtoms(interp, objv[3], &atoms, &len) != TCL_OK) {
         return TCL_ERROR;
     }
     if (SurfaceParseOptions(interp, (char *)&item, gOptionTablePath, objc-4, objv+4) != TCL_OK) {
@@ -637,16 +620,16 @@ SurfaceCreatePath(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Obj
     }
     TkPathSaveState(context);
     TkPathPushTMatrix(context, mergedStyle.matrixPtr);
-    if (TkPathMakePath(context, atomPtr, &mergedStyle) != TCL_OK) {
+    if (TkPathMakePath(context, &atoms, &mergedStyle) != TCL_OK) {
         result = TCL_ERROR;
         goto bail;
     }
-    bbox = TkPathGetTotalBbox(atomPtr, &mergedStyle);
-    TkPathPaintPath(context, atomPtr, &mergedStyle, &bbox);
+    bbox = TkPathGetTotalBbox(&atoms, &mergedStyle);
+    TkPathPaintPath(context, &atoms, &mergedStyle, &bbox);
     
 bail:
     TkPathDeleteStyle(style);
-    TkPathFreeAtoms(atomPtr);
+    TkPathFreeAtoms(&atoms);
     TkPathRestoreState(context);
     Tk_FreeConfigOptions((char *)&item, gOptionTablePath, Tk_MainWindow(interp));
     return result;
@@ -713,7 +696,7 @@ SurfaceCreatePimage(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_O
         TkPathSaveState(context);
         TkPathPushTMatrix(context, style.matrixPtr);
         TkPathImage(context, image, photo, point[0], point[1], item.width, item.height, style.fillOpacity,
-                NULL, 0.0, 99, NULL);
+                NULL, 0.0, 99, NULL, NULL);
         Tk_FreeImage(image);
         TkPathRestoreState(context);
     }
@@ -737,11 +720,14 @@ SurfaceCreatePline(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Ob
     int			i;
     PathRect		bbox;
     SurfGenericItem	item;
-    PathAtom 		*atomPtr = NULL;
+    PathPacked 		atoms;
+    unsigned char	types[2];
+    double		coords[4];
     Tk_PathStyle	mergedStyle;
     double		points[4];
     int			result = TCL_OK;
     
+    PathPackedInitStatic(&atoms, types, 2, coords, 4);
     item.styleObj = NULL;
     i = GetFirstOptionIndex(objc, objv);
     TkPathInitStyle(&item.style);
@@ -756,20 +742,20 @@ SurfaceCreatePline(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Ob
         result = TCL_ERROR;
         goto bail;
     }
-    atomPtr = NewMoveToAtom(points[0], points[1]);
-    atomPtr->nextPtr = NewLineToAtom(points[2], points[3]);
+    AddMoveToAtom(&atoms, points[0], points[1]);
+    AddLineToAtom(&atoms, points[2], points[3]);
     TkPathSaveState(context);
     TkPathPushTMatrix(context, mergedStyle.matrixPtr);
-    if (TkPathMakePath(context, atomPtr, &mergedStyle) != TCL_OK) {
+    if (TkPathMakePath(context, &atoms, &mergedStyle) != TCL_OK) {
         result = TCL_ERROR;
         goto bail;
     }
-    bbox = TkPathGetTotalBbox(atomPtr, &mergedStyle);
-    TkPathPaintPath(context, atomPtr, &mergedStyle, &bbox);
+    bbox = TkPathGetTotalBbox(&atoms, &mergedStyle);
+    TkPathPaintPath(context, &atoms, &mergedStyle, &bbox);
     
 bail:
     TkPathDeleteStyle(&item.style);
-    TkPathFreeAtoms(atomPtr);
+    TkPathFreeAtoms(&atoms);
     TkPathRestoreState(context);
     Tk_FreeConfigOptions((char *)&item, gOptionTablePline, Tk_MainWindow(interp));
     return result;
@@ -799,14 +785,16 @@ SurfaceCreatePpoly(Tcl_Interp* interp, PathSurface *surfacePtr, int type, int ob
     SurfGenericItem	item;
     Tk_PathStyle	*style = &item.style;
     Tk_PathStyle	mergedStyle;
-    PathAtom 		*atomPtr = NULL;
+    PathPacked 		atoms;
     int			result = TCL_OK;
 
+    PathPackedInit(&atoms);
     item.styleObj = NULL;
     i = GetFirstOptionIndex(objc, objv);
     TkPathInitStyle(style);
     if (MakePolyAtoms(interp, (type == kPathSurfaceItemPolyline) ? 0 : 1, 
-            i-3, objv+3, &atomPtr) != TCL_OK) {
+            i-3, objv+3, &atoms) != TCL_OK) {
+        TkPathFreeAtoms(&atoms);
         return TCL_ERROR;
     }
     if (SurfaceParseOptions(interp, (char *)&item, 
@@ -829,16 +817,16 @@ SurfaceCreatePpoly(Tcl_Interp* interp, PathSurface *surfacePtr, int type, int ob
     }
     TkPathSaveState(context);
     TkPathPushTMatrix(context, mergedStyle.matrixPtr);
-    if (TkPathMakePath(context, atomPtr, &mergedStyle) != TCL_OK) {
+    if (TkPathMakePath(context, &atoms, &mergedStyle) != TCL_OK) {
         result = TCL_ERROR;
         goto bail;
     }
-    bbox = TkPathGetTotalBbox(atomPtr, &mergedStyle);
-    TkPathPaintPath(context, atomPtr, &mergedStyle, &bbox);
+    bbox = TkPathGetTotalBbox(&atoms, &mergedStyle);
+    TkPathPaintPath(context, &atoms, &mergedStyle, &bbox);
     
 bail:
     TkPathDeleteStyle(style);
-    TkPathFreeAtoms(atomPtr);
+    TkPathFreeAtoms(&atoms);
     TkPathRestoreState(context);
     Tk_FreeConfigOptions((char *)&item, 
 	    (type == kPathSurfaceItemPolyline) ? gOptionTablePolyline : gOptionTablePpolygon, 
@@ -871,10 +859,14 @@ SurfaceCreatePrect(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Ob
     Tk_PathStyle	*style = &prect.style;
     Tk_PathStyle	mergedStyle;
     PathRect		bbox;
-    PathAtom 		*atomPtr = NULL;
+    PathPacked 		atoms;
+    unsigned char	types[PATH_PRECT_NUM_ATOMS];
+    double		coords[PATH_PRECT_NUM_COORDS];
     double		points[4];
     int			result = TCL_OK;
 
+    PathPackedInitStatic(&atoms, types, PATH_PRECT_NUM_ATOMS, 
+            coords, PATH_PRECT_NUM_COORDS);
     prect.styleObj = NULL;
     i = GetFirstOptionIndex(objc, objv);
     TkPathInitStyle(style);
@@ -901,17 +893,17 @@ SurfaceCreatePrect(Tcl_Interp* interp, PathSurface *surfacePtr, int objc, Tcl_Ob
     prect.ry = MAX(0.0, prect.ry);
     TkPathSaveState(context);
     TkPathPushTMatrix(context, mergedStyle.matrixPtr);
-    TkPathMakePrectAtoms(points, prect.rx, prect.ry, &atomPtr);
-    if (TkPathMakePath(context, atomPtr, &mergedStyle) != TCL_OK) {
+    TkPathMakePrectAtoms(points, prect.rx, prect.ry, &atoms);
+    if (TkPathMakePath(context, &atoms, &mergedStyle) != TCL_OK) {
         result = TCL_ERROR;
         goto bail;
     }
-    bbox = TkPathGetTotalBbox(atomPtr, &mergedStyle);
-    TkPathPaintPath(context, atomPtr, &mergedStyle, &bbox);
+    bbox = TkPathGetTotalBbox(&atoms, &mergedStyle);
+    TkPathPaintPath(context, &atoms, &mergedStyle, &bbox);
     
 bail:
     TkPathDeleteStyle(&prect.style);
-    TkPathFreeAtoms(atomPtr);
+    TkPathFreeAtoms(&atoms);
     TkPathRestoreState(context);
     Tk_FreeConfigOptions((char *)&prect, gOptionTablePrect, Tk_MainWindow(interp));
     return result;
@@ -112,11 +112,36 @@ TkPathContext TkPathInit(Tk_Window tkwin, Drawable d)
     return (TkPathContext) _NewPathContext(tkwin, d);
 }
 
+TkPathContext TkPathInitWithSize(Tk_Window tkwin, Drawable d, int width, int height)
+{
+    return (TkPathContext) _NewPathContext(tkwin, d);
+}
+
 TkPathContext TkPathInitSurface(int width, int height)
 {
 
 }
 
+TkPathContext TkPathInitImageBuffer(Tk_Window tkwin, int width, int height)
+{
+    return (TkPathContext) NULL;
+}
+
+void TkPathImageBufferFill(TkPathContext ctx, XColor *colorPtr,
+        int x, int y, int width, int height)
+{
+}
+
+void TkPathImageBufferPut(TkPathContext ctx, Drawable d, GC gc,
+        int srcX, int srcY, int width, int height, int destX, int destY)
+{
+}
+
+void TkPathImageBufferGet(TkPathContext ctx, Drawable d,
+        int x, int y, int width, int height)
+{
+}
+
 void
 TkPathPushTMatrix(TkPathContext ctx, TMatrix *m)
 {
@@ -279,7 +304,8 @@ TkPathOval(TkPathContext ctx, double cx, double cy, double rx, double ry)
 void
 TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
         double x, double y, double width, double height, double fillOpacity,
-        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion)
+        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+        void **customPtr)
 {
     //FIXME use fillOpacity, tintColor, tintAmount parameters
     TkPathContext_ *context = (TkPathContext_ *) ctx;
@@ -293,6 +319,29 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
     Tk_RedrawImage(image, 0, 0, iwidth, iheight, context->drawable, (int)x, (int)y);
 }
 
+void
+TkPathImageFree(void *custom)
+{
+    /* The converted image is not cached by this backend. */
+}
+
+int
+TkPathAppendRetainedPath(TkPathContext ctx, Tk_PathStyle *stylePtr, void *custom)
+{
+    /* Paths are not retained by this backend. */
+    return 0;
+}
+
+void
+TkPathRetainPath(TkPathContext ctx, void **customPtr)
+{
+}
+
+void
+TkPathFreeRetainedPath(void *custom)
+{
+}
+
 void TkPathClosePath(TkPathContext ctx)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
@@ -14,6 +14,12 @@
 
 #define DOUBLE_EQUALS(x,y)      (fabs((x) - (y)) < DBL_EPSILON)
 
+static int	MakeRetainedPath(TkPathContext context, PathPacked *atomPtr,
+		    Tk_PathStyle *stylePtr, void **pathCachePtr);
+static void	PaintPath(TkPathContext context, PathPacked *atomPtr,
+		    Tk_PathStyle *stylePtr, PathRect *bboxPtr,
+		    void **pathCachePtr);
+
 /*
  *--------------------------------------------------------------
  *
@@ -22,19 +28,17 @@
  *	Makes the path atoms for a rounded rectangle, prect.
  *
  * Results:
- *	None. Path atoms in atomPtrPtr.
+ *	None. Path atoms appended to atomPtr.
  *
  * Side effects:
- *	Path atom memory allocated.
+ *	Path atom memory may be allocated.
  *
  *--------------------------------------------------------------
  */
 
 void
-TkPathMakePrectAtoms(double *pointsPtr, double rx, double ry, PathAtom **atomPtrPtr)
+TkPathMakePrectAtoms(double *pointsPtr, double rx, double ry, PathPacked *atomPtr)
 {
-    PathAtom *atomPtr = NULL;
-    PathAtom *firstAtomPtr = NULL;
     int round = 1;
     double epsilon = 1e-6;
     double x = MIN(pointsPtr[0], pointsPtr[2]);
@@ -56,29 +60,18 @@ TkPathMakePrectAtoms(double *pointsPtr, double rx, double ry, PathAtom **atomPtr
         rx = MIN(rx, width/2.0);
         ry = MIN(ry, height/2.0);
         
-        atomPtr = NewMoveToAtom(x+rx, y);
-        firstAtomPtr = atomPtr;
-        atomPtr->nextPtr = NewLineToAtom(x+width-rx, y);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewArcAtom(rx, ry, 0.0, 0, 1, x+width, y+ry);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewLineToAtom(x+width, y+height-ry);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewArcAtom(rx, ry, 0.0, 0, 1, x+width-rx, y+height);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewLineToAtom(x+rx, y+height);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewArcAtom(rx, ry, 0.0, 0, 1, x, y+height-ry);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewLineToAtom(x, y+ry);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewArcAtom(rx, ry, 0.0, 0, 1, x+rx, y);
-        atomPtr = atomPtr->nextPtr;
-        atomPtr->nextPtr = NewCloseAtom(x, y);
-        *atomPtrPtr = firstAtomPtr;
+        AddMoveToAtom(atomPtr, x+rx, y);
+        AddLineToAtom(atomPtr, x+width-rx, y);
+        AddArcAtom(atomPtr, rx, ry, 0.0, 0, 1, x+width, y+ry);
+        AddLineToAtom(atomPtr, x+width, y+height-ry);
+        AddArcAtom(atomPtr, rx, ry, 0.0, 0, 1, x+width-rx, y+height);
+        AddLineToAtom(atomPtr, x+rx, y+height);
+        AddArcAtom(atomPtr, rx, ry, 0.0, 0, 1, x, y+height-ry);
+        AddLineToAtom(atomPtr, x, y+ry);
+        AddArcAtom(atomPtr, rx, ry, 0.0, 0, 1, x+rx, y);
+        AddCloseAtom(atomPtr, x, y);
     } else {
-        atomPtr = NewRectAtom(pointsPtr);
-        *atomPtrPtr = atomPtr;        
+        AddRectAtom(atomPtr, pointsPtr);
     }
 }
 
@@ -105,8 +98,8 @@ TkPathDrawPath(
     Tk_Window tkwin,        /* Tk window. */
     Drawable drawable,      /* Pixmap or window in which to draw
                              * item. */
-    PathAtom *atomPtr,      /* The actual path as a linked list
-                             * of PathAtoms. */
+    PathPacked *atomPtr,    /* The actual path as packed
+                             * path atoms. */
     Tk_PathStyle *stylePtr, /* The paths style. */
     TMatrix *mPtr,          /* Typically used for canvas offsets. */
     PathRect *bboxPtr)      /* The bare (untransformed) bounding box 
@@ -114,24 +107,102 @@ TkPathDrawPath(
 {
     TkPathContext context;
     
+    context = TkPathInit(tkwin, drawable);
+    TkPathDrawPathInContext(context, atomPtr, stylePtr, mPtr, bboxPtr, NULL);
+    TkPathFree(context);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDrawPathInContext --
+ *
+ *	Same as TkPathDrawPath but draws into an already existing
+ *	context, typically the one shared by all items during a
+ *	canvas redisplay. If pathCachePtr is not NULL the path
+ *	is kept there by the backend and reused on the next call
+ *	instead of replaying the atoms. The owner must free it with
+ *	TkPathFreeRetainedPath when the atoms change.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The path is painted in the context. The graphics state of
+ *	the context is left as it was on entry.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathDrawPathInContext(
+    TkPathContext context,  /* Drawing context. */
+    PathPacked *atomPtr,    /* The actual path as packed
+                             * path atoms. */
+    Tk_PathStyle *stylePtr, /* The paths style. */
+    TMatrix *mPtr,          /* Typically used for canvas offsets. */
+    PathRect *bboxPtr,      /* The bare (untransformed) bounding box 
+                             * (assuming zero stroke width) */
+    void **pathCachePtr)    /* Where the backend may retain the path,
+                             * or NULL. */
+{
     /*
      * Define the path in the drawable using the path drawing functions.
      * Any transform matrix need to be considered and canvas drawable
      * offset must always be taken into account. Note the order!
      */
      
-    context = TkPathInit(tkwin, drawable);
+    TkPathSaveState(context);
     if (mPtr != NULL) {
         TkPathPushTMatrix(context, mPtr);
     }
     if (stylePtr->matrixPtr != NULL) {
         TkPathPushTMatrix(context, stylePtr->matrixPtr);
     }
+    if (MakeRetainedPath(context, atomPtr, stylePtr, pathCachePtr) == TCL_OK) {
+        PaintPath(context, atomPtr, stylePtr, bboxPtr, pathCachePtr);
+    }
+    TkPathRestoreState(context);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * MakeRetainedPath --
+ *
+ *	Defines the path in the context from the path retained in
+ *	pathCachePtr if the backend accepts it, else from the atoms
+ *	in which case the new path is retained.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Defines the current path in the context. May update the
+ *	retained path.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+MakeRetainedPath(
+    TkPathContext context, 
+    PathPacked *atomPtr, 
+    Tk_PathStyle *stylePtr, 
+    void **pathCachePtr)
+{
+    if (pathCachePtr == NULL) {
+        return TkPathMakePath(context, atomPtr, stylePtr);
+    }
+    if ((*pathCachePtr != NULL) 
+            && TkPathAppendRetainedPath(context, stylePtr, *pathCachePtr)) {
+        return TCL_OK;
+    }
     if (TkPathMakePath(context, atomPtr, stylePtr) != TCL_OK) {
-        return;
+        return TCL_ERROR;
     }
-    TkPathPaintPath(context, atomPtr, stylePtr,	bboxPtr);
-    TkPathFree(context);
+    TkPathRetainPath(context, pathCachePtr);
+    return TCL_OK;
 }
 
 /*
@@ -153,10 +224,21 @@ TkPathDrawPath(
 void
 TkPathPaintPath(
     TkPathContext context, 
-    PathAtom *atomPtr,      /* The actual path as a linked list
-                             * of PathAtoms. */
+    PathPacked *atomPtr,    /* The actual path as packed
+                             * path atoms. */
     Tk_PathStyle *stylePtr, /* The paths style. */
     PathRect *bboxPtr)
+{
+    PaintPath(context, atomPtr, stylePtr, bboxPtr, NULL);
+}
+
+static void
+PaintPath(
+    TkPathContext context, 
+    PathPacked *atomPtr,
+    Tk_PathStyle *stylePtr,
+    PathRect *bboxPtr,
+    void **pathCachePtr)
 {
     TkPathGradientMaster *gradientPtr = GetGradientMasterFromPathColor(stylePtr->fill);
     
@@ -169,7 +251,7 @@ TkPathPaintPath(
          *     to redo the path. 
          */
         if (TkPathDrawingDestroysPath()) {
-            TkPathMakePath(context, atomPtr, stylePtr);
+            MakeRetainedPath(context, atomPtr, stylePtr, pathCachePtr);
         }
         
         /* We shall remove the path clipping here! */
@@ -186,7 +268,7 @@ TkPathPaintPath(
 }
 
 PathRect
-TkPathGetTotalBbox(PathAtom *atomPtr, Tk_PathStyle *stylePtr)
+TkPathGetTotalBbox(PathPacked *atomPtr, Tk_PathStyle *stylePtr)
 {
     PathRect bare, total;
     
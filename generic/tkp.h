@@ -119,6 +119,24 @@ typedef struct Tk_PathItem {
                              * Untransformed coordinates. */
     char *reserved1;		/* reserved for future use */
     int redraw_flags;		/* Some flags used in the canvas */
+    int indexX1, indexY1, indexX2, indexY2;
+				/* Bounding box under which the item is filed
+				 * in the canvas spatial index. */
+    int indexFlags;		/* Used by the canvas spatial index. */
+    int indexSlot;		/* Position in the canvas list of items that
+				 * must be refiled in the index, or -1. */
+    unsigned int indexStamp;	/* Last index search that saw this item. */
+    int zOrder;			/* Increases along the display list; used to
+				 * sort index search results. */
+    void *pathCache;		/* Path retained by the drawing backend
+				 * between redraws, or NULL. Dropped by the
+				 * canvas whenever the item changes. */
+    void *flatCache;		/* Flattened path used for hit testing, or
+				 * NULL. A single ckalloc'ed block which is
+				 * dropped along with pathCache. */
+    void *edgeCache;		/* Edge trees of large subpaths for hit
+				 * testing, or NULL. Dropped along with
+				 * flatCache. */
 
     /*
      *------------------------------------------------------------------
@@ -162,6 +180,15 @@ typedef void	Tk_PathItemDeleteProc(Tk_PathCanvas canvas,
 typedef void	Tk_PathItemDisplayProc(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display, Drawable dst,
 		    int x, int y, int width, int height);
+/*
+ * Opaque platform dependent drawing context.
+ */
+
+typedef XID TkPathContext;
+
+typedef void	Tk_PathItemDisplayContextProc(Tk_PathCanvas canvas,
+		    Tk_PathItem *itemPtr, TkPathContext ctx,
+		    int x, int y, int width, int height);
 typedef void	TkPathItemBboxProc(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 		    int mask);
 typedef double	Tk_PathItemPointProc(Tk_PathCanvas canvas,
@@ -247,7 +274,11 @@ typedef struct Tk_PathItemType {
 				/* Procedure to delete characters from an
 				 * item. */
     struct Tk_PathItemType *nextPtr;/* Used to link types together into a list. */
-    char *reserved1;		/* Reserved for future extension. */
+    Tk_PathItemDisplayContextProc *displayContextProc;
+				/* Procedure to display items of this type
+				 * into a drawing context that is shared by
+				 * all items in one redisplay. NULL for items
+				 * that draw using X11 GCs. */
     int reserved2;		/* Carefully compatible with */
     char *reserved3;		/* Jan Nijtmans dash patch */
     char *reserved4;
@@ -376,93 +376,155 @@ TkPathCanvasGetDepth(Tk_PathItem *itemPtr)
 /*
  *----------------------------------------------------------------------
  *
- * TkPathCanvasInheritStyle --
+ * InheritedStyle --
  *
- *	This function returns the style which is inherited from the
- *      parents of the itemPtr using cascading from the root item.
- *	Must use TkPathCanvasFreeInheritedStyle when done.
+ *	Returns the style of itemExPtr cascaded from the root item.
+ *	The result is cached in the item and reused until the item,
+ *	or any group on the canvas, is reconfigured or restyled.
  *
  * Results:
- *	Tk_PathStyle.
+ *	Pointer to the cached style. Its matrixPtr, if not NULL,
+ *	points to the items inheritedMatrix.
  *
  * Side effects:
- *	May allocate memory for matrix.
+ *	May update the cache of itemExPtr and its parents.
  *
  *----------------------------------------------------------------------
  */
 
-Tk_PathStyle
-TkPathCanvasInheritStyle(Tk_PathItem *itemPtr, long flags)
+static Tk_PathStyle *
+InheritedStyle(Tk_PathItemEx *itemExPtr)
 {
-    int depth, i, anyMatrix = 0;
-    Tk_PathItem *walkPtr;
-    Tk_PathItemEx *itemExPtr;
-    Tk_PathItemEx **parents;
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) itemExPtr->canvas;
+    Tk_PathItemEx *parentExPtr;
     Tk_PathStyle style;
     TMatrix matrix = kPathUnitTMatrix;
-    
-    depth = TkPathCanvasGetDepth(itemPtr);
-    parents = (Tk_PathItemEx **) ckalloc(depth*sizeof(Tk_PathItemEx *));
+    int anyMatrix = 0;
 
-    walkPtr = itemPtr, i = 0;
-    while (walkPtr->parentPtr != NULL) {
-	parents[i] = (Tk_PathItemEx *) walkPtr->parentPtr;
-	walkPtr = walkPtr->parentPtr, i++;
+    if (itemExPtr->inheritedEpoch == canvasPtr->styleEpoch) {
+	return &itemExPtr->inheritedStyle;
     }
-    
-    /*
-     * Cascade the style from the root item to the closest parent.
-     * Start by just making a copy of the root's style.
-     */
-    itemExPtr = parents[depth-1];
-    style = itemExPtr->style;
-    
-    for (i = depth-1; i >= 0; i--) {
-	itemExPtr = parents[i];
-	
-	/* The order of these two merges decides which take precedence. */
-	if (i < depth-1) {
-	    TkPathStyleMergeStyles(&itemExPtr->style, &style, flags);
-	}
-	if (itemExPtr->styleInst != NULL) {
-	    TkPathStyleMergeStyles(itemExPtr->styleInst->masterPtr, &style, flags);
-	}
+    parentExPtr = (Tk_PathItemEx *) itemExPtr->header.parentPtr;
+    if (parentExPtr != NULL) {
+	style = *InheritedStyle(parentExPtr);
 	if (style.matrixPtr != NULL) {
 	    anyMatrix = 1;
-	    MMulTMatrix(style.matrixPtr, &matrix);
+	    matrix = *style.matrixPtr;
 	}
-	/*
-	 * We set matrix to NULL to detect if set in group.
-	 */
-	style.matrixPtr = NULL;
+    } else {
+	style = itemExPtr->style;
     }
-    
+
     /*
-     * Merge the parents style with the actual items style.
+     * We set matrix to NULL to detect if set in this item.
      * The order of these two merges decides which take precedence.
      */
-    itemExPtr = (Tk_PathItemEx *) itemPtr;
-    TkPathStyleMergeStyles(&itemExPtr->style, &style, flags);
+    style.matrixPtr = NULL;
+    TkPathStyleMergeStyles(&itemExPtr->style, &style, 0);
     if (itemExPtr->styleInst != NULL) {
-	TkPathStyleMergeStyles(itemExPtr->styleInst->masterPtr, &style, flags);
-    }    
+	TkPathStyleMergeStyles(itemExPtr->styleInst->masterPtr, &style, 0);
+    }
     if (style.matrixPtr != NULL) {
 	anyMatrix = 1;
 	MMulTMatrix(style.matrixPtr, &matrix);
     }
-    if (anyMatrix) {
-        style.matrixPtr = (TMatrix *) ckalloc(sizeof(TMatrix));
-	memcpy(style.matrixPtr, &matrix, sizeof(TMatrix));
+    itemExPtr->inheritedMatrix = matrix;
+    style.matrixPtr = anyMatrix ? &itemExPtr->inheritedMatrix : NULL;
+    itemExPtr->inheritedStyle = style;
+    itemExPtr->inheritedEpoch = canvasPtr->styleEpoch;
+    return &itemExPtr->inheritedStyle;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasInheritStyle --
+ *
+ *	This function returns the style which is inherited from the
+ *      parents of the itemPtr using cascading from the root item.
+ *	Should call TkPathCanvasFreeInheritedStyle when done.
+ *
+ * Results:
+ *	Tk_PathStyle. Its matrixPtr is owned by the item and is only
+ *	valid until the item or its parents change.
+ *
+ * Side effects:
+ *	The result is cached in the item, see InheritedStyle.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tk_PathStyle
+TkPathCanvasInheritStyle(Tk_PathItem *itemPtr, long flags)
+{
+    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *) itemPtr;
+    Tk_PathStyle style, *rootStylePtr;
+
+    style = *InheritedStyle(itemExPtr);
+    if (flags == 0) {
+	return style;
+    }
+    
+    /*
+     * Options excluded from the cascade keep the value of the root item.
+     */
+    rootStylePtr = &((Tk_PathItemEx *) 
+	    ((TkPathCanvas *) itemExPtr->canvas)->rootItemPtr)->style;
+    if (flags & kPathMergeStyleNotFill) {
+	style.fill = rootStylePtr->fill;
+	style.fillOpacity = rootStylePtr->fillOpacity;
+	style.fillRule = rootStylePtr->fillRule;
+    }
+    if (flags & kPathMergeStyleNotStroke) {
+	style.strokeColor = rootStylePtr->strokeColor;
+	style.dashPtr = rootStylePtr->dashPtr;
+	style.capStyle = rootStylePtr->capStyle;
+	style.joinStyle = rootStylePtr->joinStyle;
+	style.miterLimit = rootStylePtr->miterLimit;
+	style.strokeOpacity = rootStylePtr->strokeOpacity;
+	style.strokeWidth = rootStylePtr->strokeWidth;
     }
-    ckfree((char *) parents);
     return style;
 }
 
 void
 TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr)
 {
-    if (stylePtr->matrixPtr != NULL) {
-	ckfree((char *) stylePtr->matrixPtr);
+    /* Nothing to free since the style is cached in its item. */
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasInheritedStyleChanged --
+ *
+ *	Invalidates the cached inherited style of an item. If the item
+ *	is a group all cached styles on the canvas are invalidated
+ *	since they may derive from it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Styles are recomputed on next use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasInheritedStyleChanged(Tk_PathItem *itemPtr)
+{
+    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *) itemPtr;
+    TkPathCanvas *canvasPtr;
+
+    if (itemPtr->typePtr == &tkGroupType) {
+	canvasPtr = (TkPathCanvas *) itemExPtr->canvas;
+	canvasPtr->styleEpoch++;
+	if (canvasPtr->styleEpoch == 0) {
+	    canvasPtr->styleEpoch = 1;
+	}
+    } else {
+	itemExPtr->inheritedEpoch = 0;
     }
 }
 
@@ -480,7 +542,7 @@ TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr)
  *	TMatrix.
  *
  * Side effects:
- *	None.
+ *	May update the cached styles of the parents.
  *
  *----------------------------------------------------------------------
  */
@@ -488,38 +550,15 @@ TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr)
 TMatrix
 TkPathCanvasInheritTMatrix(Tk_PathItem *itemPtr)
 {
-    int depth, i;
-    Tk_PathItem *walkPtr;
-    Tk_PathItemEx *itemExPtr;
-    Tk_PathItemEx **parents;
     Tk_PathStyle *stylePtr;
-    TMatrix matrix = kPathUnitTMatrix, *matrixPtr = NULL;
-
-    depth = TkPathCanvasGetDepth(itemPtr);
-    parents = (Tk_PathItemEx **) ckalloc(depth*sizeof(Tk_PathItemEx *));
+    TMatrix matrix = kPathUnitTMatrix;
 
-    walkPtr = itemPtr, i = 0;
-    while (walkPtr->parentPtr != NULL) {
-	parents[i] = (Tk_PathItemEx *) walkPtr->parentPtr;
-	walkPtr = walkPtr->parentPtr, i++;
-    }
-
-    for (i = depth-1; i >= 0; i--) {
-	itemExPtr = parents[i];
-	
-	/* The order of these two merges decides which take precedence. */
-	matrixPtr = itemExPtr->style.matrixPtr;
-	if (itemExPtr->styleInst != NULL) {
-	    stylePtr = itemExPtr->styleInst->masterPtr;
-	    if (stylePtr->mask & PATH_STYLE_OPTION_MATRIX) {
-		matrixPtr = stylePtr->matrixPtr;
-	    }
+    if (itemPtr->parentPtr != NULL) {
+	stylePtr = InheritedStyle((Tk_PathItemEx *) itemPtr->parentPtr);
+	if (stylePtr->matrixPtr != NULL) {
+	    matrix = *stylePtr->matrixPtr;
 	}
-	if (matrixPtr != NULL) {
-	    MMulTMatrix(matrixPtr, &matrix);
-	}	
     }
-    ckfree((char *) parents);
     return matrix;
 }
 
@@ -544,6 +583,17 @@ TkPathCanvasState(Tk_PathCanvas canvas)
     return ((TkPathCanvas *)canvas)->canvas_state;
 }
 
+/*
+ * Curves are flattened to within this many pixels when hit testing.
+ * Silly small values would only burn cpu.
+ */
+
+double
+TkPathCanvasTolerance(Tk_PathCanvas canvas)
+{
+    return MAX(0.01, ((TkPathCanvas *)canvas)->tolerance);
+}
+
 Tk_PathItem *
 TkPathCanvasCurrentItem(Tk_PathCanvas canvas)
 {
@@ -26,6 +26,7 @@
 #include "tkInt.h"
 #include "tkIntPath.h"
 #include "tkpCanvas.h"
+#include "tkCanvPathUtil.h"
 #ifdef TK_PATH_NO_DOUBLE_BUFFERING
 #ifdef MAC_OSX_TK
 #include "tkMacOSXInt.h"
@@ -109,8 +110,61 @@ typedef struct TagSearch {
 
 #endif /* USE_OLD_TAG_SEARCH */
 
+/*
+ * The structure defined below is used to keep track of a search of the
+ * spatial index in progress. Only IndexSearchFirst, IndexSearchNext and
+ * IndexSearchDone access its fields. If the area covers most of the items
+ * the search just walks the whole display list instead.
+ */
+
+#define INDEX_STATIC_ITEMS	64
+
+typedef struct IndexSearch {
+    int all;			/* Non-zero means walk the display list. */
+    int next;			/* Index of next item to return. */
+    int numItems;		/* Number of items found, in display order. */
+    int space;			/* Available space in items. */
+    Tk_PathItem **items;	/* Points to staticItems or malloc'ed space. */
+    Tk_PathItem *staticItems[INDEX_STATIC_ITEMS];
+} IndexSearch;
+
+/*
+ * Parameters of the spatial index: cells are (1 << INDEX_CELL_SHIFT) canvas
+ * units square, and items covering more than INDEX_MAX_CELLS cells are kept
+ * in the list of big items instead.
+ */
+
+#define INDEX_CELL_SHIFT	7
+#define INDEX_MAX_CELLS		64
+#define INDEX_COORD_MAX		(1 << 30)
+
+/*
+ * Values for the indexFlags field of items:
+ *
+ * INDEX_IN_CELLS -		The item is filed in the cells covering
+ *				indexX1, indexY1, indexX2, indexY2.
+ * INDEX_IN_BIG -		The item is in the list of big items.
+ */
+
+#define INDEX_IN_CELLS		(1 << 0)
+#define INDEX_IN_BIG		(1 << 1)
+
+typedef struct IndexCell {
+    int numItems;		/* Number of items in this cell. */
+    int space;			/* Available space in items. */
+    Tk_PathItem **items;	/* Malloc'ed array of items. */
+} IndexCell;
+
 #define PATH_DEF_STATE "normal"
 
+/*
+ * Redisplayed areas smaller than this many pixels are rasterized by the
+ * calling thread alone even if -threads is set; starting threads would
+ * cost more than it saves.
+ */
+
+#define THREADS_MIN_AREA	(256*256)
+
 /* These MUST be kept in sync with enums! X.h */
 
 static char *stateStrings[] = {
@@ -121,6 +175,12 @@ static char *tagStyleStrings[] = {
     "exact", "expr", "glob", NULL
 };
 
+/* These MUST be kept in sync with the CANVAS_RENDERER_* enums! */
+
+static char *rendererStrings[] = {
+    "native", "image", NULL
+};
+
 static Tk_ObjCustomOption offsetCO = {
     "offset",			
     TkPathOffsetOptionSetProc,
@@ -134,6 +194,9 @@ static Tk_OptionSpec optionSpecs[] = {
     {TK_OPTION_BORDER, "-background", "background", "Background",
 	DEF_CANVAS_BG_COLOR, -1, Tk_Offset(TkPathCanvas, bgBorder),
 	0, (ClientData) DEF_CANVAS_BG_MONO, 0},
+    {TK_OPTION_BOOLEAN, "-backbuffer", "backBuffer", "BackBuffer",
+	"0", -1, Tk_Offset(TkPathCanvas, backBuffer),
+	0, 0, 0},
     {TK_OPTION_SYNONYM, "-bd", NULL, NULL,
 	NULL, 0, -1, 0, (ClientData) "-borderwidth", 0},
     {TK_OPTION_SYNONYM, "-bg", NULL, NULL,
@@ -180,9 +243,21 @@ static Tk_OptionSpec optionSpecs[] = {
     {TK_OPTION_PIXELS, "-insertwidth", "insertWidth", "InsertWidth",
 	DEF_CANVAS_INSERT_WIDTH, -1, Tk_Offset(TkPathCanvas, textInfo.insertWidth),
 	0, 0, 0},
+    {TK_OPTION_COLOR, "-lodcolor", "lodColor", "LodColor",
+	"", -1, Tk_Offset(TkPathCanvas, lodColorPtr),
+	TK_OPTION_NULL_OK, 0, 0},
+    {TK_OPTION_DOUBLE, "-lodthreshold", "lodThreshold", "LodThreshold",
+	"0", -1, Tk_Offset(TkPathCanvas, lodThreshold),
+	0, 0, 0},
     {TK_OPTION_CUSTOM, "-offset", "offset", "Offset",
 	"0,0", -1, Tk_Offset(TkPathCanvas, tsoffsetPtr),
 	0, &offsetCO, 0},
+    {TK_OPTION_INT, "-redrawdelay", "redrawDelay", "RedrawDelay",
+	"0", -1, Tk_Offset(TkPathCanvas, redrawDelay),
+	0, 0, 0},
+    {TK_OPTION_STRING_TABLE, "-renderer", "renderer", "Renderer",
+	"native", -1, Tk_Offset(TkPathCanvas, renderer),
+	0, (ClientData) rendererStrings, 0},
     {TK_OPTION_RELIEF, "-relief", "relief", "Relief",
 	DEF_CANVAS_RELIEF, -1, Tk_Offset(TkPathCanvas, relief), 
 	0, 0, 0},
@@ -208,6 +283,12 @@ static Tk_OptionSpec optionSpecs[] = {
     {TK_OPTION_STRING, "-takefocus", "takeFocus", "TakeFocus",
 	DEF_CANVAS_TAKE_FOCUS, -1, Tk_Offset(TkPathCanvas, takeFocus),
 	TK_OPTION_NULL_OK, 0, 0},
+    {TK_OPTION_INT, "-threads", "threads", "Threads",
+	"0", -1, Tk_Offset(TkPathCanvas, threads),
+	0, 0, 0},
+    {TK_OPTION_DOUBLE, "-tolerance", "tolerance", "Tolerance",
+	"0.25", -1, Tk_Offset(TkPathCanvas, tolerance),
+	0, 0, 0},
     {TK_OPTION_PIXELS, "-width", "width", "Width",
 	DEF_CANVAS_WIDTH, -1, Tk_Offset(TkPathCanvas, width), 
 	0, 0, 0},
@@ -279,6 +360,19 @@ static int		CanvasFetchSelection(ClientData clientData, int offset,
 			    char *buffer, int maxBytes);
 static Tk_PathItem *	CanvasFindClosest(TkPathCanvas *canvasPtr,
 			    double coords[2]);
+static void		CanvasAddDamage(TkPathCanvas *canvasPtr,
+			    int x1, int y1, int x2, int y2);
+static void		CanvasAddExpose(TkPathCanvas *canvasPtr,
+			    int x1, int y1, int x2, int y2);
+static void		CanvasAddRedrawBbox(TkPathCanvas *canvasPtr,
+			    int x1, int y1, int x2, int y2);
+static void		CanvasScheduleRedraw(TkPathCanvas *canvasPtr);
+static void		CanvasCancelRedraw(TkPathCanvas *canvasPtr);
+static void		CanvasRedrawTimerProc(ClientData clientData);
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+static int		CanvasScrollContents(TkPathCanvas *canvasPtr,
+			    int xOrigin, int yOrigin);
+#endif
 static void		CanvasFocusProc(TkPathCanvas *canvasPtr, int gotFocus);
 static void		CanvasLostSelection(ClientData clientData);
 static void		CanvasSelectTo(TkPathCanvas *canvasPtr,
@@ -296,10 +390,30 @@ static int		ConfigureCanvas(Tcl_Interp *interp,
 			    Tcl_Obj *CONST *argv, int flags);
 static void		DestroyCanvas(char *memPtr);
 static void		DisplayCanvas(ClientData clientData);
+static void		DisplayCanvasArea(TkPathCanvas *canvasPtr,
+			    int screenX1, int screenY1,
+			    int screenX2, int screenY2);
+static int		DisplayCanvasImage(TkPathCanvas *canvasPtr,
+			    int screenX1, int screenY1,
+			    int screenX2, int screenY2);
+static void		CanvasFreeBackBuffer(TkPathCanvas *canvasPtr);
+static int		ItemNeedsRedisplay(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr, int screenX1, int screenY1,
+			    int screenX2, int screenY2);
+static int		ItemBelowLod(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr);
+static int		AddLodRect(TkPathCanvas *canvasPtr,
+			    TkPathContext ctx, Tk_PathItem *itemPtr,
+			    int numRects);
+static int		FillLodRects(TkPathCanvas *canvasPtr,
+			    TkPathContext ctx, int numRects);
 static void		DoItem(Tcl_Interp *interp,
 			    Tk_PathItem *itemPtr, Tk_Uid tag);
 static void		EventuallyRedrawItem(Tk_PathCanvas canvas,
 			    Tk_PathItem *itemPtr);
+static void		ItemFreePathCache(Tk_PathItem *itemPtr);
+static void		ItemGeometryChanged(Tk_PathCanvas canvas,
+			    Tk_PathItem *itemPtr);
 
 static Tcl_Obj *	UnshareObj(Tcl_Obj *objPtr);
 static Tk_PathItem *	ItemIteratorSubNext(Tk_PathItem *itemPtr, Tk_PathItem *groupPtr);
@@ -309,6 +423,19 @@ static int		ItemCreate(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
 				Tk_PathItemType *typePtr, int isRoot, Tk_PathItem **itemPtrPtr, 
 				int objc, Tcl_Obj *CONST objv[]);
 static int		ItemGetNumTags(Tk_PathItem *itemPtr);
+static void		IndexFree(TkPathCanvasIndex *indexPtr);
+static void		IndexInit(TkPathCanvasIndex *indexPtr);
+static void		IndexItemLinked(Tk_PathItem *itemPtr);
+static void		IndexMarkItem(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr);
+static void		IndexRemoveItem(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr);
+static Tk_PathItem *	IndexSearchFirst(TkPathCanvas *canvasPtr,
+			    IndexSearch *searchPtr, int x1, int y1,
+			    int x2, int y2);
+static Tk_PathItem *	IndexSearchNext(IndexSearch *searchPtr,
+			    Tk_PathItem *itemPtr);
+static void		IndexSearchDone(IndexSearch *searchPtr);
 static void		SetAncestorsDirtyBbox(Tk_PathItem *itemPtr);
 			    
 static void		DebugGetItemInfo(Tk_PathItem *itemPtr, char *s);
@@ -323,8 +450,13 @@ static int		FindItems(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
 			    Tcl_Obj *newTagObj, int first,
 			    TagSearch **searchPtrPtr);
 #endif /* USE_OLD_TAG_SEARCH */
+static int		FindClosestInIndex(TkPathCanvas *canvasPtr,
+			    double coords[2], double halo,
+			    Tk_PathItem **closestPtrPtr);
 static int		FindArea(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
 			    Tcl_Obj *CONST *argv, Tk_Uid uid, int enclosed);
+static int		PickItems(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
+			    int objc, Tcl_Obj *CONST objv[]);
 static double		GridAlign(double coord, double spacing);
 static CONST char**	TkGetStringsFromObjs(int argc, Tcl_Obj *CONST *objv);
 static void		InitCanvas(void);
@@ -473,7 +605,26 @@ Tk_PathCanvasObjCmd(
     canvasPtr->pixmapGC = None;
     canvasPtr->width = None;
     canvasPtr->height = None;
+    canvasPtr->numDamageRects = 0;
+    IndexInit(&canvasPtr->index);
     canvasPtr->confine = 0;
+    canvasPtr->renderer = CANVAS_RENDERER_NATIVE;
+    canvasPtr->imageBuffer = (TkPathContext) NULL;
+    canvasPtr->imageBufferWidth = 0;
+    canvasPtr->imageBufferHeight = 0;
+    canvasPtr->threads = 0;
+    canvasPtr->backBuffer = 0;
+    canvasPtr->backPixmap = None;
+    canvasPtr->scratchPixmap = None;
+    canvasPtr->scratchWidth = 0;
+    canvasPtr->scratchHeight = 0;
+    canvasPtr->exposeX1 = canvasPtr->exposeX2 = 0;
+    canvasPtr->exposeY1 = canvasPtr->exposeY2 = 0;
+    canvasPtr->redrawDelay = 0;
+    canvasPtr->redrawTimer = (Tcl_TimerToken) NULL;
+    canvasPtr->lastRedraw.sec = canvasPtr->lastRedraw.usec = 0;
+    canvasPtr->lodThreshold = 0.0;
+    canvasPtr->lodColorPtr = NULL;
     canvasPtr->textInfo.selBorder = NULL;
     canvasPtr->textInfo.selBorderWidth = 0;
     canvasPtr->textInfo.selFgColorPtr = NULL;
@@ -497,6 +648,7 @@ Tk_PathCanvasObjCmd(
     canvasPtr->currentItemPtr = NULL;
     canvasPtr->newCurrentPtr = NULL;
     canvasPtr->closeEnough = 0.0;
+    canvasPtr->tolerance = 0.25;
     canvasPtr->pickEvent.type = LeaveNotify;
     canvasPtr->pickEvent.xcrossing.x = 0;
     canvasPtr->pickEvent.xcrossing.y = 0;
@@ -527,6 +679,7 @@ Tk_PathCanvasObjCmd(
     canvasPtr->tsoffsetPtr = NULL;
     canvasPtr->styleUid = 0;
     canvasPtr->gradientUid = 0;
+    canvasPtr->styleEpoch = 1;
 #ifndef USE_OLD_TAG_SEARCH
     canvasPtr->bindTagExprs = NULL;
 #endif
@@ -621,7 +774,8 @@ CanvasWidgetCmd(
 	"gradient",	"icursor",
 	"index",	"insert",	"itemcget",	"itemconfigure",    "lastchild",
 	"lower",	"move",		"nextsibling",
-	"parent",	"prevsibling",	"postscript",	"raise",
+	"parent",	"pick",		"prevsibling",	"postscript",	"raise",
+	"redraw",
 	"scale",	"scan",		"select",	"style",	    
 	"type",		"types",
 	"xview",	"yview",
@@ -639,7 +793,8 @@ CanvasWidgetCmd(
 	CANV_GRADIENT,	CANV_ICURSOR,
 	CANV_INDEX,	CANV_INSERT,	    CANV_ITEMCGET,	CANV_ITEMCONFIGURE, CANV_LASTCHILD,
 	CANV_LOWER,	CANV_MOVE,	    CANV_NEXTSIBLING,
-	CANV_PARENT,	CANV_PREVSIBLING,   CANV_POSTSCRIPT,    CANV_RAISE,
+	CANV_PARENT,	CANV_PICK,	CANV_PREVSIBLING,   CANV_POSTSCRIPT,    CANV_RAISE,
+	CANV_REDRAW,
 	CANV_SCALE,	CANV_SCAN,	    CANV_SELECT,	CANV_STYLE,	    
 	CANV_TYPE,	CANV_TYPES,
 	CANV_XVIEW,	CANV_YVIEW,
@@ -1054,16 +1209,39 @@ CanvasWidgetCmd(
 	}
 	FIRST_CANVAS_ITEM_MATCHING(objv[2], &searchPtr, goto done);
 	if (itemPtr != NULL) {
-	    if (objc != 3) {
-		EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
-	    }
+	    int x1, y1, x2, y2, get;
+
+	    /*
+	     * Coords asked for packed are a get as well.
+	     */
+
+	    get = (objc == 3)
+		    || ((objc == 4) && GetPackedCoordsFormat(objv[3]));
+
+	    /*
+	     * Redraw both item's old and new areas. Except if the coordProc
+	     * sets the TK_ITEM_DONT_REDRAW flag, when it has already asked
+	     * for the parts that changed to be redrawn, as when points are
+	     * appended to a line.
+	     */
+
+	    x1 = itemPtr->x1; y1 = itemPtr->y1;
+	    x2 = itemPtr->x2; y2 = itemPtr->y2;
+	    itemPtr->redraw_flags &= ~TK_ITEM_DONT_REDRAW;
 	    if (itemPtr->typePtr->coordProc != NULL) {
 		result = (*itemPtr->typePtr->coordProc)(interp,
 			(Tk_PathCanvas) canvasPtr, itemPtr, objc-3, objv+3);
 	    }
-	    if (objc != 3) {
-		EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
+	    if (!get) {
+		if (itemPtr->redraw_flags & TK_ITEM_DONT_REDRAW) {
+		    ItemGeometryChanged((Tk_PathCanvas) canvasPtr, itemPtr);
+		} else {
+		    Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
+			    x1, y1, x2, y2);
+		    EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
+		}
 	    }
+	    itemPtr->redraw_flags &= ~TK_ITEM_DONT_REDRAW;
 	}
 	break;
     }
@@ -1676,6 +1854,10 @@ CanvasWidgetCmd(
 	}
 	break;
     }
+    case CANV_PICK: {
+	result = PickItems(interp, canvasPtr, objc, objv);
+	break;
+    }
     case CANV_POSTSCRIPT: {
 	result = TkCanvPostscriptCmd(canvasPtr, interp, objc, objv);
 	break;
@@ -1736,6 +1918,26 @@ CanvasWidgetCmd(
 #endif /* USE_OLD_TAG_SEARCH */
 	break;
     }
+    case CANV_REDRAW: {
+	if (objc != 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "");
+	    result = TCL_ERROR;
+	    goto done;
+	}
+
+	/*
+	 * Draw whatever is pending now instead of waiting for the idle or
+	 * -redrawdelay handler. Not from within a redisplay, for instance
+	 * from an <Enter> binding while the current item is picked.
+	 */
+
+	if ((canvasPtr->flags & REDRAW_PENDING)
+		&& !(canvasPtr->flags & REDRAW_IN_PROGRESS)) {
+	    CanvasCancelRedraw(canvasPtr);
+	    DisplayCanvas((ClientData) canvasPtr);
+	}
+	break;
+    }
     case CANV_SCALE: {
 	double xOrigin, yOrigin, xScale, yScale;
 
@@ -2097,9 +2299,11 @@ DestroyCanvas(
         prevItemPtr = TkPathCanvasItemIteratorPrev(itemPtr);
 	(*itemPtr->typePtr->deleteProc)((Tk_PathCanvas) canvasPtr, itemPtr,
 		canvasPtr->display);
+	ItemFreePathCache(itemPtr);
 	ckfree((char *) itemPtr);
         itemPtr = prevItemPtr;
     }
+    IndexFree(&canvasPtr->index);
 
     /*
      * Free up all the stuff that requires special handling, then let
@@ -2118,6 +2322,10 @@ DestroyCanvas(
     if (canvasPtr->pixmapGC != None) {
 	Tk_FreeGC(canvasPtr->display, canvasPtr->pixmapGC);
     }
+    if (canvasPtr->imageBuffer != (TkPathContext) NULL) {
+	TkPathFree(canvasPtr->imageBuffer);
+    }
+    CanvasFreeBackBuffer(canvasPtr);
 #ifndef USE_OLD_TAG_SEARCH
     expr = canvasPtr->bindTagExprs;
     while (expr) {
@@ -2127,6 +2335,7 @@ DestroyCanvas(
     }
 #endif /* USE_OLD_TAG_SEARCH */
     Tcl_DeleteTimerHandler(canvasPtr->insertBlinkHandler);
+    Tcl_DeleteTimerHandler(canvasPtr->redrawTimer);
     if (canvasPtr->bindingTable != NULL) {
 	Tk_DeleteBindingTable(canvasPtr->bindingTable);
     }    
@@ -2170,6 +2379,7 @@ ConfigureCanvas(
     Tk_SavedOptions savedOptions;
     Tcl_Obj *errorResult = NULL;
     int error;
+    int redrawDelay = canvasPtr->redrawDelay;
 
     /*
      * The following loop is potentially executed twice. During the first pass
@@ -2243,7 +2453,23 @@ ConfigureCanvas(
 		continue;
 	    }
 	}
-   
+	if (canvasPtr->threads < 0) {
+	    char buf[TCL_INTEGER_SPACE];
+
+	    sprintf(buf, "%d", canvasPtr->threads);
+	    Tcl_AppendResult(interp, "bad threads \"", buf,
+		    "\": must be a non-negative integer", NULL);
+	    continue;
+	}
+	if (canvasPtr->redrawDelay < 0) {
+	    char buf[TCL_INTEGER_SPACE];
+
+	    sprintf(buf, "%d", canvasPtr->redrawDelay);
+	    Tcl_AppendResult(interp, "bad redrawdelay \"", buf,
+		    "\": must be a non-negative integer", NULL);
+	    continue;
+	}
+
         /*
 	 * A few options need special processing, such as setting the background
 	 * from a 3-D border and creating a GC for copying bits to the screen.
@@ -2266,6 +2492,20 @@ ConfigureCanvas(
 	}
 	canvasPtr->pixmapGC = newGC;
 
+	/*
+	 * The image buffer is only kept around while it is used.
+	 */
+
+	if ((canvasPtr->renderer != CANVAS_RENDERER_IMAGE)
+		&& (canvasPtr->imageBuffer != (TkPathContext) NULL)) {
+	    TkPathFree(canvasPtr->imageBuffer);
+	    canvasPtr->imageBuffer = (TkPathContext) NULL;
+	    canvasPtr->imageBufferWidth = canvasPtr->imageBufferHeight = 0;
+	}
+	if (!canvasPtr->backBuffer) {
+	    CanvasFreeBackBuffer(canvasPtr);
+	}
+
 	/*
 	 * Reset the desired dimensions for the window.
 	 */
@@ -2316,6 +2556,18 @@ ConfigureCanvas(
      */
 
     CanvasSetOrigin(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin);
+
+    /*
+     * A redisplay that waits for the old -redrawdelay is scheduled again
+     * for the new one.
+     */
+
+    if ((canvasPtr->redrawDelay != redrawDelay)
+	    && (canvasPtr->redrawTimer != NULL)) {
+	CanvasCancelRedraw(canvasPtr);
+	canvasPtr->flags &= ~REDRAW_PENDING;
+	CanvasScheduleRedraw(canvasPtr);
+    }
     canvasPtr->flags |= UPDATE_SCROLLBARS|REDRAW_BORDERS;
     Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
 	    canvasPtr->xOrigin, canvasPtr->yOrigin,
@@ -2367,6 +2619,7 @@ PathCanvasWorldChanged(
 	if (result != TCL_OK) {
 	    Tcl_ResetResult(canvasPtr->interp);
 	}
+	IndexMarkItem(canvasPtr, itemPtr);
     }
     canvasPtr->flags |= REPICK_NEEDED;
     Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
@@ -2400,14 +2653,17 @@ DisplayCanvas(
     TkPathCanvas *canvasPtr = (TkPathCanvas *) clientData;
     Tk_Window tkwin = canvasPtr->tkwin;
     Tk_PathItem *itemPtr;
-    Pixmap pixmap;
-    int screenX1, screenX2, screenY1, screenY2, width, height;
-    int flags;
+    int screenX1, screenX2, screenY1, screenY2;
+    int i, flags;
 
     if (canvasPtr->flags & CANVAS_DELETED) {
 	return;
     }
+    canvasPtr->flags |= REDRAW_IN_PROGRESS;
+    canvasPtr->redrawTimer = (Tcl_TimerToken) NULL;
+    Tcl_GetTime(&canvasPtr->lastRedraw);
     if (!Tk_IsMapped(tkwin)) {
+	CanvasFreeBackBuffer(canvasPtr);
 	goto done;
     }
 
@@ -2441,145 +2697,87 @@ DisplayCanvas(
 	    itemPtr->redraw_flags &= ~FORCE_REDRAW;
 	}
     }
+
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    /*
+     * A new back buffer holds nothing yet, so all that is visible must
+     * be drawn into it.
+     */
+
+    if (canvasPtr->backBuffer && (canvasPtr->backPixmap == None)) {
+	canvasPtr->backPixmap = Tk_GetPixmap(Tk_Display(tkwin),
+		Tk_WindowId(tkwin), Tk_Width(tkwin), Tk_Height(tkwin),
+		Tk_Depth(tkwin));
+	CanvasAddDamage(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin,
+		canvasPtr->xOrigin + Tk_Width(tkwin),
+		canvasPtr->yOrigin + Tk_Height(tkwin));
+    }
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
     
     /*
-     * Compute the intersection between the area that needs redrawing and the
-     * area that's visible on the screen.
+     * Redraw each damaged rectangle on its own, intersected with the area
+     * that's visible on the screen.
      */
 
-    if ((canvasPtr->redrawX1 < canvasPtr->redrawX2)
-	    && (canvasPtr->redrawY1 < canvasPtr->redrawY2)) {
+    for (i = 0; i < canvasPtr->numDamageRects; i++) {
+	TkPathCanvasDamage *damagePtr = &canvasPtr->damageRects[i];
+
 	screenX1 = canvasPtr->xOrigin + canvasPtr->inset;
 	screenY1 = canvasPtr->yOrigin + canvasPtr->inset;
 	screenX2 = canvasPtr->xOrigin + Tk_Width(tkwin) - canvasPtr->inset;
 	screenY2 = canvasPtr->yOrigin + Tk_Height(tkwin) - canvasPtr->inset;
-	if (canvasPtr->redrawX1 > screenX1) {
-	    screenX1 = canvasPtr->redrawX1;
+	if (damagePtr->x1 > screenX1) {
+	    screenX1 = damagePtr->x1;
 	}
-	if (canvasPtr->redrawY1 > screenY1) {
-	    screenY1 = canvasPtr->redrawY1;
+	if (damagePtr->y1 > screenY1) {
+	    screenY1 = damagePtr->y1;
 	}
-	if (canvasPtr->redrawX2 < screenX2) {
-	    screenX2 = canvasPtr->redrawX2;
+	if (damagePtr->x2 < screenX2) {
+	    screenX2 = damagePtr->x2;
 	}
-	if (canvasPtr->redrawY2 < screenY2) {
-	    screenY2 = canvasPtr->redrawY2;
+	if (damagePtr->y2 < screenY2) {
+	    screenY2 = damagePtr->y2;
 	}
 	if ((screenX1 >= screenX2) || (screenY1 >= screenY2)) {
-	    goto borders;
+	    continue;
 	}
-
-	width = screenX2 - screenX1;
-	height = screenY2 - screenY1;
-
-#ifndef TK_PATH_NO_DOUBLE_BUFFERING
-	/*
-	 * Redrawing is done in a temporary pixmap that is allocated here and
-	 * freed at the end of the function. All drawing is done to the
-	 * pixmap, and the pixmap is copied to the screen at the end of the
-	 * function. The temporary pixmap serves two purposes:
-	 *
-	 * 1. It provides a smoother visual effect (no clearing and gradual
-	 *    redraw will be visible to users).
-	 * 2. It allows us to redraw only the objects that overlap the redraw
-	 *    area. Otherwise incorrect results could occur from redrawing
-	 *    things that stick outside of the redraw area (we'd have to
-	 *    redraw everything in order to make the overlaps look right).
-	 *
-	 * Some tricky points about the pixmap:
-	 *
-	 * 1. We only allocate a large enough pixmap to hold the area that has
-	 *    to be redisplayed. This saves time in in the X server for large
-	 *    objects that cover much more than the area being redisplayed:
-	 *    only the area of the pixmap will actually have to be redrawn.
-	 * 2. Some X servers (e.g. the one for DECstations) have troubles with
-	 *    with characters that overlap an edge of the pixmap (on the DEC
-	 *    servers, as of 8/18/92, such characters are drawn one pixel too
-	 *    far to the right). To handle this problem, make the pixmap a bit
-	 *    larger than is absolutely needed so that for normal-sized fonts
-	 *    the characters that overlap the edge of the pixmap will be
-	 *    outside the area we care about.
-	 */
-
-	canvasPtr->drawableXOrigin = screenX1 - 30;
-	canvasPtr->drawableYOrigin = screenY1 - 30;
-	pixmap = Tk_GetPixmap(Tk_Display(tkwin), Tk_WindowId(tkwin),
-	    (screenX2 + 30 - canvasPtr->drawableXOrigin),
-	    (screenY2 + 30 - canvasPtr->drawableYOrigin),
-	    Tk_Depth(tkwin));
-#else
-	canvasPtr->drawableXOrigin = canvasPtr->xOrigin;
-	canvasPtr->drawableYOrigin = canvasPtr->yOrigin;
-	pixmap = Tk_WindowId(tkwin);
-	TkpClipDrawableToRect(Tk_Display(tkwin), pixmap,
-		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin,
-		width, height);
-#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
-
-	/*
-	 * Clear the area to be redrawn.
-	 */
-
-	XFillRectangle(Tk_Display(tkwin), pixmap, canvasPtr->pixmapGC,
-		screenX1 - canvasPtr->drawableXOrigin,
-		screenY1 - canvasPtr->drawableYOrigin, (unsigned int) width,
-		(unsigned int) height);
-
-	/*
-	 * Scan through the item list, redrawing those items that need it. An
-	 * item must be redraw if either (a) it intersects the smaller
-	 * on-screen area or (b) it intersects the full canvas area and its
-	 * type requests that it be redrawn always (e.g. so subwindows can be
-	 * unmapped when they move off-screen).
-	 */
-
-	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
-	    if ((itemPtr->x1 >= screenX2)
-		    || (itemPtr->y1 >= screenY2)
-		    || (itemPtr->x2 < screenX1)
-		    || (itemPtr->y2 < screenY1)) {
-		if (!(itemPtr->typePtr->alwaysRedraw & 1)
-			|| (itemPtr->x1 >= canvasPtr->redrawX2)
-			|| (itemPtr->y1 >= canvasPtr->redrawY2)
-			|| (itemPtr->x2 < canvasPtr->redrawX1)
-			|| (itemPtr->y2 < canvasPtr->redrawY1)) {
-		    continue;
-		}
-	    }
-	    if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
-		(itemPtr->state == TK_PATHSTATE_NULL &&
-		 canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
-		continue;
-	    }
-	    (*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr, itemPtr,
-		    canvasPtr->display, pixmap, screenX1, screenY1, width,
-		    height);
+	if ((canvasPtr->renderer == CANVAS_RENDERER_IMAGE)
+		&& DisplayCanvasImage(canvasPtr, screenX1, screenY1,
+		    screenX2, screenY2)) {
+	    continue;
 	}
+	DisplayCanvasArea(canvasPtr, screenX1, screenY1, screenX2, screenY2);
+    }
 
-#ifndef TK_PATH_NO_DOUBLE_BUFFERING
-	/*
-	 * Copy from the temporary pixmap to the screen, then free up the
-	 * temporary pixmap.
-	 */
+    /*
+     * Exposed areas are copied from the back buffer, which is now up to
+     * date, without drawing any items.
+     */
 
-	XCopyArea(Tk_Display(tkwin), pixmap, Tk_WindowId(tkwin),
-		canvasPtr->pixmapGC,
-		screenX1 - canvasPtr->drawableXOrigin,
-		screenY1 - canvasPtr->drawableYOrigin,
-		(unsigned int) width, (unsigned int) height,
-		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
-	Tk_FreePixmap(Tk_Display(tkwin), pixmap);
-#else
-	TkpClipDrawableToRect(Tk_Display(tkwin), pixmap, 0, 0, -1, -1);
-#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
+    if ((canvasPtr->backPixmap != None)
+	    && (canvasPtr->exposeX1 < canvasPtr->exposeX2)) {
+	screenX1 = MAX(canvasPtr->exposeX1,
+		canvasPtr->xOrigin + canvasPtr->inset);
+	screenY1 = MAX(canvasPtr->exposeY1,
+		canvasPtr->yOrigin + canvasPtr->inset);
+	screenX2 = MIN(canvasPtr->exposeX2,
+		canvasPtr->xOrigin + Tk_Width(tkwin) - canvasPtr->inset);
+	screenY2 = MIN(canvasPtr->exposeY2,
+		canvasPtr->yOrigin + Tk_Height(tkwin) - canvasPtr->inset);
+	if ((screenX1 < screenX2) && (screenY1 < screenY2)) {
+	    XCopyArea(Tk_Display(tkwin), canvasPtr->backPixmap,
+		    Tk_WindowId(tkwin), canvasPtr->pixmapGC,
+		    screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin,
+		    (unsigned int) (screenX2 - screenX1),
+		    (unsigned int) (screenY2 - screenY1),
+		    screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+	}
     }
 
     /*
      * Draw the window borders, if needed.
      */
 
-  borders:
     if (canvasPtr->flags & REDRAW_BORDERS) {
 	canvasPtr->flags &= ~REDRAW_BORDERS;
 	if (canvasPtr->borderWidth > 0) {
@@ -2608,9 +2806,12 @@ DisplayCanvas(
     }
 
   done:
-    canvasPtr->flags &= ~(REDRAW_PENDING|BBOX_NOT_EMPTY);
+    canvasPtr->flags &= ~(REDRAW_PENDING|BBOX_NOT_EMPTY|REDRAW_IN_PROGRESS);
     canvasPtr->redrawX1 = canvasPtr->redrawX2 = 0;
     canvasPtr->redrawY1 = canvasPtr->redrawY2 = 0;
+    canvasPtr->numDamageRects = 0;
+    canvasPtr->exposeX1 = canvasPtr->exposeX2 = 0;
+    canvasPtr->exposeY1 = canvasPtr->exposeY2 = 0;
     if (canvasPtr->flags & UPDATE_SCROLLBARS) {
 	CanvasUpdateScrollbars(canvasPtr);
     }
@@ -2619,110 +2820,673 @@ DisplayCanvas(
 /*
  *--------------------------------------------------------------
  *
- * CanvasEventProc --
+ * DisplayCanvasArea --
  *
- *	This function is invoked by the Tk dispatcher for various events on
- *	canvases.
+ *	Redraws one rectangle of the canvas with the native renderer: the
+ *	area is cleared, all items that overlap it are drawn and the
+ *	result is copied to the window.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	When the window gets deleted, internal structures get cleaned up.
- *	When it gets exposed, it is redisplayed.
+ *	Information appears on the screen.
  *
  *--------------------------------------------------------------
  */
 
 static void
-CanvasEventProc(
-    ClientData clientData,	/* Information about window. */
-    XEvent *eventPtr)		/* Information about event. */
+DisplayCanvasArea(
+    TkPathCanvas *canvasPtr,	/* Information about widget. */
+    int screenX1, int screenY1,	/* Area to redraw, in canvas coordinates, */
+    int screenX2, int screenY2)	/* already clipped to the window. */
 {
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) clientData;
+    Tk_Window tkwin = canvasPtr->tkwin;
+    Tk_PathItem *itemPtr;
+    IndexSearch search;
+    Pixmap pixmap;
+    TkPathContext ctx;
+    int width, height, pixWidth, pixHeight, numLodRects;
 
-    if (eventPtr->type == Expose) {
-	int x, y;
+    width = screenX2 - screenX1;
+    height = screenY2 - screenY1;
 
-	x = eventPtr->xexpose.x + canvasPtr->xOrigin;
-	y = eventPtr->xexpose.y + canvasPtr->yOrigin;
-	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr, x, y,
-		x + eventPtr->xexpose.width,
-		y + eventPtr->xexpose.height);
-	if ((eventPtr->xexpose.x < canvasPtr->inset)
-		|| (eventPtr->xexpose.y < canvasPtr->inset)
-		|| ((eventPtr->xexpose.x + eventPtr->xexpose.width)
-		    > (Tk_Width(canvasPtr->tkwin) - canvasPtr->inset))
-		|| ((eventPtr->xexpose.y + eventPtr->xexpose.height)
-		    > (Tk_Height(canvasPtr->tkwin) - canvasPtr->inset))) {
-	    canvasPtr->flags |= REDRAW_BORDERS;
-	}
-    } else if (eventPtr->type == DestroyNotify) {
-	if (!(canvasPtr->flags & CANVAS_DELETED)) {
-	    canvasPtr->flags |= CANVAS_DELETED;
-	    Tcl_DeleteCommandFromToken(canvasPtr->interp,
-		    canvasPtr->widgetCmd);
-	    if (canvasPtr->flags & REDRAW_PENDING) {
-		Tcl_CancelIdleCall(DisplayCanvas, (ClientData) canvasPtr);
-	    }
-	    Tcl_EventuallyFree((ClientData) canvasPtr,
-		    (Tcl_FreeProc *) DestroyCanvas);
-	}
-    } else if (eventPtr->type == ConfigureNotify) {
-	canvasPtr->flags |= UPDATE_SCROLLBARS;
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    /*
+     * Redrawing is done in a temporary pixmap that is allocated here and
+     * freed at the end of the function. All drawing is done to the
+     * pixmap, and the pixmap is copied to the screen at the end of the
+     * function. The temporary pixmap serves two purposes:
+     *
+     * 1. It provides a smoother visual effect (no clearing and gradual
+     *    redraw will be visible to users).
+     * 2. It allows us to redraw only the objects that overlap the redraw
+     *    area. Otherwise incorrect results could occur from redrawing
+     *    things that stick outside of the redraw area (we'd have to
+     *    redraw everything in order to make the overlaps look right).
+     *
+     * Some tricky points about the pixmap:
+     *
+     * 1. We only allocate a large enough pixmap to hold the area that has
+     *    to be redisplayed. This saves time in in the X server for large
+     *    objects that cover much more than the area being redisplayed:
+     *    only the area of the pixmap will actually have to be redrawn.
+     * 2. Some X servers (e.g. the one for DECstations) have troubles with
+     *    with characters that overlap an edge of the pixmap (on the DEC
+     *    servers, as of 8/18/92, such characters are drawn one pixel too
+     *    far to the right). To handle this problem, make the pixmap a bit
+     *    larger than is absolutely needed so that for normal-sized fonts
+     *    the characters that overlap the edge of the pixmap will be
+     *    outside the area we care about.
+     */
 
+    canvasPtr->drawableXOrigin = screenX1 - 30;
+    canvasPtr->drawableYOrigin = screenY1 - 30;
+    pixWidth = screenX2 + 30 - canvasPtr->drawableXOrigin;
+    pixHeight = screenY2 + 30 - canvasPtr->drawableYOrigin;
+    if (canvasPtr->backPixmap != None) {
 	/*
-	 * The call below is needed in order to recenter the canvas if it's
-	 * confined and its scroll region is smaller than the window.
+	 * With a back buffer the pixmap is kept, and only reallocated
+	 * when too small, then large enough for a full redraw.
 	 */
 
-	CanvasSetOrigin(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin);
-	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr, canvasPtr->xOrigin,
-		canvasPtr->yOrigin,
-		canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
-		canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
-	canvasPtr->flags |= REDRAW_BORDERS;
-    } else if (eventPtr->type == FocusIn) {
-	if (eventPtr->xfocus.detail != NotifyInferior) {
-	    CanvasFocusProc(canvasPtr, 1);
+	if ((canvasPtr->scratchPixmap != None)
+		&& ((canvasPtr->scratchWidth < pixWidth)
+		|| (canvasPtr->scratchHeight < pixHeight))) {
+	    Tk_FreePixmap(Tk_Display(tkwin), canvasPtr->scratchPixmap);
+	    canvasPtr->scratchPixmap = None;
 	}
-    } else if (eventPtr->type == FocusOut) {
-	if (eventPtr->xfocus.detail != NotifyInferior) {
-	    CanvasFocusProc(canvasPtr, 0);
+	if (canvasPtr->scratchPixmap == None) {
+	    canvasPtr->scratchWidth = MAX(pixWidth, Tk_Width(tkwin) + 60);
+	    canvasPtr->scratchHeight = MAX(pixHeight, Tk_Height(tkwin) + 60);
+	    canvasPtr->scratchPixmap = Tk_GetPixmap(Tk_Display(tkwin),
+		    Tk_WindowId(tkwin), canvasPtr->scratchWidth,
+		    canvasPtr->scratchHeight, Tk_Depth(tkwin));
 	}
-    } else if (eventPtr->type == UnmapNotify) {
-	Tk_PathItem *itemPtr;
+	pixmap = canvasPtr->scratchPixmap;
+    } else {
+	pixmap = Tk_GetPixmap(Tk_Display(tkwin), Tk_WindowId(tkwin),
+		pixWidth, pixHeight, Tk_Depth(tkwin));
+    }
+#else
+    canvasPtr->drawableXOrigin = canvasPtr->xOrigin;
+    canvasPtr->drawableYOrigin = canvasPtr->yOrigin;
+    pixWidth = Tk_Width(tkwin);
+    pixHeight = Tk_Height(tkwin);
+    pixmap = Tk_WindowId(tkwin);
+    TkpClipDrawableToRect(Tk_Display(tkwin), pixmap,
+	    screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin,
+	    width, height);
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
 
-	/*
-	 * Special hack: if the canvas is unmapped, then must notify all items
-	 * with "alwaysRedraw" set, so that they know that they are no longer
-	 * displayed.
-	 */
+    /*
+     * Clear the area to be redrawn.
+     */
 
-	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
-	    if (itemPtr->typePtr->alwaysRedraw & 1) {
-		(*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr,
-			itemPtr, canvasPtr->display, None, 0, 0, 0, 0);
+    XFillRectangle(Tk_Display(tkwin), pixmap, canvasPtr->pixmapGC,
+	    screenX1 - canvasPtr->drawableXOrigin,
+	    screenY1 - canvasPtr->drawableYOrigin, (unsigned int) width,
+	    (unsigned int) height);
+
+    /*
+     * Scan through the items near the area, as found by the spatial
+     * index in display list order, redrawing those items that need it. An
+     * item must be redraw if either (a) it intersects the smaller
+     * on-screen area or (b) it intersects the full canvas area and its
+     * type requests that it be redrawn always (e.g. so subwindows can be
+     * unmapped when they move off-screen).
+     *
+     * Items that have a displayContextProc all draw into one context
+     * which is created on demand and only torn down before classic
+     * items, which draw directly with GCs, so that the stacking order
+     * is preserved. We know the size of the drawable and pass it on
+     * which saves the backend a server round trip.
+     */
+
+    ctx = (TkPathContext) NULL;
+    numLodRects = 0;
+    for (itemPtr = IndexSearchFirst(canvasPtr, &search,
+	    screenX1, screenY1, screenX2, screenY2); itemPtr != NULL;
+	    itemPtr = IndexSearchNext(&search, itemPtr)) {
+	if (!ItemNeedsRedisplay(canvasPtr, itemPtr,
+		screenX1, screenY1, screenX2, screenY2)) {
+	    continue;
+	}
+	if (ItemBelowLod(canvasPtr, itemPtr)) {
+	    if (canvasPtr->lodColorPtr != NULL) {
+		if (ctx == (TkPathContext) NULL) {
+		    ctx = TkPathInitWithSize(tkwin, pixmap,
+			    pixWidth, pixHeight);
+		}
+		numLodRects = AddLodRect(canvasPtr, ctx, itemPtr,
+			numLodRects);
+	    }
+	    continue;
+	}
+	numLodRects = FillLodRects(canvasPtr, ctx, numLodRects);
+	if (itemPtr->typePtr->displayContextProc != NULL) {
+	    if (ctx == (TkPathContext) NULL) {
+		ctx = TkPathInitWithSize(tkwin, pixmap, pixWidth, pixHeight);
+	    }
+	    (*itemPtr->typePtr->displayContextProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, ctx, screenX1, screenY1, width, height);
+	} else {
+	    if (ctx != (TkPathContext) NULL) {
+		TkPathFree(ctx);
+		ctx = (TkPathContext) NULL;
 	    }
+	    (*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, canvasPtr->display, pixmap, screenX1, screenY1,
+		    width, height);
 	}
     }
+    IndexSearchDone(&search);
+    if (ctx != (TkPathContext) NULL) {
+	FillLodRects(canvasPtr, ctx, numLodRects);
+	TkPathFree(ctx);
+    }
+
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    /*
+     * Copy from the temporary pixmap to the screen, and to the back
+     * buffer if there is one, then free up the temporary pixmap.
+     */
+
+    XCopyArea(Tk_Display(tkwin), pixmap, Tk_WindowId(tkwin),
+	    canvasPtr->pixmapGC,
+	    screenX1 - canvasPtr->drawableXOrigin,
+	    screenY1 - canvasPtr->drawableYOrigin,
+	    (unsigned int) width, (unsigned int) height,
+	    screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+    if (canvasPtr->backPixmap != None) {
+	XCopyArea(Tk_Display(tkwin), pixmap, canvasPtr->backPixmap,
+		canvasPtr->pixmapGC,
+		screenX1 - canvasPtr->drawableXOrigin,
+		screenY1 - canvasPtr->drawableYOrigin,
+		(unsigned int) width, (unsigned int) height,
+		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+    } else {
+	Tk_FreePixmap(Tk_Display(tkwin), pixmap);
+    }
+#else
+    TkpClipDrawableToRect(Tk_Display(tkwin), pixmap, 0, 0, -1, -1);
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
 }
 
 /*
- *----------------------------------------------------------------------
+ *--------------------------------------------------------------
  *
- * CanvasCmdDeletedProc --
+ * CanvasFreeBackBuffer --
  *
- *	This function is invoked when a widget command is deleted. If the
- *	widget isn't already in the process of being destroyed, this command
- *	destroys it.
+ *	Frees the back buffer, and the pixmap kept for drawing into,
+ *	when they are no longer wanted or may be out of date.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	The widget is destroyed.
+ *	Exposes are redrawn from the items until the next redisplay,
+ *	which makes a new back buffer if the -backbuffer option is set.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasFreeBackBuffer(
+    TkPathCanvas *canvasPtr)	/* Information about widget. */
+{
+    if (canvasPtr->backPixmap != None) {
+	Tk_FreePixmap(canvasPtr->display, canvasPtr->backPixmap);
+	canvasPtr->backPixmap = None;
+    }
+    if (canvasPtr->scratchPixmap != None) {
+	Tk_FreePixmap(canvasPtr->display, canvasPtr->scratchPixmap);
+	canvasPtr->scratchPixmap = None;
+	canvasPtr->scratchWidth = canvasPtr->scratchHeight = 0;
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ItemNeedsRedisplay --
+ *
+ *	Decides if an item must be redrawn during a redisplay of the
+ *	given screen area. An item must be redrawn if either (a) it
+ *	intersects the smaller on-screen area or (b) it intersects the
+ *	full canvas area and its type requests that it be redrawn always
+ *	(e.g. so subwindows can be unmapped when they move off-screen).
+ *
+ * Results:
+ *	1 if the item shall be displayed, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+ItemNeedsRedisplay(
+    TkPathCanvas *canvasPtr,
+    Tk_PathItem *itemPtr,
+    int screenX1, int screenY1,	/* Area being redrawn, in canvas */
+    int screenX2, int screenY2)	/* coordinates. */
+{
+    if ((itemPtr->x1 >= screenX2)
+	    || (itemPtr->y1 >= screenY2)
+	    || (itemPtr->x2 < screenX1)
+	    || (itemPtr->y2 < screenY1)) {
+	if (!(itemPtr->typePtr->alwaysRedraw & 1)
+		|| (itemPtr->x1 >= canvasPtr->redrawX2)
+		|| (itemPtr->y1 >= canvasPtr->redrawY2)
+		|| (itemPtr->x2 < canvasPtr->redrawX1)
+		|| (itemPtr->y2 < canvasPtr->redrawY1)) {
+	    return 0;
+	}
+    }
+    if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
+	    (itemPtr->state == TK_PATHSTATE_NULL &&
+	     canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
+	return 0;
+    }
+    return 1;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ItemBelowLod --
+ *
+ *	Decides if an item is too small on screen to be worth drawing in
+ *	full, which is when its bounding box fits in a square of
+ *	-lodthreshold pixels. The bounding box already includes the
+ *	item's -matrix and stroke. Only leaf items drawn into a path
+ *	context qualify; classic items and windows are always drawn.
+ *	Groups are left to their children, since a rectangle over the
+ *	union of these would cover the space between them, and since
+ *	redisplays through the index never see the groups.
+ *
+ * Results:
+ *	1 if the item shall be left out or drawn as a rectangle, 0 if it
+ *	shall be drawn in full.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+ItemBelowLod(
+    TkPathCanvas *canvasPtr,
+    Tk_PathItem *itemPtr)
+{
+    if ((canvasPtr->lodThreshold <= 0.0)
+	    || (itemPtr->typePtr->displayContextProc == NULL)
+	    || (itemPtr->typePtr == &tkGroupType)) {
+	return 0;
+    }
+    return ((itemPtr->x2 - itemPtr->x1) < canvasPtr->lodThreshold)
+	    && ((itemPtr->y2 - itemPtr->y1) < canvasPtr->lodThreshold);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * AddLodRect, FillLodRects --
+ *
+ *	Items below the -lodthreshold are drawn as a rectangle covering
+ *	their bounding box in the -lodcolor. AddLodRect adds one such
+ *	rectangle to the current path of the context, and FillLodRects
+ *	fills all of them in one go. It must be called before any other
+ *	item draws so that the stacking order is kept.
+ *
+ * Results:
+ *	The number of rectangles in the path afterwards.
+ *
+ * Side effects:
+ *	The rectangles are painted in the context.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+AddLodRect(
+    TkPathCanvas *canvasPtr,
+    TkPathContext ctx,
+    Tk_PathItem *itemPtr,
+    int numRects)		/* Rectangles in the path so far. */
+{
+    Tk_PathStyle style;
+
+    if (numRects == 0) {
+	TkPathInitStyle(&style);
+	TkPathBeginPath(ctx, &style);
+    }
+    TkPathRect(ctx, itemPtr->x1 - canvasPtr->drawableXOrigin,
+	    itemPtr->y1 - canvasPtr->drawableYOrigin,
+	    MAX(itemPtr->x2 - itemPtr->x1, 1),
+	    MAX(itemPtr->y2 - itemPtr->y1, 1));
+    return numRects + 1;
+}
+
+static int
+FillLodRects(
+    TkPathCanvas *canvasPtr,
+    TkPathContext ctx,
+    int numRects)		/* Rectangles in the path so far. */
+{
+    Tk_PathStyle style;
+    TkPathColor fill;
+
+    if ((numRects == 0) || (ctx == (TkPathContext) NULL)) {
+	return 0;
+    }
+    TkPathInitStyle(&style);
+    fill.color = canvasPtr->lodColorPtr;
+    fill.gradientInstPtr = NULL;
+    style.fill = &fill;
+    TkPathFill(ctx, &style);
+    TkPathEndPath(ctx);
+    return 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * DisplayCanvasImage --
+ *
+ *	Redraws an area of the canvas for '-renderer image'. Path items
+ *	are rasterized on the client side into the canvas image buffer,
+ *	which is then sent to the window in one go. Classic items draw
+ *	with GCs, so for those the buffer is first put into a pixmap, and
+ *	read back before the next path item is drawn.
+ *
+ * Results:
+ *	1 if the area was redrawn, 0 if the backend can't provide an
+ *	image buffer, in which case the caller shall use the native
+ *	renderer.
+ *
+ * Side effects:
+ *	Information appears on the screen.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+DisplayCanvasImage(
+    TkPathCanvas *canvasPtr,	/* Information about widget. */
+    int screenX1, int screenY1,	/* Area to redraw, in canvas */
+    int screenX2, int screenY2)	/* coordinates. */
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    Display *display = Tk_Display(tkwin);
+    Tk_PathItem *itemPtr;
+    IndexSearch search;
+    Pixmap pixmap = None;
+    Drawable drawable;
+    TkPathContext ctx, recording = (TkPathContext) NULL;
+    int width, height, pixWidth, pixHeight, x, y, record;
+    int lod, numLodRects = 0;
+    int pixmapIsNewer = 0;	/* Non-zero means that classic items have
+				 * drawn in the pixmap after the buffer was
+				 * put there. */
+
+    width = screenX2 - screenX1;
+    height = screenY2 - screenY1;
+    canvasPtr->drawableXOrigin = screenX1 - 30;
+    canvasPtr->drawableYOrigin = screenY1 - 30;
+    pixWidth = screenX2 + 30 - canvasPtr->drawableXOrigin;
+    pixHeight = screenY2 + 30 - canvasPtr->drawableYOrigin;
+    x = screenX1 - canvasPtr->drawableXOrigin;
+    y = screenY1 - canvasPtr->drawableYOrigin;
+
+    /*
+     * Keep the buffer between redisplays. It is only reallocated when
+     * it is too small, and then made large enough for a full redraw.
+     */
+
+    if ((canvasPtr->imageBuffer != (TkPathContext) NULL)
+	    && ((canvasPtr->imageBufferWidth < pixWidth)
+	    || (canvasPtr->imageBufferHeight < pixHeight))) {
+	TkPathFree(canvasPtr->imageBuffer);
+	canvasPtr->imageBuffer = (TkPathContext) NULL;
+    }
+    if (canvasPtr->imageBuffer == (TkPathContext) NULL) {
+	canvasPtr->imageBufferWidth = MAX(pixWidth, Tk_Width(tkwin) + 60);
+	canvasPtr->imageBufferHeight = MAX(pixHeight, Tk_Height(tkwin) + 60);
+	canvasPtr->imageBuffer = TkPathInitImageBuffer(tkwin,
+		canvasPtr->imageBufferWidth, canvasPtr->imageBufferHeight);
+	if (canvasPtr->imageBuffer == (TkPathContext) NULL) {
+	    canvasPtr->imageBufferWidth = canvasPtr->imageBufferHeight = 0;
+	    return 0;
+	}
+    }
+    ctx = canvasPtr->imageBuffer;
+    TkPathImageBufferFill(ctx, Tk_3DBorderColor(canvasPtr->bgBorder),
+	    x, y, width, height);
+
+    /*
+     * With -threads the path items are first recorded, here, and the
+     * recording is then rasterized by several threads before any
+     * classic item draws and at the end. Small areas are not worth it.
+     */
+
+    record = (canvasPtr->threads > 1)
+	    && ((double) width * height >= THREADS_MIN_AREA);
+
+    for (itemPtr = IndexSearchFirst(canvasPtr, &search,
+	    screenX1, screenY1, screenX2, screenY2); itemPtr != NULL;
+	    itemPtr = IndexSearchNext(&search, itemPtr)) {
+	if (!ItemNeedsRedisplay(canvasPtr, itemPtr,
+		screenX1, screenY1, screenX2, screenY2)) {
+	    continue;
+	}
+	lod = ItemBelowLod(canvasPtr, itemPtr);
+	if (lod && (canvasPtr->lodColorPtr == NULL)) {
+	    continue;
+	}
+	if (!lod) {
+	    numLodRects = FillLodRects(canvasPtr,
+		    (recording != (TkPathContext) NULL) ? recording : ctx,
+		    numLodRects);
+	}
+	if (itemPtr->typePtr->displayContextProc != NULL) {
+	    if (pixmapIsNewer) {
+		TkPathImageBufferGet(ctx, pixmap, x, y, width, height);
+		pixmapIsNewer = 0;
+	    }
+	    if (record && (recording == (TkPathContext) NULL)) {
+		recording = TkPathInitRecording(ctx, x, y, width, height);
+		record = (recording != (TkPathContext) NULL);
+	    }
+	    if (lod) {
+		numLodRects = AddLodRect(canvasPtr,
+			(recording != (TkPathContext) NULL) ? recording : ctx,
+			itemPtr, numLodRects);
+		continue;
+	    }
+	    (*itemPtr->typePtr->displayContextProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, (recording != (TkPathContext) NULL) ? recording : ctx,
+		    screenX1, screenY1, width, height);
+	} else {
+	    if (recording != (TkPathContext) NULL) {
+		TkPathReplayRecording(recording, ctx, canvasPtr->threads);
+		recording = (TkPathContext) NULL;
+	    }
+	    if (pixmap == None) {
+		pixmap = Tk_GetPixmap(display, Tk_WindowId(tkwin),
+			pixWidth, pixHeight, Tk_Depth(tkwin));
+	    }
+	    if (!pixmapIsNewer) {
+		TkPathImageBufferPut(ctx, pixmap, canvasPtr->pixmapGC,
+			x, y, width, height, x, y);
+		pixmapIsNewer = 1;
+	    }
+	    (*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, canvasPtr->display, pixmap, screenX1, screenY1,
+		    width, height);
+	}
+    }
+    IndexSearchDone(&search);
+    if (recording != (TkPathContext) NULL) {
+	FillLodRects(canvasPtr, recording, numLodRects);
+	TkPathReplayRecording(recording, ctx, canvasPtr->threads);
+    } else {
+	FillLodRects(canvasPtr, ctx, numLodRects);
+    }
+
+    /*
+     * With a back buffer the result goes there first, and is copied to
+     * the window on the server side.
+     */
+
+    drawable = (canvasPtr->backPixmap != None) ? canvasPtr->backPixmap
+	    : Tk_WindowId(tkwin);
+    if (pixmapIsNewer) {
+	XCopyArea(display, pixmap, drawable, canvasPtr->pixmapGC,
+		x, y, (unsigned int) width, (unsigned int) height,
+		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+    } else {
+	TkPathImageBufferPut(ctx, drawable, canvasPtr->pixmapGC,
+		x, y, width, height,
+		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+    }
+    if (drawable != Tk_WindowId(tkwin)) {
+	XCopyArea(display, drawable, Tk_WindowId(tkwin), canvasPtr->pixmapGC,
+		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin,
+		(unsigned int) width, (unsigned int) height,
+		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+    }
+    if (pixmap != None) {
+	Tk_FreePixmap(display, pixmap);
+    }
+    return 1;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasEventProc --
+ *
+ *	This function is invoked by the Tk dispatcher for various events on
+ *	canvases.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	When the window gets deleted, internal structures get cleaned up.
+ *	When it gets exposed, it is redisplayed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasEventProc(
+    ClientData clientData,	/* Information about window. */
+    XEvent *eventPtr)		/* Information about event. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) clientData;
+
+    if (eventPtr->type == Expose) {
+	int x, y;
+
+	x = eventPtr->xexpose.x + canvasPtr->xOrigin;
+	y = eventPtr->xexpose.y + canvasPtr->yOrigin;
+	if (canvasPtr->backPixmap != None) {
+	    /*
+	     * The back buffer already holds what shall be there.
+	     */
+
+	    CanvasAddExpose(canvasPtr, x, y, x + eventPtr->xexpose.width,
+		    y + eventPtr->xexpose.height);
+	} else {
+	    Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr, x, y,
+		    x + eventPtr->xexpose.width,
+		    y + eventPtr->xexpose.height);
+	}
+	if ((eventPtr->xexpose.x < canvasPtr->inset)
+		|| (eventPtr->xexpose.y < canvasPtr->inset)
+		|| ((eventPtr->xexpose.x + eventPtr->xexpose.width)
+		    > (Tk_Width(canvasPtr->tkwin) - canvasPtr->inset))
+		|| ((eventPtr->xexpose.y + eventPtr->xexpose.height)
+		    > (Tk_Height(canvasPtr->tkwin) - canvasPtr->inset))) {
+	    canvasPtr->flags |= REDRAW_BORDERS;
+	}
+    } else if (eventPtr->type == DestroyNotify) {
+	if (!(canvasPtr->flags & CANVAS_DELETED)) {
+	    canvasPtr->flags |= CANVAS_DELETED;
+	    Tcl_DeleteCommandFromToken(canvasPtr->interp,
+		    canvasPtr->widgetCmd);
+	    CanvasCancelRedraw(canvasPtr);
+	    Tcl_EventuallyFree((ClientData) canvasPtr,
+		    (Tcl_FreeProc *) DestroyCanvas);
+	}
+    } else if (eventPtr->type == ConfigureNotify) {
+	canvasPtr->flags |= UPDATE_SCROLLBARS;
+	CanvasFreeBackBuffer(canvasPtr);
+
+	/*
+	 * The call below is needed in order to recenter the canvas if it's
+	 * confined and its scroll region is smaller than the window.
+	 */
+
+	CanvasSetOrigin(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin);
+	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr, canvasPtr->xOrigin,
+		canvasPtr->yOrigin,
+		canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
+		canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
+	canvasPtr->flags |= REDRAW_BORDERS;
+    } else if (eventPtr->type == FocusIn) {
+	if (eventPtr->xfocus.detail != NotifyInferior) {
+	    CanvasFocusProc(canvasPtr, 1);
+	}
+    } else if (eventPtr->type == FocusOut) {
+	if (eventPtr->xfocus.detail != NotifyInferior) {
+	    CanvasFocusProc(canvasPtr, 0);
+	}
+    } else if (eventPtr->type == UnmapNotify) {
+	Tk_PathItem *itemPtr;
+
+	/*
+	 * Nothing is drawn while unmapped so the back buffer gets out
+	 * of date.
+	 */
+
+	CanvasFreeBackBuffer(canvasPtr);
+
+	/*
+	 * Special hack: if the canvas is unmapped, then must notify all items
+	 * with "alwaysRedraw" set, so that they know that they are no longer
+	 * displayed.
+	 */
+
+	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
+		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+	    if (itemPtr->typePtr->alwaysRedraw & 1) {
+		(*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr,
+			itemPtr, canvasPtr->display, None, 0, 0, 0, 0);
+	    }
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CanvasCmdDeletedProc --
+ *
+ *	This function is invoked when a widget command is deleted. If the
+ *	widget isn't already in the process of being destroyed, this command
+ *	destroys it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The widget is destroyed.
  *
  *----------------------------------------------------------------------
  */
@@ -2748,40 +3512,236 @@ CanvasCmdDeletedProc(
 /*
  *--------------------------------------------------------------
  *
- * Tk_PathCanvasEventuallyRedraw --
+ * DamageShouldMerge --
  *
- *	Arrange for part or all of a canvas widget to redrawn at some
- *	convenient time in the future.
+ *	Decides if two damage rectangles are better redrawn as their
+ *	common bounding box. This is the case if they overlap or touch,
+ *	or if the bounding box isn't much larger than the two of them
+ *	together, since every extra rectangle costs a pass over the items
+ *	and a copy to the screen.
  *
  * Results:
- *	None.
+ *	1 if the rectangles shall be merged, 0 otherwise.
  *
  * Side effects:
- *	The screen will eventually be refreshed.
+ *	None.
  *
  *--------------------------------------------------------------
  */
 
-void
-Tk_PathCanvasEventuallyRedraw(
-    Tk_PathCanvas canvas,	/* Information about widget. */
-    int x1, int y1,		/* Upper left corner of area to redraw. Pixels
-				 * on edge are redrawn. */
-    int x2, int y2)		/* Lower right corner of area to redraw.
-				 * Pixels on edge are not redrawn. */
+static double
+DamageArea(
+    int x1, int y1, int x2, int y2)
 {
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
-    Tk_Window tkwin = canvasPtr->tkwin;
+    return (double) (x2 - x1) * (double) (y2 - y1);
+}
 
-    if ((canvasPtr->flags & CANVAS_DELETED) || !Tk_IsMapped(tkwin)) {
+static int
+DamageShouldMerge(
+    TkPathCanvasDamage *aPtr,
+    TkPathCanvasDamage *bPtr)
+{
+    double unionArea;
+
+    if ((aPtr->x1 <= bPtr->x2) && (bPtr->x1 <= aPtr->x2)
+	    && (aPtr->y1 <= bPtr->y2) && (bPtr->y1 <= aPtr->y2)) {
+	return 1;
+    }
+    unionArea = DamageArea(MIN(aPtr->x1, bPtr->x1), MIN(aPtr->y1, bPtr->y1),
+	    MAX(aPtr->x2, bPtr->x2), MAX(aPtr->y2, bPtr->y2));
+
+    /*
+     * Allow the merged rectangle to waste a quarter of its area, plus a
+     * fixed slack so that tiny neighbouring rectangles (a blinking insert
+     * cursor next to its text) always go together.
+     */
+
+    return (unionArea <= 1.25 * (DamageArea(aPtr->x1, aPtr->y1,
+	    aPtr->x2, aPtr->y2) + DamageArea(bPtr->x1, bPtr->y1,
+	    bPtr->x2, bPtr->y2)) + 1024.0);
+}
+
+static void
+DamageUnion(
+    TkPathCanvasDamage *aPtr,	/* Grown to include bPtr. */
+    TkPathCanvasDamage *bPtr)
+{
+    aPtr->x1 = MIN(aPtr->x1, bPtr->x1);
+    aPtr->y1 = MIN(aPtr->y1, bPtr->y1);
+    aPtr->x2 = MAX(aPtr->x2, bPtr->x2);
+    aPtr->y2 = MAX(aPtr->y2, bPtr->y2);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasScheduleRedraw --
+ *
+ *	Arranges for the canvas to be redisplayed, unless that has
+ *	already been arranged. Without -redrawdelay this happens the next
+ *	time the application is idle. With it, if the last redisplay
+ *	started less than that many milliseconds ago, a timer is set for
+ *	the remaining time. Everything damaged in between is drawn by the
+ *	same redisplay.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	An idle or timer handler may be registered.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasScheduleRedraw(
+    TkPathCanvas *canvasPtr)	/* Information about widget. */
+{
+    Tcl_Time now;
+    long elapsed;
+
+    if (canvasPtr->flags & REDRAW_PENDING) {
 	return;
     }
-    if ((x1 >= x2) || (y1 >= y2) ||
- 	    (x2 < canvasPtr->xOrigin) || (y2 < canvasPtr->yOrigin) ||
-	    (x1 >= canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin)) ||
-	    (y1 >= canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin))) {
+    canvasPtr->flags |= REDRAW_PENDING;
+    if (canvasPtr->redrawDelay > 0) {
+	Tcl_GetTime(&now);
+	elapsed = (now.sec - canvasPtr->lastRedraw.sec) * 1000
+		+ (now.usec - canvasPtr->lastRedraw.usec) / 1000;
+	if ((elapsed >= 0) && (elapsed < canvasPtr->redrawDelay)) {
+	    canvasPtr->redrawTimer = Tcl_CreateTimerHandler(
+		    canvasPtr->redrawDelay - (int) elapsed,
+		    CanvasRedrawTimerProc, (ClientData) canvasPtr);
+	    return;
+	}
+    }
+    Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasRedrawTimerProc --
+ *
+ *	Called when the -redrawdelay timer fires. The redisplay itself is
+ *	still done as an idle handler, so that window events that have
+ *	arrived in the meantime, such as mouse and key presses, are
+ *	handled before it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	An idle handler is registered.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasRedrawTimerProc(
+    ClientData clientData)	/* Information about widget. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) clientData;
+
+    canvasPtr->redrawTimer = (Tcl_TimerToken) NULL;
+    Tcl_DoWhenIdle(DisplayCanvas, clientData);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasCancelRedraw --
+ *
+ *	Removes the handler, if any, that CanvasScheduleRedraw registered.
+ *	The REDRAW_PENDING flag is left as it is.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasCancelRedraw(
+    TkPathCanvas *canvasPtr)	/* Information about widget. */
+{
+    if (!(canvasPtr->flags & REDRAW_PENDING)) {
 	return;
     }
+    if (canvasPtr->redrawTimer != NULL) {
+	Tcl_DeleteTimerHandler(canvasPtr->redrawTimer);
+	canvasPtr->redrawTimer = (Tcl_TimerToken) NULL;
+    } else {
+	Tcl_CancelIdleCall(DisplayCanvas, (ClientData) canvasPtr);
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasAddExpose --
+ *
+ *	Adds a rectangle to the area that the next redisplay copies from
+ *	the back buffer to the window.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A redisplay is scheduled if there isn't one already.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasAddExpose(
+    TkPathCanvas *canvasPtr,	/* Information about widget. */
+    int x1, int y1,		/* Upper left corner of area, included. */
+    int x2, int y2)		/* Lower right corner of area, not included. */
+{
+    if (canvasPtr->exposeX1 >= canvasPtr->exposeX2) {
+	canvasPtr->exposeX1 = x1;
+	canvasPtr->exposeY1 = y1;
+	canvasPtr->exposeX2 = x2;
+	canvasPtr->exposeY2 = y2;
+    } else {
+	canvasPtr->exposeX1 = MIN(canvasPtr->exposeX1, x1);
+	canvasPtr->exposeY1 = MIN(canvasPtr->exposeY1, y1);
+	canvasPtr->exposeX2 = MAX(canvasPtr->exposeX2, x2);
+	canvasPtr->exposeY2 = MAX(canvasPtr->exposeY2, y2);
+    }
+    CanvasScheduleRedraw(canvasPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasAddRedrawBbox --
+ *
+ *	Includes a rectangle in the overall redraw bounding box of the
+ *	canvas without adding it to the list of damage rectangles. Items
+ *	that request to be redrawn always and are within the bounding
+ *	box are displayed by the next redisplay.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The redraw area of the canvas is updated. If it was empty, the
+ *	damage list is emptied.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasAddRedrawBbox(
+    TkPathCanvas *canvasPtr,	/* Information about widget. */
+    int x1, int y1,		/* Upper left corner of area, included. */
+    int x2, int y2)		/* Lower right corner of area, not included. */
+{
     if (canvasPtr->flags & BBOX_NOT_EMPTY) {
 	if (x1 <= canvasPtr->redrawX1) {
 	    canvasPtr->redrawX1 = x1;
@@ -2800,398 +3760,1150 @@ Tk_PathCanvasEventuallyRedraw(
 	canvasPtr->redrawY1 = y1;
 	canvasPtr->redrawX2 = x2;
 	canvasPtr->redrawY2 = y2;
+	canvasPtr->numDamageRects = 0;
 	canvasPtr->flags |= BBOX_NOT_EMPTY;
     }
-    if (!(canvasPtr->flags & REDRAW_PENDING)) {
-	Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
-	canvasPtr->flags |= REDRAW_PENDING;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasAddDamage --
+ *
+ *	Adds a rectangle to the area of the canvas that needs redrawing.
+ *	The rectangle is included in the overall redraw bounding box and
+ *	in the list of damage rectangles, where it is merged with
+ *	neighbours according to DamageShouldMerge. If the list is full
+ *	the rectangle is merged with the entry that grows the least.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The redraw area and damage list of the canvas are updated.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CanvasAddDamage(
+    TkPathCanvas *canvasPtr,	/* Information about widget. */
+    int x1, int y1,		/* Upper left corner of area, included. */
+    int x2, int y2)		/* Lower right corner of area, not included. */
+{
+    TkPathCanvasDamage *rects = canvasPtr->damageRects;
+    TkPathCanvasDamage damage;
+    int i, j, best;
+    double growth, bestGrowth;
+
+    CanvasAddRedrawBbox(canvasPtr, x1, y1, x2, y2);
+
+    /*
+     * Only the visible part is of interest; huge items would otherwise
+     * swallow every other rectangle in the list.
+     */
+
+    damage.x1 = MAX(x1, canvasPtr->xOrigin);
+    damage.y1 = MAX(y1, canvasPtr->yOrigin);
+    damage.x2 = MIN(x2, canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin));
+    damage.y2 = MIN(y2, canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
+    if ((damage.x1 >= damage.x2) || (damage.y1 >= damage.y2)) {
+	return;
+    }
+
+    for (i = 0; i < canvasPtr->numDamageRects; i++) {
+	if (DamageShouldMerge(rects + i, &damage)) {
+	    break;
+	}
+    }
+    if (i == canvasPtr->numDamageRects) {
+	if (i < CANVAS_MAX_DAMAGE_RECTS) {
+	    rects[i] = damage;
+	    canvasPtr->numDamageRects++;
+	    return;
+	}
+	best = 0;
+	bestGrowth = 0.0;
+	for (i = 0; i < canvasPtr->numDamageRects; i++) {
+	    growth = DamageArea(MIN(rects[i].x1, damage.x1),
+		    MIN(rects[i].y1, damage.y1), MAX(rects[i].x2, damage.x2),
+		    MAX(rects[i].y2, damage.y2))
+		    - DamageArea(rects[i].x1, rects[i].y1,
+		    rects[i].x2, rects[i].y2);
+	    if ((i == 0) || (growth < bestGrowth)) {
+		best = i;
+		bestGrowth = growth;
+	    }
+	}
+	i = best;
+    }
+    DamageUnion(rects + i, &damage);
+
+    /*
+     * The grown rectangle may now qualify for merging with others.
+     */
+
+    for (j = 0; j < canvasPtr->numDamageRects; j++) {
+	if ((j != i) && DamageShouldMerge(rects + i, rects + j)) {
+	    DamageUnion(rects + i, rects + j);
+	    canvasPtr->numDamageRects--;
+	    rects[j] = rects[canvasPtr->numDamageRects];
+	    if (i == canvasPtr->numDamageRects) {
+		i = j;
+	    }
+	    j = -1;
+	}
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * Tk_PathCanvasEventuallyRedraw --
+ *
+ *	Arrange for part or all of a canvas widget to redrawn at some
+ *	convenient time in the future.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The screen will eventually be refreshed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+Tk_PathCanvasEventuallyRedraw(
+    Tk_PathCanvas canvas,	/* Information about widget. */
+    int x1, int y1,		/* Upper left corner of area to redraw. Pixels
+				 * on edge are redrawn. */
+    int x2, int y2)		/* Lower right corner of area to redraw.
+				 * Pixels on edge are not redrawn. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    Tk_Window tkwin = canvasPtr->tkwin;
+
+    if ((canvasPtr->flags & CANVAS_DELETED) || !Tk_IsMapped(tkwin)) {
+	return;
+    }
+    if ((x1 >= x2) || (y1 >= y2) ||
+ 	    (x2 < canvasPtr->xOrigin) || (y2 < canvasPtr->yOrigin) ||
+	    (x1 >= canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin)) ||
+	    (y1 >= canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin))) {
+	return;
+    }
+    CanvasAddDamage(canvasPtr, x1, y1, x2, y2);
+    CanvasScheduleRedraw(canvasPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ItemFreePathCache --
+ *
+ *	Drops the path retained by the drawing backend for an item
+ *	and its flattened path and edge trees used for hit testing.
+ *	Called whenever the item may have changed since the canvas
+ *	can't tell a change of geometry from any other change.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The paths are rebuilt from its atoms when next needed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ItemFreePathCache(
+    Tk_PathItem *itemPtr)
+{
+    if (itemPtr->pathCache != NULL) {
+	TkPathFreeRetainedPath(itemPtr->pathCache);
+	itemPtr->pathCache = NULL;
+    }
+    if (itemPtr->flatCache != NULL) {
+	ckfree((char *) itemPtr->flatCache);
+	itemPtr->flatCache = NULL;
+    }
+    if (itemPtr->edgeCache != NULL) {
+	TkPathFreeEdgeCache(itemPtr->edgeCache);
+	itemPtr->edgeCache = NULL;
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * EventuallyRedrawItem --
+ *
+ *	Arrange for part or all of a canvas widget to redrawn at some
+ *	convenient time in the future.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The screen will eventually be refreshed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+EventuallyRedrawItem(
+    Tk_PathCanvas canvas,		/* Information about widget. */
+    Tk_PathItem *itemPtr)		/* Item to be redrawn. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+
+    IndexMarkItem(canvasPtr, itemPtr);
+    ItemFreePathCache(itemPtr);
+    if ((itemPtr->x1 >= itemPtr->x2) || (itemPtr->y1 >= itemPtr->y2) ||
+ 	    (itemPtr->x2 < canvasPtr->xOrigin) ||
+	    (itemPtr->y2 < canvasPtr->yOrigin) ||
+	    (itemPtr->x1 >= canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin)) ||
+	    (itemPtr->y1 >= canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin))) {
+	if (!(itemPtr->typePtr->alwaysRedraw & 1)) {
+	    return;
+	}
+    }
+    if (!(itemPtr->redraw_flags & FORCE_REDRAW)) {
+	CanvasAddDamage(canvasPtr, itemPtr->x1, itemPtr->y1,
+		itemPtr->x2, itemPtr->y2);
+	itemPtr->redraw_flags |= FORCE_REDRAW;
+    }
+    SetAncestorsDirtyBbox(itemPtr);
+    CanvasScheduleRedraw(canvasPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ItemGeometryChanged --
+ *
+ *	Does what EventuallyRedrawItem does except for the redraw. Used
+ *	when an item has already asked for the parts of it that changed
+ *	to be redrawn.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The item is updated in the spatial index and its path caches
+ *	are dropped.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ItemGeometryChanged(
+    Tk_PathCanvas canvas,		/* Information about widget. */
+    Tk_PathItem *itemPtr)		/* Item that changed. */
+{
+    IndexMarkItem((TkPathCanvas *) canvas, itemPtr);
+    ItemFreePathCache(itemPtr);
+    SetAncestorsDirtyBbox(itemPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GroupItemConfigured --
+ *
+ *	Schedules all children of a group for redisplay in a recursive way.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A number of items scheduled for redisplay.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+GroupItemConfigured(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask)
+{
+    Tk_PathItem *walkPtr;
+    
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; walkPtr = walkPtr->nextPtr) {
+	EventuallyRedrawItem(canvas, walkPtr);
+	if (walkPtr->typePtr->bboxProc != NULL) {
+	    (*walkPtr->typePtr->bboxProc)(canvas, walkPtr, mask);
+	    /*
+	     * Only if the item responds to the bboxProc we need to redraw it.
+	     */
+	    EventuallyRedrawItem(canvas, walkPtr);
+	}
+	if (walkPtr->typePtr == &tkGroupType) {
+	    /*
+	     * Call ourself recursively for each group.
+	     * @@@ An alternative would be to have this call in the group's
+	     *     own bbox proc.
+	     */
+	    GroupItemConfigured(canvas, walkPtr, mask);
+	}
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * Tk_CreatePathItemType --
+ *
+ *	This function may be invoked to add a new kind of canvas element to
+ *	the core item types supported by Tk.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	From now on, the new item type will be useable in canvas widgets
+ *	(e.g. typePtr->name can be used as the item type in "create" widget
+ *	commands). If there was already a type with the same name as in
+ *	typePtr, it is replaced with the new type.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+Tk_CreatePathItemType(
+    Tk_PathItemType *typePtr)	/* Information about item type; storage must
+				 * be statically allocated (must live
+				 * forever). */
+{
+    Tk_PathItemType *typePtr2, *prevPtr;
+
+    if (typeList == NULL) {
+	InitCanvas();
+    }
+
+    /*
+     * If there's already an item type with the given name, remove it.
+     */
+
+    Tcl_MutexLock(&typeListMutex);
+    for (typePtr2 = typeList, prevPtr = NULL; typePtr2 != NULL;
+	    prevPtr = typePtr2, typePtr2 = typePtr2->nextPtr) {
+	if (strcmp(typePtr2->name, typePtr->name) == 0) {
+	    if (prevPtr == NULL) {
+		typeList = typePtr2->nextPtr;
+	    } else {
+		prevPtr->nextPtr = typePtr2->nextPtr;
+	    }
+	    break;
+	}
+    }
+    typePtr->nextPtr = typeList;
+    typeList = typePtr;
+    Tcl_MutexUnlock(&typeListMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tk_PathGetItemTypes --
+ *
+ *	This function returns a pointer to the list of all item types. Note
+ *	that this is inherently thread-unsafe, but since item types are only
+ *	ever registered very rarely this is unlikely to be a problem in
+ *	practice.
+ *
+ * Results:
+ *	The return value is a pointer to the first in the list of item types
+ *	currently supported by canvases.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tk_PathItemType *
+Tk_PathGetItemTypes(void)
+{
+    if (typeList == NULL) {
+	InitCanvas();
+    }
+    return typeList;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasSetParent --
+ *
+ *	Appends an item as the last sibling to a parent item.
+ *	May unlink any existing linkage.
+ *
+ * Results:
+ *	Standard tcl result.
+ *
+ * Side effects:
+ *	Links in item in display list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasSetParent(Tk_PathItem *parentPtr, Tk_PathItem *itemPtr)
+{
+
+    /*
+     * Unlink any present parent, then link in again.
+     */
+    if (itemPtr->parentPtr != NULL) {
+	TkPathCanvasItemDetach(itemPtr);
+    }
+    ItemAddToParent(parentPtr, itemPtr);
+    
+    /*
+     * Descendants of a moved group inherit from a new chain of parents.
+     */
+    if (itemPtr->typePtr == &tkGroupType) {
+	TkPathCanvasInheritedStyleChanged(itemPtr);
+    }
+    
+    /* 
+     * We may have configured -parent with a tag but need to return an id. 
+     */
+    itemPtr->parentObj = UnshareObj(itemPtr->parentObj);
+    Tcl_SetIntObj(itemPtr->parentObj, parentPtr->id);
+}
+
+void
+CanvasSetParentToRoot(Tk_PathItem *itemPtr)
+{
+    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *)itemPtr;
+    Tk_PathCanvas canvas = itemExPtr->canvas;
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    TkPathCanvasSetParent(canvasPtr->rootItemPtr, itemPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasFindGroup --
+ *
+ *	Searches for the first group item described by the tagOrId parentObj.
+ *
+ * Results:
+ *	Standard tcl result. parentPtrPtr filled in on success.
+ *
+ * Side effects:
+ *	Leaves any error result in interp.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkPathCanvasFindGroup(Tcl_Interp *interp, Tk_PathCanvas canvas, 
+	Tcl_Obj *parentObj, Tk_PathItem **parentPtrPtr)
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    Tk_PathItem *parentPtr;
+    int result = TCL_OK;
+    TagSearch *searchPtr = NULL;/* Allocated by first TagSearchScan, freed by
+				 * TagSearchDestroy */
+
+    if (parentObj != NULL) {
+        if ((result = TagSearchScan(canvasPtr, parentObj, &searchPtr)) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	parentPtr = TagSearchFirst(searchPtr);
+	if (parentPtr == NULL) {
+	    Tcl_AppendStringsToObj(Tcl_GetObjResult(interp), 
+		    "tag \"", Tcl_GetString(parentObj),
+		    "\" doesn't match any items", NULL);
+	    result = TCL_ERROR;
+	} else if (strcmp(parentPtr->typePtr->name, "group") != 0) {
+	    Tcl_AppendStringsToObj(Tcl_GetObjResult(interp), 
+		    "tag \"", Tcl_GetString(parentObj),
+		    "\" is not a group item", NULL);
+	    result = TCL_ERROR;
+	} else {
+	    *parentPtrPtr = parentPtr;
+	}
+	TagSearchDestroy(searchPtr);
+    }
+    return result;
+}
+
+void	    
+CanvasTranslateGroup(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+	double deltaX, double deltaY)
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    Tk_PathItem *walkPtr;
+
+    /*
+     * Invoke all its childs translateProc. Any child groups will call this
+     * function recursively.
+     */
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; walkPtr = walkPtr->nextPtr) {
+	EventuallyRedrawItem(canvas, walkPtr);
+	(void) (*walkPtr->typePtr->translateProc)(canvas, walkPtr, deltaX, deltaY);
+	EventuallyRedrawItem(canvas, walkPtr);
+	canvasPtr->flags |= REPICK_NEEDED;
+    }
+}
+
+void	    
+CanvasScaleGroup(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+	double originX, double originY, double scaleX, double scaleY)
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    Tk_PathItem *walkPtr;
+    
+    /*
+     * Invoke all its childs scaleProc. Any child groups will call this
+     * function recursively.
+     */
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; walkPtr = walkPtr->nextPtr) {
+	EventuallyRedrawItem(canvas, walkPtr);
+	(void) (*walkPtr->typePtr->scaleProc)(canvas, walkPtr, 
+		originX, originY, scaleX, scaleY);
+	EventuallyRedrawItem(canvas, walkPtr);
+	canvasPtr->flags |= REPICK_NEEDED;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetAncestorsDirtyBbox --
+ *
+ *	Used by items when they need a redisplay for some reason
+ *	so that its ancestor groups know that they need to compute
+ *	a new bbox when requested.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Groups get their dirty bbox flag set.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SetAncestorsDirtyBbox(Tk_PathItem *itemPtr)
+{
+    Tk_PathItem *walkPtr;
+
+    walkPtr = itemPtr->parentPtr;
+    while (walkPtr != NULL) {
+	TkPathCanvasSetGroupDirtyBbox(walkPtr);
+	walkPtr = walkPtr->parentPtr;
+    }
+}
+
+void
+TkPathCanvasGroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+	int *x1Ptr, int *y1Ptr, int *x2Ptr, int *y2Ptr)
+{
+    int gotAny = 0;
+    Tk_PathItem *walkPtr;
+    int x1 = -1, y1 = -1, x2 = -1, y2 = -1;
+   
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; 
+	    walkPtr = walkPtr->nextPtr) {
+
+	/* 
+	 * Make sure sub groups have its bbox updated. 
+	 * We may be called recursively.
+	 */
+	if (walkPtr->firstChildPtr != NULL) {
+	    TkPathCanvasUpdateGroupBbox(canvas, walkPtr);
+	}
+	if ((walkPtr->x1 >= walkPtr->x2)
+		|| (walkPtr->y1 >= walkPtr->y2)) {
+	    continue;
+	}
+	if (!gotAny) {
+	    x1 = walkPtr->x1;
+	    y1 = walkPtr->y1;
+	    x2 = walkPtr->x2;
+	    y2 = walkPtr->y2;
+	    gotAny = 1;
+	} else {
+	    if (walkPtr->x1 < x1) { x1 = walkPtr->x1; }
+	    if (walkPtr->y1 < y1) { y1 = walkPtr->y1; }
+	    if (walkPtr->x2 > x2) { x2 = walkPtr->x2; }
+	    if (walkPtr->y2 > y2) { y2 = walkPtr->y2; }
+	}
+    }
+    *x1Ptr = x1, *y1Ptr = y1, *x2Ptr = x2, *y2Ptr = y2;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IndexInit, IndexFree --
+ *
+ *	Set up and tear down the spatial index of a canvas. The items
+ *	themselves are not touched by IndexFree.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory allocated or freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+IndexInit(
+    TkPathCanvasIndex *indexPtr)
+{
+    Tcl_InitHashTable(&indexPtr->cells, 2);
+    indexPtr->bigItems = NULL;
+    indexPtr->numBigItems = 0;
+    indexPtr->bigItemsSpace = 0;
+    indexPtr->dirtyItems = NULL;
+    indexPtr->numDirtyItems = 0;
+    indexPtr->dirtyItemsSpace = 0;
+    indexPtr->numItems = 0;
+    indexPtr->x1 = indexPtr->y1 = 0;
+    indexPtr->x2 = indexPtr->y2 = 0;
+    indexPtr->stamp = 0;
+    indexPtr->orderValid = 0;
+    indexPtr->maxZOrder = 0;
+}
+
+static void
+IndexFree(
+    TkPathCanvasIndex *indexPtr)
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    IndexCell *cellPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&indexPtr->cells, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+	ckfree((char *) cellPtr->items);
+	ckfree((char *) cellPtr);
+    }
+    Tcl_DeleteHashTable(&indexPtr->cells);
+    if (indexPtr->bigItems != NULL) {
+	ckfree((char *) indexPtr->bigItems);
+    }
+    if (indexPtr->dirtyItems != NULL) {
+	ckfree((char *) indexPtr->dirtyItems);
     }
 }
 
 /*
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * EventuallyRedrawItem --
+ * IndexCellCoord --
  *
- *	Arrange for part or all of a canvas widget to redrawn at some
- *	convenient time in the future.
+ *	Maps a canvas coordinate to the cell containing it.
  *
  * Results:
- *	None.
+ *	The cell coordinate, rounded towards minus infinity.
  *
  * Side effects:
- *	The screen will eventually be refreshed.
+ *	None.
  *
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  */
 
-static void
-EventuallyRedrawItem(
-    Tk_PathCanvas canvas,		/* Information about widget. */
-    Tk_PathItem *itemPtr)		/* Item to be redrawn. */
+static int
+IndexCellCoord(
+    int c)
 {
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
-    if ((itemPtr->x1 >= itemPtr->x2) || (itemPtr->y1 >= itemPtr->y2) ||
- 	    (itemPtr->x2 < canvasPtr->xOrigin) ||
-	    (itemPtr->y2 < canvasPtr->yOrigin) ||
-	    (itemPtr->x1 >= canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin)) ||
-	    (itemPtr->y1 >= canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin))) {
-	if (!(itemPtr->typePtr->alwaysRedraw & 1)) {
-	    return;
-	}
-    }
-    if (!(itemPtr->redraw_flags & FORCE_REDRAW)) {
-	if (canvasPtr->flags & BBOX_NOT_EMPTY) {
-	    if (itemPtr->x1 <= canvasPtr->redrawX1) {
-		canvasPtr->redrawX1 = itemPtr->x1;
-	    }
-	    if (itemPtr->y1 <= canvasPtr->redrawY1) {
-		canvasPtr->redrawY1 = itemPtr->y1;
-	    }
-	    if (itemPtr->x2 >= canvasPtr->redrawX2) {
-		canvasPtr->redrawX2 = itemPtr->x2;
-	    }
-	    if (itemPtr->y2 >= canvasPtr->redrawY2) {
-		canvasPtr->redrawY2 = itemPtr->y2;
-	    }
-	} else {
-	    canvasPtr->redrawX1 = itemPtr->x1;
-	    canvasPtr->redrawY1 = itemPtr->y1;
-	    canvasPtr->redrawX2 = itemPtr->x2;
-	    canvasPtr->redrawY2 = itemPtr->y2;
-	    canvasPtr->flags |= BBOX_NOT_EMPTY;
-	}
-	itemPtr->redraw_flags |= FORCE_REDRAW;
-    }
-    SetAncestorsDirtyBbox(itemPtr);
-    if (!(canvasPtr->flags & REDRAW_PENDING)) {
-	Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
-	canvasPtr->flags |= REDRAW_PENDING;
+    if (c >= 0) {
+	return MIN(c, INDEX_COORD_MAX) >> INDEX_CELL_SHIFT;
     }
+    c = MAX(c, -INDEX_COORD_MAX);
+    return -((-c - 1) >> INDEX_CELL_SHIFT) - 1;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * GroupItemConfigured --
+ * IndexAddToArray, IndexRemoveFromArray --
  *
- *	Schedules all children of a group for redisplay in a recursive way.
+ *	Append an item to a growable array of items, or remove it by
+ *	moving the last item into its place.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	A number of items scheduled for redisplay.
+ *	Memory may be (re)allocated.
  *
  *----------------------------------------------------------------------
  */
 
-void
-GroupItemConfigured(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask)
+static void
+IndexAddToArray(
+    Tk_PathItem ***arrayPtr,
+    int *numPtr,
+    int *spacePtr,
+    Tk_PathItem *itemPtr)
 {
-    Tk_PathItem *walkPtr;
-    
-    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; walkPtr = walkPtr->nextPtr) {
-	EventuallyRedrawItem(canvas, walkPtr);
-	if (walkPtr->typePtr->bboxProc != NULL) {
-	    (*walkPtr->typePtr->bboxProc)(canvas, walkPtr, mask);
-	    /*
-	     * Only if the item responds to the bboxProc we need to redraw it.
-	     */
-	    EventuallyRedrawItem(canvas, walkPtr);
-	}
-	if (walkPtr->typePtr == &tkGroupType) {
-	    /*
-	     * Call ourself recursively for each group.
-	     * @@@ An alternative would be to have this call in the group's
-	     *     own bbox proc.
-	     */
-	    GroupItemConfigured(canvas, walkPtr, mask);
+    if (*numPtr >= *spacePtr) {
+	*spacePtr = (*spacePtr == 0) ? 4 : 2 * (*spacePtr);
+	*arrayPtr = (Tk_PathItem **) ckrealloc((char *) *arrayPtr,
+		(unsigned) (*spacePtr * sizeof(Tk_PathItem *)));
+    }
+    (*arrayPtr)[(*numPtr)++] = itemPtr;
+}
+
+static void
+IndexRemoveFromArray(
+    Tk_PathItem **array,
+    int *numPtr,
+    Tk_PathItem *itemPtr)
+{
+    int i;
+
+    for (i = 0; i < *numPtr; i++) {
+	if (array[i] == itemPtr) {
+	    array[i] = array[--(*numPtr)];
+	    return;
 	}
     }
 }
 
 /*
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * Tk_CreatePathItemType --
+ * IndexFileItem, IndexUnfileItem --
  *
- *	This function may be invoked to add a new kind of canvas element to
- *	the core item types supported by Tk.
+ *	File an item in the spatial index under its current bounding box,
+ *	or take it out again using the bounding box it was filed under.
+ *	Items with inverted bboxes, items spanning too many cells and
+ *	items that must always be redrawn go into the list of big items.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	From now on, the new item type will be useable in canvas widgets
- *	(e.g. typePtr->name can be used as the item type in "create" widget
- *	commands). If there was already a type with the same name as in
- *	typePtr, it is replaced with the new type.
+ *	The index is updated.
  *
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  */
 
-void
-Tk_CreatePathItemType(
-    Tk_PathItemType *typePtr)	/* Information about item type; storage must
-				 * be statically allocated (must live
-				 * forever). */
+static void
+IndexFileItem(
+    TkPathCanvasIndex *indexPtr,
+    Tk_PathItem *itemPtr)
 {
-    Tk_PathItemType *typePtr2, *prevPtr;
-
-    if (typeList == NULL) {
-	InitCanvas();
+    int key[2], cx1, cy1, cx2, cy2, isNew;
+    Tcl_HashEntry *hPtr;
+    IndexCell *cellPtr;
+
+    itemPtr->indexX1 = itemPtr->x1;
+    itemPtr->indexY1 = itemPtr->y1;
+    itemPtr->indexX2 = itemPtr->x2;
+    itemPtr->indexY2 = itemPtr->y2;
+    if (indexPtr->numItems == 0) {
+	indexPtr->x1 = itemPtr->x1;
+	indexPtr->y1 = itemPtr->y1;
+	indexPtr->x2 = itemPtr->x2;
+	indexPtr->y2 = itemPtr->y2;
+    } else {
+	indexPtr->x1 = MIN(indexPtr->x1, itemPtr->x1);
+	indexPtr->y1 = MIN(indexPtr->y1, itemPtr->y1);
+	indexPtr->x2 = MAX(indexPtr->x2, itemPtr->x2);
+	indexPtr->y2 = MAX(indexPtr->y2, itemPtr->y2);
     }
+    indexPtr->numItems++;
 
     /*
-     * If there's already an item type with the given name, remove it.
+     * The bbox tests used by callers let a degenerate bbox through when
+     * its point is inside the area, so such items are filed in the cell
+     * of that point.
      */
 
-    Tcl_MutexLock(&typeListMutex);
-    for (typePtr2 = typeList, prevPtr = NULL; typePtr2 != NULL;
-	    prevPtr = typePtr2, typePtr2 = typePtr2->nextPtr) {
-	if (strcmp(typePtr2->name, typePtr->name) == 0) {
-	    if (prevPtr == NULL) {
-		typeList = typePtr2->nextPtr;
+    cx1 = IndexCellCoord(itemPtr->x1);
+    cy1 = IndexCellCoord(itemPtr->y1);
+    cx2 = IndexCellCoord(MAX(itemPtr->x2 - 1, itemPtr->x1));
+    cy2 = IndexCellCoord(MAX(itemPtr->y2 - 1, itemPtr->y1));
+    if ((itemPtr->x2 < itemPtr->x1) || (itemPtr->y2 < itemPtr->y1)
+	    || (itemPtr->typePtr->alwaysRedraw & 1)
+	    || ((double) (cx2 - cx1 + 1) * (double) (cy2 - cy1 + 1)
+		> INDEX_MAX_CELLS)) {
+	IndexAddToArray(&indexPtr->bigItems, &indexPtr->numBigItems,
+		&indexPtr->bigItemsSpace, itemPtr);
+	itemPtr->indexFlags = INDEX_IN_BIG;
+	return;
+    }
+    for (key[1] = cy1; key[1] <= cy2; key[1]++) {
+	for (key[0] = cx1; key[0] <= cx2; key[0]++) {
+	    hPtr = Tcl_CreateHashEntry(&indexPtr->cells, (char *) key,
+		    &isNew);
+	    if (isNew) {
+		cellPtr = (IndexCell *) ckalloc(sizeof(IndexCell));
+		cellPtr->numItems = 0;
+		cellPtr->space = 0;
+		cellPtr->items = NULL;
+		Tcl_SetHashValue(hPtr, cellPtr);
 	    } else {
-		prevPtr->nextPtr = typePtr2->nextPtr;
+		cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
 	    }
-	    break;
+	    IndexAddToArray(&cellPtr->items, &cellPtr->numItems,
+		    &cellPtr->space, itemPtr);
 	}
     }
-    typePtr->nextPtr = typeList;
-    typeList = typePtr;
-    Tcl_MutexUnlock(&typeListMutex);
+    itemPtr->indexFlags = INDEX_IN_CELLS;
+}
+
+static void
+IndexUnfileItem(
+    TkPathCanvasIndex *indexPtr,
+    Tk_PathItem *itemPtr)
+{
+    int key[2], cx1, cy1, cx2, cy2;
+    Tcl_HashEntry *hPtr;
+    IndexCell *cellPtr;
+
+    if (itemPtr->indexFlags & INDEX_IN_BIG) {
+	IndexRemoveFromArray(indexPtr->bigItems, &indexPtr->numBigItems,
+		itemPtr);
+    } else if (itemPtr->indexFlags & INDEX_IN_CELLS) {
+	cx1 = IndexCellCoord(itemPtr->indexX1);
+	cy1 = IndexCellCoord(itemPtr->indexY1);
+	cx2 = IndexCellCoord(MAX(itemPtr->indexX2 - 1, itemPtr->indexX1));
+	cy2 = IndexCellCoord(MAX(itemPtr->indexY2 - 1, itemPtr->indexY1));
+	for (key[1] = cy1; key[1] <= cy2; key[1]++) {
+	    for (key[0] = cx1; key[0] <= cx2; key[0]++) {
+		hPtr = Tcl_FindHashEntry(&indexPtr->cells, (char *) key);
+		if (hPtr == NULL) {
+		    continue;
+		}
+		cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+		IndexRemoveFromArray(cellPtr->items, &cellPtr->numItems,
+			itemPtr);
+		if (cellPtr->numItems == 0) {
+		    ckfree((char *) cellPtr->items);
+		    ckfree((char *) cellPtr);
+		    Tcl_DeleteHashEntry(hPtr);
+		}
+	    }
+	}
+    } else {
+	return;
+    }
+    itemPtr->indexFlags = 0;
+    indexPtr->numItems--;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * Tk_PathGetItemTypes --
+ * IndexMarkItem, TkPathCanvasItemBboxChanged --
  *
- *	This function returns a pointer to the list of all item types. Note
- *	that this is inherently thread-unsafe, but since item types are only
- *	ever registered very rarely this is unlikely to be a problem in
- *	practice.
+ *	Tell the spatial index that the bounding box of an item may have
+ *	changed. The item is refiled before the next search. Canvas code
+ *	does this in EventuallyRedrawItem; item code only needs to call
+ *	TkPathCanvasItemBboxChanged if it recomputes its bbox on its own,
+ *	for instance when an image changes size.
  *
  * Results:
- *	The return value is a pointer to the first in the list of item types
- *	currently supported by canvases.
+ *	None.
  *
  * Side effects:
- *	None.
+ *	The item is queued for refiling.
  *
  *----------------------------------------------------------------------
  */
 
-Tk_PathItemType *
-Tk_PathGetItemTypes(void)
+static void
+IndexMarkItem(
+    TkPathCanvas *canvasPtr,
+    Tk_PathItem *itemPtr)
 {
-    if (typeList == NULL) {
-	InitCanvas();
+    TkPathCanvasIndex *indexPtr = &canvasPtr->index;
+
+    if ((itemPtr->indexSlot >= 0) || (itemPtr->typePtr == &tkGroupType)) {
+	return;
     }
-    return typeList;
+    itemPtr->indexSlot = indexPtr->numDirtyItems;
+    IndexAddToArray(&indexPtr->dirtyItems, &indexPtr->numDirtyItems,
+	    &indexPtr->dirtyItemsSpace, itemPtr);
+}
+
+void
+TkPathCanvasItemBboxChanged(
+    Tk_PathCanvas canvas,
+    Tk_PathItem *itemPtr)
+{
+    IndexMarkItem((TkPathCanvas *) canvas, itemPtr);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * TkPathCanvasSetParent --
+ * IndexRemoveItem --
  *
- *	Appends an item as the last sibling to a parent item.
- *	May unlink any existing linkage.
+ *	Removes an item that is about to be deleted from the spatial index.
  *
  * Results:
- *	Standard tcl result.
+ *	None.
  *
  * Side effects:
- *	Links in item in display list.
+ *	The index no longer refers to the item.
  *
  *----------------------------------------------------------------------
  */
 
-void
-TkPathCanvasSetParent(Tk_PathItem *parentPtr, Tk_PathItem *itemPtr)
+static void
+IndexRemoveItem(
+    TkPathCanvas *canvasPtr,
+    Tk_PathItem *itemPtr)
 {
+    TkPathCanvasIndex *indexPtr = &canvasPtr->index;
 
-    /*
-     * Unlink any present parent, then link in again.
-     */
-    if (itemPtr->parentPtr != NULL) {
-	TkPathCanvasItemDetach(itemPtr);
+    if (itemPtr->indexSlot >= 0) {
+	indexPtr->dirtyItems[itemPtr->indexSlot] = NULL;
+	itemPtr->indexSlot = -1;
     }
-    ItemAddToParent(parentPtr, itemPtr);
-    
-    /* 
-     * We may have configured -parent with a tag but need to return an id. 
-     */
-    itemPtr->parentObj = UnshareObj(itemPtr->parentObj);
-    Tcl_SetIntObj(itemPtr->parentObj, parentPtr->id);
-}
-
-void
-CanvasSetParentToRoot(Tk_PathItem *itemPtr)
-{
-    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *)itemPtr;
-    Tk_PathCanvas canvas = itemExPtr->canvas;
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
-    TkPathCanvasSetParent(canvasPtr->rootItemPtr, itemPtr);
+    IndexUnfileItem(indexPtr, itemPtr);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * TkPathCanvasFindGroup --
+ * IndexItemLinked --
  *
- *	Searches for the first group item described by the tagOrId parentObj.
+ *	Called when an item has been linked into the display list. If it
+ *	went to the end of the root group it simply gets the next zOrder,
+ *	otherwise the order of all items is recomputed before the next
+ *	search. Unlinking doesn't disturb the order of the other items.
  *
  * Results:
- *	Standard tcl result. parentPtrPtr filled in on success.
+ *	None.
  *
  * Side effects:
- *	Leaves any error result in interp.
+ *	zOrder updated or the order marked invalid.
  *
  *----------------------------------------------------------------------
  */
 
-int
-TkPathCanvasFindGroup(Tcl_Interp *interp, Tk_PathCanvas canvas, 
-	Tcl_Obj *parentObj, Tk_PathItem **parentPtrPtr)
+static void
+IndexItemLinked(
+    Tk_PathItem *itemPtr)
 {
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
-    Tk_PathItem *parentPtr;
-    int result = TCL_OK;
-    TagSearch *searchPtr = NULL;/* Allocated by first TagSearchScan, freed by
-				 * TagSearchDestroy */
-
-    if (parentObj != NULL) {
-        if ((result = TagSearchScan(canvasPtr, parentObj, &searchPtr)) != TCL_OK) {
-	    return TCL_ERROR;
-	}
-	parentPtr = TagSearchFirst(searchPtr);
-	if (parentPtr == NULL) {
-	    Tcl_AppendStringsToObj(Tcl_GetObjResult(interp), 
-		    "tag \"", Tcl_GetString(parentObj),
-		    "\" doesn't match any items", NULL);
-	    result = TCL_ERROR;
-	} else if (strcmp(parentPtr->typePtr->name, "group") != 0) {
-	    Tcl_AppendStringsToObj(Tcl_GetObjResult(interp), 
-		    "tag \"", Tcl_GetString(parentObj),
-		    "\" is not a group item", NULL);
-	    result = TCL_ERROR;
-	} else {
-	    *parentPtrPtr = parentPtr;
-	}
-	TagSearchDestroy(searchPtr);
+    Tk_PathItemEx *parentExPtr = (Tk_PathItemEx *) itemPtr->parentPtr;
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) parentExPtr->canvas;
+    TkPathCanvasIndex *indexPtr = &canvasPtr->index;
+
+    if (indexPtr->orderValid && (itemPtr->firstChildPtr == NULL)
+	    && (itemPtr->parentPtr == canvasPtr->rootItemPtr)
+	    && (itemPtr->nextPtr == NULL)) {
+	itemPtr->zOrder = ++indexPtr->maxZOrder;
+    } else {
+	indexPtr->orderValid = 0;
     }
-    return result;
 }
 
-void	    
-CanvasTranslateGroup(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
-	double deltaX, double deltaY)
-{
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
-    Tk_PathItem *walkPtr;
-
-    /*
-     * Invoke all its childs translateProc. Any child groups will call this
-     * function recursively.
-     */
-    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; walkPtr = walkPtr->nextPtr) {
-	EventuallyRedrawItem(canvas, walkPtr);
-	(void) (*walkPtr->typePtr->translateProc)(canvas, walkPtr, deltaX, deltaY);
-	EventuallyRedrawItem(canvas, walkPtr);
-	canvasPtr->flags |= REPICK_NEEDED;
-    }
-}
+/*
+ *----------------------------------------------------------------------
+ *
+ * IndexUpdate --
+ *
+ *	Brings the spatial index up to date before a search: refiles all
+ *	queued items and renumbers the display list if needed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The index is updated.
+ *
+ *----------------------------------------------------------------------
+ */
 
-void	    
-CanvasScaleGroup(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
-	double originX, double originY, double scaleX, double scaleY)
+static void
+IndexUpdate(
+    TkPathCanvas *canvasPtr)
 {
-    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
-    Tk_PathItem *walkPtr;
-    
-    /*
-     * Invoke all its childs scaleProc. Any child groups will call this
-     * function recursively.
-     */
-    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; walkPtr = walkPtr->nextPtr) {
-	EventuallyRedrawItem(canvas, walkPtr);
-	(void) (*walkPtr->typePtr->scaleProc)(canvas, walkPtr, 
-		originX, originY, scaleX, scaleY);
-	EventuallyRedrawItem(canvas, walkPtr);
-	canvasPtr->flags |= REPICK_NEEDED;
+    TkPathCanvasIndex *indexPtr = &canvasPtr->index;
+    Tk_PathItem *itemPtr;
+    int i, z;
+
+    for (i = 0; i < indexPtr->numDirtyItems; i++) {
+	itemPtr = indexPtr->dirtyItems[i];
+	if (itemPtr == NULL) {
+	    continue;
+	}
+	itemPtr->indexSlot = -1;
+	IndexUnfileItem(indexPtr, itemPtr);
+	IndexFileItem(indexPtr, itemPtr);
+    }
+    indexPtr->numDirtyItems = 0;
+
+    if (!indexPtr->orderValid) {
+	z = 0;
+	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
+		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+	    itemPtr->zOrder = z++;
+	}
+	indexPtr->maxZOrder = z;
+	indexPtr->orderValid = 1;
     }
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * SetAncestorsDirtyBbox --
+ * IndexSearchFirst, IndexSearchNext, IndexSearchDone --
  *
- *	Used by items when they need a redisplay for some reason
- *	so that its ancestor groups know that they need to compute
- *	a new bbox when requested.
+ *	Iterate, in display list order, over the items whose bbox may
+ *	overlap the area x1, y1, x2, y2 (all included). Callers must still
+ *	test each item's bbox. Groups are never returned since they neither
+ *	draw nor are found themselves, except when the search falls back
+ *	to walking the whole display list because the area covers most of
+ *	the items anyway. IndexSearchDone must be called when done.
  *
  * Results:
- *	None.
+ *	The first or next item, or NULL when there are no more.
  *
  * Side effects:
- *	Groups get their dirty bbox flag set.
+ *	The index is brought up to date by IndexSearchFirst.
  *
  *----------------------------------------------------------------------
  */
 
+static int
+IndexCompareItems(
+    const void *a,
+    const void *b)
+{
+    return (*(Tk_PathItem **) a)->zOrder - (*(Tk_PathItem **) b)->zOrder;
+}
+
 static void
-SetAncestorsDirtyBbox(Tk_PathItem *itemPtr)
+IndexSearchAdd(
+    TkPathCanvasIndex *indexPtr,
+    IndexSearch *searchPtr,
+    Tk_PathItem **items,
+    int numItems)
 {
-    Tk_PathItem *walkPtr;
+    int i;
 
-    walkPtr = itemPtr->parentPtr;
-    while (walkPtr != NULL) {
-	TkPathCanvasSetGroupDirtyBbox(walkPtr);
-	walkPtr = walkPtr->parentPtr;
+    for (i = 0; i < numItems; i++) {
+	if (items[i]->indexStamp == indexPtr->stamp) {
+	    continue;
+	}
+	items[i]->indexStamp = indexPtr->stamp;
+	if (searchPtr->numItems >= searchPtr->space) {
+	    searchPtr->space *= 2;
+	    if (searchPtr->items == searchPtr->staticItems) {
+		searchPtr->items = (Tk_PathItem **) ckalloc((unsigned)
+			(searchPtr->space * sizeof(Tk_PathItem *)));
+		memcpy(searchPtr->items, searchPtr->staticItems,
+			INDEX_STATIC_ITEMS * sizeof(Tk_PathItem *));
+	    } else {
+		searchPtr->items = (Tk_PathItem **) ckrealloc(
+			(char *) searchPtr->items, (unsigned)
+			(searchPtr->space * sizeof(Tk_PathItem *)));
+	    }
+	}
+	searchPtr->items[searchPtr->numItems++] = items[i];
     }
 }
 
-void
-TkPathCanvasGroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
-	int *x1Ptr, int *y1Ptr, int *x2Ptr, int *y2Ptr)
+static Tk_PathItem *
+IndexSearchFirst(
+    TkPathCanvas *canvasPtr,	/* Canvas to search. */
+    IndexSearch *searchPtr,	/* Record describing search. */
+    int x1, int y1,		/* Area of interest, in integer canvas */
+    int x2, int y2)		/* coordinates. */
 {
-    int gotAny = 0;
-    Tk_PathItem *walkPtr;
-    int x1 = -1, y1 = -1, x2 = -1, y2 = -1;
-   
-    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL; 
-	    walkPtr = walkPtr->nextPtr) {
-
-	/* 
-	 * Make sure sub groups have its bbox updated. 
-	 * We may be called recursively.
-	 */
-	if (walkPtr->firstChildPtr != NULL) {
-	    TkPathCanvasUpdateGroupBbox(canvas, walkPtr);
-	}
-	if ((walkPtr->x1 >= walkPtr->x2)
-		|| (walkPtr->y1 >= walkPtr->y2)) {
-	    continue;
+    TkPathCanvasIndex *indexPtr = &canvasPtr->index;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    IndexCell *cellPtr;
+    int key[2], *keyPtr, cx1, cy1, cx2, cy2;
+
+    IndexUpdate(canvasPtr);
+    searchPtr->all = 0;
+    searchPtr->next = 0;
+    searchPtr->numItems = 0;
+    searchPtr->space = INDEX_STATIC_ITEMS;
+    searchPtr->items = searchPtr->staticItems;
+    indexPtr->stamp++;
+
+    cx1 = IndexCellCoord(x1);
+    cy1 = IndexCellCoord(y1);
+    cx2 = IndexCellCoord(x2);
+    cy2 = IndexCellCoord(y2);
+    if ((double) (cx2 - cx1 + 1) * (double) (cy2 - cy1 + 1)
+	    <= indexPtr->cells.numEntries) {
+	for (key[1] = cy1; key[1] <= cy2; key[1]++) {
+	    for (key[0] = cx1; key[0] <= cx2; key[0]++) {
+		hPtr = Tcl_FindHashEntry(&indexPtr->cells, (char *) key);
+		if (hPtr != NULL) {
+		    cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+		    IndexSearchAdd(indexPtr, searchPtr, cellPtr->items,
+			    cellPtr->numItems);
+		}
+	    }
 	}
-	if (!gotAny) {
-	    x1 = walkPtr->x1;
-	    y1 = walkPtr->y1;
-	    x2 = walkPtr->x2;
-	    y2 = walkPtr->y2;
-	    gotAny = 1;
-	} else {
-	    if (walkPtr->x1 < x1) { x1 = walkPtr->x1; }
-	    if (walkPtr->y1 < y1) { y1 = walkPtr->y1; }
-	    if (walkPtr->x2 > x2) { x2 = walkPtr->x2; }
-	    if (walkPtr->y2 > y2) { y2 = walkPtr->y2; }
+    } else {
+	/*
+	 * Fewer cells are in use than the area covers.
+	 */
+
+	for (hPtr = Tcl_FirstHashEntry(&indexPtr->cells, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    keyPtr = (int *) Tcl_GetHashKey(&indexPtr->cells, hPtr);
+	    if ((keyPtr[0] >= cx1) && (keyPtr[0] <= cx2)
+		    && (keyPtr[1] >= cy1) && (keyPtr[1] <= cy2)) {
+		cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+		IndexSearchAdd(indexPtr, searchPtr, cellPtr->items,
+			cellPtr->numItems);
+	    }
 	}
     }
-    *x1Ptr = x1, *y1Ptr = y1, *x2Ptr = x2, *y2Ptr = y2;
+    IndexSearchAdd(indexPtr, searchPtr, indexPtr->bigItems,
+	    indexPtr->numBigItems);
+
+    /*
+     * Sorting most of the items costs more than walking the display list.
+     */
+
+    if (searchPtr->numItems > INDEX_STATIC_ITEMS
+	    && searchPtr->numItems > indexPtr->numItems / 2) {
+	searchPtr->all = 1;
+	return canvasPtr->rootItemPtr;
+    }
+    qsort(searchPtr->items, (size_t) searchPtr->numItems,
+	    sizeof(Tk_PathItem *), IndexCompareItems);
+    return IndexSearchNext(searchPtr, NULL);
+}
+
+static Tk_PathItem *
+IndexSearchNext(
+    IndexSearch *searchPtr,	/* Record describing search. */
+    Tk_PathItem *itemPtr)	/* Item last returned. */
+{
+    if (searchPtr->all) {
+	return TkPathCanvasItemIteratorNext(itemPtr);
+    }
+    if (searchPtr->next >= searchPtr->numItems) {
+	return NULL;
+    }
+    return searchPtr->items[searchPtr->next++];
+}
+
+static void
+IndexSearchDone(
+    IndexSearch *searchPtr)	/* Record describing search. */
+{
+    if (searchPtr->items != searchPtr->staticItems) {
+	ckfree((char *) searchPtr->items);
+    }
+    searchPtr->items = searchPtr->staticItems;
 }
 
 /*
@@ -3239,7 +4951,8 @@ InitCanvas(void)
     tkPrectType.nextPtr = &tkPlineType;
     tkPlineType.nextPtr = &tkPolylineType;
     tkPolylineType.nextPtr = &tkPpolygonType;
-    tkPpolygonType.nextPtr = &tkCircleType;
+    tkPpolygonType.nextPtr = &tkTraceType;
+    tkTraceType.nextPtr = &tkCircleType;
     tkCircleType.nextPtr = &tkEllipseType;
     tkEllipseType.nextPtr = &tkPimageType;
     tkPimageType.nextPtr = &tkPtextType;
@@ -3294,6 +5007,13 @@ ItemCreate(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
     itemPtr->prevPtr = NULL;
     itemPtr->firstChildPtr = NULL;
     itemPtr->lastChildPtr = NULL;
+    itemPtr->indexFlags = 0;
+    itemPtr->indexSlot = -1;
+    itemPtr->indexStamp = 0;
+    itemPtr->zOrder = 0;
+    itemPtr->pathCache = NULL;
+    itemPtr->flatCache = NULL;
+    itemPtr->edgeCache = NULL;
     
     /* 
      * This is just to be able to detect if createProc processes
@@ -3323,6 +5043,7 @@ ItemCreate(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
 	ItemAddToParent(canvasPtr->rootItemPtr, itemPtr);
     }
     itemPtr->redraw_flags |= FORCE_REDRAW;
+    IndexMarkItem(canvasPtr, itemPtr);
     *itemPtrPtr = itemPtr;
     
     return TCL_OK;
@@ -3509,6 +5230,7 @@ ItemAddToParent(Tk_PathItem *parentPtr, Tk_PathItem *itemPtr)
     }
     parentPtr->lastChildPtr = itemPtr;
     itemPtr->parentPtr = parentPtr;
+    IndexItemLinked(itemPtr);
 }
 
 /*
@@ -3580,6 +5302,8 @@ ItemDelete(TkPathCanvas *canvasPtr, Tk_PathItem *itemPtr)
 	    || (itemPtr == canvasPtr->hotPrevPtr)) {
 	canvasPtr->hotPtr = NULL;
     }
+    IndexRemoveItem(canvasPtr, itemPtr);
+    ItemFreePathCache(itemPtr);
     ckfree((char *) itemPtr);
 }
 
@@ -5018,6 +6742,11 @@ FindItems(
 		startPtr = itemPtr;
 	    }
 	}
+	if ((startPtr == canvasPtr->rootItemPtr)
+		&& FindClosestInIndex(canvasPtr, coords, halo, &closestPtr)) {
+	    DoItem(interp, closestPtr, uid);
+	    return TCL_OK;
+	}
 
 	/*
 	 * The code below is optimized so that it can eliminate most items
@@ -5157,6 +6886,7 @@ FindArea(
     double rect[4], tmp;
     int x1, y1, x2, y2;
     Tk_PathItem *itemPtr;
+    IndexSearch search;
 
     if ((Tk_PathCanvasGetCoordFromObj(interp, (Tk_PathCanvas) canvasPtr, objv[0],
 		&rect[0]) != TCL_OK)
@@ -5184,8 +6914,8 @@ FindArea(
     y1 = (int) (rect[1]-1.0);
     x2 = (int) (rect[2]+1.0);
     y2 = (int) (rect[3]+1.0);
-    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+    for (itemPtr = IndexSearchFirst(canvasPtr, &search, x1, y1, x2, y2);
+	    itemPtr != NULL; itemPtr = IndexSearchNext(&search, itemPtr)) {
 	if (itemPtr->state == TK_PATHSTATE_HIDDEN || (itemPtr->state == TK_PATHSTATE_NULL &&
 		canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
 	    continue;
@@ -5199,9 +6929,107 @@ FindArea(
 	    DoItem(interp, itemPtr, uid);
 	}
     }
+    IndexSearchDone(&search);
     return TCL_OK;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * FindClosestInIndex --
+ *
+ *	Implements "find closest" without a start item using the spatial
+ *	index. Items are searched within a square around the point that is
+ *	doubled until it is known to contain the closest item. Like the
+ *	full search, the topmost of several equally close items wins.
+ *
+ * Results:
+ *	1 and the closest item in *closestPtrPtr, or 0 if the caller must
+ *	do a full search instead.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+FindClosestInIndex(
+    TkPathCanvas *canvasPtr,	/* Canvas whose items are to be searched. */
+    double coords[2],		/* Point, in canvas coordinates. */
+    double halo,		/* Distances are decreased by this. */
+    Tk_PathItem **closestPtrPtr)/* Returns the closest item. */
+{
+    TkPathCanvasIndex *indexPtr = &canvasPtr->index;
+    Tk_PathItem *itemPtr, *closestPtr;
+    IndexSearch search;
+    double closestDist, newDist, radius;
+    int x1, y1, x2, y2, all;
+
+    radius = halo + (1 << INDEX_CELL_SHIFT);
+    while (1) {
+	if ((fabs(coords[0]) + radius > INDEX_COORD_MAX)
+		|| (fabs(coords[1]) + radius > INDEX_COORD_MAX)) {
+	    return 0;
+	}
+	x1 = (int) (coords[0] - radius);
+	y1 = (int) (coords[1] - radius);
+	x2 = (int) (coords[0] + radius);
+	y2 = (int) (coords[1] + radius);
+	closestPtr = NULL;
+	closestDist = 0.0;
+	itemPtr = IndexSearchFirst(canvasPtr, &search, x1, y1, x2, y2);
+	all = search.all;
+	for (; !all && (itemPtr != NULL);
+		itemPtr = IndexSearchNext(&search, itemPtr)) {
+	    if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
+		    (itemPtr->state == TK_PATHSTATE_NULL &&
+		    canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
+		continue;
+	    }
+	    if ((itemPtr->x1 >= x2) || (itemPtr->x2 <= x1)
+		    || (itemPtr->y1 >= y2) || (itemPtr->y2 <= y1)) {
+		continue;
+	    }
+	    newDist = (*itemPtr->typePtr->pointProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, coords) - halo;
+	    if (newDist < 0.0) {
+		newDist = 0.0;
+	    }
+	    if ((closestPtr == NULL) || (newDist <= closestDist)) {
+		closestPtr = itemPtr;
+		closestDist = newDist;
+	    }
+	}
+	IndexSearchDone(&search);
+	if (all) {
+	    return 0;
+	}
+
+	/*
+	 * Any item as close as the closest one found must overlap the
+	 * square we searched if it's large enough.
+	 */
+
+	if ((closestPtr != NULL) && (closestDist + halo + 2.0 < radius)) {
+	    *closestPtrPtr = closestPtr;
+	    return 1;
+	}
+	if ((x1 < indexPtr->x1) && (y1 < indexPtr->y1)
+		&& (x2 > indexPtr->x2) && (y2 > indexPtr->y2)) {
+	    if (closestPtr == NULL) {
+		return 0;
+	    }
+	    *closestPtrPtr = closestPtr;
+	    return 1;
+	}
+	radius = 2.0 * radius;
+	if ((closestPtr != NULL) && (radius < closestDist + halo + 3.0)) {
+	    radius = closestDist + halo + 3.0;
+	}
+    }
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -5358,6 +7186,7 @@ RelinkItems(
     if (parentPtr->lastChildPtr == prevPtr) {
 	parentPtr->lastChildPtr = lastMovePtr;
     }
+    canvasPtr->index.orderValid = 0;
 
 #ifndef USE_OLD_TAG_SEARCH
     return TCL_OK;
@@ -5693,6 +7522,175 @@ PickCurrentItem(
     }
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * PickItems --
+ *
+ *	This function implements the "pick" widget command. For each
+ *	point in a list it finds the topmost item that is close to it,
+ *	in the same way as the current item is found. The candidate
+ *	items are looked up in the spatial index once for the area
+ *	covering all the points.
+ *
+ * Results:
+ *	A standard Tcl result. The interp's result is a list with the
+ *	id, or the list of tags if -tags is given, of the item picked
+ *	for each point, or an empty element if none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+PickItems(
+    Tcl_Interp *interp,		/* Interpreter for error reporting. */
+    TkPathCanvas *canvasPtr,	/* Canvas whose items are to be searched. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *CONST objv[])	/* Argument objects. */
+{
+    Tk_PathItem *itemPtr, **items;
+    Tk_PathItem *staticItems[INDEX_STATIC_ITEMS];
+    IndexSearch search;
+    Tcl_Obj **coordObjs, *resultObj, *objPtr;
+    double *coords, closeEnough = canvasPtr->closeEnough;
+    double xMin, yMin, xMax, yMax;
+    int tags = 0, numCoords, numItems, space, i, j;
+    int x1, y1, x2, y2;
+    static CONST char *optionStrings[] = {
+	"-tags", NULL
+    };
+
+    if (objc == 4) {
+	if (Tcl_GetIndexFromObj(interp, objv[2], optionStrings, "option",
+		0, &i) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	tags = 1;
+    } else if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 2, objv, "?-tags? xyList");
+	return TCL_ERROR;
+    }
+    if (Tcl_ListObjGetElements(interp, objv[objc-1], &numCoords,
+	    &coordObjs) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (numCoords & 1) {
+	char buf[64 + TCL_INTEGER_SPACE];
+
+	sprintf(buf, "wrong # coordinates: expected an even number, got %d",
+		numCoords);
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(buf, -1));
+	return TCL_ERROR;
+    }
+    if (numCoords == 0) {
+	return TCL_OK;
+    }
+    coords = (double *) ckalloc((unsigned) (numCoords * sizeof(double)));
+    for (i = 0; i < numCoords; i++) {
+	if (Tk_PathCanvasGetCoordFromObj(interp, (Tk_PathCanvas) canvasPtr,
+		coordObjs[i], &coords[i]) != TCL_OK) {
+	    ckfree((char *) coords);
+	    return TCL_ERROR;
+	}
+    }
+
+    /*
+     * Collect, in display order, the items that any of the points can
+     * pick.
+     */
+
+    xMin = xMax = coords[0];
+    yMin = yMax = coords[1];
+    for (i = 2; i < numCoords; i += 2) {
+	xMin = MIN(xMin, coords[i]);
+	xMax = MAX(xMax, coords[i]);
+	yMin = MIN(yMin, coords[i+1]);
+	yMax = MAX(yMax, coords[i+1]);
+    }
+    x1 = (int) (xMin - closeEnough);
+    y1 = (int) (yMin - closeEnough);
+    x2 = (int) (xMax + closeEnough);
+    y2 = (int) (yMax + closeEnough);
+    items = staticItems;
+    space = INDEX_STATIC_ITEMS;
+    numItems = 0;
+    for (itemPtr = IndexSearchFirst(canvasPtr, &search, x1, y1, x2, y2);
+	    itemPtr != NULL; itemPtr = IndexSearchNext(&search, itemPtr)) {
+	if (itemPtr->state == TK_PATHSTATE_HIDDEN || itemPtr->state==TK_PATHSTATE_DISABLED ||
+		(itemPtr->state == TK_PATHSTATE_NULL && (canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN ||
+		canvasPtr->canvas_state == TK_PATHSTATE_DISABLED))) {
+	    continue;
+	}
+	if ((itemPtr->x1 > x2) || (itemPtr->x2 < x1)
+		|| (itemPtr->y1 > y2) || (itemPtr->y2 < y1)) {
+	    continue;
+	}
+	if (numItems == space) {
+	    space *= 2;
+	    if (items == staticItems) {
+		items = (Tk_PathItem **)
+			ckalloc((unsigned) (space * sizeof(Tk_PathItem *)));
+		memcpy(items, staticItems, numItems * sizeof(Tk_PathItem *));
+	    } else {
+		items = (Tk_PathItem **) ckrealloc((char *) items,
+			(unsigned) (space * sizeof(Tk_PathItem *)));
+	    }
+	}
+	items[numItems++] = itemPtr;
+    }
+    IndexSearchDone(&search);
+
+    /*
+     * For each point, the topmost candidate that is close enough, as
+     * in CanvasFindClosest.
+     */
+
+    resultObj = Tcl_NewListObj(0, NULL);
+    for (i = 0; i < numCoords; i += 2) {
+	x1 = (int) (coords[i] - closeEnough);
+	y1 = (int) (coords[i+1] - closeEnough);
+	x2 = (int) (coords[i] + closeEnough);
+	y2 = (int) (coords[i+1] + closeEnough);
+	for (j = numItems-1; j >= 0; j--) {
+	    itemPtr = items[j];
+	    if ((itemPtr->x1 > x2) || (itemPtr->x2 < x1)
+		    || (itemPtr->y1 > y2) || (itemPtr->y2 < y1)) {
+		continue;
+	    }
+	    if ((*itemPtr->typePtr->pointProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, coords+i) <= closeEnough) {
+		break;
+	    }
+	}
+	if (j < 0) {
+	    objPtr = Tcl_NewObj();
+	} else if (tags) {
+	    Tk_PathTags *ptagsPtr = items[j]->pathTagsPtr;
+	    int k;
+
+	    objPtr = Tcl_NewListObj(0, NULL);
+	    if (ptagsPtr != NULL) {
+		for (k = 0; k < ptagsPtr->numTags; k++) {
+		    Tcl_ListObjAppendElement(NULL, objPtr,
+			    Tcl_NewStringObj((char *) ptagsPtr->tagPtr[k], -1));
+		}
+	    }
+	} else {
+	    objPtr = Tcl_NewIntObj(items[j]->id);
+	}
+	Tcl_ListObjAppendElement(NULL, resultObj, objPtr);
+    }
+    if (items != staticItems) {
+	ckfree((char *) items);
+    }
+    ckfree((char *) coords);
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -5720,6 +7718,7 @@ CanvasFindClosest(
 {
     Tk_PathItem *itemPtr;
     Tk_PathItem *bestPtr;
+    IndexSearch search;
     int x1, y1, x2, y2;
 
     x1 = (int) (coords[0] - canvasPtr->closeEnough);
@@ -5728,8 +7727,8 @@ CanvasFindClosest(
     y2 = (int) (coords[1] + canvasPtr->closeEnough);
 
     bestPtr = NULL;
-    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+    for (itemPtr = IndexSearchFirst(canvasPtr, &search, x1, y1, x2, y2);
+	    itemPtr != NULL; itemPtr = IndexSearchNext(&search, itemPtr)) {
 	if (itemPtr->state == TK_PATHSTATE_HIDDEN || itemPtr->state==TK_PATHSTATE_DISABLED ||
 		(itemPtr->state == TK_PATHSTATE_NULL && (canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN ||
 		canvasPtr->canvas_state == TK_PATHSTATE_DISABLED))) {
@@ -5744,6 +7743,7 @@ CanvasFindClosest(
 	    bestPtr = itemPtr;
 	}
     }
+    IndexSearchDone(&search);
     return bestPtr;
 }
 
@@ -5976,10 +7976,7 @@ CanvasFocusProc(
     }
     if (canvasPtr->highlightWidth > 0) {
 	canvasPtr->flags |= REDRAW_BORDERS;
-	if (!(canvasPtr->flags & REDRAW_PENDING)) {
-	    Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
-	    canvasPtr->flags |= REDRAW_PENDING;
-	}
+	CanvasScheduleRedraw(canvasPtr);
     }
 }
 
@@ -6395,6 +8392,12 @@ CanvasSetOrigin(
     if ((xOrigin == canvasPtr->xOrigin) && (yOrigin == canvasPtr->yOrigin)) {
 	return;
     }
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    if (CanvasScrollContents(canvasPtr, xOrigin, yOrigin)) {
+	canvasPtr->flags |= UPDATE_SCROLLBARS;
+	return;
+    }
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
 
     /*
      * Tricky point: must redisplay not only everything that's visible in the
@@ -6417,6 +8420,127 @@ CanvasSetOrigin(
 	    canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
 }
 
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+/*
+ *----------------------------------------------------------------------
+ *
+ * CanvasScrollContents --
+ *
+ *	Moves what is already drawn to where it shall be with the new
+ *	origin, so that only the strips that scroll into view need
+ *	drawing. With a back buffer the contents are moved there and
+ *	copied to the window on the next redisplay, otherwise they are
+ *	moved in the window right away.
+ *
+ * Results:
+ *	1 if the contents were moved and the new origin set, 0 if the
+ *	caller shall redraw everything instead, which is when the canvas
+ *	isn't mapped or the old and new views don't overlap.
+ *
+ * Side effects:
+ *	The origin changes and the uncovered strips are scheduled for
+ *	redraw.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CanvasScrollContents(
+    TkPathCanvas *canvasPtr,	/* Information about canvas. */
+    int xOrigin, int yOrigin)	/* New origin for canvas. */
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    int dx, dy, x1, y1, x2, y2;
+
+    if ((canvasPtr->flags & CANVAS_DELETED) || !Tk_IsMapped(tkwin)) {
+	return 0;
+    }
+
+    /*
+     * The contents move by (dx, dy) on the screen. The area inside the
+     * borders, in window coordinates, is x1 <= x < x2, y1 <= y < y2.
+     */
+
+    dx = canvasPtr->xOrigin - xOrigin;
+    dy = canvasPtr->yOrigin - yOrigin;
+    x1 = canvasPtr->inset;
+    y1 = canvasPtr->inset;
+    x2 = Tk_Width(tkwin) - canvasPtr->inset;
+    y2 = Tk_Height(tkwin) - canvasPtr->inset;
+    if ((abs(dx) >= x2 - x1) || (abs(dy) >= y2 - y1)) {
+	return 0;
+    }
+
+    /*
+     * Items that are redrawn always, like windows, must still be told
+     * that they moved, see CanvasSetOrigin.
+     */
+
+    CanvasAddRedrawBbox(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin,
+	    canvasPtr->xOrigin + Tk_Width(tkwin),
+	    canvasPtr->yOrigin + Tk_Height(tkwin));
+    CanvasAddRedrawBbox(canvasPtr, xOrigin, yOrigin,
+	    xOrigin + Tk_Width(tkwin), yOrigin + Tk_Height(tkwin));
+    canvasPtr->xOrigin = xOrigin;
+    canvasPtr->yOrigin = yOrigin;
+
+    if (canvasPtr->backPixmap != None) {
+	XCopyArea(Tk_Display(tkwin), canvasPtr->backPixmap,
+		canvasPtr->backPixmap, canvasPtr->pixmapGC,
+		MAX(x1, x1 - dx), MAX(y1, y1 - dy),
+		(unsigned int) (x2 - x1 - abs(dx)),
+		(unsigned int) (y2 - y1 - abs(dy)),
+		MAX(x1, x1 + dx), MAX(y1, y1 + dy));
+	CanvasAddExpose(canvasPtr, xOrigin + x1, yOrigin + y1,
+		xOrigin + x2, yOrigin + y2);
+    } else {
+	TkRegion damageRgn = TkCreateRegion();
+	XGCValues gcValues;
+	GC copyGC;
+	XRectangle rect;
+
+	/*
+	 * Parts of the window that are obscured have nothing to copy and
+	 * come back as graphics exposures, which need the GC to ask for
+	 * them.
+	 */
+
+	gcValues.graphics_exposures = True;
+	copyGC = Tk_GetGC(tkwin, GCGraphicsExposures, &gcValues);
+	if (TkScrollWindow(tkwin, copyGC, MAX(x1, x1 - dx), MAX(y1, y1 - dy),
+		x2 - x1 - abs(dx), y2 - y1 - abs(dy), dx, dy, damageRgn)) {
+	    TkClipBox(damageRgn, &rect);
+	    Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
+		    xOrigin + rect.x, yOrigin + rect.y,
+		    xOrigin + rect.x + rect.width,
+		    yOrigin + rect.y + rect.height);
+	}
+	Tk_FreeGC(Tk_Display(tkwin), copyGC);
+	TkDestroyRegion(damageRgn);
+    }
+
+    /*
+     * Redraw the strips that scrolled into view.
+     */
+
+    if (dx > 0) {
+	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
+		xOrigin + x1, yOrigin + y1, xOrigin + x1 + dx, yOrigin + y2);
+    } else if (dx < 0) {
+	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
+		xOrigin + x2 + dx, yOrigin + y1, xOrigin + x2, yOrigin + y2);
+    }
+    if (dy > 0) {
+	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
+		xOrigin + x1, yOrigin + y1, xOrigin + x2, yOrigin + y1 + dy);
+    } else if (dy < 0) {
+	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
+		xOrigin + x1, yOrigin + y2 + dy, xOrigin + x2, yOrigin + y2);
+    }
+    return 1;
+}
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -40,6 +40,46 @@ struct TagSearchExpr_s {
 };
 #endif /* not USE_OLD_TAG_SEARCH */
 
+/*
+ * The area of a canvas that needs to be redrawn is kept as a short list of
+ * rectangles in integer canvas coordinates, so that a few small changes far
+ * apart don't force a redraw of everything in between. Rectangles close to
+ * each other are merged, and once the list is full new damage is merged into
+ * the rectangle that grows the least.
+ */
+
+#define CANVAS_MAX_DAMAGE_RECTS	8
+
+typedef struct TkPathCanvasDamage {
+    int x1, y1;			/* Upper left corner, included. */
+    int x2, y2;			/* Lower right corner, not included. */
+} TkPathCanvasDamage;
+
+/*
+ * Spatial index of the item bounding boxes of a canvas. The canvas plane is
+ * divided into square cells and each item is filed in every cell its bbox
+ * touches, so that display and searches only look at items near the area of
+ * interest. Items spanning very many cells, and items that must always be
+ * redrawn, are kept in a plain list instead. Items whose bbox may have
+ * changed are queued and refiled just before the next search.
+ */
+
+typedef struct TkPathCanvasIndex {
+    Tcl_HashTable cells;	/* Maps a cell position, two ints, to the
+				 * items filed in that cell. */
+    Tk_PathItem **bigItems;	/* Items not filed in cells. */
+    int numBigItems, bigItemsSpace;
+    Tk_PathItem **dirtyItems;	/* Items to refile. Entries of items deleted
+				 * in the meantime are NULL. */
+    int numDirtyItems, dirtyItemsSpace;
+    int numItems;		/* Number of items filed, including big. */
+    int x1, y1, x2, y2;		/* Encloses all items ever filed. */
+    unsigned int stamp;		/* Incremented for each search. */
+    int orderValid;		/* 0 means the zOrder of the items must be
+				 * recomputed before the next search. */
+    int maxZOrder;		/* Largest zOrder handed out so far. */
+} TkPathCanvasIndex;
+
 /*
  * The record below describes a canvas widget. It is made available to the
  * item functions so they can access certain shared fields such as the overall
@@ -98,8 +138,58 @@ typedef struct TkPathCanvas {
     int redrawX2, redrawY2;	/* Lower right corner of area to redraw, in
 				 * integer canvas coordinates. Border pixels
 				 * will *not* be redrawn. */
+    int numDamageRects;		/* Number of valid entries in damageRects. */
+    TkPathCanvasDamage damageRects[CANVAS_MAX_DAMAGE_RECTS];
+				/* The parts of the redraw area above that
+				 * are visible and really need redrawing,
+				 * clipped to the window. Only valid if
+				 * REDRAW_PENDING flag is set. */
+    TkPathCanvasIndex index;	/* Spatial index of all items but groups. */
     int confine;		/* Non-zero means constrain view to keep as
 				 * much of canvas visible as possible. */
+    int renderer;		/* Value of -renderer option: how path items
+				 * are rasterized. See enum below. */
+    TkPathContext imageBuffer;	/* Client side image the path items are
+				 * drawn into when renderer is image. NULL
+				 * until first needed. */
+    int imageBufferWidth, imageBufferHeight;
+				/* Dimensions of imageBuffer. */
+    int threads;		/* Value of -threads option: number of
+				 * threads that rasterize path items into
+				 * imageBuffer. 1 or less means only the
+				 * calling thread. */
+    int backBuffer;		/* Value of -backbuffer option: non-zero
+				 * means that the last rendered frame is
+				 * kept in backPixmap. */
+    Pixmap backPixmap;		/* Window sized copy of what the canvas has
+				 * drawn, used to serve exposes. None until
+				 * first needed and whenever it may be out
+				 * of date, e.g. after a resize or unmap. */
+    Pixmap scratchPixmap;	/* Pixmap the items are drawn into before
+				 * being copied to backPixmap. Kept between
+				 * redisplays if backBuffer is set. */
+    int scratchWidth, scratchHeight;
+				/* Dimensions of scratchPixmap. */
+    int exposeX1, exposeY1;	/* Area, in canvas coordinates, to copy */
+    int exposeX2, exposeY2;	/* from backPixmap to the window. Empty if
+				 * exposeX1 >= exposeX2. Only valid if
+				 * REDRAW_PENDING flag is set. */
+    int redrawDelay;		/* Value of -redrawdelay option: minimum
+				 * number of milliseconds from the start of
+				 * one redisplay to the next. 0 means
+				 * redisplay as soon as the application is
+				 * idle. */
+    Tcl_TimerToken redrawTimer;	/* Timer that schedules the next redisplay
+				 * when it is delayed by redrawDelay. NULL
+				 * otherwise. */
+    Tcl_Time lastRedraw;	/* When the last redisplay started. */
+    double lodThreshold;	/* Value of -lodthreshold option: path items
+				 * whose bounding box fits in a square this
+				 * many pixels wide are not drawn in full.
+				 * 0 means draw all items in full. */
+    XColor *lodColorPtr;	/* Value of -lodcolor option: color of the
+				 * rectangles drawn instead of such items.
+				 * NULL means leave them out. */
 
     /*
      * Information used to manage the selection and insertion cursor:
@@ -154,6 +244,8 @@ typedef struct TkPathCanvas {
 				 * of the previous current item. */
     double closeEnough;		/* The mouse is assumed to be inside an item
 				 * if it is this close to it. */
+    double tolerance;		/* Curves are flattened to within this many
+				 * pixels when hit testing. */
     XEvent pickEvent;		/* The event upon which the current choice of
 				 * currentItem is based. Must be saved so that
 				 * if the currentItem is deleted, can pick
@@ -238,6 +330,9 @@ typedef struct TkPathCanvas {
 				 * This defines the namespace for gradient names. */
     int styleUid;		/* Running integer used to number style tokens. */
     int gradientUid;		/* Running integer used to number gradient tokens. */
+    unsigned int styleEpoch;	/* Incremented whenever a group changes in a
+				 * way that may affect the inherited style of
+				 * its descendants. Never 0. */
     int tagStyle;
     
     /*
@@ -258,8 +353,10 @@ typedef struct TkPathCanvas {
 /*
  * Flag bits for canvases:
  *
- * REDRAW_PENDING -		1 means a DoWhenIdle handler has already been
- *				created to redraw some or all of the canvas.
+ * REDRAW_PENDING -		1 means a DoWhenIdle handler, or a timer
+ *				handler if -redrawdelay is set, has already
+ *				been created to redraw some or all of the
+ *				canvas.
  * REDRAW_BORDERS - 		1 means that the borders need to be redrawn
  *				during the next redisplay operation.
  * REPICK_NEEDED -		1 means DisplayCanvas should pick a new
@@ -282,6 +379,9 @@ typedef struct TkPathCanvas {
  * BBOX_NOT_EMPTY -		1 means that the bounding box of the area that
  *				should be redrawn is not empty.
  * CANVAS_DELETED -
+ * REDRAW_IN_PROGRESS -		1 means DisplayCanvas is currently executing.
+ *				Used so that a forced redraw from an event
+ *				handler doesn't redisplay recursively.
  */
 
 #define REDRAW_PENDING		(1 << 0)
@@ -294,6 +394,23 @@ typedef struct TkPathCanvas {
 #define REPICK_IN_PROGRESS	(1 << 7)
 #define BBOX_NOT_EMPTY		(1 << 8)
 #define CANVAS_DELETED		(1 << 9)
+#define REDRAW_IN_PROGRESS	(1 << 10)
+
+/*
+ * Values for the -renderer option:
+ *
+ * CANVAS_RENDERER_NATIVE -	Items are drawn by the platform backend
+ *				directly into the server side pixmap.
+ * CANVAS_RENDERER_IMAGE -	Path items are drawn into a client side
+ *				image which is sent to the window once per
+ *				redisplay. Falls back to native where the
+ *				backend or visual doesn't support it.
+ */
+
+enum {
+    CANVAS_RENDERER_NATIVE = 0,
+    CANVAS_RENDERER_IMAGE
+};
 
 /*
  * Flag bits for canvas items (redraw_flags):
@@ -320,6 +437,13 @@ typedef struct Tk_PathItemEx  {
     Tcl_Obj *styleObj;	    /* Object with style name. */
     TkPathStyleInst *styleInst;
 			    /* The referenced style instance from styleObj. */
+    Tk_PathStyle inheritedStyle;
+			    /* Cached style cascaded from the root item,
+			     * see TkPathCanvasInheritStyle. */
+    TMatrix inheritedMatrix;/* Storage for inheritedStyle.matrixPtr. */
+    unsigned int inheritedEpoch;
+			    /* inheritedStyle is valid if this equals the
+			     * styleEpoch of the canvas. 0 when invalid. */
 
     /*
      *------------------------------------------------------------------
@@ -349,19 +473,27 @@ MODULE_SCOPE int	    TkPathCanvasGetDepth(Tk_PathItem *itemPtr);
 MODULE_SCOPE Tk_PathStyle   TkPathCanvasInheritStyle(Tk_PathItem *itemPtr, long flags);
 MODULE_SCOPE TMatrix	    TkPathCanvasInheritTMatrix(Tk_PathItem *itemPtr);
 MODULE_SCOPE void	    TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr);
+MODULE_SCOPE void	    TkPathCanvasInheritedStyleChanged(Tk_PathItem *itemPtr);
 MODULE_SCOPE Tcl_HashTable *TkPathCanvasGradientTable(Tk_PathCanvas canvas);
 MODULE_SCOPE Tcl_HashTable *TkPathCanvasStyleTable(Tk_PathCanvas canvas);
 MODULE_SCOPE Tk_PathState   TkPathCanvasState(Tk_PathCanvas canvas);
+MODULE_SCOPE double	    TkPathCanvasTolerance(Tk_PathCanvas canvas);
+MODULE_SCOPE void	    TkPathFreeEdgeCache(void *edgeCache);
 MODULE_SCOPE Tk_PathItem *  TkPathCanvasCurrentItem(Tk_PathCanvas canvas);
 MODULE_SCOPE void	    TkPathCanvasGroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 				int *x1Ptr, int *y1Ptr, int *x2Ptr, int *y2Ptr);
 MODULE_SCOPE void	    TkPathCanvasUpdateGroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr);
 MODULE_SCOPE void	    TkPathCanvasSetGroupDirtyBbox(Tk_PathItem *itemPtr);
+MODULE_SCOPE void	    TkPathCanvasItemBboxChanged(Tk_PathCanvas canvas,
+				Tk_PathItem *itemPtr);
 MODULE_SCOPE Tk_PathItem *  TkPathCanvasItemIteratorNext(Tk_PathItem *itemPtr);
 MODULE_SCOPE Tk_PathItem *  TkPathCanvasItemIteratorPrev(Tk_PathItem *itemPtr);
 MODULE_SCOPE int	    TkPathCanvasItemExConfigure(Tcl_Interp *interp, Tk_PathCanvas canvas, 
 				    Tk_PathItemEx *itemExPtr, int mask);
 MODULE_SCOPE void	    TkPathCanvasItemDetach(Tk_PathItem *itemPtr);
+MODULE_SCOPE void	    TkPathCanvasItemExDisplay(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+				    Display *display, Drawable drawable,
+				    int x, int y, int width, int height);
 	
 MODULE_SCOPE void	    GroupItemConfigured(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int mask);
 MODULE_SCOPE void	    CanvasTranslateGroup(Tk_PathCanvas canvas, 
@@ -396,6 +528,7 @@ MODULE_SCOPE Tk_PathItemType tkPrectType;
 MODULE_SCOPE Tk_PathItemType tkPlineType;
 MODULE_SCOPE Tk_PathItemType tkPolylineType;
 MODULE_SCOPE Tk_PathItemType tkPpolygonType;
+MODULE_SCOPE Tk_PathItemType tkTraceType;
 MODULE_SCOPE Tk_PathItemType tkCircleType;
 MODULE_SCOPE Tk_PathItemType tkEllipseType;
 MODULE_SCOPE Tk_PathItemType tkPimageType;
@@ -554,6 +554,54 @@ TkPathInit(Tk_Window tkwin, Drawable d)
     return (TkPathContext) context;
 }
 
+TkPathContext
+TkPathInitWithSize(Tk_Window tkwin, Drawable d, int width, int height)
+{
+    /* The drawable port knows its own bounds. */
+    return TkPathInit(tkwin, d);
+}
+
+/*
+ * Client side image buffers (-renderer image) are not supported here;
+ * the canvas falls back to the native renderer.
+ */
+
+TkPathContext
+TkPathInitImageBuffer(Tk_Window tkwin, int width, int height)
+{
+    return (TkPathContext) NULL;
+}
+
+void
+TkPathImageBufferFill(TkPathContext ctx, XColor *colorPtr,
+        int x, int y, int width, int height)
+{
+}
+
+void
+TkPathImageBufferPut(TkPathContext ctx, Drawable d, GC gc,
+        int srcX, int srcY, int width, int height, int destX, int destY)
+{
+}
+
+void
+TkPathImageBufferGet(TkPathContext ctx, Drawable d,
+        int x, int y, int width, int height)
+{
+}
+
+TkPathContext
+TkPathInitRecording(TkPathContext ctx, int x, int y, int width, int height)
+{
+    return (TkPathContext) NULL;
+}
+
+void
+TkPathReplayRecording(TkPathContext recording, TkPathContext ctx, 
+        int numThreads)
+{
+}
+
 TkPathContext
 TkPathInitSurface(int width, int height)
 {
@@ -746,7 +794,8 @@ CGInterpolationQuality convertInterpolationToCGInterpolation(int interpolation)
 void
 TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo, 
         double x, double y, double width0, double height0, double fillOpacity,
-        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion)
+        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+        void **customPtr)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
     CGImageRef cgImage;
@@ -950,6 +999,29 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
     }
 }
 
+void
+TkPathImageFree(void *custom)
+{
+    /* The converted image is not cached by this backend. */
+}
+
+int
+TkPathAppendRetainedPath(TkPathContext ctx, Tk_PathStyle *stylePtr, void *custom)
+{
+    /* Paths are not retained by this backend. */
+    return 0;
+}
+
+void
+TkPathRetainPath(TkPathContext ctx, void **customPtr)
+{
+}
+
+void
+TkPathFreeRetainedPath(void *custom)
+{
+}
+
 void
 TkPathClosePath(TkPathContext ctx)
 {
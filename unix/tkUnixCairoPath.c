@@ -18,6 +18,11 @@
 #include <cairo.h>
 #include <cairo-xlib.h>
 #include <tkUnixInt.h>
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
 #include "tkIntPath.h"
 
 #define TINT_INT_CALCULATION
@@ -60,9 +65,17 @@ typedef struct TkPathContext_ {
                                  * 0: not integer width
                                  * 1: odd integer width
                                  * 2: even integer width */
+    Display*		display;	/* Only for image buffers: */
+    XImage*		ximage;		/* the image wrapping the surface data. */
+#ifdef HAVE_XSHM
+    XShmSegmentInfo*	shmInfoPtr;	/* Non NULL if ximage is in shared memory. */
+    int			shmPending;	/* The server may still read from ximage. */
+#endif
+    cairo_rectangle_t	extents;	/* Only for recordings: the area drawn. */
 } TkPathContext_;
 
 static void TkPathPrepareForStroke(TkPathContext ctx, Tk_PathStyle *style);
+static void FreeImageBuffer(TkPathContext_ *context);
 
 void CairoSetFill(TkPathContext ctx, Tk_PathStyle *style)
 {
@@ -91,19 +104,30 @@ void TkPathSetCoordOffsets(double dx, double dy)
 
 TkPathContext TkPathInit(Tk_Window tkwin, Drawable d)
 {
-    //printf("TkPathInit(Tk_Window %p, Drawable %p)...\n", tkwin, d);
-    cairo_t *c;
-    cairo_surface_t *surface;
-    TkPathContext_ *context = (TkPathContext_ *) ckalloc((unsigned) (sizeof(TkPathContext_)));
     Window dummy;
     int x, y;
     unsigned int width, height, borderWidth, depth;
 
-    /* Find size of Drawable */
-    XGetGeometry(Tk_Display(tkwin), d,
-	    &dummy, &x, &y, &width, &height, &borderWidth, &depth);
+    /* 
+     * Find size of Drawable. Avoid the server round trip when we draw
+     * directly in the window since Tk already knows its size.
+     */
+    if (d == Tk_WindowId(tkwin)) {
+	width = Tk_Width(tkwin);
+	height = Tk_Height(tkwin);
+    } else {
+	XGetGeometry(Tk_Display(tkwin), d,
+		&dummy, &x, &y, &width, &height, &borderWidth, &depth);
+    }
+    return TkPathInitWithSize(tkwin, d, (int) width, (int) height);
+}
+
+TkPathContext TkPathInitWithSize(Tk_Window tkwin, Drawable d, int width, int height)
+{
+    cairo_t *c;
+    cairo_surface_t *surface;
+    TkPathContext_ *context = (TkPathContext_ *) ckalloc((unsigned) (sizeof(TkPathContext_)));
 
-    //printf("  geom: %d,%d,%d,%d,%d,%d\n", x, y, width, height, borderWidth, depth);
     surface = cairo_xlib_surface_create(Tk_Display(tkwin), d, Tk_Visual(tkwin),
 	    width, height);
     c = cairo_create(surface);
@@ -111,6 +135,12 @@ TkPathContext TkPathInit(Tk_Window tkwin, Drawable d)
     context->surface = surface;
     context->record = NULL;
     context->widthCode = 0;
+    context->display = NULL;
+    context->ximage = NULL;
+#ifdef HAVE_XSHM
+    context->shmInfoPtr = NULL;
+    context->shmPending = 0;
+#endif
     return (TkPathContext) context;
 }
 
@@ -141,7 +171,496 @@ TkPathContext TkPathInitSurface(int width, int height)
     context->c = c;
     context->surface = surface;
     context->record = record;
+    context->widthCode = 0;
+    context->display = NULL;
+    context->ximage = NULL;
+#ifdef HAVE_XSHM
+    context->shmInfoPtr = NULL;
+    context->shmPending = 0;
+#endif
+    return (TkPathContext) context;
+}
+
+#ifdef HAVE_XSHM
+static int
+ShmErrorProc(ClientData clientData, XErrorEvent *errEventPtr)
+{
+    *((int *) clientData) = 1;
+    return 0;
+}
+
+/*
+ * Creates an XImage in a shared memory segment. Returns NULL if this
+ * fails for any reason, for instance if the display isn't local.
+ */
+
+static XImage *
+CreateShmImage(Tk_Window tkwin, int width, int height, 
+        XShmSegmentInfo **shmInfoPtrPtr)
+{
+    Display *display = Tk_Display(tkwin);
+    XShmSegmentInfo *shmInfoPtr;
+    XImage *ximage;
+    Tk_ErrorHandler handler;
+    int failed = 0;
+
+    if (!XShmQueryExtension(display)) {
+        return NULL;
+    }
+    shmInfoPtr = (XShmSegmentInfo *) ckalloc((unsigned) (sizeof(XShmSegmentInfo)));
+    ximage = XShmCreateImage(display, Tk_Visual(tkwin), Tk_Depth(tkwin),
+            ZPixmap, NULL, shmInfoPtr, width, height);
+    if (ximage == NULL) {
+        ckfree((char *) shmInfoPtr);
+        return NULL;
+    }
+    shmInfoPtr->shmid = shmget(IPC_PRIVATE, ximage->bytes_per_line * height,
+            IPC_CREAT|0600);
+    if (shmInfoPtr->shmid < 0) {
+        XDestroyImage(ximage);
+        ckfree((char *) shmInfoPtr);
+        return NULL;
+    }
+    shmInfoPtr->shmaddr = ximage->data = (char *) shmat(shmInfoPtr->shmid, NULL, 0);
+    shmInfoPtr->readOnly = False;
+    
+    /* Attaching fails for remote displays; trap the error. */
+    handler = Tk_CreateErrorHandler(display, -1, -1, -1, ShmErrorProc, 
+            (ClientData) &failed);
+    XShmAttach(display, shmInfoPtr);
+    XSync(display, False);
+    Tk_DeleteErrorHandler(handler);
+    
+    /* The segment goes away when both we and the server have detached. */
+    shmctl(shmInfoPtr->shmid, IPC_RMID, NULL);
+    if (failed) {
+        shmdt(shmInfoPtr->shmaddr);
+        ximage->data = NULL;
+        XDestroyImage(ximage);
+        ckfree((char *) shmInfoPtr);
+        return NULL;
+    }
+    *shmInfoPtrPtr = shmInfoPtr;
+    return ximage;
+}
+
+/*
+ * The server reads a shared memory image asynchronously. Must wait
+ * until it is done before the client changes the pixels again.
+ */
+
+static void
+ShmWaitForServer(TkPathContext_ *context)
+{
+    if (context->shmPending) {
+        XSync(context->display, False);
+        context->shmPending = 0;
+    }
+}
+#endif
+
+/*
+ * Image buffers are client side surfaces which are used by the canvas
+ * for '-renderer image'. The cairo surface shares its pixels with an
+ * XImage which is sent to the server in one go, instead of letting the
+ * server do all rasterization through XRender. We use CAIRO_FORMAT_RGB24
+ * which has the same memory layout as 24 bit TrueColor visuals, and
+ * which doesn't care about the alpha byte of pixels read back from the
+ * server. Other visuals are not supported and we return NULL.
+ */
+
+TkPathContext TkPathInitImageBuffer(Tk_Window tkwin, int width, int height)
+{
+    Display *display = Tk_Display(tkwin);
+    Visual *visual = Tk_Visual(tkwin);
+    TkPathContext_ *context;
+    XImage *ximage = NULL;
+#ifdef HAVE_XSHM
+    XShmSegmentInfo *shmInfoPtr = NULL;
+#endif
+    int one = 1;
+    int byteOrder = (*((char *) &one) == 1) ? LSBFirst : MSBFirst;
+
+    if (((Tk_Depth(tkwin) != 24) && (Tk_Depth(tkwin) != 32))
+            || (visual->red_mask != 0xFF0000)
+            || (visual->green_mask != 0xFF00)
+            || (visual->blue_mask != 0xFF)) {
+        return (TkPathContext) NULL;
+    }
+    
+#ifdef HAVE_XSHM
+    /* Shared memory images are never byte swapped by Xlib. */
+    if (ImageByteOrder(display) == byteOrder) {
+        ximage = CreateShmImage(tkwin, width, height, &shmInfoPtr);
+    }
+#endif
+    if (ximage == NULL) {
+        ximage = XCreateImage(display, visual, Tk_Depth(tkwin), ZPixmap, 0, 
+                NULL, width, height, 32, 0);
+        if (ximage == NULL) {
+            return (TkPathContext) NULL;
+        }
+        ximage->data = ckalloc(ximage->bytes_per_line * height);
+        
+        /* Xlib swaps bytes for us if the server has the other order. */
+        ximage->byte_order = byteOrder;
+    }
+    context = (TkPathContext_ *) ckalloc((unsigned) (sizeof(TkPathContext_)));
+    context->display = display;
+    context->ximage = ximage;
+#ifdef HAVE_XSHM
+    context->shmInfoPtr = shmInfoPtr;
+    context->shmPending = 0;
+#endif
+    if (ximage->bits_per_pixel != 32) {
+        FreeImageBuffer(context);
+        ckfree((char *) context);
+        return (TkPathContext) NULL;
+    }
+    context->surface = cairo_image_surface_create_for_data(
+            (unsigned char *) ximage->data, CAIRO_FORMAT_RGB24, 
+            width, height, ximage->bytes_per_line);
+    context->c = cairo_create(context->surface);
+    context->record = NULL;
+    context->widthCode = 0;
+    return (TkPathContext) context;
+}
+
+void
+TkPathImageBufferFill(TkPathContext ctx, XColor *colorPtr,
+        int x, int y, int width, int height)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+#ifdef HAVE_XSHM
+    ShmWaitForServer(context);
+#endif
+    cairo_save(context->c);
+    cairo_set_operator(context->c, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_rgb(context->c,
+            (double) colorPtr->red / 0xFFFF,
+            (double) colorPtr->green / 0xFFFF,
+            (double) colorPtr->blue / 0xFFFF);
+    cairo_rectangle(context->c, x, y, width, height);
+    cairo_fill(context->c);
+    cairo_restore(context->c);
+}
+
+void
+TkPathImageBufferPut(TkPathContext ctx, Drawable d, GC gc,
+        int srcX, int srcY, int width, int height, int destX, int destY)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    cairo_surface_flush(context->surface);
+#ifdef HAVE_XSHM
+    if (context->shmInfoPtr != NULL) {
+        XShmPutImage(context->display, d, gc, context->ximage, 
+                srcX, srcY, destX, destY, width, height, False);
+        context->shmPending = 1;
+        return;
+    }
+#endif
+    XPutImage(context->display, d, gc, context->ximage, 
+            srcX, srcY, destX, destY, width, height);
+}
+
+void
+TkPathImageBufferGet(TkPathContext ctx, Drawable d,
+        int x, int y, int width, int height)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    /* This is a round trip which also takes care of any pending put. */
+    cairo_surface_flush(context->surface);
+    XGetSubImage(context->display, d, x, y, width, height, AllPlanes, 
+            ZPixmap, context->ximage, x, y);
+#ifdef HAVE_XSHM
+    context->shmPending = 0;
+#endif
+    cairo_surface_mark_dirty_rectangle(context->surface, x, y, width, height);
+}
+
+static void
+FreeImageBuffer(TkPathContext_ *context)
+{
+    XImage *ximage = context->ximage;
+
+#ifdef HAVE_XSHM
+    if (context->shmInfoPtr != NULL) {
+        XShmDetach(context->display, context->shmInfoPtr);
+        shmdt(context->shmInfoPtr->shmaddr);
+        ckfree((char *) context->shmInfoPtr);
+    } else {
+        ckfree(ximage->data);
+    }
+#else
+    ckfree(ximage->data);
+#endif
+    ximage->data = NULL;
+    XDestroyImage(ximage);
+}
+
+/*
+ * Recordings let the path items of an image buffer be rasterized by
+ * several threads. The items draw into a recording surface on the
+ * calling thread, so that all Tk and style lookups stay there, and
+ * the recording, which is then an immutable snapshot of geometry and
+ * resolved styles, is replayed onto tiles of the image buffer. Each
+ * tile gets its own surface on its part of the pixels, so threads
+ * never share a cairo context or target surface. Recording surfaces
+ * appeared in cairo 1.10.
+ *
+ * The worker threads are started when first needed and then kept
+ * waiting for the next job, since starting threads for every redisplay
+ * would cost much of what they gain. There is one job at a time in the
+ * process. A replay that finds the workers busy with the job of
+ * another thread draws all its tiles itself.
+ */
+
+#define kPathTileSize 128
+#define kPathMaxThreads 64
+
+typedef struct PathTileJob {
+    cairo_surface_t *recording;	/* What to draw. */
+    unsigned char *data;	/* The pixels of the image buffer. */
+    int stride;			/* Bytes per row of data. */
+    cairo_format_t format;
+    int x, y, width, height;	/* Area of the image buffer to draw. */
+    int numTilesX, numTiles;
+    int nextTile;		/* The next tile that no thread has taken. */
+} PathTileJob;
+
+#ifdef TCL_THREADS
+typedef struct PathTilePool {
+    PathTileJob *jobPtr;	/* The job being drawn, or NULL. */
+    unsigned long jobNumber;	/* Counts jobs so that a worker joins
+				 * each one at most once. */
+    int numWanted;		/* Number of workers that shall join
+				 * jobPtr. */
+    int numJoined;		/* Number of workers that have joined it. */
+    int numBusy;		/* Number of those still drawing it. */
+    int numThreads;		/* Number of workers started. */
+    int shutdown;		/* Set on exit to make the workers quit. */
+    Tcl_Condition jobReady;	/* Workers wait here for a job. */
+    Tcl_Condition jobDone;	/* Replay waits here for the workers to
+				 * finish, and exit for them to quit. */
+} PathTilePool;
+
+/* Everything in tilePool and the job in it is protected by this. */
+TCL_DECLARE_MUTEX(tilePoolMutex)
+static PathTilePool tilePool;
+#endif
+
+TkPathContext
+TkPathInitRecording(TkPathContext ctx, int x, int y, int width, int height)
+{
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+    TkPathContext_ *context;
+    cairo_rectangle_t extents;
+
+    if (((TkPathContext_ *) ctx)->ximage == NULL) {
+        return (TkPathContext) NULL;
+    }
+    extents.x = x;
+    extents.y = y;
+    extents.width = width;
+    extents.height = height;
+    context = (TkPathContext_ *) ckalloc((unsigned) (sizeof(TkPathContext_)));
+    context->surface = cairo_recording_surface_create(
+            CAIRO_CONTENT_COLOR_ALPHA, &extents);
+    context->extents = extents;
+    context->c = cairo_create(context->surface);
+    context->record = NULL;
+    context->widthCode = 0;
+    context->display = NULL;
+    context->ximage = NULL;
+#ifdef HAVE_XSHM
+    context->shmInfoPtr = NULL;
+    context->shmPending = 0;
+#endif
     return (TkPathContext) context;
+#else
+    return (TkPathContext) NULL;
+#endif
+}
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+static void
+DrawTile(PathTileJob *jobPtr, int tile)
+{
+    cairo_surface_t *surface;
+    cairo_t *c;
+    int x, y, width, height;
+
+    x = jobPtr->x + (tile % jobPtr->numTilesX) * kPathTileSize;
+    y = jobPtr->y + (tile / jobPtr->numTilesX) * kPathTileSize;
+    width = MIN(kPathTileSize, jobPtr->x + jobPtr->width - x);
+    height = MIN(kPathTileSize, jobPtr->y + jobPtr->height - y);
+    surface = cairo_image_surface_create_for_data(
+            jobPtr->data + y * jobPtr->stride + 4 * x, jobPtr->format,
+            width, height, jobPtr->stride);
+    c = cairo_create(surface);
+    cairo_set_source_surface(c, jobPtr->recording, -x, -y);
+    cairo_paint(c);
+    cairo_destroy(c);
+    cairo_surface_finish(surface);
+    cairo_surface_destroy(surface);
+}
+
+static int
+TakeTile(PathTileJob *jobPtr)
+{
+    int tile;
+
+    Tcl_MutexLock(&tilePoolMutex);
+    tile = jobPtr->nextTile++;
+    Tcl_MutexUnlock(&tilePoolMutex);
+    return (tile < jobPtr->numTiles) ? tile : -1;
+}
+
+#ifdef TCL_THREADS
+static Tcl_ThreadCreateType
+TileThreadProc(ClientData clientData)
+{
+    PathTileJob *jobPtr;
+    unsigned long lastJob = 0;
+    int tile;
+
+    Tcl_MutexLock(&tilePoolMutex);
+    while (1) {
+        while (!tilePool.shutdown && ((tilePool.jobPtr == NULL)
+                || (tilePool.jobNumber == lastJob)
+                || (tilePool.numJoined >= tilePool.numWanted))) {
+            Tcl_ConditionWait(&tilePool.jobReady, &tilePoolMutex, NULL);
+        }
+        if (tilePool.shutdown) {
+            break;
+        }
+        jobPtr = tilePool.jobPtr;
+        lastJob = tilePool.jobNumber;
+        tilePool.numJoined++;
+        tilePool.numBusy++;
+        Tcl_MutexUnlock(&tilePoolMutex);
+        while ((tile = TakeTile(jobPtr)) >= 0) {
+            DrawTile(jobPtr, tile);
+        }
+        Tcl_MutexLock(&tilePoolMutex);
+        if (--tilePool.numBusy == 0) {
+            Tcl_ConditionNotify(&tilePool.jobDone);
+        }
+    }
+    tilePool.numThreads--;
+    Tcl_ConditionNotify(&tilePool.jobDone);
+    Tcl_MutexUnlock(&tilePoolMutex);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ * Makes the workers quit before Tcl finalizes the mutex and conditions
+ * they wait on.
+ */
+
+static void
+TilePoolExitProc(ClientData clientData)
+{
+    Tcl_MutexLock(&tilePoolMutex);
+    tilePool.shutdown = 1;
+    Tcl_ConditionNotify(&tilePool.jobReady);
+    while (tilePool.numThreads > 0) {
+        Tcl_ConditionWait(&tilePool.jobDone, &tilePoolMutex, NULL);
+    }
+    Tcl_MutexUnlock(&tilePoolMutex);
+}
+#endif /* TCL_THREADS */
+#endif
+
+void
+TkPathReplayRecording(TkPathContext recording, TkPathContext ctx, 
+        int numThreads)
+{
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+    TkPathContext_ *recContext = (TkPathContext_ *) recording;
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    PathTileJob job;
+    int tile;
+#ifdef TCL_THREADS
+    int shared = 0;
+#endif
+
+    cairo_destroy(recContext->c);
+    recContext->c = NULL;
+    job.x = MAX(0, (int) recContext->extents.x);
+    job.y = MAX(0, (int) recContext->extents.y);
+    job.width = MIN(cairo_image_surface_get_width(context->surface), 
+            (int) (recContext->extents.x + recContext->extents.width)) - job.x;
+    job.height = MIN(cairo_image_surface_get_height(context->surface), 
+            (int) (recContext->extents.y + recContext->extents.height)) - job.y;
+    if ((job.width > 0) && (job.height > 0)) {
+        cairo_surface_flush(context->surface);
+        job.recording = recContext->surface;
+        job.data = cairo_image_surface_get_data(context->surface);
+        job.stride = cairo_image_surface_get_stride(context->surface);
+        job.format = cairo_image_surface_get_format(context->surface);
+        job.numTilesX = (job.width + kPathTileSize - 1) / kPathTileSize;
+        job.numTiles = job.numTilesX 
+                * ((job.height + kPathTileSize - 1) / kPathTileSize);
+        job.nextTile = 1;
+        
+        /*
+         * The first tile is drawn here before any worker sees the job
+         * so that state which cairo builds lazily on the recording
+         * exists before it is shared.
+         */
+        DrawTile(&job, 0);
+        numThreads = MIN(numThreads, kPathMaxThreads);
+        numThreads = MIN(numThreads, job.numTiles - 1);
+#ifdef TCL_THREADS
+        if (numThreads > 1) {
+            Tcl_ThreadId thread;
+
+            Tcl_MutexLock(&tilePoolMutex);
+            if ((tilePool.jobPtr == NULL) && !tilePool.shutdown) {
+                while (tilePool.numThreads < numThreads - 1) {
+                    if (Tcl_CreateThread(&thread, TileThreadProc, NULL,
+                            TCL_THREAD_STACK_DEFAULT, 
+                            TCL_THREAD_NOFLAGS) != TCL_OK) {
+                        /* Make do with those we have. */
+                        break;
+                    }
+                    if (tilePool.numThreads++ == 0) {
+                        Tcl_CreateExitHandler(TilePoolExitProc, NULL);
+                    }
+                }
+                tilePool.jobPtr = &job;
+                tilePool.jobNumber++;
+                tilePool.numWanted = numThreads - 1;
+                tilePool.numJoined = 0;
+                Tcl_ConditionNotify(&tilePool.jobReady);
+                shared = 1;
+            }
+            Tcl_MutexUnlock(&tilePoolMutex);
+        }
+#endif
+        while ((tile = TakeTile(&job)) >= 0) {
+            DrawTile(&job, tile);
+        }
+#ifdef TCL_THREADS
+        if (shared) {
+            /* No worker may join once the job is taken away. */
+            Tcl_MutexLock(&tilePoolMutex);
+            tilePool.jobPtr = NULL;
+            while (tilePool.numBusy > 0) {
+                Tcl_ConditionWait(&tilePool.jobDone, &tilePoolMutex, NULL);
+            }
+            Tcl_MutexUnlock(&tilePoolMutex);
+        }
+#endif
+        cairo_surface_mark_dirty_rectangle(context->surface, 
+                job.x, job.y, job.width, job.height);
+    }
+#endif
+    TkPathFree(recording);
 }
 
 void TkPathPushTMatrix(TkPathContext ctx, TMatrix *m)
@@ -292,13 +811,39 @@ cairo_filter_t convertInterpolationToCairoFilter(int interpolation)
     }
 }
 
-void
-TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
-        double x, double y, double width0, double height0, double fillOpacity,
-        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion)
+/*
+ * A converted photo cached per item, see TkPathImage. The surface owns
+ * its pixel data through imageDataKey. The key is the photo and the tint
+ * used in the conversion. The photo itself is not checked for changes;
+ * the owner must call TkPathImageFree when the image changes.
+ */
+
+typedef struct PathImageCache {
+    Tk_PhotoHandle photo;
+    int hasTint;
+    unsigned short tintRed, tintGreen, tintBlue;
+    double tintAmount;
+    cairo_surface_t *surface;
+} PathImageCache;
+
+static cairo_user_data_key_t imageDataKey;
+
+static void
+FreeImageData(void *data)
+{
+    ckfree((char *) data);
+}
+
+/*
+ * Converts the pixels of a photo to a premultiplied cairo image surface,
+ * tinted if tintColor is not NULL and tintAmount is positive.
+ * Returns NULL if the pixel format is not supported.
+ */
+
+static cairo_surface_t *
+ConvertPhotoToSurface(Tk_PhotoImageBlock *blockPtr, XColor *tintColor, 
+        double tintAmount)
 {
-    TkPathContext_ *context = (TkPathContext_ *) ctx;
-    Tk_PhotoImageBlock block;
     cairo_surface_t *surface;
     cairo_format_t format;
     unsigned char *data = NULL;
@@ -309,16 +854,10 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
     int pitch;
     int iwidth, iheight;
     int i, j;
-    double width, height;
-    cairo_filter_t filter;
 
-    /* Return value? */
-    Tk_PhotoGetImage(photo, &block);
-    iwidth = block.width;
-    iheight = block.height;
-    pitch = block.pitch;
-    width = (width0 == 0.0) ? (double) iwidth : width0;
-    height = (height0 == 0.0) ? (double) iheight : height0;
+    iwidth = blockPtr->width;
+    iheight = blockPtr->height;
+    pitch = blockPtr->pitch;
 
     /*
      * @format: the format of pixels in the buffer
@@ -338,7 +877,7 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
      *   alpha is used. (That is, 50% transparent red is 0x80800000,
      *   not 0x80ff0000.)
      */
-    if (block.pixelSize == 4) {
+    if (blockPtr->pixelSize == 4) {
         format = CAIRO_FORMAT_ARGB32;
         
         /* The offset array contains the offsets from the address of a 
@@ -348,10 +887,10 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
          * We need to copy pixel data from the source using the photo offsets
          * to cairos ARGB format which is in *native* endian order; Switch!
          */
-        srcR = block.offset[0];
-        srcG = block.offset[1]; 
-        srcB = block.offset[2];
-        srcA = block.offset[3];
+        srcR = blockPtr->offset[0];
+        srcG = blockPtr->offset[1]; 
+        srcB = blockPtr->offset[2];
+        srcA = blockPtr->offset[3];
         dstR = 1;
         dstG = 2;
         dstB = 3;
@@ -376,7 +915,7 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
             tintB = Blue255FromXColorPtr(tintColor);
 
             for (i = 0; i < iheight; i++) {
-                srcPtr = block.pixelPtr + i*pitch;
+                srcPtr = blockPtr->pixelPtr + i*pitch;
                 dstPtr = ptr + i*pitch;
                 for (j = 0; j < iwidth; j++) {
                     // extract
@@ -421,7 +960,7 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
             tintB = BlueDoubleFromXColorPtr(tintColor);
 
             for (i = 0; i < iheight; i++) {
-                srcPtr = block.pixelPtr + i*pitch;
+                srcPtr = blockPtr->pixelPtr + i*pitch;
                 dstPtr = ptr + i*pitch;
                 for (j = 0; j < iwidth; j++) {
                     // extract
@@ -460,7 +999,7 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 #endif
         } else {
             for (i = 0; i < iheight; i++) {
-                srcPtr = block.pixelPtr + i*pitch;
+                srcPtr = blockPtr->pixelPtr + i*pitch;
                 dstPtr = ptr + i*pitch;
                 for (j = 0; j < iwidth; j++) {
                     unsigned int alpha = *(srcPtr+srcA);
@@ -480,19 +1019,103 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
                 }
             }
         }
-    } else if (block.pixelSize == 3) {
+    } else if (blockPtr->pixelSize == 3) {
         /* Could do something about this? */
         fprintf(stderr, "TkPathImage: unaccepted pixel format: 1 pixel is 3 bytes\n");
-        return;
+        return NULL;
     } else {
-        fprintf(stderr, "TkPathImage: unaccepted pixel format: 1 pixel is %d bytes\n", block.pixelSize);
-        return;
+        fprintf(stderr, "TkPathImage: unaccepted pixel format: 1 pixel is %d bytes\n", blockPtr->pixelSize);
+        return NULL;
     }
     surface = cairo_image_surface_create_for_data(
             ptr,
             format, 
             (int) iwidth, (int) iheight,
             pitch);		/* stride */
+    cairo_surface_set_user_data(surface, &imageDataKey, data, FreeImageData);
+    return surface;
+}
+
+void
+TkPathImageFree(void *custom)
+{
+    PathImageCache *cachePtr = (PathImageCache *) custom;
+
+    if (cachePtr != NULL) {
+        if (cachePtr->surface != NULL) {
+            cairo_surface_destroy(cachePtr->surface);
+        }
+        ckfree((char *) cachePtr);
+    }
+}
+
+void
+TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
+        double x, double y, double width0, double height0, double fillOpacity,
+        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+        void **customPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    Tk_PhotoImageBlock block;
+    PathImageCache *cachePtr = NULL;
+    cairo_surface_t *surface = NULL;
+    int hasTint;
+    int iwidth, iheight;
+    double width, height;
+    cairo_filter_t filter;
+
+    /* Return value? */
+    Tk_PhotoGetImage(photo, &block);
+    iwidth = block.width;
+    iheight = block.height;
+    width = (width0 == 0.0) ? (double) iwidth : width0;
+    height = (height0 == 0.0) ? (double) iheight : height0;
+    hasTint = (tintColor && tintAmount > 0.0);
+
+    /*
+     * Reuse the surface converted on a previous call if the photo
+     * and tint are unchanged.
+     */
+    if (customPtr != NULL) {
+        cachePtr = (PathImageCache *) *customPtr;
+        if (cachePtr == NULL) {
+            cachePtr = (PathImageCache *) ckalloc(sizeof(PathImageCache));
+            cachePtr->surface = NULL;
+            *customPtr = (void *) cachePtr;
+        }
+        if ((cachePtr->surface != NULL)
+                && (cachePtr->photo == photo)
+                && (cachePtr->hasTint == hasTint)
+                && (!hasTint 
+                    || ((cachePtr->tintAmount == tintAmount)
+                    && (cachePtr->tintRed == tintColor->red)
+                    && (cachePtr->tintGreen == tintColor->green)
+                    && (cachePtr->tintBlue == tintColor->blue)))
+                && (cairo_image_surface_get_width(cachePtr->surface) == iwidth)
+                && (cairo_image_surface_get_height(cachePtr->surface) == iheight)) {
+            surface = cairo_surface_reference(cachePtr->surface);
+        }
+    }
+    if (surface == NULL) {
+        surface = ConvertPhotoToSurface(&block, tintColor, tintAmount);
+        if (surface == NULL) {
+            return;
+        }
+        if (cachePtr != NULL) {
+            if (cachePtr->surface != NULL) {
+                cairo_surface_destroy(cachePtr->surface);
+            }
+            cachePtr->photo = photo;
+            cachePtr->hasTint = hasTint;
+            cachePtr->tintAmount = tintAmount;
+            if (hasTint) {
+                cachePtr->tintRed = tintColor->red;
+                cachePtr->tintGreen = tintColor->green;
+                cachePtr->tintBlue = tintColor->blue;
+            }
+            cachePtr->surface = cairo_surface_reference(surface);
+        }
+    }
 
     filter = convertInterpolationToCairoFilter(interpolation);
     if (width == (double)iwidth && height == (double)iheight && !srcRegion) {
@@ -536,11 +1159,8 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
         cairo_pattern_set_filter(cairo_get_source(context->c), filter);
         cairo_paint_with_alpha(context->c, fillOpacity);
         cairo_restore(context->c);
-        cairo_surface_destroy(surface);
-    }
-    if (data) {
-        ckfree((char *)data);
     }
+    cairo_surface_destroy(surface);
 }
 
 void TkPathClosePath(TkPathContext ctx)
@@ -859,15 +1479,78 @@ void TkPathEndPath(TkPathContext ctx)
     /* Empty ??? */
 }
 
+/*
+ * A path retained between redraws. Since the depixelized coordinates
+ * depend on the stroke width the path is only valid for the same
+ * depixelize setting and width code as when it was made.
+ */
+
+typedef struct PathRetainedCairo {
+    cairo_path_t *path;
+    int depixelize;
+    int widthCode;
+} PathRetainedCairo;
+
+int
+TkPathAppendRetainedPath(TkPathContext ctx, Tk_PathStyle *stylePtr, void *custom)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    PathRetainedCairo *retainedPtr = (PathRetainedCairo *) custom;
+
+    TkPathBeginPath(ctx, stylePtr);
+    if ((retainedPtr->depixelize != gDepixelize) 
+            || (gDepixelize && (retainedPtr->widthCode != context->widthCode))) {
+        return 0;
+    }
+    cairo_append_path(context->c, retainedPtr->path);
+    return 1;
+}
+
+void
+TkPathRetainPath(TkPathContext ctx, void **customPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    PathRetainedCairo *retainedPtr;
+    cairo_path_t *path;
+
+    path = cairo_copy_path(context->c);
+    if (path->status != CAIRO_STATUS_SUCCESS) {
+        cairo_path_destroy(path);
+        return;
+    }
+    TkPathFreeRetainedPath(*customPtr);
+    retainedPtr = (PathRetainedCairo *) ckalloc(sizeof(PathRetainedCairo));
+    retainedPtr->path = path;
+    retainedPtr->depixelize = gDepixelize;
+    retainedPtr->widthCode = context->widthCode;
+    *customPtr = (void *) retainedPtr;
+}
+
+void
+TkPathFreeRetainedPath(void *custom)
+{
+    PathRetainedCairo *retainedPtr = (PathRetainedCairo *) custom;
+
+    if (retainedPtr != NULL) {
+        cairo_path_destroy(retainedPtr->path);
+        ckfree((char *) retainedPtr);
+    }
+}
+
 void TkPathFree(TkPathContext ctx)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
-    cairo_destroy(context->c);
+    if (context->c != NULL) {
+        cairo_destroy(context->c);
+    }
     cairo_surface_destroy(context->surface);
     if (context->record) {
         ckfree((char *) context->record->data);
         ckfree((char *) context->record);
     }
+    if (context->ximage) {
+        FreeImageBuffer(context);
+    }
     ckfree((char *) context);
 }
 
@@ -823,6 +823,48 @@ TkPathContext TkPathInit(Tk_Window tkwin, Drawable d)
     return (TkPathContext) context;
 }
 
+TkPathContext TkPathInitWithSize(Tk_Window tkwin, Drawable d, int width, int height)
+{
+    /* The bitmap selected into the DC knows its own size. */
+    return TkPathInit(tkwin, d);
+}
+
+/*
+ * Client side image buffers (-renderer image) are not supported here;
+ * the canvas falls back to the native renderer.
+ */
+
+TkPathContext TkPathInitImageBuffer(Tk_Window tkwin, int width, int height)
+{
+    return (TkPathContext) NULL;
+}
+
+void TkPathImageBufferFill(TkPathContext ctx, XColor *colorPtr,
+        int x, int y, int width, int height)
+{
+}
+
+void TkPathImageBufferPut(TkPathContext ctx, Drawable d, GC gc,
+        int srcX, int srcY, int width, int height, int destX, int destY)
+{
+}
+
+void TkPathImageBufferGet(TkPathContext ctx, Drawable d,
+        int x, int y, int width, int height)
+{
+}
+
+TkPathContext TkPathInitRecording(TkPathContext ctx, 
+        int x, int y, int width, int height)
+{
+    return (TkPathContext) NULL;
+}
+
+void TkPathReplayRecording(TkPathContext recording, TkPathContext ctx, 
+        int numThreads)
+{
+}
+
 TkPathContext TkPathInitSurface(int width, int height)
 {
     TkPathContext_ *context = reinterpret_cast<TkPathContext_ *> (ckalloc((unsigned) (sizeof(TkPathContext_))));
@@ -966,12 +1008,36 @@ TkPathOval(TkPathContext ctx, double cx, double cy, double rx, double ry)
 void
 TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
         double x, double y, double width, double height, double fillOpacity,
-        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion)
+        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+        void **customPtr)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
     context->c->DrawImage(photo, (float) x, (float) y, (float) width, (float) height, fillOpacity, tintColor, tintAmount, interpolation, srcRegion);
 }
 
+void
+TkPathImageFree(void *custom)
+{
+    /* The converted image is not cached by this backend. */
+}
+
+int
+TkPathAppendRetainedPath(TkPathContext ctx, Tk_PathStyle *stylePtr, void *custom)
+{
+    /* Paths are not retained by this backend. */
+    return 0;
+}
+
+void
+TkPathRetainPath(TkPathContext ctx, void **customPtr)
+{
+}
+
+void
+TkPathFreeRetainedPath(void *custom)
+{
+}
+
 void
 TkPathClosePath(TkPathContext ctx)
 {